@@ -0,0 +1,113 @@
+#ifndef BOOT_CFG_H
+#define BOOT_CFG_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * This Node
+ *
+ *  One bootloader source, built once per ECU:
+ *      xc8-cc -mcpu=18F4580 -mrom=0-7FF -DBOOT_NODE_ID=<n> -I../HAL *.c
+ *  (../HAL only for can_timing.h; BOOT/ is searched first)
+ *  The boot block must be write protected in the
+ *  configuration words (BBSIZ = 1K words, WRTB = ON) so
+ *  neither the bootloader nor a runaway application can
+ *  erase it. Applications are linked above it with
+ *      -mcodeoffset=0x800
+ *---------------------------------------------------------*/
+#ifndef BOOT_NODE_ID
+#error "BOOT_NODE_ID (1..3) must be defined for the target ECU"
+#endif
+
+#define BOOT_VERSION                0x01
+
+/*---------------------------------------------------------
+ * Program Memory Map (PIC18F4580, DS39637)
+ *---------------------------------------------------------*/
+#define BOOT_APP_BASE               0x0800  /* Application reset vector */
+#define BOOT_FLASH_END              0x8000UL
+
+#define FLASH_ERASE_ROW             64U     /* Bytes per row erase */
+#define FLASH_WRITE_GROUP           8U      /* Holding registers per write */
+
+/*---------------------------------------------------------
+ * Data EEPROM Flags (top of the 256-byte EEPROM)
+ *
+ *  APP_VALID : BOOT_APP_VALID once VERIFY has passed over a
+ *              complete image; cleared before the first erase
+ *              of an update, so a reset or power loss mid-way
+ *              leaves the node in the bootloader.
+ *  REQUEST   : BOOT_REQUEST written by the application when it
+ *              receives BOOT_CMD_ENTER; consumed at reset.
+ *---------------------------------------------------------*/
+#define BOOT_EE_APP_VALID           0xFE
+#define BOOT_EE_REQUEST             0xFF
+
+#define BOOT_APP_VALID              0xA5
+#define BOOT_REQUEST                0x5A
+
+/*---------------------------------------------------------
+ * CAN Identifiers (base + node ID)
+ *---------------------------------------------------------*/
+#define BOOT_CMD_ID                 (0x6C0 + BOOT_NODE_ID)  /* Host -> node, commands */
+#define BOOT_DATA_ID                (0x6D0 + BOOT_NODE_ID)  /* Host -> node, 8 image bytes */
+#define BOOT_RESP_ID                (0x6E0 + BOOT_NODE_ID)  /* Node -> host */
+
+/*---------------------------------------------------------
+ * Block Streaming
+ *
+ *  A BLOCK command announces up to BOOT_BLOCK_FRAMES data
+ *  frames (8 bytes each, no per-frame reply) for whole
+ *  erase rows starting at a row-aligned address. The node
+ *  checks the block CRC, erases and writes the rows, reads
+ *  them back and answers once per block.
+ *---------------------------------------------------------*/
+#define BOOT_BLOCK_SIZE             256U
+#define BOOT_BLOCK_FRAMES           (BOOT_BLOCK_SIZE / 8U)
+
+#if (BOOT_BLOCK_SIZE % FLASH_ERASE_ROW) != 0
+#error "BOOT_BLOCK_SIZE must be a whole number of erase rows"
+#endif
+
+/*---------------------------------------------------------
+ * Commands (byte 0 of a BOOT_CMD_ID frame)
+ *
+ *  ENTER   : 01 'B' 'O' 'O' 'T'         (application or boot)
+ *  CONNECT : 02
+ *  BLOCK   : 03 addr[3] frames crc[2]   (little endian)
+ *  VERIFY  : 04 end[3] crc[2]           (CRC over APP_BASE..end)
+ *  RESET   : 05
+ *
+ * Responses (BOOT_RESP_ID): command, status, details
+ *
+ *  INFO    : 02 00 version node app_base_hi flash_end_hi
+ *               block_frames erase_row
+ *  BLOCK   : 03 status addr[3]
+ *  VERIFY  : 04 status crc[2]
+ *  RESET   : 05 status
+ *---------------------------------------------------------*/
+#define BOOT_CMD_ENTER              0x01
+#define BOOT_CMD_CONNECT            0x02
+#define BOOT_CMD_BLOCK              0x03
+#define BOOT_CMD_VERIFY             0x04
+#define BOOT_CMD_RESET              0x05
+
+typedef enum
+{
+    e_boot_ok = 0,
+    e_boot_err_range,               /* Address / length outside the app region */
+    e_boot_err_crc,                 /* Block CRC does not match the data */
+    e_boot_err_timeout,             /* Data frames stopped mid-block */
+    e_boot_err_verify,              /* Flash read-back differs */
+    e_boot_err_sequence,            /* Data frame without a block */
+    e_boot_err_command,             /* Unknown or malformed command */
+    e_boot_err_no_image             /* RESET without a verified image */
+} BootStatus;
+
+/*---------------------------------------------------------
+ * Timeouts (Timer1 overflows, 1:8 prescale = 104.9 ms)
+ *---------------------------------------------------------*/
+#define BOOT_DATA_TIMEOUT           2U      /* Gap inside a block */
+#define BOOT_ENTRY_TIMEOUT          20U     /* Back to a valid app if no host */
+
+#endif /* BOOT_CFG_H */
@@ -0,0 +1,200 @@
+/***********************************************************************
+ *  File name   : can.c
+ *  Description : Polled ECAN driver for the bootloader.
+ *                Legacy mode 0, RXB0 double buffered into RXB1 so
+ *                two back-to-back data frames fit while the main
+ *                loop copies the previous one. Frames are returned
+ *                in bus order: once RXB1 has caught an overflow it
+ *                is read before RXB0 again.
+ *
+ *  API:
+ *      - init_can()
+ *      - can_transmit()
+ *      - can_receive()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include "can.h"
+#include "clock.h"
+#include "can_timing.h"         /* HAL/, same solver as the applications */
+
+/*---------------------------------------------------------
+ *  RX Buffer Register Layout (RXB0 and RXB1 alike)
+ *---------------------------------------------------------*/
+#define CAN_RXB_CON         0
+#define CAN_RXB_SIDH        1
+#define CAN_RXB_SIDL        2
+#define CAN_RXB_DLC         5
+#define CAN_RXB_D0          6
+
+#define CAN_RXB_RXFUL       0x80
+
+/* RXB1 holds an older frame than anything RXB0 gets next */
+static uint8_t g_rxb1_first;
+
+/*---------------------------------------------------------
+ *  Local Helper : Request a mode and wait (bounded)
+ *---------------------------------------------------------*/
+static uint8_t can_set_mode(uint8_t mode)
+{
+    uint16_t wait = CAN_MODE_WAIT_LOOPS;
+
+    CAN_SET_OPERATION_MODE_NO_WAIT(mode);
+
+    while ((CANSTAT & CAN_OPMODE_MASK) != mode)
+    {
+        if (--wait == 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Filter value for a standard ID
+ *---------------------------------------------------------*/
+#define CAN_SIDH(id)        ((uint8_t)((id) >> 3))
+#define CAN_SIDL(id)        ((uint8_t)(((id) & 0x07) << 5))
+
+/*---------------------------------------------------------
+ *  Function : init_can
+ *  Description :
+ *      Same pins and bit timing as the applications. RXB0
+ *      takes cmd_id (RXF0) and data_id (RXF1); RXB1 only
+ *      receives RXB0 overflow (its filters repeat the two
+ *      IDs so nothing else gets in).
+ *---------------------------------------------------------*/
+uint8_t init_can(uint16_t cmd_id, uint16_t data_id)
+{
+    /* CAN_TX = RB2 (output), CAN_RX = RB3 (input) */
+    TRISB2 = 0;
+    TRISB3 = 1;
+
+    if (!can_set_mode(CAN_OPMODE_CONFIG))
+    {
+        return 0;
+    }
+
+    ECANCON = 0x00;
+
+    BRGCON1 = CAN_BRGCON1;
+    BRGCON2 = CAN_BRGCON2;
+    BRGCON3 = CAN_BRGCON3;
+
+    /* Compare all 11 ID bits on both buffers */
+    RXM0SIDH = 0xFF;
+    RXM0SIDL = 0xE0;
+    RXM1SIDH = 0xFF;
+    RXM1SIDL = 0xE0;
+
+    RXF0SIDH = CAN_SIDH(cmd_id);
+    RXF0SIDL = CAN_SIDL(cmd_id);
+    RXF1SIDH = CAN_SIDH(data_id);
+    RXF1SIDL = CAN_SIDL(data_id);
+    RXF2SIDH = RXF4SIDH = RXF0SIDH;
+    RXF2SIDL = RXF4SIDL = RXF0SIDL;
+    RXF3SIDH = RXF5SIDH = RXF1SIDH;
+    RXF3SIDL = RXF5SIDL = RXF1SIDL;
+
+    RXB0CON = 0x00;
+    RXB0CONbits.RXB0DBEN = 1;
+    RXB1CON = 0x00;
+
+    g_rxb1_first = 0;
+
+    return can_set_mode(CAN_OPMODE_NORMAL);
+}
+
+/*---------------------------------------------------------
+ *  Function : can_transmit
+ *---------------------------------------------------------*/
+void can_transmit(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    uint8_t *tx_buffer;
+
+    while (ECAN_TX0_BUSY)
+    {
+        ;
+    }
+
+    TXB0EIDH = 0x00;
+    TXB0EIDL = 0x00;
+    TXB0SIDL = CAN_SIDL(msg_id);
+    TXB0SIDH = CAN_SIDH(msg_id);
+
+    if (len > CAN_MAX_DLC)
+    {
+        len = CAN_MAX_DLC;
+    }
+
+    TXB0DLC = len;
+
+    tx_buffer = (uint8_t *)&TXB0D0;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        tx_buffer[i] = data[i];
+    }
+
+    TXB0CONbits.TXREQ = 1;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Copy one RX buffer and free it
+ *---------------------------------------------------------*/
+static uint8_t can_read_buffer(volatile uint8_t *rxb, uint16_t *msg_id, uint8_t *data)
+{
+    uint8_t len = rxb[CAN_RXB_DLC] & 0x0F;
+
+    if (len > CAN_MAX_DLC)
+    {
+        len = CAN_MAX_DLC;
+    }
+
+    *msg_id = ((rxb[CAN_RXB_SIDL] >> 5) & 0x07) | ((uint16_t)rxb[CAN_RXB_SIDH] << 3);
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        data[i] = rxb[CAN_RXB_D0 + i];
+    }
+
+    rxb[CAN_RXB_CON] &= (uint8_t)~CAN_RXB_RXFUL;
+
+    return len;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_receive
+ *  Description :
+ *      RXB1 only fills while RXB0 is full, so a frame that
+ *      is in RXB1 right after RXB0 was read is the older of
+ *      the two and must come next. Empty (0 byte) frames are
+ *      returned as "none"; the protocol never sends them.
+ *---------------------------------------------------------*/
+uint8_t can_receive(uint16_t *msg_id, uint8_t *data)
+{
+    if (g_rxb1_first && RXB1CONbits.RXFUL)
+    {
+        g_rxb1_first = 0;
+        return can_read_buffer(&RXB1CON, msg_id, data);
+    }
+
+    if (RXB0CONbits.RXFUL)
+    {
+        uint8_t len = can_read_buffer(&RXB0CON, msg_id, data);
+
+        g_rxb1_first = RXB1CONbits.RXFUL;
+        return len;
+    }
+
+    if (RXB1CONbits.RXFUL)
+    {
+        return can_read_buffer(&RXB1CON, msg_id, data);
+    }
+
+    return 0;
+}
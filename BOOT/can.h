@@ -1,8 +1,8 @@
 /***********************************************************************
  *  File name   : can.h
- *  Description : Header file for CAN driver.
- *                Contains macro definitions for ECAN operation modes,
- *                FIFO status helpers, and CAN API prototypes.
+ *  Description : Polled ECAN driver for the bootloader.
+ *                Only this node's command and data identifiers are
+ *                accepted; nothing runs from interrupts.
  ***********************************************************************/
 
 #ifndef CAN_H
@@ -14,22 +14,21 @@
  *  CAN Operation Mode Values
  *---------------------------------------------------------*/
 #define CAN_OPMODE_NORMAL   0x00
-#define CAN_OPMODE_LOOP     0x40
 #define CAN_OPMODE_CONFIG   0x80
+#define CAN_OPMODE_MASK     0xE0
+
+/* Bound on polling loops while waiting for a mode change */
+#define CAN_MODE_WAIT_LOOPS 10000U
+
+/* TX Buffer 0 still holds a pending message */
+#define ECAN_TX0_BUSY       TXB0CONbits.TXREQ
 
 /*---------------------------------------------------------
- *  ECAN FIFO status flags
+ *  Nominal Bit Rate (must match the application nodes)
  *---------------------------------------------------------*/
-#define ECAN_MODE_BITS      (CANCON & 0x0F)
+#define CAN_BITRATE         500000UL
 
-#define ECAN_FIFO0_FULL     RXB0CONbits.RXFUL
-#define ECAN_FIFO1_FULL     RXB1CONbits.RXFUL
-#define ECAN_FIFO2_FULL     B0CONbits.RXFUL
-#define ECAN_FIFO3_FULL     B1CONbits.RXFUL
-#define ECAN_FIFO4_FULL     B2CONbits.RXFUL
-#define ECAN_FIFO5_FULL     B3CONbits.RXFUL
-#define ECAN_FIFO6_FULL     B4CONbits.RXFUL
-#define ECAN_FIFO7_FULL     B5CONbits.RXFUL
+#define CAN_MAX_DLC         8
 
 /*---------------------------------------------------------
  *  Set CAN mode (no wait)
@@ -44,17 +43,13 @@
  *  Function Prototypes
  *---------------------------------------------------------*/
 
-/* Initialize the CAN peripheral */
-void init_can(void);
+/* Filters on cmd_id / data_id (1 = ok, 0 = mode change timeout) */
+uint8_t init_can(uint16_t cmd_id, uint16_t data_id);
 
-/* Send a CAN message */
-void can_transmit(uint16_t msg_id,
-                  const uint8_t *data,
-                  uint8_t len);
+/* Send a CAN message, waits for TXB0 */
+void can_transmit(uint16_t msg_id, const uint8_t *data, uint8_t len);
 
-/* Receive CAN message (len = 0 if none) */
-void can_receive(uint16_t *msg_id,
-                 uint8_t *data,
-                 uint8_t *len);
+/* Oldest received frame; returns its length, 0 if none */
+uint8_t can_receive(uint16_t *msg_id, uint8_t *data);
 
 #endif /* CAN_H */
@@ -0,0 +1,38 @@
+/***********************************************************************
+ *  File name   : crc16.c
+ *  Description : CRC-16/CCITT-FALSE for image blocks.
+ *                Computed bit by bit: the bootloader has to fit in
+ *                the 2 KB boot block, and the CRC only runs once
+ *                per received byte (a 512-byte table would cost a
+ *                quarter of the block for no visible gain next to
+ *                the flash write time).
+ *
+ *  API:
+ *      - crc16_update()
+ *
+ ***********************************************************************/
+
+#include <stdint.h>
+#include "crc16.h"
+
+/*---------------------------------------------------------
+ * Function : crc16_update
+ *---------------------------------------------------------*/
+uint16_t crc16_update(uint16_t crc, uint8_t byte)
+{
+    crc ^= (uint16_t)byte << 8;
+
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+        if (crc & 0x8000)
+        {
+            crc = (uint16_t)((crc << 1) ^ 0x1021);
+        }
+        else
+        {
+            crc = (uint16_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
@@ -0,0 +1,16 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * CRC-16/CCITT-FALSE parameters (poly 0x1021, no reflection)
+ *---------------------------------------------------------*/
+#define CRC16_INIT                  0xFFFF
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+uint16_t crc16_update(uint16_t crc, uint8_t byte);
+
+#endif /* CRC16_H */
@@ -0,0 +1,407 @@
+/***********************************************************************
+ *  File name   : main.c
+ *  Description : Resident CAN bootloader (boot block, 0x0000..0x07FF).
+ *
+ *                At reset the application runs at once unless it
+ *                asked for the bootloader (BOOT_EE_REQUEST) or no
+ *                verified image is present (BOOT_EE_APP_VALID).
+ *                Otherwise the node announces itself with an INFO
+ *                frame and serves the host:
+ *
+ *                  BLOCK  : up to BOOT_BLOCK_FRAMES data frames are
+ *                           streamed back to back; the block is
+ *                           CRC checked, its rows erased, written
+ *                           and read back, then acknowledged once.
+ *                  VERIFY : CRC over the whole application region;
+ *                           on a match the image is marked valid.
+ *                  RESET  : restart into the verified application.
+ *
+ *                The valid mark is cleared before the first erase
+ *                of an update, so an interrupted update (reset,
+ *                power loss, host gone) always comes back here.
+ *                If the application requested the bootloader but
+ *                no host connects within BOOT_ENTRY_TIMEOUT, the
+ *                still valid application is restarted.
+ *
+ *                Runs fully polled: both interrupt vectors forward
+ *                to the application's vectors (vectors.c).
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+
+#include "boot_cfg.h"
+#include "can.h"
+#include "nvm.h"
+#include "crc16.h"
+
+/*---------------------------------------------------------
+ * Session State
+ *---------------------------------------------------------*/
+static uint8_t  g_block[BOOT_BLOCK_SIZE];
+static uint32_t g_block_addr;
+static uint16_t g_block_crc;
+static uint8_t  g_block_frames;             /* Announced by BLOCK */
+static uint8_t  g_block_received;           /* Data frames so far */
+static uint8_t  g_block_active;
+
+static uint8_t  g_connected;
+static uint8_t  g_app_invalidated;
+static uint8_t  g_timer_ovf;                /* Timer1 overflows since last frame */
+
+/*---------------------------------------------------------
+ *  Local Helper : No session after a reset
+ *   Set here rather than left to the start-up code, as
+ *   RESET() is the only way out of a session.
+ *---------------------------------------------------------*/
+static void boot_session_init(void)
+{
+    g_block_active    = 0;
+    g_block_received  = 0;
+    g_connected       = 0;
+    g_app_invalidated = 0;
+    g_timer_ovf       = 0;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Jump to the application reset vector
+ *---------------------------------------------------------*/
+static void run_app(void)
+{
+    asm("GOTO " ___mkstr(BOOT_APP_BASE));
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : 24-bit little endian field
+ *---------------------------------------------------------*/
+static uint32_t get_u24(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Response frames
+ *---------------------------------------------------------*/
+static void boot_respond(uint8_t cmd, uint8_t status, uint32_t value, uint8_t value_len)
+{
+    uint8_t frame[5];
+
+    frame[0] = cmd;
+    frame[1] = status;
+    frame[2] = (uint8_t)value;
+    frame[3] = (uint8_t)(value >> 8);
+    frame[4] = (uint8_t)(value >> 16);
+
+    can_transmit(BOOT_RESP_ID, frame, (uint8_t)(2U + value_len));
+}
+
+static void boot_send_info(void)
+{
+    uint8_t frame[8];
+
+    frame[0] = BOOT_CMD_CONNECT;
+    frame[1] = e_boot_ok;
+    frame[2] = BOOT_VERSION;
+    frame[3] = BOOT_NODE_ID;
+    frame[4] = (uint8_t)(BOOT_APP_BASE >> 8);
+    frame[5] = (uint8_t)(BOOT_FLASH_END >> 8);
+    frame[6] = BOOT_BLOCK_FRAMES;
+    frame[7] = FLASH_ERASE_ROW;
+
+    can_transmit(BOOT_RESP_ID, frame, 8);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Start of a block (BLOCK command)
+ *---------------------------------------------------------*/
+static void boot_block_start(const uint8_t *cmd, uint8_t len)
+{
+    uint32_t addr;
+    uint16_t size;
+
+    g_block_active = 0;
+
+    if (len < 7)
+    {
+        boot_respond(BOOT_CMD_BLOCK, e_boot_err_command, 0, 3);
+        return;
+    }
+
+    addr = get_u24(&cmd[1]);
+    size = (uint16_t)cmd[4] * 8U;
+
+    if (cmd[4] == 0 || cmd[4] > BOOT_BLOCK_FRAMES ||
+        (size % FLASH_ERASE_ROW) != 0 || (addr % FLASH_ERASE_ROW) != 0 ||
+        addr < BOOT_APP_BASE || addr + size > BOOT_FLASH_END)
+    {
+        boot_respond(BOOT_CMD_BLOCK, e_boot_err_range, addr, 3);
+        return;
+    }
+
+    g_block_addr     = addr;
+    g_block_frames   = cmd[4];
+    g_block_crc      = (uint16_t)cmd[5] | ((uint16_t)cmd[6] << 8);
+    g_block_received = 0;
+    g_block_active   = 1;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Program a complete block
+ *   Erased groups read 0xFF, so all-0xFF groups (padding,
+ *   unused code space) need no write.
+ *---------------------------------------------------------*/
+static uint8_t boot_block_program(void)
+{
+    uint16_t size = (uint16_t)g_block_frames * 8U;
+    uint16_t crc  = CRC16_INIT;
+    uint16_t i;
+    uint8_t  j;
+    uint8_t  blank;
+
+    for (i = 0; i < size; i++)
+    {
+        crc = crc16_update(crc, g_block[i]);
+    }
+
+    if (crc != g_block_crc)
+    {
+        return e_boot_err_crc;
+    }
+
+    /* From here on the old image is gone */
+    if (!g_app_invalidated)
+    {
+        eeprom_write(BOOT_EE_APP_VALID, 0xFF);
+        g_app_invalidated = 1;
+    }
+
+    for (i = 0; i < size; i += FLASH_WRITE_GROUP)
+    {
+        if ((i % FLASH_ERASE_ROW) == 0)
+        {
+            flash_erase_row(g_block_addr + i);
+        }
+
+        blank = 1;
+
+        for (j = 0; j < FLASH_WRITE_GROUP; j++)
+        {
+            if (g_block[i + j] != 0xFF)
+            {
+                blank = 0;
+            }
+        }
+
+        if (!blank)
+        {
+            flash_write_group(g_block_addr + i, &g_block[i]);
+        }
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        if (flash_read(g_block_addr + i) != g_block[i])
+        {
+            return e_boot_err_verify;
+        }
+    }
+
+    return e_boot_ok;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : One data frame of the current block
+ *---------------------------------------------------------*/
+static void boot_on_data(const uint8_t *data, uint8_t len)
+{
+    if (!g_block_active || len != 8)
+    {
+        g_block_active = 0;
+        boot_respond(BOOT_CMD_BLOCK, e_boot_err_sequence, g_block_addr, 3);
+        return;
+    }
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        g_block[(uint16_t)g_block_received * 8U + i] = data[i];
+    }
+
+    if (++g_block_received == g_block_frames)
+    {
+        g_block_active = 0;
+        boot_respond(BOOT_CMD_BLOCK, boot_block_program(), g_block_addr, 3);
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : VERIFY the whole application region
+ *---------------------------------------------------------*/
+static void boot_verify(const uint8_t *cmd, uint8_t len)
+{
+    uint32_t end;
+    uint32_t addr;
+    uint16_t crc = CRC16_INIT;
+
+    if (len < 6)
+    {
+        boot_respond(BOOT_CMD_VERIFY, e_boot_err_command, 0, 2);
+        return;
+    }
+
+    end = get_u24(&cmd[1]);
+
+    if (end <= BOOT_APP_BASE || end > BOOT_FLASH_END)
+    {
+        boot_respond(BOOT_CMD_VERIFY, e_boot_err_range, 0, 2);
+        return;
+    }
+
+    for (addr = BOOT_APP_BASE; addr < end; addr++)
+    {
+        crc = crc16_update(crc, flash_read(addr));
+    }
+
+    if (crc != ((uint16_t)cmd[4] | ((uint16_t)cmd[5] << 8)))
+    {
+        boot_respond(BOOT_CMD_VERIFY, e_boot_err_verify, crc, 2);
+        return;
+    }
+
+    eeprom_write(BOOT_EE_APP_VALID, BOOT_APP_VALID);
+    boot_respond(BOOT_CMD_VERIFY, e_boot_ok, crc, 2);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Restart (into the application if valid)
+ *---------------------------------------------------------*/
+static void boot_reset(void)
+{
+    if (eeprom_read(BOOT_EE_APP_VALID) != BOOT_APP_VALID)
+    {
+        boot_respond(BOOT_CMD_RESET, e_boot_err_no_image, 0, 0);
+        return;
+    }
+
+    boot_respond(BOOT_CMD_RESET, e_boot_ok, 0, 0);
+
+    /* Let the response leave before the ECAN is reset */
+    while (ECAN_TX0_BUSY)
+    {
+        ;
+    }
+
+    RESET();
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Command frame
+ *---------------------------------------------------------*/
+static void boot_on_command(const uint8_t *cmd, uint8_t len)
+{
+    switch (cmd[0])
+    {
+        case BOOT_CMD_ENTER:
+        case BOOT_CMD_CONNECT:
+            g_connected    = 1;
+            g_block_active = 0;
+            boot_send_info();
+            break;
+
+        case BOOT_CMD_BLOCK:
+            boot_block_start(cmd, len);
+            break;
+
+        case BOOT_CMD_VERIFY:
+            boot_verify(cmd, len);
+            break;
+
+        case BOOT_CMD_RESET:
+            boot_reset();
+            break;
+
+        default:
+            boot_respond(cmd[0], e_boot_err_command, 0, 0);
+            break;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : main
+ *---------------------------------------------------------*/
+void main(void)
+{
+    uint16_t msg_id;
+    uint8_t  data[CAN_MAX_DLC];
+    uint8_t  len;
+    uint8_t  requested;
+    uint8_t  app_valid;
+
+    requested = (uint8_t)(eeprom_read(BOOT_EE_REQUEST) == BOOT_REQUEST);
+    app_valid = (uint8_t)(eeprom_read(BOOT_EE_APP_VALID) == BOOT_APP_VALID);
+
+    /* Normal power-up: nothing initialised, nothing delayed */
+    if (!requested && app_valid)
+    {
+        run_app();
+    }
+
+    if (requested)
+    {
+        eeprom_write(BOOT_EE_REQUEST, 0xFF);
+    }
+
+    boot_session_init();
+
+    /* Timer1, 1:8 prescale: timeouts in ~105 ms overflows */
+    T1CON  = 0xB1;
+    TMR1IF = 0;
+
+    while (!init_can(BOOT_CMD_ID, BOOT_DATA_ID))
+    {
+        ;
+    }
+
+    boot_send_info();
+
+    while (1)
+    {
+        len = can_receive(&msg_id, data);
+
+        if (len != 0)
+        {
+            g_timer_ovf = 0;
+
+            if (msg_id == BOOT_DATA_ID)
+            {
+                boot_on_data(data, len);
+            }
+            else
+            {
+                boot_on_command(data, len);
+            }
+
+            continue;
+        }
+
+        if (!TMR1IF)
+        {
+            continue;
+        }
+
+        TMR1IF = 0;
+        g_timer_ovf++;
+
+        if (g_block_active && g_timer_ovf >= BOOT_DATA_TIMEOUT)
+        {
+            g_block_active = 0;
+            boot_respond(BOOT_CMD_BLOCK, e_boot_err_timeout, g_block_addr, 3);
+        }
+
+        /* Requested, but nobody came: back to the intact image */
+        if (!g_connected && app_valid && g_timer_ovf >= BOOT_ENTRY_TIMEOUT)
+        {
+            RESET();
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/***********************************************************************
+ *  File name   : nvm.c
+ *  Description : Program flash and data EEPROM access for the
+ *                bootloader (PIC18F4580, DS39637 section 6/7).
+ *
+ *                Flash is erased in FLASH_ERASE_ROW byte rows and
+ *                written through FLASH_WRITE_GROUP holding
+ *                registers; programming only clears bits, so a row
+ *                must be erased before it is rewritten. The boot
+ *                block is write protected in the configuration
+ *                words, which makes erase / write there a no-op.
+ *
+ *  API:
+ *      - flash_read()
+ *      - flash_erase_row()
+ *      - flash_write_group()
+ *      - eeprom_read()
+ *      - eeprom_write()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "nvm.h"
+#include "boot_cfg.h"
+
+/*---------------------------------------------------------
+ *  Local Helper : Point the table pointer at addr
+ *---------------------------------------------------------*/
+static void nvm_set_tblptr(uint32_t addr)
+{
+    TBLPTRU = (uint8_t)(addr >> 16);
+    TBLPTRH = (uint8_t)(addr >> 8);
+    TBLPTRL = (uint8_t)addr;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Required unlock sequence, starts the
+ *  operation selected in EECON1 (interrupts are never
+ *  enabled in the bootloader)
+ *---------------------------------------------------------*/
+static void nvm_unlock_and_start(void)
+{
+    EECON1bits.WREN = 1;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    NOP();
+
+    /* Flash: CPU resumes after the write. EEPROM: poll. */
+    while (EECON1bits.WR)
+    {
+        ;
+    }
+
+    EECON1bits.WREN = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : flash_read
+ *---------------------------------------------------------*/
+uint8_t flash_read(uint32_t addr)
+{
+    nvm_set_tblptr(addr);
+    asm("TBLRD*");
+
+    return TABLAT;
+}
+
+/*---------------------------------------------------------
+ * Function : flash_erase_row
+ *  addr : any byte inside the row
+ *---------------------------------------------------------*/
+void flash_erase_row(uint32_t addr)
+{
+    nvm_set_tblptr(addr);
+
+    EECON1bits.EEPGD = 1;
+    EECON1bits.CFGS  = 0;
+    EECON1bits.FREE  = 1;
+    nvm_unlock_and_start();
+    EECON1bits.FREE  = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : flash_write_group
+ * Description :
+ *    Loads FLASH_WRITE_GROUP bytes into the holding
+ *    registers and programs them at addr (group aligned).
+ *    TBLPTR must still point inside the group when the
+ *    write starts, so the last load does not increment.
+ *---------------------------------------------------------*/
+void flash_write_group(uint32_t addr, const uint8_t *data)
+{
+    nvm_set_tblptr(addr);
+
+    for (uint8_t i = 0; i < FLASH_WRITE_GROUP - 1U; i++)
+    {
+        TABLAT = data[i];
+        asm("TBLWT*+");
+    }
+
+    TABLAT = data[FLASH_WRITE_GROUP - 1U];
+    asm("TBLWT*");
+
+    EECON1bits.EEPGD = 1;
+    EECON1bits.CFGS  = 0;
+    nvm_unlock_and_start();
+}
+
+/*---------------------------------------------------------
+ * Function : eeprom_read
+ *---------------------------------------------------------*/
+uint8_t eeprom_read(uint8_t addr)
+{
+    EEADR = addr;
+
+    EECON1bits.EEPGD = 0;
+    EECON1bits.CFGS  = 0;
+    EECON1bits.RD    = 1;
+
+    return EEDATA;
+}
+
+/*---------------------------------------------------------
+ * Function : eeprom_write
+ *  Blocking (~4 ms); skipped when the byte already holds
+ *  the value.
+ *---------------------------------------------------------*/
+void eeprom_write(uint8_t addr, uint8_t data)
+{
+    if (eeprom_read(addr) == data)
+    {
+        return;
+    }
+
+    EEADR  = addr;
+    EEDATA = data;
+
+    EECON1bits.EEPGD = 0;
+    EECON1bits.CFGS  = 0;
+    nvm_unlock_and_start();
+}
@@ -0,0 +1,21 @@
+#ifndef NVM_H
+#define NVM_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *
+ *  Program memory addresses are byte addresses. Erase and
+ *  write stall the CPU until the cell operation finishes
+ *  (self-timed, ~2 ms each); the ECAN module keeps
+ *  receiving into its buffers meanwhile.
+ *---------------------------------------------------------*/
+uint8_t flash_read(uint32_t addr);
+void    flash_erase_row(uint32_t addr);
+void    flash_write_group(uint32_t addr, const uint8_t *data);
+
+uint8_t eeprom_read(uint8_t addr);
+void    eeprom_write(uint8_t addr, uint8_t data);
+
+#endif /* NVM_H */
@@ -0,0 +1,16 @@
+/***********************************************************************
+ *  File name   : vectors.c
+ *  Description : Interrupt vectors of the boot block. The bootloader
+ *                runs polled, so both vectors forward to the
+ *                application's, BOOT_APP_BASE above them.
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "boot_cfg.h"
+
+asm("PSECT boot_vectors,class=CODE,abs,delta=1");
+asm("ORG 0x08");
+asm("GOTO " ___mkstr(BOOT_APP_BASE) " + 0x08");
+asm("ORG 0x18");
+asm("GOTO " ___mkstr(BOOT_APP_BASE) " + 0x18");
@@ -1,78 +1,18 @@
 #include <xc.h>
-#include "adc.h"
-#include "clcd.h"
-#include "msg_id.h"
-#include "sensor.h"
-#include "digital_keypad.h"
-#include "can.h"
-#include "string.h"
+#include "timesync.h"
 
-unsigned long int timer_count;
-
-#define _XTAL_FREQ 200000
-
-void init_config()
+/* Interrupt service routine: time base, receive timestamps, IDLE wake-up */
+void __interrupt() isr(void)
 {
-    init_adc();
-    init_digital_keypad();
-    init_can();
-}
+	if (TMR2IE && TMR2IF)	// 1 ms wake-up timer, only ends IDLE
+		TMR2IF = 0;
 
-void reverse(char str[], int length)
-{
-    int start = 0;
-    int end = length - 1;
-    while (start < end) {
-        char temp = str[start];
-        str[start] = str[end];
-        str[end] = temp;
-        end--;
-        start++;
-    }
-}
+	if (TMR3IE && TMR3IF)	// Timer3 overflow, extends the local clock
+		tsync_timer_isr();
 
-char * my_itoa(unsigned int num, unsigned char* str, unsigned int base)
-{
-    int i = 0;
-    if (num == 0)
-    {
-        str[i++] = '0';
-        str[i++] = '0';
-        str[i] = '\0';
-        return str;
-    }
-    
-    while (num != 0)
-    {
-        int rem = num % base;
-        str[i++] = rem + '0';
-        num = num / base;
-    }
-    str[i] = '\0'; // Append string terminator
-
-    // Reverse the string
-    reverse(str, i);
+	if (RXB0IE && RXB0IF)	// Frame landed in RXB0, timestamp it
+		tsync_rx_isr();
 
-    return str;
+	if (RXB1IE && RXB1IF)	// Heartbeat in RXB1: only ends IDLE, the loop reads it
+		RXB1IE = 0;
 }
-
-int main()
-{
-    init_config();
-    unsigned int speed = 0;
-    unsigned char gear_pos = 0;
-    unsigned char data[5] = {0x00};
-    while(1)
-    {
-        __delay_ms(10);
-        
-        gear_pos = get_gear_pos();
-        can_transmit(GEAR_MSG_ID, &gear_pos, 1);
-       
-        __delay_ms(10);
-        
-        speed = get_speed(gear_pos);
-        my_itoa(speed, data, 10);
-        can_transmit(SPEED_MSG_ID, data, 3);
-    }
-}
\ No newline at end of file
@@ -1,21 +1,64 @@
 #include <xc.h>
 #include "adc.h"
-#include "clcd.h"
 #include "msg_id.h"
 #include "sensor.h"
 #include "digital_keypad.h"
 #include "can.h"
 #include "string.h"
+#include "xcp.h"
+#include "e2e.h"
+#include "profile.h"
+#include "timesync.h"
+#include "nm.h"
+#include "power.h"
+#include "bootreq.h"
+#include "calib.h"
+#include "ttsched.h"
 
 unsigned long int timer_count;
 
-#define _XTAL_FREQ 200000
+/* E2E alive counters, one per protected message */
+e2e_tx_t e2e_gear_tx;
+e2e_tx_t e2e_speed_tx;
+
 
 void init_config()
 {
+    calib_init();       // EEPROM -> RAM cache (defaults if invalid)
     init_adc();
     init_digital_keypad();
     init_can();
+    xcp_init();
+    tsync_init();       // local clock + RX timestamps
+    nm_init();          // heartbeat, starts awake (repeat state)
+    POWER_WAKE_TIMER_START(); // 1 ms wake-up from IDLE in profile_delay_ms()
+    PEIE = 1;
+    GIE = 1;
+    profile_init();     // probe overhead, first load window
+}
+
+/* Feed XCP commands, time sync frames, NM heartbeats and bootloader entry */
+void process_can_rx(void)
+{
+    uint16_t msg_id;
+    uint8_t rx[CAN_MAX_DLC];
+    uint8_t len = 0;
+    uint32_t stamp;
+
+    RXB0IE = 0;         // keep the RX stamp with this frame
+    can_receive(&msg_id, rx, &len);
+    stamp = tsync_rx_stamp();
+    RXB0IE = 1;
+    RXB1IE = 1;         // next RXB1 frame ends IDLE again
+
+    if (len != 0 && msg_id == XCP_CRO_ID)
+        xcp_on_frame(rx, len);
+    else if (len != 0 && msg_id == TIME_SYNC_MSG_ID)
+        tsync_on_frame(rx, len, stamp);
+    else if (len != 0 && nm_is_nm_frame(msg_id))
+        nm_on_frame(msg_id, rx, len);
+    else if (len != 0 && bootreq_is_frame(msg_id))
+        bootreq_on_frame(msg_id, rx, len);  // resets into the bootloader
 }
 
 void reverse(char str[], int length)
@@ -62,17 +105,41 @@ int main()
     unsigned int speed = 0;
     unsigned char gear_pos = 0;
     unsigned char data[5] = {0x00};
+    unsigned char frame[CAN_MAX_DLC];
+    unsigned char len;
     while(1)
     {
-        __delay_ms(10);
-        
         gear_pos = get_gear_pos();
-        can_transmit(GEAR_MSG_ID, &gear_pos, 1);
-       
-        __delay_ms(10);
+        TTSCHED_WAIT(GEAR);     // ECU1 window: GEAR first, then housekeeping
+        if (nm_tx_allowed()) {
+            len = e2e_protect(&e2e_gear_tx, GEAR_MSG_ID, frame, &gear_pos, 1);
+            can_transmit(GEAR_MSG_ID, frame, len);
+        }
+
+        /* Measurement: sample DAQ lists once per loop, then talk to the master */
+        process_can_rx();
+        if (nm_tx_allowed()) {
+            xcp_event(XCP_EVENT_MAIN_LOOP);
+            profile_poll();
+        }
+        can_tx_wait();  // slot frame still in TXB0: XCP goes out after it
+        xcp_poll();
         
         speed = get_speed(gear_pos);
-        my_itoa(speed, data, 10);
-        can_transmit(SPEED_MSG_ID, data, 3);
+        TTSCHED_WAIT(SPEED);    // ECU1 window: SPEED first, then NM heartbeat
+        if (nm_tx_allowed()) {
+            my_itoa(speed, data, 10);
+            len = e2e_protect(&e2e_speed_tx, SPEED_MSG_ID, frame, data, 3);
+            can_transmit(SPEED_MSG_ID, frame, len);
+        }
+
+        /* Parked (ON / neutral, standing still) -> let the bus sleep */
+        if (gear_pos > 1 || speed != 0)
+            nm_network_request();
+        else
+            nm_network_release();
+        can_tx_wait();  // SPEED still in TXB0: the heartbeat goes out after it
+        nm_poll();
+        calib_poll();   // one EEPROM byte per pass while storing
     }
 }
\ No newline at end of file
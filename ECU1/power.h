@@ -0,0 +1,46 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <xc.h>
+#include "clock.h"
+
+/*---------------------------------------------------------
+ * CPU Power Mode (IDLE)
+ *
+ *  The core stops, the oscillator and every peripheral
+ *  (timers, ADC, ECAN) keep running, so no frame is lost.
+ *  Any enabled interrupt wakes the core: the 1 ms wake-up
+ *  timer, the Timer3 time base, an RXB0 frame or an RXB1
+ *  frame (re-armed by process_can_rx(), which reads it).
+ *
+ *  The keypad (PORTC) cannot raise an interrupt; it is
+ *  read by the main loop after each delay as before. Full
+ *  SLEEP is therefore not used on this node.
+ *---------------------------------------------------------*/
+#define POWER_IDLE()                                \
+{                                                   \
+    OSCCONbits.IDLEN = 1;                           \
+    SLEEP();                                        \
+    NOP();                                          \
+}
+
+/*---------------------------------------------------------
+ * Wake-up Timer (Timer2, 1 ms)
+ *  Fosc/4 / 4 (prescale) / 5 (postscale) = 250 kHz,
+ *  PR2 = 249 -> 1 kHz. The ISR only clears TMR2IF.
+ *---------------------------------------------------------*/
+#define POWER_WAKE_TIMER_START()                    \
+{                                                   \
+    T2CON  = 0x21;      /* 1:5 post, 1:4 pre, off */ \
+    PR2    = 249;                                   \
+    TMR2   = 0;                                     \
+    TMR2IF = 0;                                     \
+    TMR2IE = 1;                                     \
+    TMR2ON = 1;                                     \
+}
+
+#if (_XTAL_FREQ / 4UL / 4UL / 5UL / 250UL) != 1000UL
+#error "POWER_WAKE_TIMER_START assumes a 20 MHz oscillator"
+#endif
+
+#endif /* POWER_H */
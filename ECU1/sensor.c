@@ -10,12 +10,15 @@ uint16_t get_speed(int index)
     // Implement the speed function
     uint16_t speed;
 //    if(index > 1 && index < 8)
-            speed = read_adc(CHANNEL4) / 10.33;
+            speed = (uint16_t)((uint32_t)read_adc(CHANNEL4) * 100U / g_calib.speed_div_x100);
 //    else
 //        speed = 0;
 
-    if(index == 7)
-        speed /= 5;
+    if(index == GEAR_REVERSE)
+        speed /= g_calib.reverse_divisor;
+
+    if(speed > SPEED_MAX)
+        speed = SPEED_MAX;  // SPEED frame carries 3 digits
     
     return speed;
 }
@@ -29,7 +32,7 @@ unsigned char get_gear_pos()
     {
         if(key == SWITCH1)
         {
-            if(index < 7)
+            if(index < g_calib.gear_max)
                 index++;
             else if(index == 8)
                 index = 1;
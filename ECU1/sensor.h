@@ -7,13 +7,18 @@
 #include <stdint.h>
 #include "digital_keypad.h"
 #include <xc.h>
+#include "calib.h"
 
 #define MAX_GEAR 6
+#define GEAR_REVERSE 7      /* Gear index shown as "Gr" */
 #define SPEED_ADC_CHANNEL 0x04
+#define SPEED_MAX 999       /* km/h, 3 ASCII digits on the bus */
 #define GEAR_UP             SWITCH1
 #define GEAR_DOWN           SWITCH2
 #define COLLISION           SWITCH3
 
+/* Scale factor and gear limits: g_calib (calib.h) */
+
 uint16_t get_speed(int);
 unsigned char get_gear_pos();
 
@@ -0,0 +1,7 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/* Oscillator frequency, shared by __delay_xx() and CAN bit timing */
+#define _XTAL_FREQ 20000000UL
+
+#endif /* CLOCK_H */
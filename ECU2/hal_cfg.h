@@ -0,0 +1,20 @@
+/* Generated by tools/gen_hal_cfg.py from tools/hal_nodes.csv, do not edit */
+
+#ifndef HAL_CFG_H
+#define HAL_CFG_H
+
+/*---------------------------------------------------------
+ * Shared Driver Configuration : ECU2
+ *---------------------------------------------------------*/
+#define HAL_NODE_ID                 2     /* NM / XCP / boot / profile IDs */
+#define HAL_TSYNC_MASTER            0     /* Time slave, Timer3 */
+#define HAL_CAN_RX_IRQ              0     /* Polled can_receive() */
+#define HAL_CAN_FILTER_NODE         1     /* Node acceptance filters */
+#define HAL_CAN_TX_WAIT_LOOPS       2000  /* Wait for a busy TXB0 */
+#define HAL_ADC                     1     /* adc.c */
+#define HAL_CLCD                    0     /* clcd.c */
+#define HAL_DIGITAL_KEYPAD          1     /* digital_keypad.c */
+#define HAL_CALIB                   1     /* calib.c */
+#define HAL_TTSCHED                 1     /* ttsched.c */
+
+#endif /* HAL_CFG_H */
@@ -0,0 +1,18 @@
+#include <xc.h>
+#include "timesync.h"
+
+/* Interrupt service routine: time base, receive timestamps, IDLE wake-up */
+void __interrupt() isr(void)
+{
+	if (TMR2IE && TMR2IF)	// 1 ms wake-up timer, only ends IDLE
+		TMR2IF = 0;
+
+	if (TMR3IE && TMR3IF)	// Timer3 overflow, extends the local clock
+		tsync_timer_isr();
+
+	if (RXB0IE && RXB0IF)	// Frame landed in RXB0, timestamp it
+		tsync_rx_isr();
+
+	if (RXB1IE && RXB1IF)	// Heartbeat in RXB1: only ends IDLE, the loop reads it
+		RXB1IE = 0;
+}
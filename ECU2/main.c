@@ -1,19 +1,64 @@
 #include <xc.h>
+#include "clock.h"
 #include "adc.h"
 #include "digital_keypad.h"
 #include "ssd.h"
 #include "sensor.h"
 #include "msg_id.h"
 #include "can.h"
+#include "xcp.h"
+#include "e2e.h"
+#include "profile.h"
+#include "timesync.h"
+#include "nm.h"
+#include "power.h"
+#include "bootreq.h"
+#include "calib.h"
+#include "ttsched.h"
+
+/* E2E alive counters, one per protected message */
+e2e_tx_t e2e_indicator_tx;
+e2e_tx_t e2e_rpm_tx;
 
 
-#define _XTAL_FREQ 200000
 
 void init_config()
 {
+    calib_init();       // EEPROM -> RAM cache (defaults if invalid)
     init_adc();
     init_digital_keypad();
     init_can();
+    xcp_init();
+    tsync_init();       // local clock + RX timestamps
+    nm_init();          // heartbeat, starts awake (repeat state)
+    POWER_WAKE_TIMER_START(); // 1 ms wake-up from IDLE in profile_delay_ms()
+    PEIE = 1;
+    GIE = 1;
+    profile_init();     // probe overhead, first load window
+}
+
+/* Feed XCP commands, time sync frames, NM heartbeats and bootloader entry */
+void process_can_rx(void)
+{
+    uint16_t msg_id;
+    uint8_t rx[CAN_MAX_DLC];
+    uint8_t len = 0;
+    uint32_t stamp;
+
+    RXB0IE = 0;         // keep the RX stamp with this frame
+    can_receive(&msg_id, rx, &len);
+    stamp = tsync_rx_stamp();
+    RXB0IE = 1;
+    RXB1IE = 1;         // next RXB1 frame ends IDLE again
+
+    if (len != 0 && msg_id == XCP_CRO_ID)
+        xcp_on_frame(rx, len);
+    else if (len != 0 && msg_id == TIME_SYNC_MSG_ID)
+        tsync_on_frame(rx, len, stamp);
+    else if (len != 0 && nm_is_nm_frame(msg_id))
+        nm_on_frame(msg_id, rx, len);
+    else if (len != 0 && bootreq_is_frame(msg_id))
+        bootreq_on_frame(msg_id, rx, len);  // resets into the bootloader
 }
 
 
@@ -62,18 +107,43 @@ void main(void) {
     unsigned int adc;
     
     unsigned char data[5] = {0x00};
+    unsigned char frame[CAN_MAX_DLC];
+    unsigned char len;
     
     while(1)
     {
         indicator = process_indicator();
         adc = get_rpm();
         
-        can_transmit(INDICATOR_MSG_ID, &indicator, 1);
-        __delay_ms(10);
+        /* Engine stopped, indicators off -> let the bus sleep */
+        if (adc != 0 || indicator != e_ind_off)
+            nm_network_request();
+        else
+            nm_network_release();
         
         my_itoa(adc, data, 10);
-        can_transmit(RPM_MSG_ID, data, 5);
-        __delay_ms(10);     
+        TTSCHED_WAIT(RPM);      // ECU2 window: RPM first
+        if (nm_tx_allowed()) {
+            len = e2e_protect(&e2e_rpm_tx, RPM_MSG_ID, frame, data, 5);
+            can_transmit(RPM_MSG_ID, frame, len);
+        }
+        
+        TTSCHED_WAIT(INDICATOR); // ECU2 window: INDICATOR first, then housekeeping
+        if (nm_tx_allowed()) {
+            len = e2e_protect(&e2e_indicator_tx, INDICATOR_MSG_ID, frame, &indicator, 1);
+            can_transmit(INDICATOR_MSG_ID, frame, len);
+        }
+
+        /* Measurement: sample DAQ lists once per loop, then talk to the master */
+        process_can_rx();
+        if (nm_tx_allowed()) {
+            xcp_event(XCP_EVENT_MAIN_LOOP);
+            profile_poll();
+        }
+        can_tx_wait();  // slot frame still in TXB0: XCP goes out after it
+        xcp_poll();
+        nm_poll();
+        calib_poll();   // one EEPROM byte per pass while storing
     }
     return;
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+/***********************************************************************
+ *  File name   : node_cfg.h
+ *  Description : ECU2 settings of the shared modules (HAL/) that are
+ *                more than a switch: EEPROM map, XCP event channels,
+ *                profiler probes and the calibration set. Node ID,
+ *                time-sync role and module selection are in the
+ *                generated hal_cfg.h.
+ *
+ *                Network management: ECU2 requests the network
+ *                while the engine turns or an indicator is on.
+ *
+ ***********************************************************************/
+
+#ifndef NODE_CFG_H
+#define NODE_CFG_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Data EEPROM Map (below EE_BOOT_BASE)
+ *---------------------------------------------------------*/
+#define EE_CALIB_BASE               0x00    /* Calibration block, two slots */
+#define EE_FREE_BASE                0x20    /* Unused */
+
+/*---------------------------------------------------------
+ * XCP Event Channels
+ *---------------------------------------------------------*/
+#define XCP_MAX_EVENT               1
+#define XCP_EVENT_MAIN_LOOP         0
+
+/*---------------------------------------------------------
+ * Slot Wait (ttsched.c)
+ *  The NM heartbeats share RXB1: drain it on every 1 ms
+ *  wake-up, two heartbeats can arrive within one loop.
+ *---------------------------------------------------------*/
+void process_can_rx(void);
+#define TTSCHED_IDLE_POLL()         process_can_rx()
+
+/*---------------------------------------------------------
+ * Profiler Probe Table
+ *  PROF_OVERHEAD measures an empty ENTER/EXIT pair at boot.
+ *---------------------------------------------------------*/
+#define PROF_OVERHEAD               0
+#define PROF_CAN_TRANSMIT           1
+#define PROF_CAN_RECEIVE            2
+#define PROF_READ_ADC               3
+#define PROFILE_PROBES              4
+
+/*---------------------------------------------------------
+ * Calibration Set (calib.c)
+ *
+ *  Layout rules: fields are only ever appended, and every
+ *  change bumps CALIB_LAYOUT_VERSION. A block written by an
+ *  older layout keeps its stored fields, the new ones take
+ *  the defaults below. Fields are integers (fixed point
+ *  where needed), so the stored size does not depend on the
+ *  compiler's float width; CALIB_LAYOUT_SIZE is checked at
+ *  compile time.
+ *---------------------------------------------------------*/
+#define CALIB_LAYOUT_VERSION        2
+#define CALIB_OLDEST_VERSION        2   /* v1 held floats: not migrated */
+#define CALIB_LAYOUT_SIZE           2U
+
+typedef struct
+{
+    uint16_t rpm_scale_x10k;        /* RPM per ADC count, x10000 */
+} calib_t;
+
+#define CALIB_DEFAULTS              { 58651U }
+
+/* Values the code can run with (a zero scale reads 0 RPM) */
+#define CALIB_IN_RANGE(c)           ((c)->rpm_scale_x10k > 0)
+
+#endif /* NODE_CFG_H */
@@ -8,13 +8,14 @@ uint16_t get_rpm()
 {
     //Implement the rpm function
     int rpm;
-    rpm = read_adc(CHANNEL4) * 5.8651;
+    rpm = (uint16_t)((uint32_t)read_adc(CHANNEL4) * g_calib.rpm_scale_x10k / 10000U);
     return rpm;
 }
 
 uint16_t get_engine_temp()
 {
-    //Implement the engine temperature function
+    // LM35 on AN6: 10 mV/degC, 10-bit ADC over a 5 V reference
+    return (uint16_t)((uint32_t)read_adc(ENG_TEMP_ADC_CHANNEL) * 500U / 1023U);
 }
 
 IndicatorStatus process_indicator()
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "digital_keypad.h"
 #include <xc.h>
+#include "calib.h"
 
 #define RPM_ADC_CHANNEL 0x04
 #define ENG_TEMP_ADC_CHANNEL 0x06
@@ -26,6 +27,8 @@ typedef enum {
 extern volatile IndicatorStatus prev_ind_status, cur_ind_status;
 extern volatile unsigned char led_state;
 
+/* RPM scale factor: g_calib (calib.h) */
+
 uint16_t get_rpm();
 uint16_t get_engine_temp();
 IndicatorStatus process_indicator();
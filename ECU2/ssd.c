@@ -17,7 +17,6 @@ void init_ssd_control(void)
 void display(unsigned char data[])
 {
 	unsigned int wait;
-	unsigned char data_bit;
 	unsigned char digit;
 
 	for (digit = 0; digit < MAX_SSD_CNT; digit++)
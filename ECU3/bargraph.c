@@ -0,0 +1,163 @@
+/***********************************************************************
+ *  File name   : bargraph.c
+ *  Description : Horizontal bar graph on the character LCD.
+ *                Partial-block glyphs (1 - 4 columns) live in CGRAM;
+ *                empty and full cells use the built-in space and 0xFF
+ *                block. Each instance remembers what every cell shows
+ *                and only rewrites cells whose level changed, so a
+ *                small RPM change costs a few bus writes. Cells go
+ *                through the screen layer, so a warning overlay
+ *                above them is respected.
+ *
+ *  API:
+ *      - bargraph_init()
+ *      - bargraph_invalidate()
+ *      - bargraph_draw()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "bargraph.h"
+#include "clcd.h"
+#include "screen.h"
+
+/*---------------------------------------------------------
+ * Glyph Set
+ *  CGRAM slots 0..3 hold 1..4 lit columns (from the left).
+ *---------------------------------------------------------*/
+#define BAR_GLYPH_SET_ID        1
+#define BAR_GLYPH_COUNT         (BAR_PIXELS_PER_CELL - 1)
+#define BAR_CHAR_EMPTY          ' '
+#define BAR_CHAR_FULL           0xFF
+
+static const unsigned char g_bar_row_bits[BAR_GLYPH_COUNT] =
+{
+    0x10, 0x18, 0x1C, 0x1E
+};
+
+/* Glyph set currently held in CGRAM (0 = unknown) */
+static uint8_t g_cgram_set = 0;
+
+/*---------------------------------------------------------
+ *  Local Helper : Load partial-block glyphs if not present
+ *---------------------------------------------------------*/
+static void bargraph_load_glyphs(void)
+{
+    unsigned char pattern[CGRAM_ROWS];
+
+    if (g_cgram_set == BAR_GLYPH_SET_ID)
+    {
+        return;
+    }
+
+    for (uint8_t glyph = 0; glyph < BAR_GLYPH_COUNT; glyph++)
+    {
+        for (uint8_t row = 0; row < CGRAM_ROWS; row++)
+        {
+            pattern[row] = g_bar_row_bits[glyph];
+        }
+
+        screen_load_char(glyph, pattern);
+    }
+
+    g_cgram_set = BAR_GLYPH_SET_ID;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Character code for a cell level (0 - 5)
+ *---------------------------------------------------------*/
+static unsigned char bargraph_cell_char(uint8_t level)
+{
+    if (level == 0)
+    {
+        return BAR_CHAR_EMPTY;
+    }
+
+    if (level >= BAR_PIXELS_PER_CELL)
+    {
+        return BAR_CHAR_FULL;
+    }
+
+    return (unsigned char)(level - 1);      /* CGRAM slot */
+}
+
+/*---------------------------------------------------------
+ * Function : bargraph_init
+ * Description :
+ *    Sets up a bar graph instance. Nothing is drawn until the
+ *    first bargraph_draw().
+ *
+ *      addr       → DDRAM address of the first cell (LINEx(n))
+ *      cells      → width in characters (<= BAR_MAX_CELLS)
+ *      full_scale → value that fills every cell
+ *---------------------------------------------------------*/
+void bargraph_init(bargraph_t *bar, uint8_t addr, uint8_t cells, uint16_t full_scale)
+{
+    bar->addr       = addr;
+    bar->cells      = (cells > BAR_MAX_CELLS) ? BAR_MAX_CELLS : cells;
+    bar->full_scale = full_scale;
+
+    bargraph_invalidate(bar);
+}
+
+/*---------------------------------------------------------
+ * Function : bargraph_invalidate
+ * Description :
+ *    Forgets what is on screen, e.g. after clcd_clear(), so
+ *    the next draw rewrites every cell.
+ *---------------------------------------------------------*/
+void bargraph_invalidate(bargraph_t *bar)
+{
+    for (uint8_t cell = 0; cell < BAR_MAX_CELLS; cell++)
+    {
+        bar->level[cell] = BAR_LEVEL_UNKNOWN;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : bargraph_draw
+ * Description :
+ *    Draws value scaled to full_scale. Consecutive changed
+ *    cells share one address write (screen layer cursor);
+ *    unchanged cells cost nothing.
+ *---------------------------------------------------------*/
+void bargraph_draw(bargraph_t *bar, uint16_t value)
+{
+    uint16_t pixels;
+    uint16_t total = (uint16_t)bar->cells * BAR_PIXELS_PER_CELL;
+
+    if (value >= bar->full_scale)
+    {
+        pixels = total;
+    }
+    else
+    {
+        pixels = (uint16_t)(((uint32_t)value * total) / bar->full_scale);
+    }
+
+    bargraph_load_glyphs();
+
+    for (uint8_t cell = 0; cell < bar->cells; cell++)
+    {
+        uint8_t level;
+
+        if (pixels >= BAR_PIXELS_PER_CELL)
+        {
+            level   = BAR_PIXELS_PER_CELL;
+            pixels -= BAR_PIXELS_PER_CELL;
+        }
+        else
+        {
+            level  = (uint8_t)pixels;
+            pixels = 0;
+        }
+
+        if (level == bar->level[cell])
+        {
+            continue;
+        }
+
+        screen_putch(bargraph_cell_char(level), (uint8_t)(bar->addr + cell));
+        bar->level[cell] = level;
+    }
+}
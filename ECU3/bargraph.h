@@ -0,0 +1,33 @@
+#ifndef BARGRAPH_H
+#define BARGRAPH_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Bar Graph Geometry
+ *---------------------------------------------------------*/
+#define BAR_PIXELS_PER_CELL     5           /* 5x8 font columns */
+#define BAR_MAX_CELLS           16
+
+/* Cell level that has never been drawn (forces a rewrite) */
+#define BAR_LEVEL_UNKNOWN       0xFF
+
+/*---------------------------------------------------------
+ * Bar Graph Instance
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  addr;                          /* DDRAM address of first cell */
+    uint8_t  cells;                         /* Width in characters */
+    uint16_t full_scale;                    /* Value drawn as a full bar */
+    uint8_t  level[BAR_MAX_CELLS];          /* Columns lit per cell, as shown */
+} bargraph_t;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void bargraph_init(bargraph_t *bar, uint8_t addr, uint8_t cells, uint16_t full_scale);
+void bargraph_invalidate(bargraph_t *bar);
+void bargraph_draw(bargraph_t *bar, uint16_t value);
+
+#endif /* BARGRAPH_H */
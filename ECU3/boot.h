@@ -0,0 +1,31 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+#include "tick.h"
+
+/*---------------------------------------------------------
+ * Boot Timeline (ms since the system tick started)
+ *---------------------------------------------------------*/
+#define BOOT_MARK_UNSET             0xFFFF
+
+typedef struct
+{
+    uint16_t can_ready_ms;          /* ECAN in normal mode */
+    uint16_t first_frame_ms;        /* First dashboard frame received */
+    uint16_t lcd_ready_ms;          /* LCD power-on sequence complete */
+    uint16_t first_pixel_ms;        /* First received value drawn */
+} boot_timeline_t;
+
+extern boot_timeline_t g_boot_timeline;
+
+/* Record an event the first time it happens */
+#define BOOT_MARK(field)                                                    \
+{                                                                           \
+    if (g_boot_timeline.field == BOOT_MARK_UNSET)                           \
+    {                                                                       \
+        g_boot_timeline.field = (uint16_t)((tick_now() * TICK_PERIOD_US) / 1000UL); \
+    }                                                                       \
+}
+
+#endif /* BOOT_H */
@@ -0,0 +1,70 @@
+#ifndef CAN_SELFTEST_H
+#define CAN_SELFTEST_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Boot Selection
+ *
+ *  The self-test runs once at boot, before normal CAN
+ *  traffic, when CAN_SELFTEST_REQUESTED() is true. By
+ *  default it follows CAN_SELFTEST_AT_BOOT; a board can
+ *  redefine it to read a strap pin instead.
+ *---------------------------------------------------------*/
+#ifndef CAN_SELFTEST_AT_BOOT
+#define CAN_SELFTEST_AT_BOOT        0
+#endif
+
+#ifndef CAN_SELFTEST_REQUESTED
+#define CAN_SELFTEST_REQUESTED()    (CAN_SELFTEST_AT_BOOT)
+#endif
+
+/* Number of frames pushed through the loopback */
+#ifndef CAN_SELFTEST_FRAMES
+#define CAN_SELFTEST_FRAMES         256U
+#endif
+
+/* Wait for a looped-back frame, in instruction cycles (Timer1);
+ * 1 ms, several longest frames at 500 kbit/s */
+#define CAN_SELFTEST_RX_WAIT_CYCLES 5000U
+
+/*---------------------------------------------------------
+ * Report Pages (SELFTEST_REPORT_MSG_ID, byte 0 = page,
+ * then 3 x u16 little-endian)
+ *---------------------------------------------------------*/
+#define CAN_SELFTEST_PAGE_RESULT    0   /* frames, lost, mismatches */
+#define CAN_SELFTEST_PAGE_RATE      1   /* elapsed_ms, frames_per_s, mode_ok */
+#define CAN_SELFTEST_PAGE_TX        2   /* tx cycles min, avg, max */
+#define CAN_SELFTEST_PAGE_RX        3   /* rx cycles min, avg, max */
+#define CAN_SELFTEST_PAGES          4
+
+/*---------------------------------------------------------
+ * Benchmark Result (readable over XCP)
+ *  Cycle figures are instruction cycles (Fosc / 4) spent
+ *  inside can_transmit() / can_receive() per frame.
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint16_t frames;
+    uint16_t lost;                  /* Not looped back in time */
+    uint16_t mismatches;            /* ID, DLC or payload differ */
+    uint16_t elapsed_ms;
+    uint16_t frames_per_s;
+    uint16_t mode_ok;               /* Loopback and normal mode entered */
+    uint16_t tx_cycles_min;
+    uint16_t tx_cycles_avg;
+    uint16_t tx_cycles_max;
+    uint16_t rx_cycles_min;
+    uint16_t rx_cycles_avg;
+    uint16_t rx_cycles_max;
+} can_selftest_result_t;
+
+extern can_selftest_result_t g_can_selftest;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+uint8_t can_selftest_run(uint16_t frames);
+void    can_selftest_report_poll(void);
+
+#endif /* CAN_SELFTEST_H */
@@ -0,0 +1,11 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+/*---------------------------------------------------------
+ * Oscillator Frequency
+ *  Single definition used by __delay_xx(), the system tick
+ *  and the CAN bit-timing solver.
+ *---------------------------------------------------------*/
+#define _XTAL_FREQ                  20000000UL
+
+#endif /* CLOCK_H */
@@ -0,0 +1,229 @@
+/***********************************************************************
+ *  File name   : diag.c
+ *  Description : Diagnostic responder on the ISO-TP channel.
+ *                Takes one complete request from isotp.c, answers
+ *                it in place in the ISO-TP transmit buffer (sent on
+ *                DIAG_RESP_MSG_ID) and releases the receive buffer,
+ *                so the next request can come in. A request waits
+ *                in the RX buffer while a previous response is
+ *                still being sent.
+ *
+ *                Services (UDS subset):
+ *                - 0x22 ReadDataByIdentifier, one DID per request
+ *                - 0x3E TesterPresent (optionally suppressed)
+ *                Anything else gets a negative response.
+ *
+ *  API:
+ *      - diag_poll()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include <stddef.h>
+#include "diag.h"
+#include "isotp.h"
+#include "odometer.h"
+#include "msg_handler.h"
+#include "boot.h"
+#include "nm.h"
+#include "profile.h"
+
+/* Largest records must fit the ISO-TP transmit buffer */
+#if ISOTP_TX_BUF_SIZE < 3 + 1 + 8 * PROFILE_PROBES || ISOTP_TX_BUF_SIZE < 3 + 6 * E2E_RX_SLOTS
+#error "ISOTP_TX_BUF_SIZE is too small for the diagnostic records"
+#endif
+
+uint16_t g_diag_requests;
+uint16_t g_diag_rejected;
+
+/*---------------------------------------------------------
+ *  Local Helper : Append big-endian values
+ *---------------------------------------------------------*/
+static uint16_t diag_put_u16(uint8_t *buf, uint16_t pos, uint16_t value)
+{
+    buf[pos]     = (uint8_t)(value >> 8);
+    buf[pos + 1] = (uint8_t)value;
+
+    return (uint16_t)(pos + 2);
+}
+
+static uint16_t diag_put_u32(uint8_t *buf, uint16_t pos, uint32_t value)
+{
+    pos = diag_put_u16(buf, pos, (uint16_t)(value >> 16));
+
+    return diag_put_u16(buf, pos, (uint16_t)value);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Negative response (3 bytes)
+ *---------------------------------------------------------*/
+static uint16_t diag_negative(uint8_t *rsp, uint8_t sid, uint8_t nrc)
+{
+    rsp[0] = DIAG_NEGATIVE;
+    rsp[1] = sid;
+    rsp[2] = nrc;
+
+    g_diag_rejected++;
+
+    return 3;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Record of one DID after rsp[0..2]
+ *  Returns the response length, 0 for an unknown DID.
+ *---------------------------------------------------------*/
+static uint16_t diag_read_did(uint8_t *rsp, uint16_t did)
+{
+    uint16_t pos = 3;
+
+    switch (did)
+    {
+        case DIAG_DID_ODOMETER:
+            pos = diag_put_u32(rsp, pos, odometer_total_m());
+            pos = diag_put_u32(rsp, pos, odometer_trip_m());
+            break;
+
+        case DIAG_DID_E2E:
+            for (uint8_t i = 0; i < E2E_RX_SLOTS; i++)
+            {
+                pos = diag_put_u16(rsp, pos, g_e2e_rx[i].repeated);
+                pos = diag_put_u16(rsp, pos, g_e2e_rx[i].skipped);
+                pos = diag_put_u16(rsp, pos, g_e2e_rx[i].crc_failed);
+            }
+            break;
+
+        case DIAG_DID_BOOT:
+            pos = diag_put_u16(rsp, pos, g_boot_timeline.can_ready_ms);
+            pos = diag_put_u16(rsp, pos, g_boot_timeline.first_frame_ms);
+            pos = diag_put_u16(rsp, pos, g_boot_timeline.lcd_ready_ms);
+            pos = diag_put_u16(rsp, pos, g_boot_timeline.first_pixel_ms);
+            break;
+
+        case DIAG_DID_NODES:
+            for (uint8_t i = 0; i < NM_NODE_COUNT; i++)
+            {
+                rsp[pos++] = g_nm_nodes[i].present;
+                rsp[pos++] = g_nm_nodes[i].state;
+                rsp[pos++] = g_nm_nodes[i].tec;
+                rsp[pos++] = g_nm_nodes[i].rec;
+                rsp[pos++] = g_nm_nodes[i].joins;
+            }
+            break;
+
+#if PROFILE_ENABLE
+        case DIAG_DID_PROFILE:
+            rsp[pos++] = g_profile_load;
+
+            for (uint8_t i = 0; i < PROFILE_PROBES; i++)
+            {
+                const profile_probe_t *probe = &g_profile[i];
+
+                pos = diag_put_u16(rsp, pos, probe->min);
+                pos = diag_put_u16(rsp, pos, probe->max);
+                pos = diag_put_u16(rsp, pos, probe->count);
+                pos = diag_put_u16(rsp, pos, (probe->count != 0) ?
+                                   (uint16_t)(probe->sum / probe->count) : 0);
+            }
+            break;
+#endif
+
+        default:
+            return 0;
+    }
+
+    return pos;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Build the response to one request
+ *  Returns its length, 0 for no response.
+ *---------------------------------------------------------*/
+static uint16_t diag_handle(const uint8_t *req, uint16_t len, uint8_t *rsp)
+{
+    uint8_t  sid = req[0];
+    uint16_t did;
+    uint16_t rsp_len;
+
+    switch (sid)
+    {
+        case DIAG_SID_READ_DID:
+            if (len != 3)
+            {
+                return diag_negative(rsp, sid, DIAG_NRC_BAD_LENGTH);
+            }
+
+            did     = ((uint16_t)req[1] << 8) | req[2];
+            rsp_len = diag_read_did(rsp, did);
+
+            if (rsp_len == 0)
+            {
+                return diag_negative(rsp, sid, DIAG_NRC_OUT_OF_RANGE);
+            }
+
+            rsp[0] = DIAG_POSITIVE(sid);
+            rsp[1] = req[1];
+            rsp[2] = req[2];
+            return rsp_len;
+
+        case DIAG_SID_TESTER_PRESENT:
+            if (len != 2)
+            {
+                return diag_negative(rsp, sid, DIAG_NRC_BAD_LENGTH);
+            }
+
+            if (req[1] == DIAG_TP_SUPPRESS_RESPONSE)
+            {
+                return 0;
+            }
+
+            if (req[1] != 0)
+            {
+                return diag_negative(rsp, sid, DIAG_NRC_OUT_OF_RANGE);
+            }
+
+            rsp[0] = DIAG_POSITIVE(sid);
+            rsp[1] = 0;
+            return 2;
+
+        default:
+            return diag_negative(rsp, sid, DIAG_NRC_NOT_SUPPORTED);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : diag_poll
+ * Description :
+ *    Answers the pending request, if any, once the ISO-TP
+ *    transmit side is free, then releases the request.
+ *---------------------------------------------------------*/
+void diag_poll(void)
+{
+    const uint8_t *req;
+    uint8_t       *rsp;
+    uint16_t       len;
+
+    req = isotp_rx_data(&len);
+
+    if (req == NULL)
+    {
+        return;
+    }
+
+    rsp = isotp_tx_claim();
+
+    if (rsp == NULL)
+    {
+        return;
+    }
+
+    g_diag_requests++;
+
+    len = diag_handle(req, len, rsp);
+
+    isotp_rx_release();
+
+    if (len != 0)
+    {
+        isotp_tx_commit(len);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Diagnostic Services (UDS subset, ISO-TP on 0x7E0/0x7E8)
+ *---------------------------------------------------------*/
+#define DIAG_SID_READ_DID           0x22
+#define DIAG_SID_TESTER_PRESENT     0x3E
+
+#define DIAG_POSITIVE(sid)          ((uint8_t)((sid) + 0x40))
+#define DIAG_NEGATIVE               0x7F
+
+#define DIAG_NRC_NOT_SUPPORTED      0x11
+#define DIAG_NRC_BAD_LENGTH         0x13
+#define DIAG_NRC_OUT_OF_RANGE       0x31
+
+#define DIAG_TP_SUPPRESS_RESPONSE   0x80
+
+/*---------------------------------------------------------
+ * Data Identifiers (ReadDataByIdentifier, big-endian)
+ *
+ *  ODOMETER : odometer m (u32), trip m (u32)
+ *  E2E      : per dashboard message SPEED .. INDICATOR:
+ *             repeated, skipped, crc_failed (u16 each)
+ *  BOOT     : boot timeline, 4 x u16 ms
+ *  NODES    : per node 1 .. NM_NODE_COUNT: present, state,
+ *             tec, rec, joins
+ *  PROFILE  : load %, then per probe min, max, count (u16)
+ *             and average (u16) cycles
+ *---------------------------------------------------------*/
+#define DIAG_DID_ODOMETER           0xF100
+#define DIAG_DID_E2E                0xF101
+#define DIAG_DID_BOOT               0xF102
+#define DIAG_DID_NODES              0xF103
+#define DIAG_DID_PROFILE            0xF104
+
+/* Requests answered / rejected (readable over XCP) */
+extern uint16_t g_diag_requests;
+extern uint16_t g_diag_rejected;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void diag_poll(void);
+
+#endif /* DIAG_H */
@@ -0,0 +1,20 @@
+/* Generated by tools/gen_hal_cfg.py from tools/hal_nodes.csv, do not edit */
+
+#ifndef HAL_CFG_H
+#define HAL_CFG_H
+
+/*---------------------------------------------------------
+ * Shared Driver Configuration : ECU3
+ *---------------------------------------------------------*/
+#define HAL_NODE_ID                 3     /* NM / XCP / boot / profile IDs */
+#define HAL_TSYNC_MASTER            1     /* Time master, Timer1 */
+#define HAL_CAN_RX_IRQ              1     /* RX ISR + ring */
+#define HAL_CAN_FILTER_NODE         0     /* Accept every frame */
+#define HAL_CAN_TX_WAIT_LOOPS       0     /* Callers check ECAN_TX0_BUSY */
+#define HAL_ADC                     0     /* adc.c */
+#define HAL_CLCD                    1     /* clcd.c */
+#define HAL_DIGITAL_KEYPAD          0     /* digital_keypad.c */
+#define HAL_CALIB                   0     /* calib.c */
+#define HAL_TTSCHED                 0     /* ttsched.c */
+
+#endif /* HAL_CFG_H */
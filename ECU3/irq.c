@@ -0,0 +1,95 @@
+/***********************************************************************
+ *  File name   : irq.c
+ *  Description : Two-level interrupt priority set-up and the
+ *                interrupt latency report.
+ *                init_irq() assigns every source used on ECU3 to
+ *                the high or low vector (see irq.h) and enables
+ *                both levels. The ISRs (isr.c) record the latency
+ *                of the tick, the time base and CAN reception;
+ *                the worst case since boot is sent once a second.
+ *
+ *  API:
+ *      - init_irq()
+ *      - irq_report_poll()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "irq.h"
+#include "can.h"
+#include "msg_id.h"
+#include "tick.h"
+
+/*---------------------------------------------------------
+ * Latency Statistics
+ *---------------------------------------------------------*/
+irq_latency_t g_irq_latency[IRQ_SRC_COUNT];
+
+static uint32_t g_report_tick;
+
+/*---------------------------------------------------------
+ * Function : init_irq
+ * Description :
+ *    Enables priority mode and sets each source's priority
+ *    bit. Sources power up as high priority, so only the
+ *    low ones strictly need setting; all are written to
+ *    keep the map in one place. Call before any module
+ *    enables its interrupt.
+ *---------------------------------------------------------*/
+void init_irq(void)
+{
+    for (uint8_t i = 0; i < IRQ_SRC_COUNT; i++)
+    {
+        g_irq_latency[i].last  = 0;
+        g_irq_latency[i].max   = 0;
+        g_irq_latency[i].count = 0;
+    }
+
+    RCONbits.IPEN = 1;
+
+    /* High priority */
+    RXB0IP = 1;
+    RXB1IP = 1;
+    TMR1IP = 1;
+    TXB0IP = 1;
+    WAKIP  = 1;
+
+    /* Low priority */
+    TMR2IP = 0;
+    TXIP   = 0;
+
+    g_report_tick = 0;
+
+    GIEL = 1;
+    GIEH = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : irq_report_poll
+ * Description :
+ *    Sends the worst-case latency per source (u16 cycles,
+ *    tick / time base / CAN RX) and the RX overrun count
+ *    every IRQ_REPORT_PERIOD_MS when TXB0 is free.
+ *---------------------------------------------------------*/
+void irq_report_poll(void)
+{
+    uint8_t  report[7];
+    uint32_t now = tick_now();
+
+    if ((now - g_report_tick) < TICK_FROM_MS(IRQ_REPORT_PERIOD_MS) || ECAN_TX0_BUSY)
+    {
+        return;
+    }
+
+    g_report_tick = now;
+
+    for (uint8_t i = 0; i < IRQ_SRC_COUNT; i++)
+    {
+        report[2 * i]     = (uint8_t)g_irq_latency[i].max;
+        report[2 * i + 1] = (uint8_t)(g_irq_latency[i].max >> 8);
+    }
+
+    report[6] = (g_can_rx_overruns > 0xFF) ? 0xFF : (uint8_t)g_can_rx_overruns;
+
+    can_transmit(IRQ_LATENCY_MSG_ID, report, sizeof(report));
+}
@@ -0,0 +1,74 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Interrupt Priorities (RCON.IPEN = 1)
+ *
+ *  High : CAN receive (RXB0/RXB1 drained into the RX ring
+ *         before the two-frame hardware buffer overruns),
+ *         Timer1 overflow (network time base) and the SYNC
+ *         transmit timestamp (TXB0).
+ *  Low  : Timer2 system tick (software timers, blink and
+ *         display pacing) and the EUSART telemetry bytes.
+ *
+ *  A high priority source preempts the low priority ISR,
+ *  never the other way round.
+ *---------------------------------------------------------*/
+
+/*---------------------------------------------------------
+ * Latency Measurement Sources
+ *
+ *  tick     : TMR2 counts since the period match (x4 cycles)
+ *  timebase : TMR1 counts since the overflow
+ *  can_rx   : TMR1 minus the CCP1 capture of the CAN
+ *             receive signal (CIOCON.CANCAP)
+ *
+ *  All figures are instruction cycles from the event to
+ *  the first statement of the handler, context save
+ *  included (0.2 us per cycle at 20 MHz).
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_irq_tick = 0,
+    e_irq_timebase,
+    e_irq_can_rx,
+    IRQ_SRC_COUNT
+} IrqSource;
+
+#define IRQ_TMR2_CYCLES_PER_COUNT   4U      /* Timer2 prescaler (tick.c) */
+
+typedef struct
+{
+    uint16_t last;
+    uint16_t max;
+    uint16_t count;
+} irq_latency_t;
+
+/* Readable over XCP; reported on IRQ_LATENCY_MSG_ID */
+extern irq_latency_t g_irq_latency[IRQ_SRC_COUNT];
+
+#define IRQ_REPORT_PERIOD_MS        1000U
+
+/*---------------------------------------------------------
+ * Record one latency sample (called from the ISRs)
+ *---------------------------------------------------------*/
+#define IRQ_LATENCY(src, cycles)                    \
+{                                                   \
+    g_irq_latency[src].last = (cycles);             \
+    g_irq_latency[src].count++;                     \
+    if ((cycles) > g_irq_latency[src].max)          \
+    {                                               \
+        g_irq_latency[src].max = (cycles);          \
+    }                                               \
+}
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void init_irq(void);
+void irq_report_poll(void);
+
+#endif /* IRQ_H */
@@ -0,0 +1,520 @@
+/***********************************************************************
+ *  File name   : isotp.c
+ *  Description : ISO 15765-2 (ISO-TP) transport layer on top of the
+ *                single-frame ECAN driver.
+ *                Segments messages up to ISOTP_TX_BUF_SIZE bytes into
+ *                single/first/consecutive frames, honours the peer's
+ *                block size and STmin, and reassembles incoming
+ *                messages with flow control. Everything runs from
+ *                isotp_poll()/isotp_on_frame() without blocking, one
+ *                frame per call at most, using static buffers only.
+ *
+ *                A received message stays in the RX buffer until the
+ *                consumer (diag.c) releases it; responses are built
+ *                in place in the TX buffer (claim / commit).
+ *
+ *  API:
+ *      - isotp_init()
+ *      - isotp_send()
+ *      - isotp_tx_claim()
+ *      - isotp_tx_commit()
+ *      - isotp_tx_busy()
+ *      - isotp_on_frame()
+ *      - isotp_rx_data()
+ *      - isotp_rx_release()
+ *      - isotp_poll()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include <stddef.h>
+#include "isotp.h"
+#include "can.h"
+#include "msg_id.h"
+#include "tick.h"
+
+#if ISOTP_RX_BUF_SIZE > 4095 || ISOTP_TX_BUF_SIZE > 4095
+#error "ISOTP_*_BUF_SIZE exceeds the 12-bit ISO-TP length field"
+#endif
+
+/*---------------------------------------------------------
+ * Channel States
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_isotp_tx_idle = 0,
+    e_isotp_tx_wait_fc,
+    e_isotp_tx_send_cf
+} IsoTpTxState;
+
+typedef enum
+{
+    e_isotp_rx_idle = 0,
+    e_isotp_rx_receiving,
+    e_isotp_rx_done
+} IsoTpRxState;
+
+/*---------------------------------------------------------
+ * Transmit Side
+ *---------------------------------------------------------*/
+static uint8_t      g_tx_buf[ISOTP_TX_BUF_SIZE];
+static uint16_t     g_tx_len;
+static uint16_t     g_tx_pos;
+static uint8_t      g_tx_sn;
+static uint8_t      g_tx_bs;            /* Block size granted by peer */
+static uint8_t      g_tx_bs_count;      /* CFs sent in current block */
+static uint8_t      g_tx_stmin;         /* Ticks between CFs */
+static uint32_t     g_tx_timer;         /* Last CF / FC deadline base */
+static IsoTpTxState g_tx_state = e_isotp_tx_idle;
+
+/*---------------------------------------------------------
+ * Receive Side
+ *---------------------------------------------------------*/
+static uint8_t      g_rx_buf[ISOTP_RX_BUF_SIZE];
+static uint16_t     g_rx_len;
+static uint16_t     g_rx_pos;
+static uint8_t      g_rx_sn;
+static uint8_t      g_rx_bs_count;
+static uint8_t      g_rx_fc_pending;    /* FC status to send, 0xFF = none */
+static uint32_t     g_rx_timer;
+static IsoTpRxState g_rx_state = e_isotp_rx_idle;
+
+/*---------------------------------------------------------
+ *  Local Helper : Send one padded frame if TX buffer is free
+ *  Returns 1 on success, 0 if the hardware is still busy.
+ *---------------------------------------------------------*/
+static uint8_t isotp_send_frame(const uint8_t *frame, uint8_t used)
+{
+    uint8_t padded[CAN_MAX_DLC];
+
+    if (ECAN_TX0_BUSY)
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < CAN_MAX_DLC; i++)
+    {
+        padded[i] = (i < used) ? frame[i] : ISOTP_PAD_BYTE;
+    }
+
+    can_transmit(ISOTP_TX_ID, padded, CAN_MAX_DLC);
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Convert an STmin byte into ticks
+ *      0x00 - 0x7F : milliseconds
+ *      0xF1 - 0xF9 : 100 - 900 us (rounded up to one tick)
+ *      other       : reserved, treated as 127 ms
+ *  A non-zero STmin gets one tick more: the previous CF may
+ *  have gone out just before a tick edge.
+ *---------------------------------------------------------*/
+static uint8_t isotp_stmin_ticks(uint8_t stmin)
+{
+    if (stmin == 0)
+    {
+        return 0;
+    }
+
+    if (stmin <= 0x7F)
+    {
+        return (uint8_t)(TICK_FROM_MS(stmin) + 1);
+    }
+
+    if (stmin >= 0xF1 && stmin <= 0xF9)
+    {
+        return 2;
+    }
+
+    return (uint8_t)(TICK_FROM_MS(0x7F) + 1);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Send the next consecutive frame
+ *---------------------------------------------------------*/
+static void isotp_tx_next_cf(void)
+{
+    uint8_t  frame[CAN_MAX_DLC];
+    uint16_t remaining = g_tx_len - g_tx_pos;
+    uint8_t  chunk = (remaining > 7) ? 7 : (uint8_t)remaining;
+
+    frame[0] = ISOTP_PCI_CF | g_tx_sn;
+
+    for (uint8_t i = 0; i < chunk; i++)
+    {
+        frame[1 + i] = g_tx_buf[g_tx_pos + i];
+    }
+
+    if (!isotp_send_frame(frame, (uint8_t)(chunk + 1)))
+    {
+        return;
+    }
+
+    g_tx_pos  += chunk;
+    g_tx_sn    = (g_tx_sn + 1) & 0x0F;
+    g_tx_timer = tick_now();
+
+    if (g_tx_pos >= g_tx_len)
+    {
+        g_tx_state = e_isotp_tx_idle;
+    }
+    else if (g_tx_bs != 0 && ++g_tx_bs_count >= g_tx_bs)
+    {
+        g_tx_state = e_isotp_tx_wait_fc;
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Handle a flow control frame from the peer
+ *---------------------------------------------------------*/
+static void isotp_on_flow_control(const uint8_t *data, uint8_t len)
+{
+    if (g_tx_state != e_isotp_tx_wait_fc || len < 3)
+    {
+        return;
+    }
+
+    switch (data[0] & 0x0F)
+    {
+        case ISOTP_FC_CTS:
+            g_tx_bs       = data[1];
+            g_tx_bs_count = 0;
+            g_tx_stmin    = isotp_stmin_ticks(data[2]);
+            g_tx_state    = e_isotp_tx_send_cf;
+            /* First CF of a block may go out immediately */
+            g_tx_timer    = tick_now() - g_tx_stmin;
+            break;
+
+        case ISOTP_FC_WAIT:
+            g_tx_timer = tick_now();
+            break;
+
+        default:                            /* Overflow or invalid */
+            g_tx_state = e_isotp_tx_idle;
+            break;
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Try to send a pending flow control frame
+ *---------------------------------------------------------*/
+static void isotp_rx_send_fc(void)
+{
+    uint8_t frame[3];
+
+    frame[0] = ISOTP_PCI_FC | g_rx_fc_pending;
+    frame[1] = ISOTP_RX_BLOCK_SIZE;
+    frame[2] = ISOTP_RX_STMIN;
+
+    if (isotp_send_frame(frame, 3))
+    {
+        g_rx_fc_pending = 0xFF;
+        g_rx_timer      = tick_now();
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_init
+ * Description :
+ *    Resets both directions of the channel.
+ *---------------------------------------------------------*/
+void isotp_init(void)
+{
+    g_tx_state      = e_isotp_tx_idle;
+    g_rx_state      = e_isotp_rx_idle;
+    g_rx_fc_pending = 0xFF;
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_tx_claim
+ * Description :
+ *    Returns the channel's transmit buffer
+ *    (ISOTP_TX_BUF_SIZE bytes) so a message can be built in
+ *    place, or NULL while a message is still being sent.
+ *---------------------------------------------------------*/
+uint8_t *isotp_tx_claim(void)
+{
+    return (g_tx_state == e_isotp_tx_idle) ? g_tx_buf : NULL;
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_tx_commit
+ * Description :
+ *    Sends the first len bytes of the claimed buffer; frames
+ *    go out from isotp_poll().
+ *
+ *    Returns 1 if accepted, 0 if busy or too long.
+ *---------------------------------------------------------*/
+uint8_t isotp_tx_commit(uint16_t len)
+{
+    if (g_tx_state != e_isotp_tx_idle || len == 0 || len > ISOTP_TX_BUF_SIZE)
+    {
+        return 0;
+    }
+
+    g_tx_len   = len;
+    g_tx_pos   = 0;
+    g_tx_state = e_isotp_tx_send_cf;        /* SF/FF sent from poll */
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_send
+ * Description :
+ *    Queues a copy of a message for transmission.
+ *
+ *    Returns 1 if accepted, 0 if busy or too long.
+ *---------------------------------------------------------*/
+uint8_t isotp_send(const uint8_t *data, uint16_t len)
+{
+    if (isotp_tx_claim() == NULL || len == 0 || len > ISOTP_TX_BUF_SIZE)
+    {
+        return 0;
+    }
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        g_tx_buf[i] = data[i];
+    }
+
+    return isotp_tx_commit(len);
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_tx_busy
+ * Description :
+ *    Returns 1 while a message is being transmitted.
+ *---------------------------------------------------------*/
+uint8_t isotp_tx_busy(void)
+{
+    return (g_tx_state != e_isotp_tx_idle);
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_on_frame
+ * Description :
+ *    Feeds one received ISOTP_RX_ID frame into the channel.
+ *---------------------------------------------------------*/
+void isotp_on_frame(const uint8_t *data, uint8_t len)
+{
+    uint8_t  pci;
+    uint16_t msg_len;
+    uint8_t  chunk;
+
+    if (len == 0)
+    {
+        return;
+    }
+
+    pci = data[0] & 0xF0;
+
+    if (pci == ISOTP_PCI_FC)
+    {
+        isotp_on_flow_control(data, len);
+        return;
+    }
+
+    /* Previous message not yet consumed: drop new ones */
+    if (g_rx_state == e_isotp_rx_done)
+    {
+        return;
+    }
+
+    if (pci == ISOTP_PCI_SF)
+    {
+        msg_len = data[0] & 0x0F;
+
+        if (msg_len == 0 || msg_len > 7 || msg_len + 1 > len)
+        {
+            return;
+        }
+
+        for (uint8_t i = 0; i < msg_len; i++)
+        {
+            g_rx_buf[i] = data[1 + i];
+        }
+
+        g_rx_len   = msg_len;
+        g_rx_state = e_isotp_rx_done;
+    }
+    else if (pci == ISOTP_PCI_FF)
+    {
+        if (len < CAN_MAX_DLC)
+        {
+            return;
+        }
+
+        msg_len = ((uint16_t)(data[0] & 0x0F) << 8) | data[1];
+
+        if (msg_len <= 7)
+        {
+            return;
+        }
+
+        if (msg_len > ISOTP_RX_BUF_SIZE)
+        {
+            g_rx_fc_pending = ISOTP_FC_OVFLW;
+            g_rx_state      = e_isotp_rx_idle;
+            return;
+        }
+
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            g_rx_buf[i] = data[2 + i];
+        }
+
+        g_rx_len        = msg_len;
+        g_rx_pos        = 6;
+        g_rx_sn         = 1;
+        g_rx_bs_count   = 0;
+        g_rx_fc_pending = ISOTP_FC_CTS;
+        g_rx_state      = e_isotp_rx_receiving;
+    }
+    else if (pci == ISOTP_PCI_CF)
+    {
+        if (g_rx_state != e_isotp_rx_receiving)
+        {
+            return;
+        }
+
+        /* Sequence error aborts the reception */
+        if ((data[0] & 0x0F) != g_rx_sn)
+        {
+            g_rx_state = e_isotp_rx_idle;
+            return;
+        }
+
+        chunk = (g_rx_len - g_rx_pos > 7) ? 7 : (uint8_t)(g_rx_len - g_rx_pos);
+
+        if (chunk + 1 > len)
+        {
+            g_rx_state = e_isotp_rx_idle;
+            return;
+        }
+
+        for (uint8_t i = 0; i < chunk; i++)
+        {
+            g_rx_buf[g_rx_pos + i] = data[1 + i];
+        }
+
+        g_rx_pos  += chunk;
+        g_rx_sn    = (g_rx_sn + 1) & 0x0F;
+        g_rx_timer = tick_now();
+
+        if (g_rx_pos >= g_rx_len)
+        {
+            g_rx_state = e_isotp_rx_done;
+        }
+        else if (ISOTP_RX_BLOCK_SIZE != 0 && ++g_rx_bs_count >= ISOTP_RX_BLOCK_SIZE)
+        {
+            g_rx_bs_count   = 0;
+            g_rx_fc_pending = ISOTP_FC_CTS;
+        }
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_rx_data
+ * Description :
+ *    Returns the completed received message (and its length)
+ *    or NULL if none. The buffer stays valid until
+ *    isotp_rx_release() is called.
+ *---------------------------------------------------------*/
+const uint8_t *isotp_rx_data(uint16_t *len)
+{
+    if (g_rx_state != e_isotp_rx_done)
+    {
+        return NULL;
+    }
+
+    *len = g_rx_len;
+
+    return g_rx_buf;
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_rx_release
+ * Description :
+ *    Frees the receive buffer for the next message.
+ *---------------------------------------------------------*/
+void isotp_rx_release(void)
+{
+    g_rx_state = e_isotp_rx_idle;
+}
+
+/*---------------------------------------------------------
+ * Function : isotp_poll
+ * Description :
+ *    Advances both state machines: sends pending FC, the next
+ *    SF/FF/CF when STmin allows, and handles N_Bs / N_Cr
+ *    timeouts. Sends at most one frame per direction.
+ *---------------------------------------------------------*/
+void isotp_poll(void)
+{
+    uint8_t  frame[CAN_MAX_DLC];
+    uint32_t now = tick_now();
+
+    /* Receive side */
+    if (g_rx_fc_pending != 0xFF)
+    {
+        isotp_rx_send_fc();
+    }
+    else if (g_rx_state == e_isotp_rx_receiving &&
+             (now - g_rx_timer) > TICK_FROM_MS(ISOTP_TIMEOUT_CR_MS))
+    {
+        g_rx_state = e_isotp_rx_idle;
+    }
+
+    /* Transmit side */
+    if (g_tx_state == e_isotp_tx_send_cf && g_tx_pos == 0)
+    {
+        if (g_tx_len <= 7)
+        {
+            frame[0] = ISOTP_PCI_SF | (uint8_t)g_tx_len;
+
+            for (uint8_t i = 0; i < g_tx_len; i++)
+            {
+                frame[1 + i] = g_tx_buf[i];
+            }
+
+            if (isotp_send_frame(frame, (uint8_t)(g_tx_len + 1)))
+            {
+                g_tx_state = e_isotp_tx_idle;
+            }
+        }
+        else
+        {
+            frame[0] = ISOTP_PCI_FF | (uint8_t)(g_tx_len >> 8);
+            frame[1] = (uint8_t)g_tx_len;
+
+            for (uint8_t i = 0; i < 6; i++)
+            {
+                frame[2 + i] = g_tx_buf[i];
+            }
+
+            if (isotp_send_frame(frame, CAN_MAX_DLC))
+            {
+                g_tx_pos   = 6;
+                g_tx_sn    = 1;
+                g_tx_timer = now;
+                g_tx_state = e_isotp_tx_wait_fc;
+            }
+        }
+    }
+    else if (g_tx_state == e_isotp_tx_send_cf)
+    {
+        if ((now - g_tx_timer) >= g_tx_stmin)
+        {
+            isotp_tx_next_cf();
+        }
+    }
+    else if (g_tx_state == e_isotp_tx_wait_fc)
+    {
+        if ((now - g_tx_timer) > TICK_FROM_MS(ISOTP_TIMEOUT_BS_MS))
+        {
+            g_tx_state = e_isotp_tx_idle;
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ISOTP_H
+#define ISOTP_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * ISO-TP Channel Configuration
+ *---------------------------------------------------------*/
+/*
+ * Max message length per direction (<= 4095). Requests to this
+ * node are short; responses are the largest diagnostic record
+ * (diag.c), so neither buffer needs to hold more.
+ */
+#ifndef ISOTP_RX_BUF_SIZE
+#define ISOTP_RX_BUF_SIZE           32
+#endif
+
+#ifndef ISOTP_TX_BUF_SIZE
+#define ISOTP_TX_BUF_SIZE           64
+#endif
+
+#define ISOTP_TX_ID                 DIAG_RESP_MSG_ID
+#define ISOTP_RX_ID                 DIAG_REQ_MSG_ID
+
+/* Flow control parameters this node offers as receiver */
+#define ISOTP_RX_BLOCK_SIZE         8       /* CFs per FC, 0 = unlimited */
+#define ISOTP_RX_STMIN              0       /* ms between CFs */
+
+/* Timeouts (ms) */
+#define ISOTP_TIMEOUT_BS_MS         1000    /* Wait for FC after FF/block */
+#define ISOTP_TIMEOUT_CR_MS         1000    /* Wait for next CF */
+
+#define ISOTP_PAD_BYTE              0xCC
+
+/*---------------------------------------------------------
+ * Protocol Control Information (upper nibble of byte 0)
+ *---------------------------------------------------------*/
+#define ISOTP_PCI_SF                0x00
+#define ISOTP_PCI_FF                0x10
+#define ISOTP_PCI_CF                0x20
+#define ISOTP_PCI_FC                0x30
+
+#define ISOTP_FC_CTS                0
+#define ISOTP_FC_WAIT               1
+#define ISOTP_FC_OVFLW              2
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void           isotp_init(void);
+uint8_t        isotp_send(const uint8_t *data, uint16_t len);
+uint8_t       *isotp_tx_claim(void);
+uint8_t        isotp_tx_commit(uint16_t len);
+uint8_t        isotp_tx_busy(void);
+void           isotp_on_frame(const uint8_t *data, uint8_t len);
+const uint8_t *isotp_rx_data(uint16_t *len);
+void           isotp_rx_release(void);
+void           isotp_poll(void);
+
+#endif /* ISOTP_H */
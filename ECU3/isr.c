@@ -1,22 +1,57 @@
 #include <xc.h>
-
-/* External timing counter */
-extern unsigned long int timer_count;
+#include "tick.h"
+#include "uart.h"
+#include "timesync.h"
+#include "can.h"
+#include "irq.h"
+#include "cycles.h"
 
 /*---------------------------------------------------------
- * Timer0 Interrupt Service Routine
+ * High Priority Interrupt Service Routine
+ *  CAN reception and the network time base. Kept short:
+ *  it preempts the low priority ISR.
  *---------------------------------------------------------*/
-void __interrupt() isr(void)
+void __interrupt(high_priority) isr_high(void)
 {
-    if (TMR0IF)                             /* Timer0 overflow interrupt */
+    if ((RXB0IE && RXB0IF) || (RXB1IE && RXB1IF))   /* Frame received */
+    {
+        can_rx_isr();
+    }
+
+    if (TMR1IE && TMR1IF)                   /* Timer1 overflow (network time base) */
+    {
+        /* Read here: Timer1 may overflow while a frame is drained */
+        IRQ_LATENCY(e_irq_timebase, CYCLES_NOW());
+        tsync_timer_isr();
+    }
+
+    if (TXB0IE && TXB0IF)                   /* SYNC frame has left the bus */
+    {
+        tsync_tx_isr();
+    }
+
+    if (WAKIE && WAKIF)                     /* Bus activity during SLEEP */
     {
-        TMR0 = TMR0 + 9;                    /* Reload value (preserves timing) */
+        WAKIE = 0;
+        WAKIF = 0;
+    }
+}
 
-        if (timer_count++ == 20000)         /* 20,000 ticks rollover */
-        {
-            timer_count = 0;
-        }
+/*---------------------------------------------------------
+ * Low Priority Interrupt Service Routine
+ *  System tick (timers, blink, display pacing) and the
+ *  telemetry UART.
+ *---------------------------------------------------------*/
+void __interrupt(low_priority) isr_low(void)
+{
+    if (TMR2IF)                             /* Timer2 period match (system tick) */
+    {
+        IRQ_LATENCY(e_irq_tick, (uint16_t)(TMR2 * IRQ_TMR2_CYCLES_PER_COUNT));
+        TICK_ISR();
+    }
 
-        TMR0IF = 0;                         /* Clear interrupt flag */
+    if (TXIE && TXIF)                       /* EUSART ready for next telemetry byte */
+    {
+        uart_tx_isr();
     }
 }
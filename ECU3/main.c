@@ -13,7 +13,39 @@
 #include "clcd.h"
 #include "msg_id.h"
 #include "msg_handler.h"
-#include "timer0.h"
+#include "tick.h"
+#include "sw_timer.h"
+#include "isotp.h"
+#include "diag.h"
+#include "xcp.h"
+#include "odometer.h"
+#include "boot.h"
+#include "can_selftest.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "timesync.h"
+#include "nm.h"
+#include "irq.h"
+#include "power.h"
+#include "eeprom.h"
+#include "uart.h"
+
+/*---------------------------------------------------------
+ * Boot Timeline
+ *---------------------------------------------------------*/
+boot_timeline_t g_boot_timeline =
+{
+    BOOT_MARK_UNSET, BOOT_MARK_UNSET, BOOT_MARK_UNSET, BOOT_MARK_UNSET
+};
+
+static uint8_t g_lcd_ready = 0;
+static uint8_t g_boot_reported = 0;
+
+static uint32_t g_wake_tick = 0;
+
+#if PROFILE_ENABLE && PROFILE_SHOW_LOAD
+static uint8_t g_load_shown = 0;
+#endif
 
 /*---------------------------------------------------------
  * Initialize LED pins
@@ -28,23 +60,151 @@ static void init_leds(void)
 }
 
 /*---------------------------------------------------------
- * Initialize all system-level modules:
- *  - LCD
- *  - CAN peripheral
- *  - LED GPIOs
- *  - Timer0
- *  - Interrupt control
+ * Bus Sleep
+ *  Once NM is in bus sleep and nothing is in flight
+ *  (EEPROM write, telemetry bytes, CAN frames), the ECAN
+ *  module is put to sleep and the CPU stops its clock.
+ *  The next bus edge sets WAKIF and wakes both; the frame
+ *  that caused it is lost, the following NM heartbeat is
+ *  not. After a wake-up the node listens for
+ *  POWER_WAKE_LISTEN_MS before it may sleep again.
+ *---------------------------------------------------------*/
+static void bus_sleep_poll(void)
+{
+    if (g_nm_state != e_nm_bus_sleep ||
+        (tick_now() - g_wake_tick) < TICK_FROM_MS(POWER_WAKE_LISTEN_MS))
+    {
+        return;
+    }
+
+    if (eeprom_busy() || !uart_tx_idle() || can_rx_pending() || ECAN_TX0_BUSY)
+    {
+        return;
+    }
+
+    if (!can_set_mode(CAN_OPMODE_DISABLE))
+    {
+        can_set_mode(CAN_OPMODE_NORMAL);
+        return;
+    }
+
+    WAKIF = 0;
+    WAKIE = 1;
+
+    POWER_SLEEP();
+
+    WAKIE = 0;
+    can_set_mode(CAN_OPMODE_NORMAL);
+
+    g_wake_tick = tick_now();
+}
+
+/*---------------------------------------------------------
+ * XCP DAQ event channels (10 ms and 100 ms)
+ *---------------------------------------------------------*/
+static sw_timer_t g_xcp_10ms_timer;
+static sw_timer_t g_xcp_100ms_timer;
+
+static void xcp_event_10ms(void)
+{
+    if (nm_tx_allowed())
+    {
+        xcp_event(XCP_EVENT_10MS);
+    }
+}
+
+static void xcp_event_100ms(void)
+{
+    if (nm_tx_allowed())
+    {
+        xcp_event(XCP_EVENT_100MS);
+    }
+}
+
+static void init_xcp_events(void)
+{
+    sw_timer_start(&g_xcp_10ms_timer,  (uint16_t)TICK_FROM_MS(10),
+                   (uint16_t)TICK_FROM_MS(10),  xcp_event_10ms);
+    sw_timer_start(&g_xcp_100ms_timer, (uint16_t)TICK_FROM_MS(100),
+                   (uint16_t)TICK_FROM_MS(100), xcp_event_100ms);
+}
+
+/*---------------------------------------------------------
+ * Send the boot timeline once the first value is on screen
+ *---------------------------------------------------------*/
+static void boot_report_poll(void)
+{
+    uint8_t report[8];
+
+    if (g_boot_reported || g_boot_timeline.first_pixel_ms == BOOT_MARK_UNSET || ECAN_TX0_BUSY)
+    {
+        return;
+    }
+
+    report[0] = (uint8_t)g_boot_timeline.can_ready_ms;
+    report[1] = (uint8_t)(g_boot_timeline.can_ready_ms >> 8);
+    report[2] = (uint8_t)g_boot_timeline.first_frame_ms;
+    report[3] = (uint8_t)(g_boot_timeline.first_frame_ms >> 8);
+    report[4] = (uint8_t)g_boot_timeline.lcd_ready_ms;
+    report[5] = (uint8_t)(g_boot_timeline.lcd_ready_ms >> 8);
+    report[6] = (uint8_t)g_boot_timeline.first_pixel_ms;
+    report[7] = (uint8_t)(g_boot_timeline.first_pixel_ms >> 8);
+
+    can_transmit(BOOT_REPORT_MSG_ID, report, sizeof(report));
+    g_boot_reported = 1;
+}
+
+/*---------------------------------------------------------
+ * Staged system start-up:
+ *  - Interrupt priorities (high: CAN RX, time base;
+ *    low: tick, UART), system tick (needed for all timing)
+ *  - Profiler (probe cost, first load window)
+ *  - Network time base (time master), network management
+ *  - CAN peripheral (frames are accepted from here on),
+ *    optionally preceded by the loopback self-test
+ *  - LED GPIOs, serial telemetry bridge
+ *  - Software timers, ISO-TP, XCP, odometer
+ *  - LCD power-on sequence started, completed from the
+ *    main loop while CAN is already being serviced
  *---------------------------------------------------------*/
 static void init_system(void)
 {
-    init_clcd();
-    init_can();
+    /* Priority map first, then enable both interrupt levels */
+    init_irq();
+    init_tick();
+
+    /* Probe overhead, first load window */
+    profile_init();
+
+    /* Network time base (Timer1 extended by its overflow IRQ) */
+    tsync_init();
+
+    /* Heartbeat + node presence (runs on the time-sync clock) */
+    nm_init();
+
+    if (init_can())
+    {
+        /* Optional loopback benchmark before the bus is used */
+        if (CAN_SELFTEST_REQUESTED())
+        {
+            can_selftest_run(CAN_SELFTEST_FRAMES);
+        }
+
+        BOOT_MARK(can_ready_ms);
+    }
+
     init_leds();
-    init_timer0();
+    init_telemetry();
+    sw_timer_init();
+    isotp_init();
+    xcp_init();
+    init_xcp_events();
+    odometer_init();
+
+    /* Set up RPM bar graph and indicator blink timer */
+    init_msg_handler();
 
-    /* Enable global + peripheral interrupts */
-    PEIE = 1;
-    GIE  = 1;
+    clcd_init_start();
 }
 
 /*---------------------------------------------------------
@@ -54,12 +214,74 @@ void main(void)
 {
     init_system();
 
-    /* Draw static labels once */
-    display_labels();
-
     while (1)
     {
-        /* Read and process CAN data continuously */
+        /* Finish LCD power-on; then draw labels and held-back values */
+        if (!g_lcd_ready && clcd_init_poll())
+        {
+            g_lcd_ready = 1;
+            msg_handler_display_ready();
+        }
+
+        /* Read and decode CAN data continuously (signal store only) */
         process_canbus_data();
+
+        /* Draw changed signals, rate limited per field */
+        msg_handler_render_poll();
+
+        /* Run due timer callbacks (blink, timeouts) */
+        PROFILE_ENTER(PROF_SW_TIMER_POLL);
+        sw_timer_poll();
+        PROFILE_EXIT(PROF_SW_TIMER_POLL);
+
+        /* Advance multi-frame diagnostic transfers, answer requests */
+        isotp_poll();
+        diag_poll();
+
+        /* Send XCP responses and queued DAQ samples */
+        xcp_poll();
+
+        /* Batched, non-blocking odometer persistence */
+        odometer_poll();
+
+        /* One-shot boot timeline report */
+        boot_report_poll();
+
+        /* Loopback benchmark result (only after a self-test run) */
+        can_selftest_report_poll();
+
+        /* Heartbeat, node presence, bus sleep / wake-up */
+        nm_poll();
+        msg_handler_presence_poll();
+
+        /* Periodic reports stop while the bus sleeps */
+        if (nm_tx_allowed())
+        {
+            /* Time master: SYNC / FUP schedule */
+            tsync_poll();
+
+            /* CPU load window + probe table report */
+            profile_poll();
+
+            /* Worst-case interrupt latency per source */
+            irq_report_poll();
+        }
+
+#if PROFILE_ENABLE && PROFILE_SHOW_LOAD
+        if (g_profile_windows != g_load_shown)
+        {
+            g_load_shown = g_profile_windows;
+            msg_handler_show_load(g_profile_load);
+        }
+#endif
+
+        /* Stop the CPU clock while the whole network sleeps */
+        bus_sleep_poll();
+
+        /* Core stops until the next interrupt; busy time shows up as load */
+        if (!can_rx_pending() && !ECAN_TX0_BUSY)
+        {
+            profile_idle();
+        }
     }
 }
@@ -4,9 +4,26 @@
  *                - Speed
  *                - Gear
  *                - RPM
+ *                - Engine temperature
  *                - Indicators
  *
- *                Provides display routines and collision-event logic.
+ *                Provides display routines and raises the dashboard
+ *                warnings (collision, overheat, node lost / back);
+ *                warning.c decides which one owns the label row.
+ *                Dashboard frames carry an E2E header (CRC-8 and
+ *                alive counter); corrupted, repeated and out-of-
+ *                sequence frames are dropped before they reach the
+ *                display.
+ *
+ *                The receive path only decodes frames into the
+ *                signal store; msg_handler_render_poll() draws
+ *                changed signals at most once per RENDER_*_MS per
+ *                field, so CAN throughput does not depend on LCD
+ *                speed. All drawing goes through the screen layer,
+ *                which keeps fields under a warning in its shadow
+ *                buffer. Values from a node that has stopped
+ *                sending heartbeats are shown as dashes until it
+ *                rejoins.
  *
  ***********************************************************************/
 
@@ -16,11 +33,75 @@
 #include "msg_id.h"
 #include "can.h"
 #include "clcd.h"
+#include "tick.h"
+#include "sw_timer.h"
+#include "bargraph.h"
+#include "isotp.h"
+#include "xcp.h"
+#include "odometer.h"
+#include "boot.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "nm.h"
+#include "bootreq.h"
+#include "signal_store.h"
+#include "screen.h"
+#include "warning.h"
+
+/*---------------------------------------------------------
+ * Indicator Blink State (driven by software timer)
+ *---------------------------------------------------------*/
+#define IND_BLINK_PERIOD_MS     500
+
+static sw_timer_t g_blink_timer;
+static uint8_t    g_indicator = e_ind_off;
+static uint8_t    g_blink_on  = 1;
+
+/* Set while the GEAR frame reports a collision */
+static uint8_t    g_collision_flag = 0;
+
+/* E2E slot of a dashboard message ID (SPEED .. INDICATOR) */
+#define E2E_RX_SLOT(id)         (((id) >> 4) - 1)
+
+/* Values are only drawn once the LCD has finished power-on */
+static uint8_t g_display_ready = 0;
+
+/*---------------------------------------------------------
+ * Render Task State (per signal)
+ *  Last drawn version / value, and the earliest tick the
+ *  field may be drawn again.
+ *---------------------------------------------------------*/
+#define RENDER_FORCE            0xFF    /* g_drawn_valid: redraw */
+
+static const uint16_t g_render_period_ms[SIGNAL_COUNT] =
+{
+    RENDER_SPEED_MS, RENDER_GEAR_MS, RENDER_RPM_MS, RENDER_INDICATOR_MS
+};
+
+static uint8_t  g_drawn_version[SIGNAL_COUNT];
+static uint8_t  g_drawn_valid[SIGNAL_COUNT];
+static uint16_t g_drawn_value[SIGNAL_COUNT];
+static uint32_t g_render_due[SIGNAL_COUNT];
+
+/* Nodes present at the last presence check (bit n-1 = node n) */
+static uint8_t g_present_mask = 0;
+
+/* Nodes lost and not yet back */
+static uint8_t g_lost_mask = 0;
+
+/*---------------------------------------------------------
+ * E2E Receive State
+ *---------------------------------------------------------*/
+e2e_rx_t g_e2e_rx[E2E_RX_SLOTS];
 
 /*---------------------------------------------------------
- * Global Tick Counter (updated in Timer0 ISR)
+ * RPM Bar Graph (LINE2 columns 8..12)
  *---------------------------------------------------------*/
-unsigned long int g_timer_ticks;
+#define RPM_BAR_ADDR            LINE2(8)
+#define RPM_BAR_CELLS           5
+#define RPM_FULL_SCALE          8000U
+
+static bargraph_t g_rpm_bar;
 
 /*---------------------------------------------------------
  * Gear Labels (String table)
@@ -40,153 +121,556 @@ static const unsigned char g_gear_labels[9][3] =
  *---------------------------------------------------------*/
 void display_labels(void)
 {
-    clcd_print("SP",  LINE1(0));
-    clcd_print("GR",  LINE1(4));
-    clcd_print("RPM", LINE1(8));
-    clcd_print("IND", LINE1(13));
+    screen_print("SP",  LINE1(0));
+    screen_print("GR",  LINE1(4));
+    screen_print("RPM", LINE1(8));
+    screen_print("IND", LINE1(13));
+}
+
+/*---------------------------------------------------------
+ * Parse leading ASCII digits of a frame (ECU1/ECU2 format)
+ *---------------------------------------------------------*/
+static uint16_t parse_ascii_value(const uint8_t *data, uint8_t len)
+{
+    uint16_t value = 0;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (data[i] < '0' || data[i] > '9')
+        {
+            break;
+        }
+
+        value = (uint16_t)(value * 10U + (data[i] - '0'));
+    }
+
+    return value;
 }
 
 /*---------------------------------------------------------
  * SPEED Handler
+ *  Stores the speed, feeds the odometer and the telemetry
+ *  bridge (every frame, independent of the display).
  *---------------------------------------------------------*/
-void handle_speed_data(uint8_t *data, uint8_t len)
+void handle_speed_data(const uint8_t *data, uint8_t len)
 {
-    /* Display 2-character speed */
-    clcd_putch(data[0], LINE2(0));
-    clcd_putch(data[1], LINE2(1));
+    uint16_t speed;
+
+    if (len < 1)
+    {
+        return;
+    }
+
+    speed = parse_ascii_value(data, len);
+
+    signal_write(e_sig_speed, speed);
+    odometer_on_speed(speed);
+    telemetry_signal(TELE_SIG_SPEED, speed);
 }
 
 /*---------------------------------------------------------
  * GEAR Handler
  *---------------------------------------------------------*/
-void handle_gear_data(uint8_t *data, uint8_t len)
+void handle_gear_data(const uint8_t *data, uint8_t len)
 {
-    if (*data < 9)
+    if (len >= 1 && *data < 9)
     {
-        clcd_print(g_gear_labels[*data], LINE2(4));
+        signal_write(e_sig_gear, *data);
+        telemetry_signal(TELE_SIG_GEAR, *data);
     }
 }
 
 /*---------------------------------------------------------
  * RPM Handler
- * NOTE:
- *   Previous version incorrectly used clcd_print() on raw bytes.
- *   RPM data is NOT null-terminated, so print them individually.
+ *  ECU2 sends RPM as ASCII digits (optionally NUL padded).
  *---------------------------------------------------------*/
-void handle_rpm_data(uint8_t *data, uint8_t len)
+void handle_rpm_data(const uint8_t *data, uint8_t len)
 {
-    if (len >= 2)
+    uint16_t rpm;
+
+    if (len >= 1)
     {
-        clcd_putch(data[0], LINE2(8));
-        clcd_putch(data[1], LINE2(9));
+        rpm = parse_ascii_value(data, len);
+
+        signal_write(e_sig_rpm, rpm);
+        telemetry_signal(TELE_SIG_RPM, rpm);
     }
 }
 
 /*---------------------------------------------------------
- * INDICATOR Handler
- *  Uses flashing control based on g_timer_ticks.
+ * ENGINE TEMPERATURE Handler
+ *  ASCII degrees C. Not a gauge: only drives the overheat
+ *  warning, with hysteresis so a reading near the limit
+ *  does not make it flicker.
  *---------------------------------------------------------*/
-void handle_indicator_data(uint8_t *data, uint8_t len)
+void handle_engine_temp_data(const uint8_t *data, uint8_t len)
 {
-    int indicator = *data;
+    uint16_t temp;
 
-    /* ON phase */
-    if (g_timer_ticks <= 10000)
+    if (len < 1)
     {
-        if (indicator == e_ind_off)
-        {
-            LEFT_IND_OFF();
-            RIGHT_IND_OFF();
-            clcd_putch(' ', LINE2(14));
-            clcd_putch(' ', LINE2(15));
-        }
-        else if (indicator == e_ind_left)
-        {
-            LEFT_IND_ON();
-            RIGHT_IND_OFF();
-            clcd_putch('<', LINE2(14));
-            clcd_putch(' ', LINE2(15));
-        }
-        else if (indicator == e_ind_right)
-        {
-            LEFT_IND_OFF();
-            RIGHT_IND_ON();
-            clcd_putch(' ', LINE2(14));
-            clcd_putch('>', LINE2(15));
-        }
-        else if (indicator == e_ind_hazard)
-        {
-            LEFT_IND_ON();
-            RIGHT_IND_ON();
-            clcd_putch('<', LINE2(14));
-            clcd_putch('>', LINE2(15));
-        }
+        return;
+    }
+
+    temp = parse_ascii_value(data, len);
+
+    if (temp >= ENG_OVERHEAT_ON_C)
+    {
+        warning_raise(e_warn_overheat);
     }
-    else    /* OFF phase */
+    else if (temp <= ENG_OVERHEAT_OFF_C)
+    {
+        warning_clear(e_warn_overheat);
+    }
+}
+
+/*---------------------------------------------------------
+ * Apply indicator LEDs and LCD symbols for the current
+ * indicator state and blink phase.
+ *---------------------------------------------------------*/
+static void update_indicator_output(void)
+{
+    uint8_t indicator = g_blink_on ? g_indicator : e_ind_off;
+
+    if (indicator == e_ind_left)
+    {
+        LEFT_IND_ON();
+        RIGHT_IND_OFF();
+        screen_putch('<', LINE2(14));
+        screen_putch(' ', LINE2(15));
+    }
+    else if (indicator == e_ind_right)
+    {
+        LEFT_IND_OFF();
+        RIGHT_IND_ON();
+        screen_putch(' ', LINE2(14));
+        screen_putch('>', LINE2(15));
+    }
+    else if (indicator == e_ind_hazard)
+    {
+        LEFT_IND_ON();
+        RIGHT_IND_ON();
+        screen_putch('<', LINE2(14));
+        screen_putch('>', LINE2(15));
+    }
+    else
     {
         LEFT_IND_OFF();
         RIGHT_IND_OFF();
+        screen_putch(' ', LINE2(14));
+        screen_putch(' ', LINE2(15));
+    }
+}
+
+/*---------------------------------------------------------
+ * Blink timer callback (every IND_BLINK_PERIOD_MS)
+ *---------------------------------------------------------*/
+static void indicator_blink(void)
+{
+    g_blink_on = !g_blink_on;
 
-        clcd_putch(' ', LINE2(14));
-        clcd_putch(' ', LINE2(15));
+    if (g_indicator != e_ind_off)
+    {
+        update_indicator_output();
     }
 }
 
 /*---------------------------------------------------------
- * CAN Message Processing Logic
+ * Set up the screen layer, the warning manager, the RPM
+ * bar graph and the periodic indicator blink timer
  *---------------------------------------------------------*/
-void process_canbus_data(void)
+void init_msg_handler(void)
 {
-    uint8_t  data[5];
-    uint8_t  len = 0;
-    uint16_t msg_id;
+    signal_store_init();
+    screen_init();
+    warning_init();
 
-    static uint8_t collision_flag = 0;
+    bargraph_init(&g_rpm_bar, RPM_BAR_ADDR, RPM_BAR_CELLS, RPM_FULL_SCALE);
 
-    can_receive(&msg_id, data, &len);
+    sw_timer_start(&g_blink_timer,
+                   (uint16_t)TICK_FROM_MS(IND_BLINK_PERIOD_MS),
+                   (uint16_t)TICK_FROM_MS(IND_BLINK_PERIOD_MS),
+                   indicator_blink);
+}
 
-    /* Normal operation (no collision detected yet) */
-    if (collision_flag == 0)
+/*---------------------------------------------------------
+ * INDICATOR Handler
+ *  Stores the requested state; flashing is driven by the
+ *  blink timer instead of the received frame rate.
+ *---------------------------------------------------------*/
+void handle_indicator_data(const uint8_t *data, uint8_t len)
+{
+    if (len < 1 || *data > e_ind_hazard)
+    {
+        return;
+    }
+
+    if (!g_signals[e_sig_indicator].valid || *data != g_signals[e_sig_indicator].value)
     {
-        if (msg_id == SPEED_MSG_ID)
+        telemetry_signal(TELE_SIG_INDICATOR, *data);
+    }
+
+    signal_write(e_sig_indicator, *data);
+}
+
+/*---------------------------------------------------------
+ * Mark every field for redraw at the next render pass
+ *---------------------------------------------------------*/
+static void render_invalidate_all(void)
+{
+    uint32_t now = tick_now();
+
+    for (uint8_t sig = 0; sig < SIGNAL_COUNT; sig++)
+    {
+        g_drawn_version[sig] = (uint8_t)(signal_version(sig) - 1);
+        g_drawn_valid[sig]   = RENDER_FORCE;
+        g_render_due[sig]    = now;
+    }
+
+    bargraph_invalidate(&g_rpm_bar);
+}
+
+/*---------------------------------------------------------
+ * Route one dashboard frame to its decoder; raise / clear
+ * the collision warning carried by the GEAR frame
+ *---------------------------------------------------------*/
+static void dispatch_display_frame(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    PROFILE_ENTER(PROF_FRAME_HANDLER);
+
+    if (msg_id == SPEED_MSG_ID)
+    {
+        handle_speed_data(data, len);
+    }
+    else if (msg_id == GEAR_MSG_ID)
+    {
+        handle_gear_data(data, len);
+
+        if (*data == GEAR_COLLISION_CODE && g_collision_flag == 0)
         {
-            handle_speed_data(data, len);
+            /* Collision event triggered */
+            g_collision_flag = 1;
+            telemetry_signal(TELE_SIG_COLLISION, 1);
+            warning_raise(e_warn_collision);
         }
-        else if (msg_id == GEAR_MSG_ID)
+        else if (*data != GEAR_COLLISION_CODE && g_collision_flag != 0)
         {
-            handle_gear_data(data, len);
+            /* Collision cleared */
+            g_collision_flag = 0;
+            telemetry_signal(TELE_SIG_COLLISION, 0);
+            warning_clear(e_warn_collision);
+        }
+    }
+    else if (msg_id == RPM_MSG_ID)
+    {
+        handle_rpm_data(data, len);
+    }
+    else if (msg_id == ENG_TEMP_MSG_ID)
+    {
+        handle_engine_temp_data(data, len);
+    }
+    else if (msg_id == INDICATOR_MSG_ID)
+    {
+        handle_indicator_data(data, len);
+    }
 
-            /* Collision event triggered */
-            if (*data == GEAR_COLLISION_CODE)
+    PROFILE_EXIT(PROF_FRAME_HANDLER);
+}
+
+/*---------------------------------------------------------
+ * CAN Message Processing Logic
+ *  data is the driver's read-only view of an RX ring slot,
+ *  len is already clamped to CAN_MAX_DLC.
+ *---------------------------------------------------------*/
+static void process_frame(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    uint8_t        slot;
+    const uint8_t *payload;
+    E2eStatus      status;
+
+    /* Empty frames carry nothing for any handler */
+    if (len == 0)
+    {
+        return;
+    }
+
+    /* Raw copy of every frame to the serial bridge */
+    telemetry_can_frame(msg_id, data, len);
+
+    /* Diagnostic transport runs regardless of display mode */
+    if (msg_id == ISOTP_RX_ID)
+    {
+        isotp_on_frame(data, len);
+        return;
+    }
+
+    /* Measurement / calibration commands */
+    if (msg_id == XCP_CRO_ID)
+    {
+        xcp_on_frame(data, len);
+        return;
+    }
+
+    /* Node heartbeats */
+    if (nm_is_nm_frame(msg_id))
+    {
+        nm_on_frame(msg_id, data, len);
+        return;
+    }
+
+    /* Reset into the bootloader (does not return) */
+    if (bootreq_is_frame(msg_id))
+    {
+        bootreq_on_frame(msg_id, data, len);
+        return;
+    }
+
+    if (msg_id < SPEED_MSG_ID || msg_id > INDICATOR_MSG_ID || (msg_id & 0x0F) != 0)
+    {
+        return;
+    }
+
+    slot   = E2E_RX_SLOT(msg_id);
+    status = e2e_check(&g_e2e_rx[slot], msg_id, data, len);
+
+    /*
+     * Only ok, ok_some_lost and initial carry a valid payload.
+     * Corrupted, stale (sender stuck), out-of-sequence and
+     * empty frames never reach the display; e2e_check() has
+     * already resynchronised to a wrong_sequence counter, so
+     * the next frame in order is accepted again.
+     */
+    if ((status != e_e2e_ok && status != e_e2e_ok_some_lost && status != e_e2e_initial) ||
+        len <= E2E_HEADER_LEN)
+    {
+        return;
+    }
+
+    payload = &data[E2E_HEADER_LEN];
+    len    -= E2E_HEADER_LEN;
+
+    BOOT_MARK(first_frame_ms);
+
+    /* Decoded into the signal store even while the LCD powers up */
+    dispatch_display_frame(msg_id, payload, len);
+}
+
+/*---------------------------------------------------------
+ * Function : process_canbus_data
+ * Description :
+ *    Handles one received frame in place (no copy) and
+ *    returns its buffer to the CAN driver.
+ *---------------------------------------------------------*/
+void process_canbus_data(void)
+{
+    can_rx_view_t frame;
+
+    if (!can_rx_acquire(&frame))
+    {
+        return;
+    }
+
+    process_frame(frame.id, frame.data, frame.len);
+
+    can_rx_release(&frame);
+}
+
+/*---------------------------------------------------------
+ * Draw one signal field
+ *---------------------------------------------------------*/
+static void render_signal(uint8_t sig, const signal_t *entry)
+{
+    unsigned char text[4];
+    uint16_t      value = entry->value;
+
+    switch (sig)
+    {
+        case e_sig_speed:
+            if (!entry->valid)
             {
-                collision_flag = 1;
+                screen_print("---", LINE2(0));
+                break;
+            }
 
-                clcd_clear();
-                clcd_print("Collision !",     LINE1(0));
-                clcd_print("Vehicle Damaged", LINE2(0));
+            if (value > 999)
+            {
+                value = 999;
             }
+
+            text[0] = (value >= 100) ? (unsigned char)('0' + value / 100) : ' ';
+            text[1] = (unsigned char)('0' + (value / 10) % 10);
+            text[2] = (unsigned char)('0' + value % 10);
+            text[3] = '\0';
+            screen_print(text, LINE2(0));
+            break;
+
+        case e_sig_gear:
+            screen_print(entry->valid ? g_gear_labels[value] : (const unsigned char *)"--", LINE2(4));
+            break;
+
+        case e_sig_rpm:
+            bargraph_draw(&g_rpm_bar, entry->valid ? value : 0);
+            break;
+
+        default:
+            g_indicator = entry->valid ? (uint8_t)value : e_ind_off;
+            update_indicator_output();
+            break;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : msg_handler_render_poll
+ * Description :
+ *    Render task. Draws each signal whose version changed,
+ *    at most once per its RENDER_*_MS period; a change
+ *    after a quiet spell is drawn at once. Frames that
+ *    arrive in between only update the store. Fields whose
+ *    visible value is unchanged cost no LCD write; fields
+ *    under a warning only update the screen shadow.
+ *---------------------------------------------------------*/
+void msg_handler_render_poll(void)
+{
+    uint32_t now;
+    signal_t entry;
+
+    if (!g_display_ready)
+    {
+        return;
+    }
+
+    now = tick_now();
+
+    for (uint8_t sig = 0; sig < SIGNAL_COUNT; sig++)
+    {
+        if (signal_version(sig) == g_drawn_version[sig] ||
+            (int32_t)(now - g_render_due[sig]) < 0)
+        {
+            continue;
         }
-        else if (msg_id == RPM_MSG_ID)
+
+        signal_read(sig, &entry);
+
+        g_drawn_version[sig] = entry.version;
+        g_render_due[sig]    = now + TICK_FROM_MS(g_render_period_ms[sig]);
+
+        if (entry.valid == g_drawn_valid[sig] && entry.value == g_drawn_value[sig])
         {
-            handle_rpm_data(data, len);
+            continue;
         }
-        else if (msg_id == INDICATOR_MSG_ID)
+
+        g_drawn_valid[sig] = entry.valid;
+        g_drawn_value[sig] = entry.value;
+
+        if (entry.valid)
         {
-            handle_indicator_data(data, len);
+            BOOT_MARK(first_pixel_ms);
         }
+
+        render_signal(sig, &entry);
     }
-    else
+}
+
+/*---------------------------------------------------------
+ * Function : msg_handler_display_ready
+ * Description :
+ *    Called once the LCD power-on sequence has finished.
+ *    Draws labels and any warning raised during power-on;
+ *    the render task then draws everything already in the
+ *    store, so the first values appear immediately.
+ *---------------------------------------------------------*/
+void msg_handler_display_ready(void)
+{
+    BOOT_MARK(lcd_ready_ms);
+
+    g_display_ready = 1;
+
+    display_labels();
+    screen_lcd_ready();
+    render_invalidate_all();
+
+    if (g_warning.shown != WARN_NONE)
     {
-        /* Collision mode — only look for collision clearance msg */
-        if (msg_id == GEAR_MSG_ID)
-        {
-            if (*data != GEAR_COLLISION_CODE)
-            {
-                collision_flag = 0;
+        BOOT_MARK(first_pixel_ms);
+    }
+}
 
-                clcd_clear();
-                display_labels();
-            }
+/*---------------------------------------------------------
+ * Function : msg_handler_show_load
+ * Description :
+ *    Draws the CPU load (00..99 %) at LINE2(6) unless the
+ *    display is still booting.
+ *---------------------------------------------------------*/
+void msg_handler_show_load(uint8_t load_pct)
+{
+    if (!g_display_ready)
+    {
+        return;
+    }
+
+    if (load_pct > 99)
+    {
+        load_pct = 99;
+    }
+
+    screen_putch((unsigned char)('0' + load_pct / 10), LINE2(6));
+    screen_putch((unsigned char)('0' + load_pct % 10), LINE2(7));
+}
+
+/*---------------------------------------------------------
+ * Function : msg_handler_presence_poll
+ * Description :
+ *    Invalidates the signals of a node that has dropped off
+ *    the bus: ECU1 (speed, gear) shows dashes, ECU2 (RPM
+ *    bar, indicators) goes dark, and a stale-sensor warning
+ *    is raised over its labels. Fresh frames redraw the
+ *    fields when the node rejoins; a short info message
+ *    replaces the warning.
+ *---------------------------------------------------------*/
+void msg_handler_presence_poll(void)
+{
+    uint8_t mask = 0;
+    uint8_t lost;
+    uint8_t back;
+
+    for (uint8_t node = 1; node <= NM_NODE_COUNT; node++)
+    {
+        if (nm_node_present(node))
+        {
+            mask |= (uint8_t)(1U << (node - 1));
         }
     }
+
+    lost = (uint8_t)(g_present_mask & ~mask);
+    back = (uint8_t)(g_lost_mask & mask);
+    g_present_mask = mask;
+    g_lost_mask    = (uint8_t)((g_lost_mask | lost) & ~back);
+
+    if (lost & 0x01)
+    {
+        signal_invalidate(e_sig_speed);
+        signal_invalidate(e_sig_gear);
+        warning_clear(e_warn_ecu1_back);
+        warning_raise(e_warn_ecu1_lost);
+    }
+
+    if (lost & 0x02)
+    {
+        signal_invalidate(e_sig_rpm);
+        signal_invalidate(e_sig_indicator);
+        warning_clear(e_warn_ecu2_back);
+        warning_raise(e_warn_ecu2_lost);
+    }
+
+    if (back & 0x01)
+    {
+        warning_clear(e_warn_ecu1_lost);
+        warning_raise(e_warn_ecu1_back);
+    }
+
+    if (back & 0x02)
+    {
+        warning_clear(e_warn_ecu2_lost);
+        warning_raise(e_warn_ecu2_back);
+    }
 }
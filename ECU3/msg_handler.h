@@ -2,6 +2,7 @@
 #define MSG_HANDLER_H
 
 #include <stdint.h>
+#include "e2e.h"
 
 /*---------------------------------------------------------
  * Indicator LED Control (PORTB Bit Manipulation)
@@ -26,16 +27,45 @@ typedef enum
     e_ind_hazard
 } IndicatorStatus;
 
+/*---------------------------------------------------------
+ * Render Rate Limits (minimum ms between redraws per field;
+ * 100 ms = 10 Hz, 50 ms = 20 Hz)
+ *---------------------------------------------------------*/
+#define RENDER_SPEED_MS             100
+#define RENDER_GEAR_MS              50
+#define RENDER_RPM_MS               50
+#define RENDER_INDICATOR_MS         50
+
+/*---------------------------------------------------------
+ * Overheat Warning (engine temperature in degrees C;
+ * raised at ON, cleared at OFF)
+ *---------------------------------------------------------*/
+#define ENG_OVERHEAT_ON_C           110
+#define ENG_OVERHEAT_OFF_C          100
+
+/*---------------------------------------------------------
+ * E2E Receive State (one per dashboard message ID,
+ * SPEED .. INDICATOR; counters readable over XCP)
+ *---------------------------------------------------------*/
+#define E2E_RX_SLOTS                5
+
+extern e2e_rx_t g_e2e_rx[E2E_RX_SLOTS];
+
 /*---------------------------------------------------------
  * Application UI & CAN Message Handlers
  *---------------------------------------------------------*/
+void init_msg_handler(void);
 void display_labels(void);
 void process_canbus_data(void);
+void msg_handler_display_ready(void);
+void msg_handler_show_load(uint8_t load_pct);
+void msg_handler_presence_poll(void);
+void msg_handler_render_poll(void);
 
-void handle_speed_data(uint8_t *data, uint8_t len);
-void handle_gear_data(uint8_t *data, uint8_t len);
-void handle_rpm_data(uint8_t *data, uint8_t len);
-void handle_engine_temp_data(uint8_t *data, uint8_t len);
-void handle_indicator_data(uint8_t *data, uint8_t len);
+void handle_speed_data(const uint8_t *data, uint8_t len);
+void handle_gear_data(const uint8_t *data, uint8_t len);
+void handle_rpm_data(const uint8_t *data, uint8_t len);
+void handle_engine_temp_data(const uint8_t *data, uint8_t len);
+void handle_indicator_data(const uint8_t *data, uint8_t len);
 
 #endif /* MSG_HANDLER_H */
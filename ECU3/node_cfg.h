@@ -0,0 +1,44 @@
+/***********************************************************************
+ *  File name   : node_cfg.h
+ *  Description : ECU3 settings of the shared modules (HAL/) that are
+ *                more than a switch: EEPROM map, XCP event channels
+ *                and profiler probes. Node ID, time-sync role and
+ *                module selection are in the generated hal_cfg.h.
+ *
+ *                Network management: ECU3 has no inputs of its own
+ *                and never requests the network; it stays awake
+ *                while any other node does and tracks who is
+ *                present for the display.
+ *
+ ***********************************************************************/
+
+#ifndef NODE_CFG_H
+#define NODE_CFG_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Data EEPROM Map (below EE_BOOT_BASE)
+ *---------------------------------------------------------*/
+#define EE_ODO_BASE                 0x00    /* Odometer record ring */
+#define EE_ODO_END                  0xFD
+
+/*---------------------------------------------------------
+ * XCP Event Channels
+ *---------------------------------------------------------*/
+#define XCP_MAX_EVENT               2
+#define XCP_EVENT_10MS              0
+#define XCP_EVENT_100MS             1
+
+/*---------------------------------------------------------
+ * Profiler Probe Table
+ *  PROF_OVERHEAD measures an empty ENTER/EXIT pair at boot.
+ *---------------------------------------------------------*/
+#define PROF_OVERHEAD               0
+#define PROF_CAN_RECEIVE            1
+#define PROF_CLCD_WRITE             2
+#define PROF_FRAME_HANDLER          3
+#define PROF_SW_TIMER_POLL          4
+#define PROFILE_PROBES              5
+
+#endif /* NODE_CFG_H */
@@ -0,0 +1,290 @@
+/***********************************************************************
+ *  File name   : odometer.c
+ *  Description : Odometer and trip meter.
+ *                Distance is integrated in fixed point from SPEED
+ *                frames using the measured time between frames
+ *                (trapezoidal rule, exact remainder carried over).
+ *                Totals are persisted in data EEPROM as a ring of
+ *                CRC-protected records with sequence numbers, so each
+ *                save lands in the next slot (wear levelling). A
+ *                save first marks its slot invalid and marks it
+ *                valid only after the CRC, so a torn write never
+ *                leaves a record that passes the check with mixed
+ *                old and new bytes; it only loses the record being
+ *                written.
+ *                EEPROM bytes are written one per odometer_poll()
+ *                call and never block the CAN loop.
+ *
+ *  API:
+ *      - odometer_init()
+ *      - odometer_on_speed()
+ *      - odometer_poll()
+ *      - odometer_flush()
+ *      - odometer_reset_trip()
+ *      - odometer_total_m()
+ *      - odometer_trip_m()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "odometer.h"
+#include "tick.h"
+#include "crc8.h"
+
+#if ODO_ENDURANCE_KM < 1000000UL
+#error "Odometer ring wears out before 1,000,000 km; widen it or save less often"
+#endif
+
+/*---------------------------------------------------------
+ * Integration Units
+ *  (v_prev + v_now) * dt_ms is in 0.5 km/h * ms;
+ *  1 m = 3600 km/h * ms = 7200 of those units.
+ *---------------------------------------------------------*/
+#define ODO_UNITS_PER_M             7200UL
+
+/* Record byte offsets (CRC over SEQ .. TRIP) */
+#define ODO_REC_MARK                0
+#define ODO_REC_SEQ                 1
+#define ODO_REC_ODO                 3
+#define ODO_REC_TRIP                7
+#define ODO_REC_CRC                 11
+
+/*---------------------------------------------------------
+ * Distance State
+ *---------------------------------------------------------*/
+static uint32_t g_odo_m;
+static uint32_t g_trip_m;
+static uint32_t g_dist_rem;
+static uint32_t g_last_frame_tick;
+static uint16_t g_last_speed;
+static uint8_t  g_have_last;
+
+/*---------------------------------------------------------
+ * Persistence State
+ *---------------------------------------------------------*/
+static uint8_t  g_rec_buf[ODO_RECORD_SIZE];
+static uint8_t  g_rec_pos;
+static uint8_t  g_rec_slot;             /* Slot of newest valid record */
+static uint8_t  g_rec_writing;
+static uint16_t g_rec_seq;
+static uint32_t g_saved_odo_m;
+static uint8_t  g_save_request;
+
+/*---------------------------------------------------------
+ *  Local Helpers : Little-endian packing
+ *---------------------------------------------------------*/
+static void odometer_put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t odometer_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : EEPROM address of a ring slot
+ *---------------------------------------------------------*/
+static uint8_t odometer_slot_addr(uint8_t slot)
+{
+    return (uint8_t)(EE_ODO_BASE + slot * ODO_RECORD_SIZE);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Snapshot totals into the next ring slot
+ *---------------------------------------------------------*/
+static void odometer_start_save(void)
+{
+    g_rec_seq++;
+
+    g_rec_buf[ODO_REC_MARK]    = ODO_MARK_VALID;
+    g_rec_buf[ODO_REC_SEQ]     = (uint8_t)g_rec_seq;
+    g_rec_buf[ODO_REC_SEQ + 1] = (uint8_t)(g_rec_seq >> 8);
+    odometer_put_u32(&g_rec_buf[ODO_REC_ODO],  g_odo_m);
+    odometer_put_u32(&g_rec_buf[ODO_REC_TRIP], g_trip_m);
+    g_rec_buf[ODO_REC_CRC] = crc8(&g_rec_buf[ODO_REC_SEQ], ODO_REC_CRC - ODO_REC_SEQ);
+
+    g_saved_odo_m  = g_odo_m;
+    g_save_request = 0;
+    g_rec_pos      = 0;
+    g_rec_writing  = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : odometer_init
+ * Description :
+ *    Scans the EEPROM ring and restores the newest record
+ *    with a valid marker and CRC. Blank or torn slots are
+ *    skipped.
+ *---------------------------------------------------------*/
+void odometer_init(void)
+{
+    uint8_t  found = 0;
+    uint16_t seq;
+
+    g_odo_m  = 0;
+    g_trip_m = 0;
+    g_rec_seq  = 0;
+    g_rec_slot = ODO_RECORD_COUNT - 1;
+
+    for (uint8_t slot = 0; slot < ODO_RECORD_COUNT; slot++)
+    {
+        uint8_t addr = odometer_slot_addr(slot);
+
+        for (uint8_t i = 0; i < ODO_RECORD_SIZE; i++)
+        {
+            g_rec_buf[i] = eeprom_read((uint8_t)(addr + i));
+        }
+
+        if (g_rec_buf[ODO_REC_MARK] != ODO_MARK_VALID ||
+            crc8(&g_rec_buf[ODO_REC_SEQ], ODO_REC_CRC - ODO_REC_SEQ) != g_rec_buf[ODO_REC_CRC])
+        {
+            continue;
+        }
+
+        seq = (uint16_t)g_rec_buf[ODO_REC_SEQ] | ((uint16_t)g_rec_buf[ODO_REC_SEQ + 1] << 8);
+
+        /* Wrap-safe "newer than" */
+        if (!found || (int16_t)(seq - g_rec_seq) > 0)
+        {
+            found      = 1;
+            g_rec_seq  = seq;
+            g_rec_slot = slot;
+            g_odo_m    = odometer_get_u32(&g_rec_buf[ODO_REC_ODO]);
+            g_trip_m   = odometer_get_u32(&g_rec_buf[ODO_REC_TRIP]);
+        }
+    }
+
+    g_saved_odo_m  = g_odo_m;
+    g_dist_rem     = 0;
+    g_have_last    = 0;
+    g_rec_writing  = 0;
+    g_save_request = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : odometer_on_speed
+ * Description :
+ *    Integrates distance since the previous SPEED frame.
+ *    Gaps longer than ODO_MAX_FRAME_GAP_MS (sender lost) are
+ *    not extrapolated.
+ *---------------------------------------------------------*/
+void odometer_on_speed(uint16_t speed_kmh)
+{
+    uint32_t now = tick_now();
+    uint32_t dt_ms;
+    uint32_t metres;
+
+    if (g_have_last)
+    {
+        dt_ms = ((now - g_last_frame_tick) * TICK_PERIOD_US) / 1000UL;
+
+        if (dt_ms <= ODO_MAX_FRAME_GAP_MS)
+        {
+            g_dist_rem += (uint32_t)(g_last_speed + speed_kmh) * dt_ms;
+
+            if (g_dist_rem >= ODO_UNITS_PER_M)
+            {
+                metres      = g_dist_rem / ODO_UNITS_PER_M;
+                g_dist_rem -= metres * ODO_UNITS_PER_M;
+                g_odo_m    += metres;
+                g_trip_m   += metres;
+            }
+        }
+    }
+
+    g_last_frame_tick = now;
+    g_last_speed      = speed_kmh;
+    g_have_last       = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : odometer_poll
+ * Description :
+ *    Batches saves (every ODO_SAVE_INTERVAL_M or on request)
+ *    and advances the EEPROM writer by at most one byte.
+ *    The slot's marker is cleared first and set last, after
+ *    the CRC, so a torn record is never taken for valid and
+ *    the previous slot is used on next boot.
+ *---------------------------------------------------------*/
+void odometer_poll(void)
+{
+    uint8_t slot;
+    uint8_t addr;
+
+    if (g_rec_writing)
+    {
+        if (eeprom_busy())
+        {
+            return;
+        }
+
+        slot = (uint8_t)((g_rec_slot + 1) % ODO_RECORD_COUNT);
+        addr = odometer_slot_addr(slot);
+
+        if (g_rec_pos == 0)
+        {
+            eeprom_write_start((uint8_t)(addr + ODO_REC_MARK), ODO_MARK_INVALID);
+        }
+        else if (g_rec_pos < ODO_RECORD_SIZE)
+        {
+            eeprom_write_start((uint8_t)(addr + g_rec_pos), g_rec_buf[g_rec_pos]);
+        }
+        else if (g_rec_pos == ODO_RECORD_SIZE)
+        {
+            eeprom_write_start((uint8_t)(addr + ODO_REC_MARK), ODO_MARK_VALID);
+        }
+        else
+        {
+            g_rec_slot    = slot;
+            g_rec_writing = 0;
+            return;
+        }
+
+        g_rec_pos++;
+        return;
+    }
+
+    if (g_save_request || (g_odo_m - g_saved_odo_m) >= ODO_SAVE_INTERVAL_M)
+    {
+        odometer_start_save();
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : odometer_flush
+ * Description :
+ *    Requests an immediate save, e.g. on a power-down
+ *    warning. Keep calling odometer_poll() until done.
+ *---------------------------------------------------------*/
+void odometer_flush(void)
+{
+    g_save_request = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : odometer_reset_trip
+ *---------------------------------------------------------*/
+void odometer_reset_trip(void)
+{
+    g_trip_m = 0;
+    g_save_request = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : odometer_total_m / odometer_trip_m
+ *---------------------------------------------------------*/
+uint32_t odometer_total_m(void)
+{
+    return g_odo_m;
+}
+
+uint32_t odometer_trip_m(void)
+{
+    return g_trip_m;
+}
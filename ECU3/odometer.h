@@ -0,0 +1,44 @@
+#ifndef ODOMETER_H
+#define ODOMETER_H
+
+#include <stdint.h>
+#include "eeprom.h"
+
+/*---------------------------------------------------------
+ * Odometer Configuration
+ *---------------------------------------------------------*/
+#define ODO_SAVE_INTERVAL_M         1000U   /* Persist every 1 km */
+#define ODO_MAX_FRAME_GAP_MS        1000U   /* Longer gaps are not integrated */
+
+/*
+ * Wear-levelled record ring in data EEPROM, filling the whole
+ * odometer region. Each save rewrites one slot; its marker
+ * byte is written twice (invalid first, valid last), so it
+ * wears fastest: one marker cycle per
+ * ODO_RECORD_COUNT * ODO_SAVE_INTERVAL_M / 2 of distance.
+ * At the PIC18F4580's 100k-cycle minimum endurance that is
+ * ODO_ENDURANCE_KM (21 slots, 1 km: 1,050,000 km). A
+ * power-down warning (odometer_flush()) saves the remainder.
+ */
+#define ODO_RECORD_SIZE             12U     /* mark(1) seq(2) odo(4) trip(4) crc(1) */
+#define ODO_RECORD_COUNT            ((EE_ODO_END - EE_ODO_BASE + 1U) / ODO_RECORD_SIZE)
+
+#define ODO_EE_MIN_CYCLES           100000UL
+#define ODO_ENDURANCE_KM            (ODO_EE_MIN_CYCLES * ODO_RECORD_COUNT * ODO_SAVE_INTERVAL_M / 2000UL)
+
+/* Record marker: a slot counts only once its marker is valid */
+#define ODO_MARK_VALID              0xA5
+#define ODO_MARK_INVALID            0x00
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void     odometer_init(void);
+void     odometer_on_speed(uint16_t speed_kmh);
+void     odometer_poll(void);
+void     odometer_flush(void);
+void     odometer_reset_trip(void);
+uint32_t odometer_total_m(void);
+uint32_t odometer_trip_m(void);
+
+#endif /* ODOMETER_H */
@@ -0,0 +1,36 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <xc.h>
+
+/*---------------------------------------------------------
+ * CPU Power Modes
+ *
+ *  IDLE  : the core stops, the oscillator and every
+ *          peripheral (timers, ECAN, EUSART) keep running,
+ *          so no frame or byte is lost. Any enabled
+ *          interrupt wakes the core; the 1 ms tick
+ *          guarantees a wake-up.
+ *  SLEEP : the oscillator stops as well (timers, tick and
+ *          the time base halt). Used only in NM bus sleep,
+ *          with the ECAN module asleep and WAKIF as the
+ *          wake-up source.
+ *---------------------------------------------------------*/
+#define POWER_IDLE()                                \
+{                                                   \
+    OSCCONbits.IDLEN = 1;                           \
+    SLEEP();                                        \
+    NOP();                                          \
+}
+
+#define POWER_SLEEP()                               \
+{                                                   \
+    OSCCONbits.IDLEN = 0;                           \
+    SLEEP();                                        \
+    NOP();                                          \
+}
+
+/* Stay awake this long after a bus wake-up to hear the NM heartbeat */
+#define POWER_WAKE_LISTEN_MS        500U
+
+#endif /* POWER_H */
@@ -0,0 +1,271 @@
+/***********************************************************************
+ *  File name   : screen.c
+ *  Description : Shadow-buffered access to the character LCD.
+ *
+ *                Every dashboard field is drawn into a shadow copy of
+ *                the screen. A cell reaches the LCD only when it is
+ *                visible (not under the overlay) and differs from
+ *                what the LCD already shows; the DDRAM address is
+ *                sent only when the cursor is not already there, so
+ *                a run of cells costs one address write.
+ *
+ *                One overlay region (part of one row) can be laid
+ *                over the dashboard, e.g. a warning. Moving or
+ *                removing it rewrites only the cells that change:
+ *                what lies underneath comes from the shadow, not
+ *                from a full redraw, and live values keep being
+ *                drawn around it.
+ *
+ *                Before the LCD has finished power-on only the
+ *                buffers are updated; screen_lcd_ready() then draws
+ *                the whole state at once.
+ *
+ *  API:
+ *      - screen_init()
+ *      - screen_lcd_ready()
+ *      - screen_print()
+ *      - screen_putch()
+ *      - screen_load_char()
+ *      - screen_overlay()
+ *      - screen_overlay_off()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "screen.h"
+#include "clcd.h"
+
+/*---------------------------------------------------------
+ * Screen State
+ *  shadow : dashboard content (what is under the overlay)
+ *  lcd    : what the display shows right now
+ *---------------------------------------------------------*/
+static unsigned char g_shadow[SCREEN_ROWS][SCREEN_COLS];
+static unsigned char g_lcd[SCREEN_ROWS][SCREEN_COLS];
+
+static uint8_t g_lcd_ready = 0;
+static uint8_t g_cursor    = SCREEN_CURSOR_UNKNOWN;
+
+/* Overlay region (width 0 = none); text is padded with spaces */
+static const unsigned char *g_over_text;
+static uint8_t g_over_row;
+static uint8_t g_over_col;
+static uint8_t g_over_width = 0;
+static uint8_t g_over_len;                  /* Text characters in the region */
+
+uint16_t g_screen_writes;
+
+/*---------------------------------------------------------
+ *  Local Helper : DDRAM address of a cell
+ *---------------------------------------------------------*/
+static uint8_t screen_addr(uint8_t row, uint8_t col)
+{
+    return (uint8_t)(row ? LINE2(col) : LINE1(col));
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Content the cell should show
+ *---------------------------------------------------------*/
+static unsigned char screen_wanted(uint8_t row, uint8_t col)
+{
+    uint8_t i = (uint8_t)(col - g_over_col);
+
+    if (g_over_width == 0 || row != g_over_row || col < g_over_col || i >= g_over_width)
+    {
+        return g_shadow[row][col];
+    }
+
+    return (i < g_over_len) ? g_over_text[i] : ' ';
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Bring one LCD cell up to date
+ *---------------------------------------------------------*/
+static void screen_sync(uint8_t row, uint8_t col)
+{
+    unsigned char ch   = screen_wanted(row, col);
+    uint8_t       addr = screen_addr(row, col);
+
+    if (!g_lcd_ready || g_lcd[row][col] == ch)
+    {
+        return;
+    }
+
+    if (g_cursor != addr)
+    {
+        clcd_write(addr, INSTRUCTION_COMMAND);
+        g_screen_writes++;
+    }
+
+    clcd_write(ch, DATA_COMMAND);
+    g_screen_writes++;
+
+    g_lcd[row][col] = ch;
+    g_cursor        = (uint8_t)(addr + 1);     /* DDRAM auto-increment */
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Sync a run of cells in one row
+ *---------------------------------------------------------*/
+static void screen_sync_run(uint8_t row, uint8_t col, uint8_t width)
+{
+    for (uint8_t i = 0; i < width && col + i < SCREEN_COLS; i++)
+    {
+        screen_sync(row, (uint8_t)(col + i));
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : screen_init
+ * Description :
+ *    Empty shadow, no overlay, LCD not ready yet.
+ *---------------------------------------------------------*/
+void screen_init(void)
+{
+    for (uint8_t row = 0; row < SCREEN_ROWS; row++)
+    {
+        for (uint8_t col = 0; col < SCREEN_COLS; col++)
+        {
+            g_shadow[row][col] = ' ';
+        }
+    }
+
+    g_lcd_ready  = 0;
+    g_over_width = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : screen_lcd_ready
+ * Description :
+ *    Called once the LCD power-on sequence has finished (the
+ *    display is clear). Draws everything written so far.
+ *---------------------------------------------------------*/
+void screen_lcd_ready(void)
+{
+    for (uint8_t row = 0; row < SCREEN_ROWS; row++)
+    {
+        for (uint8_t col = 0; col < SCREEN_COLS; col++)
+        {
+            g_lcd[row][col] = ' ';
+        }
+    }
+
+    g_lcd_ready = 1;
+    g_cursor    = SCREEN_CURSOR_UNKNOWN;
+
+    for (uint8_t row = 0; row < SCREEN_ROWS; row++)
+    {
+        screen_sync_run(row, 0, SCREEN_COLS);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : screen_putch
+ * Description :
+ *    Writes one dashboard cell (any character code,
+ *    including CGRAM glyphs 0..7).
+ *---------------------------------------------------------*/
+void screen_putch(unsigned char ch, uint8_t addr)
+{
+    uint8_t row = (addr >= LINE2(0)) ? 1 : 0;
+    uint8_t col = (uint8_t)(addr - screen_addr(row, 0));
+
+    if (col >= SCREEN_COLS)
+    {
+        return;
+    }
+
+    g_shadow[row][col] = ch;
+    screen_sync(row, col);
+}
+
+/*---------------------------------------------------------
+ * Function : screen_print
+ * Description :
+ *    Writes a null-terminated string from addr on; text
+ *    past the end of the row is dropped.
+ *---------------------------------------------------------*/
+void screen_print(const unsigned char *str, uint8_t addr)
+{
+    while (*str != '\0')
+    {
+        screen_putch(*str++, addr++);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : screen_load_char
+ * Description :
+ *    Loads a CGRAM glyph; the LCD address counter is left
+ *    in CGRAM, so the next cell write re-addresses.
+ *---------------------------------------------------------*/
+void screen_load_char(uint8_t index, const unsigned char *pattern)
+{
+    clcd_load_char(index, pattern);
+
+    g_screen_writes += 1 + CGRAM_ROWS;
+    g_cursor         = SCREEN_CURSOR_UNKNOWN;
+}
+
+/*---------------------------------------------------------
+ * Function : screen_overlay
+ * Description :
+ *    Lays 'text' (padded to 'width' with spaces) over the
+ *    dashboard from addr on, replacing any previous overlay.
+ *    Only cells whose content changes are written; cells
+ *    the old region uncovers are restored from the shadow.
+ *    'text' must stay valid while it is shown.
+ *---------------------------------------------------------*/
+void screen_overlay(const unsigned char *text, uint8_t addr, uint8_t width)
+{
+    uint8_t old_row   = g_over_row;
+    uint8_t old_col   = g_over_col;
+    uint8_t old_width = g_over_width;
+    uint8_t row       = (addr >= LINE2(0)) ? 1 : 0;
+    uint8_t col       = (uint8_t)(addr - screen_addr(row, 0));
+
+    if (col >= SCREEN_COLS)
+    {
+        return;
+    }
+
+    if (width > SCREEN_COLS - col)
+    {
+        width = (uint8_t)(SCREEN_COLS - col);
+    }
+
+    g_over_text  = text;
+    g_over_row   = row;
+    g_over_col   = col;
+    g_over_width = width;
+
+    for (g_over_len = 0; g_over_len < width && text[g_over_len] != '\0'; g_over_len++)
+    {
+    }
+
+    /* New region, then whatever the old one no longer covers */
+    screen_sync_run(row, col, width);
+
+    if (old_width != 0)
+    {
+        screen_sync_run(old_row, old_col, old_width);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : screen_overlay_off
+ * Description :
+ *    Removes the overlay; the region shows the dashboard
+ *    content again (only cells that differ are written).
+ *---------------------------------------------------------*/
+void screen_overlay_off(void)
+{
+    uint8_t width = g_over_width;
+
+    g_over_width = 0;
+
+    if (width != 0)
+    {
+        screen_sync_run(g_over_row, g_over_col, width);
+    }
+}
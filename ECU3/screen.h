@@ -0,0 +1,33 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Screen Geometry (16x2 character LCD)
+ *---------------------------------------------------------*/
+#define SCREEN_ROWS                 2
+#define SCREEN_COLS                 16
+
+/* DDRAM address that is never written (cursor unknown) */
+#define SCREEN_CURSOR_UNKNOWN       0x00
+
+/*---------------------------------------------------------
+ * Bus Transfers (clcd_write calls) issued by this layer;
+ * wraps, readers take differences
+ *---------------------------------------------------------*/
+extern uint16_t g_screen_writes;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *  Addresses are LINE1(x) / LINE2(x) of clcd.h.
+ *---------------------------------------------------------*/
+void screen_init(void);
+void screen_lcd_ready(void);
+void screen_print(const unsigned char *str, uint8_t addr);
+void screen_putch(unsigned char ch, uint8_t addr);
+void screen_load_char(uint8_t index, const unsigned char *pattern);
+void screen_overlay(const unsigned char *text, uint8_t addr, uint8_t width);
+void screen_overlay_off(void);
+
+#endif /* SCREEN_H */
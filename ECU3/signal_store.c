@@ -0,0 +1,106 @@
+/***********************************************************************
+ *  File name   : signal_store.c
+ *  Description : Latest-value signal store.
+ *                The CAN receive path decodes frames into this
+ *                table (value, timestamp, version); the display
+ *                render task reads it at its own rate. Only the
+ *                newest value of each signal is kept, so a burst
+ *                of frames costs one store write each instead of
+ *                one LCD write each.
+ *
+ *                Writer and reader both run in the main loop, so
+ *                entries are plain copies; no interrupt touches
+ *                the table.
+ *
+ *  API:
+ *      - signal_store_init()
+ *      - signal_write()
+ *      - signal_invalidate()
+ *      - signal_read()
+ *      - signal_version()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "signal_store.h"
+#include "tick.h"
+
+/*---------------------------------------------------------
+ * Signal Table
+ *---------------------------------------------------------*/
+signal_t g_signals[SIGNAL_COUNT];
+
+/*---------------------------------------------------------
+ * Function : signal_store_init
+ *  All signals start invalid (nothing received yet).
+ *---------------------------------------------------------*/
+void signal_store_init(void)
+{
+    for (uint8_t i = 0; i < SIGNAL_COUNT; i++)
+    {
+        g_signals[i].value   = 0;
+        g_signals[i].stamp   = 0;
+        g_signals[i].version = 0;
+        g_signals[i].valid   = 0;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : signal_write
+ * Description :
+ *    Stores a freshly decoded value. The version is bumped
+ *    even if the value is unchanged; the renderer skips
+ *    the LCD write itself when nothing visible changed.
+ *---------------------------------------------------------*/
+void signal_write(uint8_t sig, uint16_t value)
+{
+    uint32_t now = tick_now();
+
+    if (sig >= SIGNAL_COUNT)
+    {
+        return;
+    }
+
+    g_signals[sig].value = value;
+    g_signals[sig].stamp = now;
+    g_signals[sig].valid = 1;
+    g_signals[sig].version++;
+}
+
+/*---------------------------------------------------------
+ * Function : signal_invalidate
+ *  Sender lost: keep the last value, flag it as stale.
+ *---------------------------------------------------------*/
+void signal_invalidate(uint8_t sig)
+{
+    if (sig >= SIGNAL_COUNT || !g_signals[sig].valid)
+    {
+        return;
+    }
+
+    g_signals[sig].valid = 0;
+    g_signals[sig].version++;
+}
+
+/*---------------------------------------------------------
+ * Function : signal_read
+ *  Copy of one entry.
+ *---------------------------------------------------------*/
+void signal_read(uint8_t sig, signal_t *out)
+{
+    if (sig >= SIGNAL_COUNT)
+    {
+        return;
+    }
+
+    *out = g_signals[sig];
+}
+
+/*---------------------------------------------------------
+ * Function : signal_version
+ *  Cheap change check before a full read.
+ *---------------------------------------------------------*/
+uint8_t signal_version(uint8_t sig)
+{
+    return (sig < SIGNAL_COUNT) ? g_signals[sig].version : 0;
+}
@@ -0,0 +1,44 @@
+#ifndef SIGNAL_STORE_H
+#define SIGNAL_STORE_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Dashboard Signals
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_sig_speed = 0,                /* km/h */
+    e_sig_gear,                     /* gear code (0..8) */
+    e_sig_rpm,
+    e_sig_indicator,                /* IndicatorStatus */
+    SIGNAL_COUNT
+} SignalId;
+
+/*---------------------------------------------------------
+ * Latest Value of one Signal
+ *  version changes on every write or invalidation, so a
+ *  reader can tell whether anything happened since its
+ *  last look without comparing values.
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint16_t value;
+    uint32_t stamp;                 /* tick_now() of the write */
+    uint8_t  version;
+    uint8_t  valid;                 /* 0: no data / sender lost */
+} signal_t;
+
+/* Readable over XCP */
+extern signal_t g_signals[SIGNAL_COUNT];
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void    signal_store_init(void);
+void    signal_write(uint8_t sig, uint16_t value);
+void    signal_invalidate(uint8_t sig);
+void    signal_read(uint8_t sig, signal_t *out);
+uint8_t signal_version(uint8_t sig);
+
+#endif /* SIGNAL_STORE_H */
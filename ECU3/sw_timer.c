@@ -0,0 +1,242 @@
+/***********************************************************************
+ *  File name   : sw_timer.c
+ *  Description : Hierarchical software timer wheel.
+ *                One-shot and periodic callbacks driven by the system
+ *                tick. Insert, stop and expiry are O(1); callbacks run
+ *                from sw_timer_poll() in main-loop context, never from
+ *                the ISR.
+ *
+ *  API:
+ *      - sw_timer_init()
+ *      - sw_timer_start()
+ *      - sw_timer_stop()
+ *      - sw_timer_active()
+ *      - sw_timer_poll()
+ *
+ ***********************************************************************/
+
+#include <stddef.h>
+#include "sw_timer.h"
+#include "tick.h"
+
+#define SW_TIMER_LEVEL1_SPAN        (1UL << (SW_TIMER_SLOT_BITS))
+#define SW_TIMER_LEVEL2_SPAN        (1UL << (2 * SW_TIMER_SLOT_BITS))
+#define SW_TIMER_MAX_SPAN           (1UL << (3 * SW_TIMER_SLOT_BITS))
+
+/*---------------------------------------------------------
+ * Wheel State
+ *---------------------------------------------------------*/
+static sw_timer_t *g_wheel[SW_TIMER_LEVELS][SW_TIMER_SLOTS];
+static uint32_t    g_wheel_now;
+
+/*---------------------------------------------------------
+ *  Local Helper : Link timer at the head of a slot list
+ *---------------------------------------------------------*/
+static void sw_timer_link(sw_timer_t **head, sw_timer_t *timer)
+{
+    timer->next  = *head;
+    timer->pprev = head;
+
+    if (*head != NULL)
+    {
+        (*head)->pprev = &timer->next;
+    }
+
+    *head = timer;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Unlink timer from whatever list holds it
+ *---------------------------------------------------------*/
+static void sw_timer_unlink(sw_timer_t *timer)
+{
+    *timer->pprev = timer->next;
+
+    if (timer->next != NULL)
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next  = NULL;
+    timer->pprev = NULL;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Place timer in the slot matching its expiry
+ *  A delta of 0 is only produced by cascading and lands in
+ *  the level 0 slot that is about to be processed.
+ *---------------------------------------------------------*/
+static void sw_timer_place(sw_timer_t *timer)
+{
+    uint32_t delta = timer->expires - g_wheel_now;
+    uint32_t slot_time = timer->expires;
+
+    if (delta < SW_TIMER_LEVEL1_SPAN)
+    {
+        sw_timer_link(&g_wheel[0][slot_time & SW_TIMER_SLOT_MASK], timer);
+    }
+    else if (delta < SW_TIMER_LEVEL2_SPAN)
+    {
+        sw_timer_link(&g_wheel[1][(slot_time >> SW_TIMER_SLOT_BITS) & SW_TIMER_SLOT_MASK], timer);
+    }
+    else
+    {
+        /* Park beyond-range timers in the furthest level 2 slot */
+        if (delta >= SW_TIMER_MAX_SPAN)
+        {
+            slot_time = g_wheel_now + SW_TIMER_MAX_SPAN - SW_TIMER_LEVEL2_SPAN;
+        }
+
+        sw_timer_link(&g_wheel[2][(slot_time >> (2 * SW_TIMER_SLOT_BITS)) & SW_TIMER_SLOT_MASK], timer);
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Re-distribute one slot into lower levels
+ *---------------------------------------------------------*/
+static void sw_timer_cascade(sw_timer_t **head)
+{
+    sw_timer_t *timer;
+
+    while ((timer = *head) != NULL)
+    {
+        sw_timer_unlink(timer);
+        sw_timer_place(timer);
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Advance the wheel by one tick
+ *---------------------------------------------------------*/
+static void sw_timer_advance(void)
+{
+    sw_timer_t *expired;
+    sw_timer_t *timer;
+    uint8_t     index;
+
+    g_wheel_now++;
+
+    index = (uint8_t)(g_wheel_now & SW_TIMER_SLOT_MASK);
+
+    if (index == 0)
+    {
+        uint8_t index1 = (uint8_t)((g_wheel_now >> SW_TIMER_SLOT_BITS) & SW_TIMER_SLOT_MASK);
+
+        if (index1 == 0)
+        {
+            sw_timer_cascade(&g_wheel[2][(g_wheel_now >> (2 * SW_TIMER_SLOT_BITS)) & SW_TIMER_SLOT_MASK]);
+        }
+
+        sw_timer_cascade(&g_wheel[1][index1]);
+    }
+
+    /* Detach the due slot so callbacks may re-arm freely */
+    expired = g_wheel[0][index];
+    g_wheel[0][index] = NULL;
+
+    if (expired != NULL)
+    {
+        expired->pprev = &expired;
+    }
+
+    while ((timer = expired) != NULL)
+    {
+        sw_timer_unlink(timer);
+
+        if (timer->period != 0)
+        {
+            timer->expires += timer->period;
+            sw_timer_place(timer);
+        }
+
+        timer->callback();
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : sw_timer_init
+ * Description :
+ *    Empties the wheel and aligns it with the tick counter.
+ *---------------------------------------------------------*/
+void sw_timer_init(void)
+{
+    for (uint8_t level = 0; level < SW_TIMER_LEVELS; level++)
+    {
+        for (uint8_t slot = 0; slot < SW_TIMER_SLOTS; slot++)
+        {
+            g_wheel[level][slot] = NULL;
+        }
+    }
+
+    g_wheel_now = tick_now();
+}
+
+/*---------------------------------------------------------
+ * Function : sw_timer_start
+ * Description :
+ *    Arms (or re-arms) a timer.
+ *
+ *      timer    → caller owned timer object
+ *      delay    → ticks until first expiry (0 treated as 1)
+ *      period   → reload ticks, 0 for one-shot
+ *      callback → function run from sw_timer_poll()
+ *---------------------------------------------------------*/
+void sw_timer_start(sw_timer_t *timer, uint16_t delay, uint16_t period, sw_timer_cb_t callback)
+{
+    if (timer->pprev != NULL)
+    {
+        sw_timer_unlink(timer);
+    }
+
+    if (delay == 0)
+    {
+        delay = 1;
+    }
+
+    timer->expires  = g_wheel_now + delay;
+    timer->period   = period;
+    timer->callback = callback;
+
+    sw_timer_place(timer);
+}
+
+/*---------------------------------------------------------
+ * Function : sw_timer_stop
+ * Description :
+ *    Disarms a timer. Safe to call on an idle timer and from
+ *    inside any timer callback.
+ *---------------------------------------------------------*/
+void sw_timer_stop(sw_timer_t *timer)
+{
+    if (timer->pprev != NULL)
+    {
+        sw_timer_unlink(timer);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : sw_timer_active
+ * Description :
+ *    Returns 1 while the timer is armed.
+ *---------------------------------------------------------*/
+uint8_t sw_timer_active(const sw_timer_t *timer)
+{
+    return (timer->pprev != NULL);
+}
+
+/*---------------------------------------------------------
+ * Function : sw_timer_poll
+ * Description :
+ *    Catches the wheel up with the tick counter and runs the
+ *    callbacks of every timer that fell due. Call from the
+ *    main loop.
+ *---------------------------------------------------------*/
+void sw_timer_poll(void)
+{
+    uint32_t now = tick_now();
+
+    while (g_wheel_now != now)
+    {
+        sw_timer_advance();
+    }
+}
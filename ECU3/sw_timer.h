@@ -0,0 +1,43 @@
+#ifndef SW_TIMER_H
+#define SW_TIMER_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Timer Wheel Geometry
+ *
+ *  Three levels of 32 slots each:
+ *      Level 0 : 1 tick per slot      (0 .. 31 ticks)
+ *      Level 1 : 32 ticks per slot    (32 .. 1023 ticks)
+ *      Level 2 : 1024 ticks per slot  (1024 .. 32767 ticks)
+ *  Longer delays are parked in level 2 and re-cascaded.
+ *---------------------------------------------------------*/
+#define SW_TIMER_SLOT_BITS          5
+#define SW_TIMER_SLOTS              (1U << SW_TIMER_SLOT_BITS)
+#define SW_TIMER_SLOT_MASK          (SW_TIMER_SLOTS - 1U)
+#define SW_TIMER_LEVELS             3
+
+/*---------------------------------------------------------
+ * Software Timer (caller allocated, intrusive list node)
+ *---------------------------------------------------------*/
+typedef void (*sw_timer_cb_t)(void);
+
+typedef struct sw_timer
+{
+    struct sw_timer  *next;
+    struct sw_timer **pprev;        /* NULL when not armed */
+    uint32_t          expires;      /* Absolute expiry tick */
+    uint16_t          period;       /* 0 = one-shot */
+    sw_timer_cb_t     callback;
+} sw_timer_t;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void    sw_timer_init(void);
+void    sw_timer_start(sw_timer_t *timer, uint16_t delay, uint16_t period, sw_timer_cb_t callback);
+void    sw_timer_stop(sw_timer_t *timer);
+uint8_t sw_timer_active(const sw_timer_t *timer);
+void    sw_timer_poll(void);
+
+#endif /* SW_TIMER_H */
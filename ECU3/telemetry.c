@@ -0,0 +1,138 @@
+/***********************************************************************
+ *  File name   : telemetry.c
+ *  Description : Serial telemetry bridge.
+ *                Mirrors every received CAN frame and each decoded
+ *                dashboard signal to the EUSART as compact binary
+ *                records (type, sequence, payload, CRC-8), framed
+ *                with COBS so 0x00 only ever appears as the record
+ *                delimiter and a receiver can resynchronise on any
+ *                byte boundary.
+ *
+ *                Records are queued in the UART ring buffer and sent
+ *                by the TX interrupt; a record that does not fit is
+ *                dropped (the sequence gap shows it on the host).
+ *
+ *                Host side: tools/telemetry_view.py
+ *
+ *  API:
+ *      - init_telemetry()
+ *      - telemetry_can_frame()
+ *      - telemetry_signal()
+ *
+ ***********************************************************************/
+
+#include <stdint.h>
+#include "telemetry.h"
+#include "uart.h"
+#include "crc8.h"
+
+uint16_t g_tele_dropped;
+
+static uint8_t g_tele_seq;
+
+/*---------------------------------------------------------
+ *  Local Helper : COBS encode src into dst, add delimiter
+ *  dst must hold len + 2 bytes (records are < 254 bytes).
+ *  Returns the encoded length including the delimiter.
+ *---------------------------------------------------------*/
+static uint8_t cobs_encode(const uint8_t *src, uint8_t len, uint8_t *dst)
+{
+    uint8_t code_pos = 0;
+    uint8_t code     = 1;
+    uint8_t out      = 1;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (src[i] == 0)
+        {
+            dst[code_pos] = code;
+            code_pos = out++;
+            code     = 1;
+        }
+        else
+        {
+            dst[out++] = src[i];
+            code++;
+        }
+    }
+
+    dst[code_pos] = code;
+    dst[out++]    = 0x00;
+
+    return out;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Seal, frame and queue one record
+ *  rec[0] = type, rec[2..len-1] = payload; room for CRC.
+ *---------------------------------------------------------*/
+static void telemetry_send(uint8_t *rec, uint8_t len)
+{
+    uint8_t frame[TELE_MAX_FRAME];
+    uint8_t frame_len;
+
+    rec[1]   = g_tele_seq++;
+    rec[len] = crc8(rec, len);
+
+    frame_len = cobs_encode(rec, (uint8_t)(len + 1), frame);
+
+    if (!uart_write(frame, frame_len))
+    {
+        g_tele_dropped++;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : init_telemetry
+ *---------------------------------------------------------*/
+void init_telemetry(void)
+{
+    g_tele_seq     = 0;
+    g_tele_dropped = 0;
+
+    init_uart();
+}
+
+/*---------------------------------------------------------
+ * Function : telemetry_can_frame
+ * Description :
+ *    Mirrors one raw CAN frame.
+ *---------------------------------------------------------*/
+void telemetry_can_frame(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    uint8_t rec[TELE_MAX_RECORD];
+
+    if (len > 8)
+    {
+        len = 8;
+    }
+
+    rec[0] = TELE_REC_CAN_FRAME;
+    rec[2] = (uint8_t)msg_id;
+    rec[3] = (uint8_t)(msg_id >> 8);
+    rec[4] = len;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        rec[5 + i] = data[i];
+    }
+
+    telemetry_send(rec, (uint8_t)(5 + len));
+}
+
+/*---------------------------------------------------------
+ * Function : telemetry_signal
+ * Description :
+ *    Mirrors one decoded dashboard value.
+ *---------------------------------------------------------*/
+void telemetry_signal(uint8_t signal, uint16_t value)
+{
+    uint8_t rec[6];
+
+    rec[0] = TELE_REC_SIGNAL;
+    rec[2] = signal;
+    rec[3] = (uint8_t)value;
+    rec[4] = (uint8_t)(value >> 8);
+
+    telemetry_send(rec, 5);
+}
@@ -0,0 +1,40 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Telemetry Record Format (before framing)
+ *
+ *      byte 0      : record type
+ *      byte 1      : sequence number (gaps = dropped records)
+ *      byte 2..n-1 : payload
+ *      byte n      : CRC-8 (crc8.h) over bytes 0..n-1
+ *
+ *  Each record is COBS encoded and terminated by 0x00.
+ *---------------------------------------------------------*/
+#define TELE_REC_CAN_FRAME          0x01    /* id (u16), dlc, data[dlc] */
+#define TELE_REC_SIGNAL             0x02    /* signal id, value (u16) */
+
+/* Decoded dashboard signals */
+#define TELE_SIG_SPEED              0x00    /* km/h */
+#define TELE_SIG_GEAR               0x01    /* gear code (0..8) */
+#define TELE_SIG_RPM                0x02
+#define TELE_SIG_INDICATOR          0x03    /* IndicatorStatus */
+#define TELE_SIG_COLLISION          0x04    /* 0 / 1 */
+
+/* Longest record: type, seq, id, dlc, 8 data bytes, CRC */
+#define TELE_MAX_RECORD             14
+#define TELE_MAX_FRAME              (TELE_MAX_RECORD + 2)   /* + COBS code + delimiter */
+
+/* Records dropped because the UART ring was full */
+extern uint16_t g_tele_dropped;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void init_telemetry(void);
+void telemetry_can_frame(uint16_t msg_id, const uint8_t *data, uint8_t len);
+void telemetry_signal(uint8_t signal, uint16_t value);
+
+#endif /* TELEMETRY_H */
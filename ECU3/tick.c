@@ -0,0 +1,88 @@
+/***********************************************************************
+ *  File name   : tick.c
+ *  Description : System tick driver.
+ *                Timer2 runs from Fosc/4 through a 1:4 prescaler and
+ *                a 1:5 postscaler. PR2 is reloaded by hardware on each
+ *                period match, so the tick has no ISR reload drift and
+ *                fires once per TICK_PERIOD_US instead of every 50 us.
+ *
+ *  API:
+ *      - init_tick()
+ *      - tick_now()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "tick.h"
+#include "clock.h"
+
+/*---------------------------------------------------------
+ * Timer2 period calculation
+ *---------------------------------------------------------*/
+#define TICK_TMR2_PRESCALE          4UL
+#define TICK_TMR2_POSTSCALE         5UL
+#define TICK_TMR2_HZ                ((_XTAL_FREQ / 4UL) / TICK_TMR2_PRESCALE / TICK_TMR2_POSTSCALE)
+#define TICK_TMR2_COUNTS            ((TICK_TMR2_HZ * TICK_PERIOD_US) / 1000000UL)
+
+#if ((TICK_TMR2_HZ * TICK_PERIOD_US) % 1000000UL) != 0
+#error "TICK_PERIOD_US is not an exact number of Timer2 counts"
+#endif
+
+#if (TICK_TMR2_COUNTS < 1) || (TICK_TMR2_COUNTS > 256)
+#error "TICK_PERIOD_US is out of Timer2 range"
+#endif
+
+/*---------------------------------------------------------
+ * Tick Counter
+ *---------------------------------------------------------*/
+volatile uint32_t g_tick_count;
+seqlock_t         g_tick_seq;
+
+/*---------------------------------------------------------
+ * Function : init_tick
+ * Description :
+ *    Configures Timer2 for the periodic system tick.
+ *
+ *    - Internal clock (Fosc / 4)
+ *    - Prescaler 1:4, Postscaler 1:5
+ *    - PR2 = period - 1 (hardware reload)
+ *    - Period match interrupt enabled
+ *---------------------------------------------------------*/
+void init_tick(void)
+{
+    TMR2ON = 0;
+
+    /* Postscaler 1:5 (T2OUTPS = 0100), Prescaler 1:4 (T2CKPS = 01) */
+    T2CON = (uint8_t)(((TICK_TMR2_POSTSCALE - 1) << 3) | 0x01);
+
+    PR2  = (uint8_t)(TICK_TMR2_COUNTS - 1);
+    TMR2 = 0;
+
+    g_tick_count = 0;
+
+    /* Clear interrupt flag */
+    TMR2IF = 0;
+
+    /* Enable Timer2 interrupt */
+    TMR2IE = 1;
+
+    /* Start Timer2 */
+    TMR2ON = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : tick_now
+ * Description :
+ *    Returns the current tick count.
+ *    The four byte loads are retried if a tick interrupt
+ *    landed between them (seqlock), so the value is never
+ *    torn and the tick interrupt is never delayed.
+ *---------------------------------------------------------*/
+uint32_t tick_now(void)
+{
+    uint32_t now;
+
+    SEQLOCK_READ(g_tick_seq, now, g_tick_count);
+
+    return now;
+}
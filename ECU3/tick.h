@@ -0,0 +1,46 @@
+#ifndef TICK_H
+#define TICK_H
+
+#include <stdint.h>
+#include "atomic.h"
+
+/*---------------------------------------------------------
+ * System Tick Period
+ *
+ *  Derived from Timer2 (Fosc/4, prescaler 1:4, postscaler
+ *  1:5), so one PR2 count is 4 us at 20 MHz. Any multiple
+ *  of 4 us between 4 us and 1024 us is accepted.
+ *---------------------------------------------------------*/
+#ifndef TICK_PERIOD_US
+#define TICK_PERIOD_US              1000UL
+#endif
+
+/* Convert milliseconds into system ticks (rounded up) */
+#define TICK_FROM_MS(ms)            ((uint32_t)(((ms) * 1000UL + TICK_PERIOD_US - 1) / TICK_PERIOD_US))
+
+/*---------------------------------------------------------
+ * Tick Counter (updated in the Timer2 ISR, read through
+ * tick_now() as a seqlock snapshot)
+ *---------------------------------------------------------*/
+extern volatile uint32_t g_tick_count;
+extern seqlock_t         g_tick_seq;
+
+/*---------------------------------------------------------
+ * Tick ISR body, called from isr() on TMR2IF.
+ * Hardware reloads PR2, so no reload is needed here.
+ *---------------------------------------------------------*/
+#define TICK_ISR()                                  \
+{                                                   \
+    SEQLOCK_WRITE_BEGIN(g_tick_seq);                \
+    g_tick_count++;                                 \
+    SEQLOCK_WRITE_END(g_tick_seq);                  \
+    TMR2IF = 0;                                     \
+}
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void     init_tick(void);
+uint32_t tick_now(void);
+
+#endif /* TICK_H */
@@ -1,9 +0,0 @@
-#ifndef TIMER0_H
-#define TIMER0_H
-
-/*---------------------------------------------------------
- * Timer0 Initialization Prototype
- *---------------------------------------------------------*/
-void init_timer0(void);
-
-#endif /* TIMER0_H */
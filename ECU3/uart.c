@@ -0,0 +1,127 @@
+/***********************************************************************
+ *  File name   : uart.c
+ *  Description : Interrupt-driven EUSART transmitter.
+ *                The main loop appends whole messages to a 256-byte
+ *                ring buffer and returns at once; the TX interrupt
+ *                drains the ring one byte per TXIF. The main loop
+ *                owns the head index and the ISR the tail index,
+ *                both single bytes, so no locking is needed.
+ *                Messages that do not fit are dropped whole, never
+ *                waited for.
+ *
+ *                TX = RC6, RX = RC7 (receiver unused).
+ *
+ *  API:
+ *      - init_uart()
+ *      - uart_tx_free()
+ *      - uart_tx_idle()
+ *      - uart_write()
+ *      - uart_tx_isr()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "uart.h"
+
+/*---------------------------------------------------------
+ * Transmit Ring
+ *---------------------------------------------------------*/
+static uint8_t          g_tx_ring[UART_TX_RING_SIZE];
+static volatile uint8_t g_tx_head;          /* Next free byte (main) */
+static volatile uint8_t g_tx_tail;          /* Next byte to send (ISR) */
+
+/*---------------------------------------------------------
+ * Function : init_uart
+ * Description :
+ *    Configures the EUSART for asynchronous 8N1 transmit at
+ *    UART_BAUD. The TX interrupt is enabled only while the
+ *    ring holds data.
+ *---------------------------------------------------------*/
+void init_uart(void)
+{
+    /* Both pins must be inputs; the EUSART drives TX itself */
+    TRISC6 = 1;
+    TRISC7 = 1;
+
+    BAUDCONbits.BRG16 = 1;
+    SPBRGH = (uint8_t)(UART_BRG >> 8);
+    SPBRG  = (uint8_t)UART_BRG;
+
+    TXSTAbits.SYNC = 0;
+    TXSTAbits.BRGH = 1;
+    RCSTAbits.SPEN = 1;
+    TXSTAbits.TXEN = 1;
+
+    g_tx_head = 0;
+    g_tx_tail = 0;
+
+    TXIE = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : uart_tx_free
+ * Description :
+ *    Returns the number of bytes that can be queued now.
+ *---------------------------------------------------------*/
+uint8_t uart_tx_free(void)
+{
+    /* One slot stays empty to tell full from empty */
+    return (uint8_t)(g_tx_tail - g_tx_head - 1U);
+}
+
+/*---------------------------------------------------------
+ * Function : uart_tx_idle
+ * Description :
+ *    Returns 1 once the ring is empty and the last stop bit
+ *    has left the shift register (safe to stop the clock).
+ *---------------------------------------------------------*/
+uint8_t uart_tx_idle(void)
+{
+    return (uint8_t)(g_tx_head == g_tx_tail && TXSTAbits.TRMT);
+}
+
+/*---------------------------------------------------------
+ * Function : uart_write
+ * Description :
+ *    Queues len bytes for transmission.
+ *    Returns 1 if queued, 0 if the ring had no room (nothing
+ *    is queued in that case).
+ *---------------------------------------------------------*/
+uint8_t uart_write(const uint8_t *data, uint8_t len)
+{
+    uint8_t head = g_tx_head;
+
+    if (len > uart_tx_free())
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        g_tx_ring[head++] = data[i];
+    }
+
+    /* Publish, then wake the transmitter */
+    g_tx_head = head;
+    TXIE = 1;
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Function : uart_tx_isr
+ * Description :
+ *    Called from isr() on TXIF with TXIE set. Sends the
+ *    next byte or disables the interrupt when drained.
+ *---------------------------------------------------------*/
+void uart_tx_isr(void)
+{
+    if (g_tx_tail != g_tx_head)
+    {
+        TXREG = g_tx_ring[g_tx_tail++];
+    }
+    else
+    {
+        TXIE = 0;
+    }
+}
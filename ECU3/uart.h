@@ -0,0 +1,44 @@
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include "clock.h"
+
+/*---------------------------------------------------------
+ * EUSART Baud Rate
+ *
+ *  BRG16 = 1, BRGH = 1 : baud = Fosc / (4 * (SPBRG + 1))
+ *  The divisor is rounded to nearest; the build fails if
+ *  the resulting rate is off by more than 2 %.
+ *---------------------------------------------------------*/
+#ifndef UART_BAUD
+#define UART_BAUD                   115200UL
+#endif
+
+#define UART_BRG                    ((_XTAL_FREQ + 2UL * UART_BAUD) / (4UL * UART_BAUD) - 1UL)
+#define UART_ACTUAL_BAUD            (_XTAL_FREQ / (4UL * (UART_BRG + 1UL)))
+
+#if (UART_BRG > 0xFFFFUL)
+#error "UART_BAUD is too low for this oscillator"
+#endif
+
+#if ((UART_ACTUAL_BAUD > UART_BAUD ? UART_ACTUAL_BAUD - UART_BAUD : UART_BAUD - UART_ACTUAL_BAUD) * 50UL) > UART_BAUD
+#error "UART_BAUD: baud rate error above 2 %"
+#endif
+
+/*---------------------------------------------------------
+ * Transmit Ring Buffer (size must be 256: the 8-bit
+ * indices wrap by themselves)
+ *---------------------------------------------------------*/
+#define UART_TX_RING_SIZE           256U
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void    init_uart(void);
+uint8_t uart_tx_free(void);
+uint8_t uart_tx_idle(void);
+uint8_t uart_write(const uint8_t *data, uint8_t len);
+void    uart_tx_isr(void);
+
+#endif /* UART_H */
@@ -0,0 +1,238 @@
+/***********************************************************************
+ *  File name   : warning.c
+ *  Description : Prioritised warning overlay for the dashboard LCD.
+ *
+ *                Each warning owns a fixed region of the label row
+ *                (LINE1); the values on LINE2 keep updating while it
+ *                is shown. Only one warning is on screen at a time,
+ *                drawn through the screen layer's overlay, so taking
+ *                over or giving back a region rewrites just the
+ *                cells that change and never clears the display.
+ *
+ *                Arbitration:
+ *                - a raised warning of a higher class than the one
+ *                  shown replaces it at once;
+ *                - clearing the shown warning shows the highest
+ *                  remaining one, or restores the labels;
+ *                - while several are active they take turns every
+ *                  WARN_ROTATE_MS, in class order; a collision
+ *                  warning is never rotated out;
+ *                - info messages clear themselves after WARN_INFO_MS.
+ *
+ *  API:
+ *      - warning_init()
+ *      - warning_raise()
+ *      - warning_clear()
+ *      - warning_active()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "warning.h"
+#include "screen.h"
+#include "clcd.h"
+#include "tick.h"
+#include "sw_timer.h"
+#include "boot.h"
+
+/*---------------------------------------------------------
+ * Warning Table (WarningId order)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t              prio;
+    uint8_t              addr;      /* Region start */
+    uint8_t              width;     /* Region width (text padded) */
+    const unsigned char *text;
+} warning_def_t;
+
+static const warning_def_t g_warn_defs[WARN_COUNT] =
+{
+    { e_warn_prio_collision, LINE1(0), 16, (const unsigned char *)"Collision !" },
+    { e_warn_prio_overheat,  LINE1(0), 16, (const unsigned char *)"Engine Overheat" },
+    { e_warn_prio_stale,     LINE1(0),  8, (const unsigned char *)"NO ECU1" },      /* over SP / GR */
+    { e_warn_prio_stale,     LINE1(8),  8, (const unsigned char *)"NO ECU2" },      /* over RPM / IND */
+    { e_warn_prio_info,      LINE1(0),  8, (const unsigned char *)"ECU1 OK" },
+    { e_warn_prio_info,      LINE1(8),  8, (const unsigned char *)"ECU2 OK" },
+};
+
+warning_state_t g_warning;
+
+static sw_timer_t g_warn_timer;
+static uint32_t   g_shown_tick;                 /* When the shown warning went up */
+static uint32_t   g_raised_tick[WARN_COUNT];
+
+#define WARN_BIT(id)                ((uint8_t)(1U << (id)))
+
+/*---------------------------------------------------------
+ *  Local Helper : Put warning 'id' (or WARN_NONE) on screen
+ *   and book the LCD writes the transition cost.
+ *---------------------------------------------------------*/
+static void warning_show(uint8_t id)
+{
+    uint16_t writes = g_screen_writes;
+    uint8_t  cost;
+
+    if (id == WARN_NONE)
+    {
+        screen_overlay_off();
+    }
+    else
+    {
+        screen_overlay(g_warn_defs[id].text, g_warn_defs[id].addr, g_warn_defs[id].width);
+    }
+
+    cost = (uint8_t)(g_screen_writes - writes);
+
+    if (cost != 0 && id != WARN_NONE)
+    {
+        BOOT_MARK(first_pixel_ms);
+    }
+
+    g_warning.shown       = id;
+    g_warning.last_writes = cost;
+    g_warning.transitions++;
+
+    if (cost > g_warning.max_writes)
+    {
+        g_warning.max_writes = cost;
+    }
+
+    g_shown_tick = tick_now();
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : First active warning after 'id' in table
+ *   order, wrapping; WARN_NONE when nothing is active.
+ *---------------------------------------------------------*/
+static uint8_t warning_next(uint8_t id)
+{
+    uint8_t next = (id == WARN_NONE) ? (WARN_COUNT - 1) : id;
+
+    for (uint8_t n = 0; n < WARN_COUNT; n++)
+    {
+        next = (uint8_t)((next + 1) % WARN_COUNT);
+
+        if (g_warning.active & WARN_BIT(next))
+        {
+            return next;
+        }
+    }
+
+    return WARN_NONE;
+}
+
+/*---------------------------------------------------------
+ * Timer callback (every WARN_POLL_MS): info expiry and
+ * rotation
+ *---------------------------------------------------------*/
+static void warning_tick(void)
+{
+    uint32_t now = tick_now();
+    uint8_t  next;
+
+    for (uint8_t id = 0; id < WARN_COUNT; id++)
+    {
+        if ((g_warning.active & WARN_BIT(id)) && g_warn_defs[id].prio == e_warn_prio_info &&
+            (now - g_raised_tick[id]) >= TICK_FROM_MS(WARN_INFO_MS))
+        {
+            warning_clear(id);
+        }
+    }
+
+    if (g_warning.shown == WARN_NONE ||
+        g_warn_defs[g_warning.shown].prio == e_warn_prio_collision ||
+        (now - g_shown_tick) < TICK_FROM_MS(WARN_ROTATE_MS))
+    {
+        return;
+    }
+
+    next = warning_next(g_warning.shown);
+
+    if (next != g_warning.shown)
+    {
+        warning_show(next);
+    }
+    else
+    {
+        g_shown_tick = now;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : warning_init
+ * Description :
+ *    Nothing raised; starts the rotation timer. Requires the
+ *    software timers to be initialised.
+ *---------------------------------------------------------*/
+void warning_init(void)
+{
+    g_warning.active = 0;
+    g_warning.shown  = WARN_NONE;
+
+    sw_timer_start(&g_warn_timer,
+                   (uint16_t)TICK_FROM_MS(WARN_POLL_MS),
+                   (uint16_t)TICK_FROM_MS(WARN_POLL_MS),
+                   warning_tick);
+}
+
+/*---------------------------------------------------------
+ * Function : warning_raise
+ * Description :
+ *    Activates a warning. It is shown at once if nothing is
+ *    shown or it outranks the shown one; otherwise it waits
+ *    for its turn. Raising an active info message restarts
+ *    its lifetime.
+ *---------------------------------------------------------*/
+void warning_raise(uint8_t id)
+{
+    if (id >= WARN_COUNT)
+    {
+        return;
+    }
+
+    g_raised_tick[id] = tick_now();
+
+    if (g_warning.active & WARN_BIT(id))
+    {
+        return;
+    }
+
+    g_warning.active |= WARN_BIT(id);
+
+    if (g_warning.shown == WARN_NONE ||
+        g_warn_defs[id].prio > g_warn_defs[g_warning.shown].prio)
+    {
+        warning_show(id);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : warning_clear
+ * Description :
+ *    Deactivates a warning. If it was on screen, the highest
+ *    remaining warning takes its place, or the region goes
+ *    back to the dashboard.
+ *---------------------------------------------------------*/
+void warning_clear(uint8_t id)
+{
+    if (id >= WARN_COUNT || !(g_warning.active & WARN_BIT(id)))
+    {
+        return;
+    }
+
+    g_warning.active &= (uint8_t)~WARN_BIT(id);
+
+    if (g_warning.shown == id)
+    {
+        warning_show(warning_next(WARN_NONE));
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : warning_active
+ *---------------------------------------------------------*/
+uint8_t warning_active(uint8_t id)
+{
+    return (id < WARN_COUNT) ? (uint8_t)((g_warning.active >> id) & 1U) : 0;
+}
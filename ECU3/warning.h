@@ -0,0 +1,68 @@
+#ifndef WARNING_H
+#define WARNING_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Warning Classes (higher value wins)
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_warn_prio_info = 0,
+    e_warn_prio_stale,              /* Sensor node silent */
+    e_warn_prio_overheat,
+    e_warn_prio_collision           /* Never rotated out */
+} WarningPrio;
+
+/*---------------------------------------------------------
+ * Warnings (ordered by class, highest first; the table in
+ * warning.c follows this order)
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_warn_collision = 0,
+    e_warn_overheat,
+    e_warn_ecu1_lost,
+    e_warn_ecu2_lost,
+    e_warn_ecu1_back,
+    e_warn_ecu2_back,
+    WARN_COUNT
+} WarningId;
+
+#define WARN_NONE                   0xFF
+
+/*---------------------------------------------------------
+ * Timing
+ *  ROTATE : dwell of each warning while several are active
+ *  INFO   : info messages clear themselves after this
+ *  POLL   : timer period for rotation and expiry
+ *---------------------------------------------------------*/
+#define WARN_ROTATE_MS              2000
+#define WARN_INFO_MS                3000
+#define WARN_POLL_MS                100
+
+/*---------------------------------------------------------
+ * Manager State (readable over XCP)
+ *  writes per transition = bus transfers to the LCD when
+ *  the shown warning changed (overlay drawn or restored)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  active;                /* Bit n = WarningId n raised */
+    uint8_t  shown;                 /* WarningId on screen or WARN_NONE */
+    uint16_t transitions;
+    uint8_t  last_writes;
+    uint8_t  max_writes;
+} warning_state_t;
+
+extern warning_state_t g_warning;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void    warning_init(void);
+void    warning_raise(uint8_t id);
+void    warning_clear(uint8_t id);
+uint8_t warning_active(uint8_t id);
+
+#endif /* WARNING_H */
@@ -0,0 +1,94 @@
+/***********************************************************************
+ *  File name   : adc.c
+ *  Description : Driver for the 10-bit ADC (right justified,
+ *                Fosc/32 conversion clock, 4 Tad acquisition,
+ *                VDD / VSS references). Conversions are blocking.
+ *                Compiled only on nodes with HAL_ADC set.
+ *
+ *  API:
+ *      - init_adc()
+ *      - read_adc()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "adc.h"
+
+#if HAL_ADC
+
+#include "profile.h"
+
+/* Profiler probe, where the node's node_cfg.h has a slot for it */
+#ifdef PROF_READ_ADC
+#define ADC_PROBE_ENTER()       PROFILE_ENTER(PROF_READ_ADC)
+#define ADC_PROBE_EXIT()        PROFILE_EXIT(PROF_READ_ADC)
+#else
+#define ADC_PROBE_ENTER()
+#define ADC_PROBE_EXIT()
+#endif
+
+/*---------------------------------------------------------
+ *  Function : init_adc
+ *  Description :
+ *      Configures and switches on the ADC module.
+ *---------------------------------------------------------*/
+void init_adc(void)
+{
+    /* Right justified result in ADRESH:ADRESL */
+    ADFM = 1;
+
+    /* Acquisition time 4 Tad */
+    ACQT2 = 0;
+    ACQT1 = 1;
+    ACQT0 = 0;
+
+    /* Conversion clock Fosc / 32 -> 1.6 us per Tad at 20 MHz */
+    ADCS0 = 0;
+    ADCS1 = 1;
+    ADCS2 = 0;
+
+    /* No conversion running to start with */
+    GODONE = 0;
+
+    /* References: VSS and VDD */
+    VCFG1 = 0;
+    VCFG0 = 0;
+
+    ADRESH = 0;
+    ADRESL = 0;
+
+    /* Turn ON the ADC module */
+    ADON = 1;
+}
+
+/*---------------------------------------------------------
+ *  Function : read_adc
+ *  Description :
+ *      Converts one channel (CHANNEL0 .. CHANNEL10) and
+ *      returns the 10-bit result.
+ *---------------------------------------------------------*/
+unsigned short read_adc(unsigned char channel)
+{
+    unsigned short reg_val;
+
+    ADC_PROBE_ENTER();
+
+    /* Select the channel */
+    ADCON0 = (ADCON0 & 0xC3) | (channel << 2);
+
+    /* Start the conversion and wait for it */
+    GO = 1;
+
+    while (GO)
+    {
+        continue;
+    }
+
+    reg_val = (ADRESH << 8) | ADRESL;
+
+    ADC_PROBE_EXIT();
+
+    return reg_val;
+}
+
+#endif /* HAL_ADC */
@@ -0,0 +1,58 @@
+#ifndef ATOMIC_H
+#define ATOMIC_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Critical Sections
+ *
+ *  Mask only the interrupt that shares the data, not GIE,
+ *  so unrelated interrupts keep their latency. The previous
+ *  enable state is restored, so sections may nest and are
+ *  safe before the interrupt has been enabled.
+ *
+ *      uint8_t ie;
+ *      CRITICAL_ENTER(ie, TMR2IE);
+ *      ...
+ *      CRITICAL_EXIT(ie, TMR2IE);
+ *---------------------------------------------------------*/
+#define CRITICAL_ENTER(saved, ie_bit)               \
+{                                                   \
+    (saved)  = (uint8_t)(ie_bit);                   \
+    (ie_bit) = 0;                                   \
+}
+
+#define CRITICAL_EXIT(saved, ie_bit)                \
+{                                                   \
+    (ie_bit) = (saved);                             \
+}
+
+/*---------------------------------------------------------
+ * Sequence Lock (versioned snapshot)
+ *
+ *  For multi-byte values written by an ISR and read by
+ *  lower priority code. The writer bumps the sequence
+ *  before and after the update; the reader copies the
+ *  value and retries if the sequence was odd or changed.
+ *  The writer never waits and the interrupt is never
+ *  masked. The writer must be the higher priority context
+ *  (a reader in an ISR could spin forever).
+ *---------------------------------------------------------*/
+typedef volatile uint8_t seqlock_t;
+
+#define SEQLOCK_WRITE_BEGIN(seq)    { (seq)++; }
+#define SEQLOCK_WRITE_END(seq)      { (seq)++; }
+
+#define SEQLOCK_READ(seq, dst, src)                 \
+{                                                   \
+    uint8_t seq_start_;                             \
+    do                                              \
+    {                                               \
+        seq_start_ = (seq);                         \
+        (dst) = (src);                              \
+    }                                               \
+    while ((seq_start_ & 1U) || seq_start_ != (seq)); \
+}
+
+#endif /* ATOMIC_H */
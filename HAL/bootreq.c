@@ -0,0 +1,67 @@
+/***********************************************************************
+ *  File name   : bootreq.c
+ *  Description : Application side of the CAN bootloader (BOOT/).
+ *                A BOOT_CMD_ENTER frame on this node's bootloader
+ *                command ID ("ENTER" + "BOOT" magic) sets the
+ *                request flag in data EEPROM and resets the CPU;
+ *                the bootloader sees the flag, clears it and waits
+ *                for the flashing host.
+ *
+ *                The command ID follows HAL_NODE_ID (hal_cfg.h).
+ *
+ *  API:
+ *      - bootreq_is_frame()
+ *      - bootreq_on_frame()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "bootreq.h"
+
+/*---------------------------------------------------------
+ * Function : bootreq_is_frame
+ *---------------------------------------------------------*/
+uint8_t bootreq_is_frame(uint16_t msg_id)
+{
+    return (uint8_t)(msg_id == BOOTREQ_CMD_ID);
+}
+
+/*---------------------------------------------------------
+ * Function : bootreq_on_frame
+ * Description :
+ *    Does not return on a valid request. The EEPROM write
+ *    waits for any write already in progress and runs with
+ *    interrupts off: nothing else matters after it.
+ *---------------------------------------------------------*/
+void bootreq_on_frame(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    if (!bootreq_is_frame(msg_id) || len < 5 || data[0] != BOOTREQ_CMD_ENTER ||
+        data[1] != 'B' || data[2] != 'O' || data[3] != 'O' || data[4] != 'T')
+    {
+        return;
+    }
+
+    GIE = 0;
+
+    while (EECON1bits.WR)
+    {
+        ;
+    }
+
+    EEADR  = BOOTREQ_EE_REQUEST;
+    EEDATA = BOOTREQ_REQUEST;
+
+    EECON1bits.EEPGD = 0;
+    EECON1bits.CFGS  = 0;
+    EECON1bits.WREN  = 1;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+
+    while (EECON1bits.WR)
+    {
+        ;
+    }
+
+    RESET();
+}
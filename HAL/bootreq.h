@@ -0,0 +1,26 @@
+#ifndef BOOTREQ_H
+#define BOOTREQ_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "msg_id.h"
+
+/*---------------------------------------------------------
+ * Bootloader Entry (must match BOOT/boot_cfg.h)
+ *
+ *  The application is linked above the boot block
+ *  (-mcodeoffset=0x800) and started by the bootloader.
+ *---------------------------------------------------------*/
+#define BOOTREQ_CMD_ID              (BOOT_CMD_MSG_ID_BASE + HAL_NODE_ID)
+#define BOOTREQ_CMD_ENTER           0x01
+
+#define BOOTREQ_EE_REQUEST          0xFF    /* Data EEPROM flag byte */
+#define BOOTREQ_REQUEST             0x5A
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+uint8_t bootreq_is_frame(uint16_t msg_id);
+void    bootreq_on_frame(uint16_t msg_id, const uint8_t *data, uint8_t len);
+
+#endif /* BOOTREQ_H */
@@ -0,0 +1,278 @@
+/***********************************************************************
+ *  File name   : calib.c
+ *  Description : Calibration set in data EEPROM with a RAM cache.
+ *
+ *                calib_init() reads both EEPROM slots once at boot,
+ *                keeps the newer one whose CRC-8 and layout version
+ *                check out and copies it into g_calib; the compiled
+ *                defaults (CALIB_DEFAULTS) are used when there is
+ *                nothing usable, or when the stored values fail the
+ *                node's CALIB_IN_RANGE() check. From then on the
+ *                application reads g_calib fields directly, at the
+ *                cost of a plain global access.
+ *
+ *                Updates go to the RAM cache (XCP DOWNLOAD) and take
+ *                effect at once; calib_write_ok() turns away a write
+ *                that would leave the cache out of range, and no
+ *                out-of-range cache is stored. calib_store_request() (XCP
+ *                SET_REQUEST STORE_CAL_REQ) snapshots the cache into
+ *                a slot image; calib_poll() then writes it one byte
+ *                per call into the older slot, never waiting on the
+ *                EEPROM. The CRC is written last, so a reset mid-way
+ *                leaves the previous slot in charge.
+ *
+ *                Compiled only on nodes with HAL_CALIB set; the
+ *                node's node_cfg.h defines the set.
+ *
+ *  API:
+ *      - calib_init()
+ *      - calib_write_ok()
+ *      - calib_store_request()
+ *      - calib_store_pending()
+ *      - calib_poll()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "calib.h"
+
+#if HAL_CALIB
+
+#include "eeprom.h"
+#include "crc8.h"
+#include "cycles.h"
+
+/*---------------------------------------------------------
+ * Slot Image Layout
+ *---------------------------------------------------------*/
+#define CALIB_VERSION               0
+#define CALIB_SEQ                   1
+#define CALIB_LEN                   2
+#define CALIB_HEADER_LEN            3
+#define CALIB_MAX_PAYLOAD           (CALIB_SLOT_SIZE - CALIB_HEADER_LEN - 1U)
+
+/* Fails to compile when calib_t outgrows a slot or its layout size changes */
+typedef char calib_slot_fits_t[(sizeof(calib_t) <= CALIB_MAX_PAYLOAD) ? 1 : -1];
+typedef char calib_layout_size_t[(sizeof(calib_t) == CALIB_LAYOUT_SIZE) ? 1 : -1];
+
+/*---------------------------------------------------------
+ * RAM Cache and Store State
+ *---------------------------------------------------------*/
+calib_t  g_calib;
+uint8_t  g_calib_status;
+uint16_t g_calib_load_cycles;
+
+static const calib_t g_calib_defaults = CALIB_DEFAULTS;
+
+static uint8_t g_seq;                       /* Sequence of the slot in use */
+static uint8_t g_next_slot;                 /* Slot written by the next store */
+static uint8_t g_image[CALIB_SLOT_SIZE];    /* Snapshot being written */
+static uint8_t g_store_len;                 /* 0 = no store running */
+static uint8_t g_store_pos;
+
+/*---------------------------------------------------------
+ *  Local Helper : Read and check one slot
+ *   Returns 1 if the slot holds a CRC-valid block;
+ *   *blank is set when the slot was never written.
+ *---------------------------------------------------------*/
+static uint8_t calib_read_slot(uint8_t base, uint8_t *slot, uint8_t *blank)
+{
+    uint8_t len;
+
+    for (uint8_t i = 0; i < CALIB_SLOT_SIZE; i++)
+    {
+        slot[i] = eeprom_read((uint8_t)(base + i));
+    }
+
+    *blank = (uint8_t)(slot[CALIB_VERSION] == 0xFF && slot[CALIB_SEQ] == 0xFF);
+    len    = slot[CALIB_LEN];
+
+    if (*blank || len == 0 || len > CALIB_MAX_PAYLOAD)
+    {
+        return 0;
+    }
+
+    return (uint8_t)(crc8(slot, (uint8_t)(CALIB_HEADER_LEN + len)) == slot[CALIB_HEADER_LEN + len]);
+}
+
+/*---------------------------------------------------------
+ * Function : calib_init
+ * Description :
+ *    Fills the RAM cache. Must run before anything reads
+ *    g_calib and before any EEPROM write is started.
+ *---------------------------------------------------------*/
+void calib_init(void)
+{
+    uint8_t  slot_a[CALIB_SLOT_SIZE];
+    uint8_t  slot_b[CALIB_SLOT_SIZE];
+    uint8_t  valid_a, valid_b, blank_a, blank_b;
+    uint8_t *use;
+    uint8_t *dst = (uint8_t *)&g_calib;
+    uint16_t start;
+
+    CYCLES_INIT();
+    start = CYCLES_NOW();
+
+    g_calib = g_calib_defaults;
+
+    valid_a = calib_read_slot(CALIB_SLOT_A, slot_a, &blank_a);
+    valid_b = calib_read_slot(CALIB_SLOT_B, slot_b, &blank_b);
+
+    g_store_len = 0;
+
+    if (!valid_a && !valid_b)
+    {
+        g_seq          = 0;
+        g_next_slot    = CALIB_SLOT_A;
+        g_calib_status = (blank_a && blank_b) ? e_calib_default_blank : e_calib_default_crc;
+        g_calib_load_cycles = CYCLES_NOW() - start;
+        return;
+    }
+
+    /* Both valid: the later sequence number (8-bit wrap) wins */
+    if (valid_a && (!valid_b || (int8_t)(slot_a[CALIB_SEQ] - slot_b[CALIB_SEQ]) > 0))
+    {
+        use         = slot_a;
+        g_next_slot = CALIB_SLOT_B;
+    }
+    else
+    {
+        use         = slot_b;
+        g_next_slot = CALIB_SLOT_A;
+    }
+
+    g_seq = use[CALIB_SEQ];
+
+    if (use[CALIB_VERSION] == CALIB_LAYOUT_VERSION && use[CALIB_LEN] == sizeof(calib_t))
+    {
+        g_calib_status = e_calib_loaded;
+    }
+    else if (use[CALIB_VERSION] >= CALIB_OLDEST_VERSION &&
+             use[CALIB_VERSION] < CALIB_LAYOUT_VERSION && use[CALIB_LEN] < sizeof(calib_t))
+    {
+        /* Older layout: its fields are a prefix of this one */
+        g_calib_status = e_calib_migrated;
+    }
+    else
+    {
+        g_calib_status = e_calib_default_version;
+        g_calib_load_cycles = CYCLES_NOW() - start;
+        return;
+    }
+
+    for (uint8_t i = 0; i < use[CALIB_LEN]; i++)
+    {
+        dst[i] = use[CALIB_HEADER_LEN + i];
+    }
+
+    /* CRC-valid is not the same as usable: a zero divisor */
+    if (!CALIB_IN_RANGE(&g_calib))
+    {
+        g_calib        = g_calib_defaults;
+        g_calib_status = e_calib_default_range;
+    }
+
+    g_calib_load_cycles = CYCLES_NOW() - start;
+}
+
+/*---------------------------------------------------------
+ * Function : calib_write_ok
+ * Description :
+ *    Checks a write of 'len' bytes at 'mem' (XCP DOWNLOAD)
+ *    before it is made. Returns 0 if it lands in the RAM
+ *    cache and would take a value out of range; writes
+ *    elsewhere always pass. A multi-byte field must be
+ *    written in one go.
+ *---------------------------------------------------------*/
+uint8_t calib_write_ok(const uint8_t *mem, const uint8_t *data, uint8_t len)
+{
+    const uint8_t *base = (const uint8_t *)&g_calib;
+    calib_t        next = g_calib;
+    uint8_t       *dst  = (uint8_t *)&next;
+
+    if (mem + len <= base || mem >= base + sizeof(calib_t))
+    {
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        if (mem + i >= base && mem + i < base + sizeof(calib_t))
+        {
+            dst[mem + i - base] = data[i];
+        }
+    }
+
+    return (uint8_t)CALIB_IN_RANGE(&next);
+}
+
+/*---------------------------------------------------------
+ * Function : calib_store_request
+ * Description :
+ *    Snapshots the RAM cache for persistence. Returns 0 if
+ *    a store is still running or the cache is out of range
+ *    (nothing is taken then).
+ *---------------------------------------------------------*/
+uint8_t calib_store_request(void)
+{
+    const uint8_t *src = (const uint8_t *)&g_calib;
+    uint8_t        n   = (uint8_t)sizeof(calib_t);
+
+    if (g_store_len != 0 || !CALIB_IN_RANGE(&g_calib))
+    {
+        return 0;
+    }
+
+    g_image[CALIB_VERSION] = CALIB_LAYOUT_VERSION;
+    g_image[CALIB_SEQ]     = (uint8_t)(g_seq + 1U);
+    g_image[CALIB_LEN]     = n;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        g_image[CALIB_HEADER_LEN + i] = src[i];
+    }
+
+    g_image[CALIB_HEADER_LEN + n] = crc8(g_image, (uint8_t)(CALIB_HEADER_LEN + n));
+
+    g_store_pos = 0;
+    g_store_len = (uint8_t)(CALIB_HEADER_LEN + n + 1U);
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Function : calib_store_pending
+ *---------------------------------------------------------*/
+uint8_t calib_store_pending(void)
+{
+    return (uint8_t)(g_store_len != 0);
+}
+
+/*---------------------------------------------------------
+ * Function : calib_poll
+ * Description :
+ *    Starts the next EEPROM byte write of a running store
+ *    once the previous one has finished (~4 ms each). Call
+ *    from the main loop.
+ *---------------------------------------------------------*/
+void calib_poll(void)
+{
+    if (g_store_len == 0 || eeprom_busy())
+    {
+        return;
+    }
+
+    if (g_store_pos < g_store_len)
+    {
+        eeprom_write_start((uint8_t)(g_next_slot + g_store_pos), g_image[g_store_pos]);
+        g_store_pos++;
+        return;
+    }
+
+    /* Last byte (CRC) is in: this slot is now the current one */
+    g_seq       = g_image[CALIB_SEQ];
+    g_next_slot = (g_next_slot == CALIB_SLOT_A) ? CALIB_SLOT_B : CALIB_SLOT_A;
+    g_store_len = 0;
+}
+
+#endif /* HAL_CALIB */
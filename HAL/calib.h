@@ -0,0 +1,66 @@
+#ifndef CALIB_H
+#define CALIB_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "eeprom.h"
+
+#if HAL_CALIB
+
+/*---------------------------------------------------------
+ * Calibration Set : node_cfg.h
+ *  calib_t, CALIB_DEFAULTS, CALIB_IN_RANGE(),
+ *  CALIB_LAYOUT_VERSION, CALIB_OLDEST_VERSION,
+ *  CALIB_LAYOUT_SIZE and the slot base EE_CALIB_BASE.
+ *---------------------------------------------------------*/
+#if !defined(CALIB_LAYOUT_VERSION) || !defined(CALIB_LAYOUT_SIZE) || !defined(EE_CALIB_BASE) || \
+    !defined(CALIB_IN_RANGE)
+#error "HAL_CALIB needs the calibration set and EE_CALIB_BASE in node_cfg.h"
+#endif
+
+/*---------------------------------------------------------
+ * EEPROM Slots (two, written alternately)
+ *
+ *  byte 0     : layout version
+ *  byte 1     : sequence (newer slot wins)
+ *  byte 2     : payload length
+ *  byte 3..   : calib_t
+ *  last       : CRC-8 over bytes 0 .. payload end
+ *---------------------------------------------------------*/
+#define CALIB_SLOT_SIZE             16U
+#define CALIB_SLOT_A                EE_CALIB_BASE
+#define CALIB_SLOT_B                (EE_CALIB_BASE + CALIB_SLOT_SIZE)
+
+/*---------------------------------------------------------
+ * Load Result (readable over XCP)
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_calib_loaded = 0,             /* Stored block, current layout */
+    e_calib_migrated,               /* Stored block, older layout + defaults */
+    e_calib_default_blank,          /* Nothing stored yet */
+    e_calib_default_version,        /* Newer or unknown layout */
+    e_calib_default_crc,            /* Both slots corrupted */
+    e_calib_default_range           /* Stored block out of range */
+} CalibStatus;
+
+/*---------------------------------------------------------
+ * RAM Cache (read directly by the application, written by
+ * XCP DOWNLOAD)
+ *---------------------------------------------------------*/
+extern calib_t  g_calib;
+extern uint8_t  g_calib_status;
+extern uint16_t g_calib_load_cycles;   /* calib_init() duration */
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void    calib_init(void);
+uint8_t calib_write_ok(const uint8_t *mem, const uint8_t *data, uint8_t len);
+uint8_t calib_store_request(void);
+uint8_t calib_store_pending(void);
+void    calib_poll(void);
+
+#endif /* HAL_CALIB */
+
+#endif /* CALIB_H */
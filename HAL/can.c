@@ -0,0 +1,564 @@
+/***********************************************************************
+ *  File name   : can.c
+ *  Description : ECAN driver for PIC18 microcontroller.
+ *                Provides initialization, message transmit and receive
+ *                interfaces using Standard Identifier (11-bit).
+ *
+ *                Shared by all nodes (HAL/), variants selected by
+ *                the node's hal_cfg.h:
+ *
+ *                HAL_CAN_RX_IRQ = 1 : reception is interrupt driven.
+ *                The high priority ISR drains RXB0/RXB1 into a RAM
+ *                ring as soon as a frame lands, so slow main-loop
+ *                work no longer overruns the two hardware buffers.
+ *                Handlers get a read-only view of the oldest ring
+ *                slot through can_rx_acquire(), with the DLC clamped
+ *                to CAN_MAX_DLC, and give it back with
+ *                can_rx_release(). CCP1 captures Timer1 on every CAN
+ *                receive (CIOCON.CANCAP) for the RX interrupt
+ *                latency.
+ *
+ *                HAL_CAN_RX_IRQ = 0 : can_receive() polls RXB0, then
+ *                RXB1, and returns as soon as it has read a frame.
+ *
+ *                HAL_CAN_FILTER_NODE = 1 : RXB0 only takes this
+ *                node's XCP commands and the time sync frames, RXB1
+ *                the NM heartbeats and bootloader commands; 0 : both
+ *                buffers accept every frame, RXB0 overflowing into
+ *                RXB1.
+ *
+ *                HAL_CAN_TX_WAIT_LOOPS > 0 : can_transmit() waits
+ *                that long for a pending TXB0 frame and aborts it if
+ *                the bus is stuck; 0 : callers check ECAN_TX0_BUSY.
+ *
+ *  API:
+ *      - init_can()
+ *      - can_set_mode()
+ *      - can_transmit()
+ *      - can_receive()
+ *      - can_rx_isr()          (HAL_CAN_RX_IRQ)
+ *      - can_rx_pending()      (HAL_CAN_RX_IRQ, inline in can.h otherwise)
+ *      - can_rx_acquire()      (HAL_CAN_RX_IRQ)
+ *      - can_rx_release()      (HAL_CAN_RX_IRQ)
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include "can.h"
+#include "clock.h"
+#include "can_timing.h"
+#include "profile.h"
+
+#if HAL_CAN_RX_IRQ
+#include "irq.h"
+#include "cycles.h"
+#endif
+
+#if HAL_CAN_FILTER_NODE
+#include "msg_id.h"
+#include "xcp.h"
+#endif
+
+/*---------------------------------------------------------
+ *  Profiler Probes (only where the node's node_cfg.h has
+ *  a slot for them)
+ *---------------------------------------------------------*/
+#ifdef PROF_CAN_TRANSMIT
+#define CAN_TX_PROBE_ENTER()    PROFILE_ENTER(PROF_CAN_TRANSMIT)
+#define CAN_TX_PROBE_EXIT()     PROFILE_EXIT(PROF_CAN_TRANSMIT)
+#else
+#define CAN_TX_PROBE_ENTER()
+#define CAN_TX_PROBE_EXIT()
+#endif
+
+#ifdef PROF_CAN_RECEIVE
+#define CAN_RX_PROBE_ENTER()    PROFILE_ENTER(PROF_CAN_RECEIVE)
+#define CAN_RX_PROBE_EXIT()     PROFILE_EXIT(PROF_CAN_RECEIVE)
+#else
+#define CAN_RX_PROBE_ENTER()
+#define CAN_RX_PROBE_EXIT()
+#endif
+
+/*---------------------------------------------------------
+ *  RX Buffer Register Layout
+ *   RXBnCON, SIDH, SIDL, EIDH, EIDL, DLC, D0..D7 are
+ *   consecutive for both RXB0 and RXB1 (legacy mode).
+ *---------------------------------------------------------*/
+#define CAN_RXB_SIDH        1
+#define CAN_RXB_SIDL        2
+#define CAN_RXB_DLC         5
+#define CAN_RXB_D0          6
+
+#if HAL_CAN_RX_IRQ
+
+/*---------------------------------------------------------
+ *  RX Ring (single producer: high ISR, single consumer:
+ *  main loop; 8-bit indices are updated atomically)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint16_t id;
+    uint8_t  len;
+    uint8_t  data[CAN_MAX_DLC];
+} can_rx_slot_t;
+
+static can_rx_slot_t    g_rx_ring[CAN_RX_RING_SIZE];
+static volatile uint8_t g_rx_head;          /* Written by the ISR */
+static volatile uint8_t g_rx_tail;          /* Written by the main loop */
+
+volatile uint16_t g_can_rx_overruns;
+
+#if (CAN_RX_RING_SIZE & (CAN_RX_RING_SIZE - 1)) != 0
+#error "CAN_RX_RING_SIZE must be a power of two"
+#endif
+
+#endif /* HAL_CAN_RX_IRQ */
+
+/*---------------------------------------------------------
+ *  Local Helper : Read Standard ID from an RX buffer
+ *---------------------------------------------------------*/
+static uint16_t can_read_standard_id(const volatile uint8_t *rxb)
+{
+    uint16_t std_id = 0;
+
+    /* Extract bits from SIDH and SIDL */
+    std_id = ((rxb[CAN_RXB_SIDL] >> 5) & 0x07) | ((uint16_t)rxb[CAN_RXB_SIDH] << 3);
+
+    return std_id;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Copy the payload of an RX buffer
+ *   Returns the length, clamped to CAN_MAX_DLC (the DLC
+ *   field may encode up to 15).
+ *---------------------------------------------------------*/
+static uint8_t can_read_payload(const volatile uint8_t *rxb, uint8_t *data)
+{
+    uint8_t len = rxb[CAN_RXB_DLC] & 0x0F;
+
+    if (len > CAN_MAX_DLC)
+    {
+        len = CAN_MAX_DLC;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        data[i] = rxb[CAN_RXB_D0 + i];
+    }
+
+    return len;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Write Standard ID into TX Buffer 0
+ *---------------------------------------------------------*/
+static void can_write_standard_id(uint16_t msg_id)
+{
+    TXB0SIDL = (msg_id & 0x07) << 5;
+    TXB0SIDH = (msg_id >> 3);
+}
+
+/*---------------------------------------------------------
+ *  Function : can_set_mode
+ *  Description :
+ *      Requests an ECAN operation mode and waits (bounded)
+ *      until CANSTAT reports it.
+ *
+ *      Returns 1 on success, 0 on timeout.
+ *---------------------------------------------------------*/
+uint8_t can_set_mode(uint8_t mode)
+{
+    uint16_t wait = CAN_MODE_WAIT_LOOPS;
+
+    CAN_SET_OPERATION_MODE_NO_WAIT(mode);
+
+    /* Compare OPMODE bits only */
+    while ((CANSTAT & CAN_OPMODE_MASK) != mode)
+    {
+        if (--wait == 0)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Function : init_can
+ *  Description :
+ *      Initializes the ECAN peripheral.
+ *      Sets CAN TX/RX pins, config mode, timing parameters,
+ *      receive filters, and enters normal mode; with
+ *      HAL_CAN_RX_IRQ also the RX ring and its interrupts.
+ *
+ *      Returns 1 on success, 0 if the module never reached
+ *      configuration mode (bounded wait, no hang at boot).
+ *---------------------------------------------------------*/
+uint8_t init_can(void)
+{
+    /* CAN_TX = RB2 (output), CAN_RX = RB3 (input) */
+    TRISB2 = 0;
+    TRISB3 = 1;
+
+    /* Enter configuration mode */
+    if (!can_set_mode(CAN_OPMODE_CONFIG))
+    {
+        return 0;
+    }
+
+    /* Select ECAN Legacy Mode */
+    ECANCON = 0x00;
+
+    /* Bit Timing solved at compile time for _XTAL_FREQ / CAN_BITRATE */
+    BRGCON1 = CAN_BRGCON1;   /* SJW, BRP */
+    BRGCON2 = CAN_BRGCON2;   /* PS2 programmable, PS1, Propagation */
+    BRGCON3 = CAN_BRGCON3;   /* PS2 */
+
+    /* Enable Filter Control (Filter 0 enabled) */
+    RXFCON0 = 0x00;
+
+#if HAL_CAN_FILTER_NODE
+    /*
+     * RXB0 only takes this node's XCP commands (RXF0) and the
+     * time sync frames (RXF1); RXB1 only takes the network
+     * management heartbeats (RXF2, RXF4, RXF5) and the
+     * bootloader commands (RXF3), low 3 ID bits ignored
+     */
+    RXM0SIDH = 0xFF;                            /* Compare all 11 ID bits */
+    RXM0SIDL = 0xE0;
+    RXF0SIDH = (uint8_t)(XCP_CRO_ID >> 3);
+    RXF0SIDL = (uint8_t)((XCP_CRO_ID & 0x07) << 5);
+    RXF1SIDH = (uint8_t)(TIME_SYNC_MSG_ID >> 3);
+    RXF1SIDL = (uint8_t)((TIME_SYNC_MSG_ID & 0x07) << 5);
+
+    RXM1SIDH = 0xFF;                            /* Compare ID bits 10..3 */
+    RXM1SIDL = 0x00;
+    RXF2SIDH = (uint8_t)(NM_MSG_ID_BASE >> 3);
+    RXF2SIDL = 0x00;
+    RXF3SIDH = (uint8_t)(BOOT_CMD_MSG_ID_BASE >> 3);
+    RXF3SIDL = 0x00;
+    RXF4SIDH = RXF5SIDH = RXF2SIDH;
+    RXF4SIDL = RXF5SIDL = RXF2SIDL;
+#endif
+
+    /* Enter Normal Mode */
+    CAN_SET_OPERATION_MODE_NO_WAIT(CAN_OPMODE_NORMAL);
+
+#if HAL_CAN_FILTER_NODE
+    /* Receive valid messages that match the filters */
+    RXB0CON = 0x00;
+    RXB1CON = 0x00;
+#else
+    /* Receive all valid messages, RXB0 overflows into RXB1 */
+    RXB0CON = 0x00;
+    RXB0CONbits.RXM0 = 1;     /* Accept all messages */
+    RXB0CONbits.RXM1 = 1;
+    RXB0CONbits.RXB0DBEN = 1;
+
+    RXB1CON = 0x00;
+    RXB1CONbits.RXM0 = 1;
+    RXB1CONbits.RXM1 = 1;
+#endif
+
+#if HAL_CAN_RX_IRQ
+    g_rx_head = 0;
+    g_rx_tail = 0;
+    g_can_rx_overruns = 0;
+
+    /* CCP1 capture input = CAN receive signal (Timer1 source) */
+    CIOCONbits.CANCAP = 1;
+    CCP1CON = 0x05;
+
+    /* Receive interrupts (high priority, see irq.h) */
+    RXB0IF = 0;
+    RXB1IF = 0;
+    RXB0IE = 1;
+    RXB1IE = 1;
+#endif
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_tx_wait
+ *  Description :
+ *      Lets the previous frame leave TX Buffer 0, for at most
+ *      HAL_CAN_TX_WAIT_LOOPS polls (no wait if 0).
+ *
+ *      Returns 1 if TXB0 is free, 0 if still busy.
+ *---------------------------------------------------------*/
+uint8_t can_tx_wait(void)
+{
+#if HAL_CAN_TX_WAIT_LOOPS > 0
+    uint16_t wait = HAL_CAN_TX_WAIT_LOOPS;
+
+    while (ECAN_TX0_BUSY && wait)
+    {
+        wait--;
+    }
+#endif
+
+    return !ECAN_TX0_BUSY;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_transmit
+ *  Description :
+ *      Sends a CAN message using TX Buffer 0.
+ *
+ *      Parameters:
+ *          msg_id  - Standard Identifier (11-bit)
+ *          data    - Pointer to payload data bytes
+ *          len     - Number of data bytes (0–8)
+ *---------------------------------------------------------*/
+void can_transmit(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    uint8_t *tx_buffer;
+
+    CAN_TX_PROBE_ENTER();
+
+#if HAL_CAN_TX_WAIT_LOOPS > 0
+    /* Let the previous frame leave TXB0; abort it if the bus is stuck */
+    if (!can_tx_wait())
+    {
+        TXB0REQ = 0;
+    }
+#endif
+
+    /* Extended ID disabled */
+    TXB0EIDH = 0x00;
+    TXB0EIDL = 0x00;
+
+    /* Load Standard ID */
+    can_write_standard_id(msg_id);
+
+    /* Set Data Length Code */
+    if (len > CAN_MAX_DLC)
+    {
+        len = CAN_MAX_DLC;
+    }
+
+    TXB0DLC = len;
+
+    /* Load payload bytes */
+    tx_buffer = (uint8_t *)&TXB0D0;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        tx_buffer[i] = data[i];
+    }
+
+    /* Request message transmission */
+    TXB0REQ = 1;
+
+    CAN_TX_PROBE_EXIT();
+}
+
+#if HAL_CAN_RX_IRQ
+
+/*---------------------------------------------------------
+ *  Local Helper : Copy one RX buffer into the ring
+ *---------------------------------------------------------*/
+static void can_rx_store(const volatile uint8_t *rxb)
+{
+    can_rx_slot_t *slot;
+    uint8_t        next = (uint8_t)((g_rx_head + 1) & (CAN_RX_RING_SIZE - 1));
+
+    if (next == g_rx_tail)
+    {
+        g_can_rx_overruns++;
+        return;
+    }
+
+    slot      = &g_rx_ring[g_rx_head];
+    slot->id  = can_read_standard_id(rxb);
+    slot->len = can_read_payload(rxb, slot->data);
+
+    g_rx_head = next;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_rx_isr
+ *  Description :
+ *      High priority RXB0/RXB1 interrupt. Records the
+ *      latency from the capture of the receive signal, then
+ *      moves every full buffer into the ring. RXB1 only
+ *      fills while RXB0 is full, so RXB0 is the older frame.
+ *      Hardware overflows and ring overruns are counted.
+ *---------------------------------------------------------*/
+void can_rx_isr(void)
+{
+    uint16_t latency = (uint16_t)(CYCLES_NOW() - CCPR1);
+
+    IRQ_LATENCY(e_irq_can_rx, latency);
+
+    if (ECAN_FIFO0_FULL)
+    {
+        can_rx_store(&RXB0CON);
+        ECAN_FIFO0_FULL = 0;
+    }
+
+    if (ECAN_FIFO1_FULL)
+    {
+        can_rx_store(&RXB1CON);
+        ECAN_FIFO1_FULL = 0;
+    }
+
+    if (COMSTATbits.RXB0OVFL || COMSTATbits.RXB1OVFL)
+    {
+        g_can_rx_overruns++;
+        COMSTATbits.RXB0OVFL = 0;
+        COMSTATbits.RXB1OVFL = 0;
+    }
+
+    RXB0IF = 0;
+    RXB1IF = 0;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_rx_pending
+ *      Returns 1 if a received frame is waiting.
+ *---------------------------------------------------------*/
+uint8_t can_rx_pending(void)
+{
+    return (uint8_t)(g_rx_tail != g_rx_head);
+}
+
+/*---------------------------------------------------------
+ *  Function : can_rx_acquire
+ *  Description :
+ *      Points view at the oldest received frame without
+ *      copying it. view->data is valid for view->len
+ *      (0..CAN_MAX_DLC) bytes until can_rx_release(view);
+ *      the ISR does not reuse the slot until then.
+ *
+ *      Returns 1 if a frame is available, 0 otherwise.
+ *---------------------------------------------------------*/
+uint8_t can_rx_acquire(can_rx_view_t *view)
+{
+    const can_rx_slot_t *slot;
+    uint8_t              tail = g_rx_tail;
+
+    CAN_RX_PROBE_ENTER();
+
+    if (tail == g_rx_head)
+    {
+        view->len  = 0;
+        view->slot = CAN_RX_RING_SIZE;
+        CAN_RX_PROBE_EXIT();
+        return 0;
+    }
+
+    slot = &g_rx_ring[tail];
+
+    view->id   = slot->id;
+    view->len  = slot->len;
+    view->slot = tail;
+    view->data = slot->data;
+
+    CAN_RX_PROBE_EXIT();
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_rx_release
+ *  Description :
+ *      Returns the slot of an acquired view to the ring.
+ *---------------------------------------------------------*/
+void can_rx_release(can_rx_view_t *view)
+{
+    /* Ignore a view that was never filled or is already released */
+    if (view->slot == g_rx_tail && g_rx_tail != g_rx_head)
+    {
+        g_rx_tail = (uint8_t)((g_rx_tail + 1) & (CAN_RX_RING_SIZE - 1));
+    }
+
+    view->len  = 0;
+    view->slot = CAN_RX_RING_SIZE;
+}
+
+/*---------------------------------------------------------
+ *  Function : can_receive
+ *  Description :
+ *      Copying receive on top of the view API, for callers
+ *      that keep the frame after releasing the buffer.
+ *
+ *      Parameters:
+ *          msg_id  - pointer to store received Standard ID
+ *          data    - CAN_MAX_DLC bytes for the payload
+ *          len     - pointer to data length
+ *
+ *      Note:
+ *          If no message is available:
+ *              *len = 0
+ *---------------------------------------------------------*/
+void can_receive(uint16_t *msg_id, uint8_t *data, uint8_t *len)
+{
+    can_rx_view_t view;
+
+    if (!can_rx_acquire(&view))
+    {
+        *len = 0;
+        return;
+    }
+
+    *msg_id = view.id;
+    *len    = view.len;
+
+    for (uint8_t i = 0; i < view.len; i++)
+    {
+        data[i] = view.data[i];
+    }
+
+    can_rx_release(&view);
+}
+
+#else
+
+/*---------------------------------------------------------
+ *  Function : can_receive
+ *  Description :
+ *      Reads the frame in RXB0, else the one in RXB1, and
+ *      frees that buffer. One frame per call.
+ *
+ *      Parameters:
+ *          msg_id  - pointer to store received Standard ID
+ *          data    - CAN_MAX_DLC bytes for the payload
+ *          len     - pointer to data length
+ *
+ *      Note:
+ *          If no message is available:
+ *              *len = 0
+ *---------------------------------------------------------*/
+void can_receive(uint16_t *msg_id, uint8_t *data, uint8_t *len)
+{
+    CAN_RX_PROBE_ENTER();
+
+    if (ECAN_FIFO0_FULL)
+    {
+        *msg_id = can_read_standard_id(&RXB0CON);
+        *len    = can_read_payload(&RXB0CON, data);
+
+        ECAN_FIFO0_FULL = 0;
+        RXB0IF = 0;
+    }
+    else if (ECAN_FIFO1_FULL)
+    {
+        *msg_id = can_read_standard_id(&RXB1CON);
+        *len    = can_read_payload(&RXB1CON, data);
+
+        ECAN_FIFO1_FULL = 0;
+        RXB1IF = 0;
+    }
+    else
+    {
+        /* No data available */
+        *len = 0;
+    }
+
+    CAN_RX_PROBE_EXIT();
+}
+
+#endif /* HAL_CAN_RX_IRQ */
@@ -0,0 +1,141 @@
+/***********************************************************************
+ *  File name   : can.h
+ *  Description : Header file for CAN driver.
+ *                Contains macro definitions for ECAN operation modes,
+ *                FIFO status helpers, and CAN API prototypes.
+ *
+ *                Receive variant (hal_cfg.h, HAL_CAN_RX_IRQ):
+ *                  1 : the high priority ISR drains RXB0/RXB1 into
+ *                      a RAM ring, read through zero-copy views
+ *                  0 : polled, can_receive() reads the hardware
+ *                      buffers directly (RXB0IE stays with the
+ *                      application, e.g. for receive timestamps)
+ ***********************************************************************/
+
+#ifndef CAN_H
+#define CAN_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "hal.h"
+
+/*---------------------------------------------------------
+ *  CAN Operation Mode Values
+ *---------------------------------------------------------*/
+#define CAN_OPMODE_NORMAL   0x00
+#define CAN_OPMODE_DISABLE  0x20    /* Module asleep, bus activity sets WAKIF */
+#define CAN_OPMODE_LOOP     0x40
+#define CAN_OPMODE_CONFIG   0x80
+#define CAN_OPMODE_MASK     0xE0
+
+/* Bound on polling loops while waiting for a mode change */
+#define CAN_MODE_WAIT_LOOPS 10000U
+
+/*---------------------------------------------------------
+ *  ECAN FIFO status flags
+ *---------------------------------------------------------*/
+#define ECAN_MODE_BITS      (CANCON & 0x0F)
+
+#define ECAN_FIFO0_FULL     RXB0CONbits.RXFUL
+#define ECAN_FIFO1_FULL     RXB1CONbits.RXFUL
+#define ECAN_FIFO2_FULL     B0CONbits.RXFUL
+#define ECAN_FIFO3_FULL     B1CONbits.RXFUL
+#define ECAN_FIFO4_FULL     B2CONbits.RXFUL
+#define ECAN_FIFO5_FULL     B3CONbits.RXFUL
+#define ECAN_FIFO6_FULL     B4CONbits.RXFUL
+#define ECAN_FIFO7_FULL     B5CONbits.RXFUL
+
+/* TX Buffer 0 still holds a pending message */
+#define ECAN_TX0_BUSY       TXB0CONbits.TXREQ
+
+/*---------------------------------------------------------
+ *  Nominal Bit Rate (bit timing solved in can_timing.h)
+ *---------------------------------------------------------*/
+#define CAN_BITRATE         500000UL
+
+/*---------------------------------------------------------
+ *  CAN Frame Limits
+ *---------------------------------------------------------*/
+#define CAN_MAX_DLC         8
+
+/*---------------------------------------------------------
+ *  Set CAN mode (no wait)
+ *---------------------------------------------------------*/
+#define CAN_SET_OPERATION_MODE_NO_WAIT(mode)   \
+{                                              \
+    CANCON &= 0x1F;     /* clear old mode */   \
+    CANCON |= (mode);   /* set new mode */     \
+}
+
+#if HAL_CAN_RX_IRQ
+
+/*---------------------------------------------------------
+ *  Receive Ring (filled by the high priority RX ISR)
+ *---------------------------------------------------------*/
+#define CAN_RX_RING_SIZE    8       /* Power of two, one slot kept free */
+
+/* Frames lost to a full ring or a hardware buffer overflow */
+extern volatile uint16_t g_can_rx_overruns;
+
+/*---------------------------------------------------------
+ *  Zero-Copy Receive View
+ *   data points into the RX ring slot holding the frame
+ *   and is valid for len (<= CAN_MAX_DLC) bytes until the
+ *   view is released.
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint16_t       id;
+    uint8_t        len;
+    uint8_t        slot;            /* Ring index (CAN_RX_RING_SIZE = none) */
+    const uint8_t *data;
+} can_rx_view_t;
+
+#endif /* HAL_CAN_RX_IRQ */
+
+/*---------------------------------------------------------
+ *  Function Prototypes
+ *---------------------------------------------------------*/
+
+/* Initialize the CAN peripheral (1 = ok, 0 = mode change timeout) */
+uint8_t init_can(void);
+
+/* Switch ECAN operation mode (1 = ok, 0 = timeout) */
+uint8_t can_set_mode(uint8_t mode);
+
+/* Wait (up to HAL_CAN_TX_WAIT_LOOPS) for TXB0 (1 = free) */
+uint8_t can_tx_wait(void);
+
+/* Send a CAN message */
+void can_transmit(uint16_t msg_id,
+                  const uint8_t *data,
+                  uint8_t len);
+
+/* Receive CAN message into data[CAN_MAX_DLC] (len = 0 if none) */
+void can_receive(uint16_t *msg_id,
+                 uint8_t *data,
+                 uint8_t *len);
+
+#if HAL_CAN_RX_IRQ
+
+/* High priority RXB0 / RXB1 interrupt body */
+void can_rx_isr(void);
+
+/* 1 if a received frame is waiting in the ring */
+uint8_t can_rx_pending(void);
+
+/* Borrow / return the oldest received frame (1 = frame available) */
+uint8_t can_rx_acquire(can_rx_view_t *view);
+void    can_rx_release(can_rx_view_t *view);
+
+#else
+
+/* 1 if a received frame is waiting in RXB0 or RXB1 */
+static inline uint8_t can_rx_pending(void)
+{
+    return (uint8_t)(ECAN_FIFO0_FULL || ECAN_FIFO1_FULL);
+}
+
+#endif /* HAL_CAN_RX_IRQ */
+
+#endif /* CAN_H */
@@ -0,0 +1,116 @@
+/***********************************************************************
+ *  File name   : can_timing.h
+ *  Description : Compile-time ECAN bit-timing solver.
+ *                From _XTAL_FREQ and CAN_BITRATE it picks the number
+ *                of time quanta per bit (N) and the baud rate
+ *                prescaler (BRP) such that
+ *
+ *                    Fosc = 2 * BRP * N * bitrate     (exactly)
+ *
+ *                with 1 <= BRP <= 64 and 8 <= N <= 25. Candidates are
+ *                tried in order of sample-point error against 87.5 %
+ *                (CiA recommendation), larger N first on ties. The
+ *                segments are then split as
+ *
+ *                    PS2  = 2 (N - 17 for N >= 20: PS1, Prop <= 8)
+ *                    PS1  = ceil(TSEG1 / 2), TSEG1 = N - 1 - PS2
+ *                    Prop = TSEG1 - PS1
+ *                    SJW  = min(PS2, 4)
+ *
+ *                and packed into BRGCON1..3. The build fails if no
+ *                exact solution exists.
+ *
+ *  Provides:
+ *      - CAN_BRGCON1 / CAN_BRGCON2 / CAN_BRGCON3
+ *      - CAN_BIT_TQ, CAN_BRP, CAN_PROPSEG, CAN_PS1, CAN_PS2, CAN_SJW
+ *      - CAN_SAMPLE_POINT_PERMILLE
+ *
+ ***********************************************************************/
+
+#ifndef CAN_TIMING_H
+#define CAN_TIMING_H
+
+#ifndef _XTAL_FREQ
+#error "_XTAL_FREQ must be defined before including can_timing.h"
+#endif
+
+#ifndef CAN_BITRATE
+#error "CAN_BITRATE must be defined before including can_timing.h"
+#endif
+
+#if (_XTAL_FREQ % (2UL * CAN_BITRATE)) != 0
+#error "CAN_BITRATE: Fosc is not an integer multiple of 2 x bit rate"
+#endif
+
+/* Total prescaled quanta per bit: BRP * N */
+#define CAN_TQ_BUDGET       (_XTAL_FREQ / (2UL * CAN_BITRATE))
+
+#define CAN_FITS(n)         (((CAN_TQ_BUDGET % (n)) == 0) && ((CAN_TQ_BUDGET / (n)) <= 64))
+
+/*---------------------------------------------------------
+ * Quanta per bit, best sample point first
+ *---------------------------------------------------------*/
+#if   CAN_FITS(16)
+#define CAN_BIT_TQ          16
+#elif CAN_FITS(17)
+#define CAN_BIT_TQ          17
+#elif CAN_FITS(15)
+#define CAN_BIT_TQ          15
+#elif CAN_FITS(18)
+#define CAN_BIT_TQ          18
+#elif CAN_FITS(14)
+#define CAN_BIT_TQ          14
+#elif CAN_FITS(19)
+#define CAN_BIT_TQ          19
+#elif CAN_FITS(20)
+#define CAN_BIT_TQ          20
+#elif CAN_FITS(13)
+#define CAN_BIT_TQ          13
+#elif CAN_FITS(12)
+#define CAN_BIT_TQ          12
+#elif CAN_FITS(11)
+#define CAN_BIT_TQ          11
+#elif CAN_FITS(21)
+#define CAN_BIT_TQ          21
+#elif CAN_FITS(10)
+#define CAN_BIT_TQ          10
+#elif CAN_FITS(9)
+#define CAN_BIT_TQ          9
+#elif CAN_FITS(22)
+#define CAN_BIT_TQ          22
+#elif CAN_FITS(8)
+#define CAN_BIT_TQ          8
+#elif CAN_FITS(23)
+#define CAN_BIT_TQ          23
+#elif CAN_FITS(24)
+#define CAN_BIT_TQ          24
+#elif CAN_FITS(25)
+#define CAN_BIT_TQ          25
+#else
+#error "CAN_BITRATE: no exact ECAN bit timing for this oscillator"
+#endif
+
+/*---------------------------------------------------------
+ * Segment split
+ *---------------------------------------------------------*/
+#define CAN_BRP             (CAN_TQ_BUDGET / CAN_BIT_TQ)
+#define CAN_PS2             ((CAN_BIT_TQ >= 20) ? (CAN_BIT_TQ - 17) : 2)
+#define CAN_TSEG1           (CAN_BIT_TQ - 1 - CAN_PS2)
+#define CAN_PS1             ((CAN_TSEG1 + 1) / 2)
+#define CAN_PROPSEG         (CAN_TSEG1 - CAN_PS1)
+#define CAN_SJW             ((CAN_PS2 < 4) ? CAN_PS2 : 4)
+
+#define CAN_SAMPLE_POINT_PERMILLE   (((CAN_BIT_TQ - CAN_PS2) * 1000) / CAN_BIT_TQ)
+
+/*---------------------------------------------------------
+ * Register values
+ *  BRGCON1 : SJW<7:6> BRP<5:0>
+ *  BRGCON2 : SEG2PHTS=1 (PS2 programmable), SAM=0,
+ *            SEG1PH<5:3>, PRSEG<2:0>
+ *  BRGCON3 : SEG2PH<2:0>
+ *---------------------------------------------------------*/
+#define CAN_BRGCON1         ((uint8_t)(((CAN_SJW - 1) << 6) | (CAN_BRP - 1)))
+#define CAN_BRGCON2         ((uint8_t)(0x80 | ((CAN_PS1 - 1) << 3) | (CAN_PROPSEG - 1)))
+#define CAN_BRGCON3         ((uint8_t)(CAN_PS2 - 1))
+
+#endif /* CAN_TIMING_H */
@@ -0,0 +1,244 @@
+/***********************************************************************
+ *  File name   : clcd.c
+ *  Description : Driver for Character LCD (CLCD) in 8-bit mode.
+ *                Handles instruction/data writes, initialization,
+ *                character output, string output, and display clear.
+ *                Compiled only on nodes with HAL_CLCD set.
+ *
+ *                Functions:
+ *                - clcd_write()
+ *                - init_clcd()
+ *                - clcd_init_start()
+ *                - clcd_init_poll()
+ *                - clcd_print()
+ *                - clcd_putch()
+ *                - clcd_clear()
+ *                - clcd_load_char()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include <stdint.h>
+#include "clcd.h"
+
+#if HAL_CLCD
+
+#include "tick.h"
+#include "profile.h"
+
+/* Profiler probe, where the node's node_cfg.h has a slot for it */
+#ifdef PROF_CLCD_WRITE
+#define CLCD_PROBE_ENTER()      PROFILE_ENTER(PROF_CLCD_WRITE)
+#define CLCD_PROBE_EXIT()       PROFILE_EXIT(PROF_CLCD_WRITE)
+#else
+#define CLCD_PROBE_ENTER()
+#define CLCD_PROBE_EXIT()
+#endif
+
+/* Use TRISD for data direction */
+#define CLCD_DATA_DIR   TRISD
+#define CLCD_CTRL_DIR   TRISC
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_write
+ *  Description :
+ *      Sends one byte (command or data) to the CLCD controller.
+ *      Automatically waits for the busy flag before returning.
+ *
+ *      value       → Byte to send (command/data)
+ *      control_bit → INSTRUCTION_COMMAND or DATA_COMMAND
+ *----------------------------------------------------------------------*/
+void clcd_write(unsigned char value, unsigned char control_bit)
+{
+    CLCD_PROBE_ENTER();
+
+    /* Select Command/Data register */
+    CLCD_RS = control_bit;
+
+    /* Place value on PortD */
+    CLCD_PORT = value;
+
+    /* Enable strobe (min 200ns) */
+    CLCD_EN = HI;
+    CLCD_EN = LO;
+
+    /* Configure for reading busy flag */
+    CLCD_DATA_DIR = INPUT;         /* PortD = input */
+    CLCD_RW       = HI;            /* Read mode     */
+    CLCD_RS       = INSTRUCTION_COMMAND;
+
+    /* Poll busy flag */
+    do
+    {
+        CLCD_EN = HI;
+        CLCD_EN = LO;
+    }
+    while (CLCD_BUSY);
+
+    /* Restore to write mode */
+    CLCD_RW       = LO;
+    CLCD_DATA_DIR = OUTPUT;
+
+    CLCD_PROBE_EXIT();
+}
+
+/*----------------------------------------------------------------------
+ *  Power-on sequence (HD44780 datasheet), one entry per step:
+ *  instruction to write, then minimum wait in ms before the next.
+ *  The power-on delay before the first step is CLCD_POWER_ON_MS.
+ *----------------------------------------------------------------------*/
+#define CLCD_POWER_ON_MS    30
+
+typedef struct
+{
+    unsigned char cmd;
+    unsigned char wait_ms;
+} clcd_init_step_t;
+
+static const clcd_init_step_t g_clcd_init_steps[] =
+{
+    { LCD_RESET_SEQ,                   5 },    /* >= 4.1 ms */
+    { LCD_RESET_SEQ,                   1 },    /* >= 100 us */
+    { LCD_RESET_SEQ,                   1 },
+    { LCD_CMD_FUNCTION_SET_8BIT_2LINE, 1 },
+    { LCD_CMD_CLEAR_DISPLAY,           2 },
+    { LCD_CMD_DISPLAY_ON_CURSOR_OFF,   1 },
+    { LCD_CMD_RETURN_HOME,             2 },
+};
+
+#define CLCD_INIT_STEPS     (sizeof(g_clcd_init_steps) / sizeof(g_clcd_init_steps[0]))
+
+static uint8_t  g_clcd_step;
+static uint8_t  g_clcd_wait_ms;
+static uint32_t g_clcd_step_tick;
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_init_start
+ *  Description :
+ *      Configures the LCD port pins and starts the non-blocking
+ *      power-on sequence. Requires the system tick to be running.
+ *      Call clcd_init_poll() until it returns 1.
+ *----------------------------------------------------------------------*/
+void clcd_init_start(void)
+{
+    /* Configure ports */
+    CLCD_DATA_DIR = OUTPUT;      /* PortD = data output */
+    CLCD_CTRL_DIR &= 0xF8;       /* RC2 (EN), RC1 (RS), RC0 (RW) as output */
+
+    CLCD_RW = LO;
+
+    g_clcd_step      = 0;
+    g_clcd_wait_ms   = CLCD_POWER_ON_MS;
+    g_clcd_step_tick = tick_now();
+}
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_init_poll
+ *  Description :
+ *      Issues the next power-on instruction once its wait has
+ *      elapsed. Returns 1 when the display is ready for use.
+ *      The wait is strictly longer than wait_ms whole ticks, so
+ *      tick phase can never shorten it.
+ *----------------------------------------------------------------------*/
+unsigned char clcd_init_poll(void)
+{
+    uint32_t now = tick_now();
+
+    if ((now - g_clcd_step_tick) <= TICK_FROM_MS(g_clcd_wait_ms))
+    {
+        return 0;
+    }
+
+    if (g_clcd_step >= CLCD_INIT_STEPS)
+    {
+        return 1;
+    }
+
+    clcd_write(g_clcd_init_steps[g_clcd_step].cmd, INSTRUCTION_COMMAND);
+
+    g_clcd_wait_ms   = g_clcd_init_steps[g_clcd_step].wait_ms;
+    g_clcd_step_tick = now;
+    g_clcd_step++;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------
+ *  Function : init_clcd
+ *  Description :
+ *      Blocking initialization: runs the power-on sequence to
+ *      completion. Requires the system tick to be running.
+ *----------------------------------------------------------------------*/
+void init_clcd(void)
+{
+    clcd_init_start();
+
+    while (!clcd_init_poll())
+    {
+        continue;
+    }
+}
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_print
+ *  Description :
+ *      Prints a null-terminated string to the CLCD.
+ *
+ *      str  → pointer to string
+ *      addr → display address (LINE1(x), LINE2(x))
+ *----------------------------------------------------------------------*/
+void clcd_print(const unsigned char *str, unsigned char addr)
+{
+    clcd_write(addr, INSTRUCTION_COMMAND);
+
+    while (*str != '\0')
+    {
+        clcd_write(*str++, DATA_COMMAND);
+    }
+}
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_putch
+ *  Description :
+ *      Prints a single character at a given LCD address.
+ *
+ *      ch   → character to display
+ *      addr → display address
+ *----------------------------------------------------------------------*/
+void clcd_putch(const unsigned char ch, unsigned char addr)
+{
+    clcd_write(addr, INSTRUCTION_COMMAND);
+    clcd_write(ch,  DATA_COMMAND);
+}
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_clear
+ *  Description :
+ *      Clears screen and returns cursor to home position.
+ *----------------------------------------------------------------------*/
+void clcd_clear(void)
+{
+    LCD_CMD_CLEAR();
+}
+
+/*----------------------------------------------------------------------
+ *  Function : clcd_load_char
+ *  Description :
+ *      Writes one 5x8 custom character into CGRAM.
+ *      The DDRAM address is left in CGRAM mode, so the next print
+ *      must set a display address (clcd_print/clcd_putch do).
+ *
+ *      index   → CGRAM character slot (0 - 7)
+ *      pattern → CGRAM_ROWS row bitmaps (bits 4..0)
+ *----------------------------------------------------------------------*/
+void clcd_load_char(unsigned char index, const unsigned char *pattern)
+{
+    clcd_write(CGRAM_CHAR(index & 0x07), INSTRUCTION_COMMAND);
+
+    for (unsigned char row = 0; row < CGRAM_ROWS; row++)
+    {
+        clcd_write(pattern[row], DATA_COMMAND);
+    }
+}
+
+#endif /* HAL_CLCD */
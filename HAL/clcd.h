@@ -1,6 +1,8 @@
 #ifndef CLCD_H
 #define CLCD_H
 
+#include "hal.h"
+
 /*---------------------------------------------------------
  * LCD Port Definitions
  *---------------------------------------------------------*/
@@ -34,6 +36,13 @@
 #define LINE1(x)                (0x80 + (x))
 #define LINE2(x)                (0xC0 + (x))
 
+/*---------------------------------------------------------
+ * CGRAM (custom character) Addresses
+ *---------------------------------------------------------*/
+#define CGRAM_CHAR(n)           (0x40 + ((n) << 3))
+#define CGRAM_CHAR_COUNT        8
+#define CGRAM_ROWS              8
+
 /*---------------------------------------------------------
  * Low-Level Instruction Codes
  *---------------------------------------------------------*/
@@ -57,15 +66,22 @@
 /*---------------------------------------------------------
  * Clock Frequency for Delays
  *---------------------------------------------------------*/
-#define _XTAL_FREQ                    20000000UL
+#include "clock.h"
 
 /*---------------------------------------------------------
- * Function Prototypes
+ * Function Prototypes (HAL_CLCD)
  *---------------------------------------------------------*/
+#if HAL_CLCD
+
 void init_clcd(void);
+void clcd_init_start(void);
+unsigned char clcd_init_poll(void);
 void clcd_write(unsigned char byte, unsigned char control_bit);
 void clcd_print(const unsigned char *data, unsigned char addr);
 void clcd_putch(const unsigned char data, unsigned char addr);
 void clcd_clear(void);
+void clcd_load_char(unsigned char index, const unsigned char *pattern);
+
+#endif /* HAL_CLCD */
 
 #endif /* CLCD_H */
@@ -0,0 +1,18 @@
+#ifndef CRC8_H
+#define CRC8_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * CRC-8 SAE J1850 parameters
+ *---------------------------------------------------------*/
+#define CRC8_INIT                   0xFF
+#define CRC8_XOR_OUT                0xFF
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+uint8_t crc8_update(uint8_t crc, const uint8_t *data, uint8_t len);
+uint8_t crc8(const uint8_t *data, uint8_t len);
+
+#endif /* CRC8_H */
@@ -0,0 +1,21 @@
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Instruction Cycle Counter (Timer1)
+ *
+ *  Timer1 free-runs from Fosc/4 with a 1:1 prescaler in
+ *  16-bit read/write mode, so TMR1 counts instruction
+ *  cycles and wraps every 65536 cycles (13.1 ms @ 20 MHz).
+ *  Differences of CYCLES_NOW() are wrap-safe as long as
+ *  the measured section is shorter than that.
+ *
+ *  T1CON : RD16=1, T1CKPS=00, T1OSCEN=0, TMR1CS=0, TMR1ON=1
+ *---------------------------------------------------------*/
+#define CYCLES_INIT()               { T1CON = 0x81; }
+#define CYCLES_NOW()                ((uint16_t)TMR1)
+
+#endif /* CYCLES_H */
@@ -0,0 +1,63 @@
+/***********************************************************************
+ *  File name   : digital_keypad.c
+ *  Description : Driver for the four push buttons on RC0..RC3
+ *                (active low). Reads either the current level or
+ *                one event per press (state change).
+ *                Compiled only on nodes with HAL_DIGITAL_KEYPAD set.
+ *
+ *  API:
+ *      - init_digital_keypad()
+ *      - read_digital_keypad()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "digital_keypad.h"
+
+#if HAL_DIGITAL_KEYPAD
+
+/*---------------------------------------------------------
+ *  Function : init_digital_keypad
+ *  Description :
+ *      Sets the keypad pins (INPUT_PINS) as inputs.
+ *---------------------------------------------------------*/
+void init_digital_keypad(void)
+{
+    TRISC = TRISC | INPUT_PINS;
+}
+
+/*---------------------------------------------------------
+ *  Function : read_digital_keypad
+ *  Description :
+ *      LEVEL        : returns the pin state (ALL_RELEASED if
+ *                     no key is down)
+ *      STATE_CHANGE : returns the pin state once per press,
+ *                     0xFF otherwise
+ *---------------------------------------------------------*/
+unsigned char read_digital_keypad(unsigned char detection_type)
+{
+    static unsigned char once = 1;      /* Armed until a press is reported */
+
+    if (detection_type == STATE_CHANGE)
+    {
+        if (((KEY_PORT & INPUT_PINS) != ALL_RELEASED) && once)
+        {
+            /* Block further detections until the key is released */
+            once = 0;
+
+            return (KEY_PORT & INPUT_PINS);
+        }
+        else if ((KEY_PORT & INPUT_PINS) == ALL_RELEASED)
+        {
+            once = 1;
+        }
+    }
+    else if (detection_type == LEVEL)
+    {
+        return (KEY_PORT & INPUT_PINS);
+    }
+
+    return 0xFF;    /* No key detected */
+}
+
+#endif /* HAL_DIGITAL_KEYPAD */
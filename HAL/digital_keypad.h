@@ -0,0 +1,35 @@
+#ifndef DIGITAL_KEYPAD_H
+#define DIGITAL_KEYPAD_H
+
+#include "hal.h"
+
+/*---------------------------------------------------------
+ * Detection Types
+ *---------------------------------------------------------*/
+#define LEVEL                   0
+#define STATE_CHANGE            1
+
+/*---------------------------------------------------------
+ * Keys (pin state with one key down, active low)
+ *---------------------------------------------------------*/
+#define KEY_PORT                PORTC
+
+#define SWITCH1                 0x0E
+#define SWITCH2                 0x0D
+#define SWITCH3                 0x0B
+#define SWITCH4                 0x07
+#define ALL_RELEASED            0x0F
+
+#define INPUT_PINS              0x0F
+
+/*---------------------------------------------------------
+ * Function Prototypes (HAL_DIGITAL_KEYPAD)
+ *---------------------------------------------------------*/
+#if HAL_DIGITAL_KEYPAD
+
+void init_digital_keypad(void);
+unsigned char read_digital_keypad(unsigned char detection_type);
+
+#endif /* HAL_DIGITAL_KEYPAD */
+
+#endif /* DIGITAL_KEYPAD_H */
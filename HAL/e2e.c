@@ -0,0 +1,118 @@
+/***********************************************************************
+ *  File name   : e2e.c
+ *  Description : End-to-end protection for safety signals.
+ *                The sender prepends a CRC-8 (over the 16-bit data ID
+ *                and the frame contents) and a 4-bit alive counter.
+ *                The receiver rejects corrupted and repeated frames
+ *                and counts frames lost in between, so a stuck sender
+ *                re-sending a stale frame is detected.
+ *
+ *  API:
+ *      - e2e_protect()
+ *      - e2e_check()
+ *
+ ***********************************************************************/
+
+#include <stdint.h>
+#include "e2e.h"
+#include "crc8.h"
+
+/*---------------------------------------------------------
+ *  Local Helper : CRC over data ID + frame bytes 1..len-1
+ *---------------------------------------------------------*/
+static uint8_t e2e_crc(uint16_t data_id, const uint8_t *frame, uint8_t len)
+{
+    uint8_t id[2];
+    uint8_t crc;
+
+    id[0] = (uint8_t)data_id;
+    id[1] = (uint8_t)(data_id >> 8);
+
+    crc = crc8_update(CRC8_INIT, id, 2);
+    crc = crc8_update(crc, &frame[1], (uint8_t)(len - 1));
+
+    return (uint8_t)(crc ^ CRC8_XOR_OUT);
+}
+
+/*---------------------------------------------------------
+ * Function : e2e_protect
+ * Description :
+ *    Builds a protected frame from payload and advances the
+ *    alive counter. frame must hold len + E2E_HEADER_LEN bytes.
+ *
+ *    Returns the protected frame length.
+ *---------------------------------------------------------*/
+uint8_t e2e_protect(e2e_tx_t *tx, uint16_t data_id, uint8_t *frame,
+                    const uint8_t *payload, uint8_t len)
+{
+    frame[1] = tx->counter & 0x0F;
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        frame[E2E_HEADER_LEN + i] = payload[i];
+    }
+
+    len += E2E_HEADER_LEN;
+    frame[0] = e2e_crc(data_id, frame, len);
+
+    tx->counter = (tx->counter >= E2E_COUNTER_MAX) ? 0 : (uint8_t)(tx->counter + 1);
+
+    return len;
+}
+
+/*---------------------------------------------------------
+ * Function : e2e_check
+ * Description :
+ *    Verifies CRC and alive counter of a received frame and
+ *    updates the receiver statistics. The payload starts at
+ *    frame[E2E_HEADER_LEN] and is only valid for e_e2e_ok,
+ *    e_e2e_ok_some_lost and e_e2e_initial.
+ *---------------------------------------------------------*/
+E2eStatus e2e_check(e2e_rx_t *rx, uint16_t data_id, const uint8_t *frame, uint8_t len)
+{
+    uint8_t counter;
+    uint8_t delta;
+
+    if (len < E2E_HEADER_LEN || e2e_crc(data_id, frame, len) != frame[0])
+    {
+        rx->crc_failed++;
+        return e_e2e_crc_error;
+    }
+
+    counter = frame[1] & 0x0F;
+
+    if (counter > E2E_COUNTER_MAX)
+    {
+        rx->crc_failed++;
+        return e_e2e_crc_error;
+    }
+
+    if (!rx->synced)
+    {
+        rx->synced       = 1;
+        rx->last_counter = counter;
+        return e_e2e_initial;
+    }
+
+    delta = (counter >= rx->last_counter) ?
+            (uint8_t)(counter - rx->last_counter) :
+            (uint8_t)(counter + E2E_COUNTER_MAX + 1 - rx->last_counter);
+
+    if (delta == 0)
+    {
+        rx->repeated++;
+        return e_e2e_repeated;
+    }
+
+    /* Resynchronise, also after a wrong sequence (payload dropped) */
+    rx->last_counter = counter;
+
+    if (delta == 1)
+    {
+        return e_e2e_ok;
+    }
+
+    rx->skipped += (uint16_t)(delta - 1);
+
+    return (delta <= E2E_MAX_DELTA_COUNTER) ? e_e2e_ok_some_lost : e_e2e_wrong_sequence;
+}
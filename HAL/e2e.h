@@ -0,0 +1,55 @@
+#ifndef E2E_H
+#define E2E_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * E2E Protection (AUTOSAR Profile 1 style)
+ *
+ *  Frame layout:
+ *      byte 0      : CRC-8 over DataID (low, high) + bytes 1..n
+ *      byte 1      : alive counter (bits 3..0, 0..14)
+ *      byte 2..n   : signal payload
+ *---------------------------------------------------------*/
+#define E2E_HEADER_LEN              2
+#define E2E_COUNTER_MAX             14      /* 15 is reserved */
+#define E2E_MAX_DELTA_COUNTER       2       /* Accept up to 1 lost frame */
+
+/*---------------------------------------------------------
+ * Receiver check result
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_e2e_ok = 0,
+    e_e2e_ok_some_lost,
+    e_e2e_initial,
+    e_e2e_repeated,
+    e_e2e_wrong_sequence,
+    e_e2e_crc_error
+} E2eStatus;
+
+/*---------------------------------------------------------
+ * Per-message sender / receiver state
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t counter;
+} e2e_tx_t;
+
+typedef struct
+{
+    uint8_t  last_counter;
+    uint8_t  synced;
+    uint16_t repeated;              /* Stale frames (same counter) */
+    uint16_t skipped;               /* Frames lost between receptions */
+    uint16_t crc_failed;
+} e2e_rx_t;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+uint8_t   e2e_protect(e2e_tx_t *tx, uint16_t data_id, uint8_t *frame,
+                      const uint8_t *payload, uint8_t len);
+E2eStatus e2e_check(e2e_rx_t *rx, uint16_t data_id, const uint8_t *frame, uint8_t len);
+
+#endif /* E2E_H */
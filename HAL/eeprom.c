@@ -0,0 +1,80 @@
+/***********************************************************************
+ *  File name   : eeprom.c
+ *  Description : PIC18 data EEPROM driver.
+ *                Writes are started and left running in hardware
+ *                (~4 ms per byte); callers poll eeprom_busy() instead
+ *                of waiting, so the main loop keeps servicing CAN.
+ *
+ *  API:
+ *      - eeprom_read()
+ *      - eeprom_write_start()
+ *      - eeprom_busy()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "eeprom.h"
+#include "atomic.h"
+
+/*---------------------------------------------------------
+ * Function : eeprom_read
+ * Description :
+ *    Reads one byte from data EEPROM.
+ *    Must not be called while a write is in progress.
+ *---------------------------------------------------------*/
+uint8_t eeprom_read(uint8_t addr)
+{
+    EEADR = addr;
+
+    EECON1bits.EEPGD = 0;       /* Data EEPROM */
+    EECON1bits.CFGS  = 0;
+    EECON1bits.RD    = 1;
+
+    return EEDATA;
+}
+
+/*---------------------------------------------------------
+ * Function : eeprom_write_start
+ * Description :
+ *    Starts a single byte write and returns immediately.
+ *    The caller must check eeprom_busy() before the next
+ *    read or write.
+ *---------------------------------------------------------*/
+void eeprom_write_start(uint8_t addr, uint8_t data)
+{
+    uint8_t gie;
+
+    EEADR  = addr;
+    EEDATA = data;
+
+    EECON1bits.EEPGD = 0;
+    EECON1bits.CFGS  = 0;
+    EECON1bits.WREN  = 1;
+
+    /* Required unlock sequence: the hardware demands that no
+     * interrupt at all runs in between, so this is the one
+     * section that masks GIE */
+    CRITICAL_ENTER(gie, GIE);
+    EECON2  = 0x55;
+    EECON2  = 0xAA;
+    EECON1bits.WR = 1;
+    CRITICAL_EXIT(gie, GIE);
+}
+
+/*---------------------------------------------------------
+ * Function : eeprom_busy
+ * Description :
+ *    Returns 1 while a write is in progress. Disables further
+ *    writes once the hardware has finished.
+ *---------------------------------------------------------*/
+uint8_t eeprom_busy(void)
+{
+    if (EECON1bits.WR)
+    {
+        return 1;
+    }
+
+    EECON1bits.WREN = 0;
+
+    return 0;
+}
@@ -0,0 +1,23 @@
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+#include "node_cfg.h"
+
+/*---------------------------------------------------------
+ * Data EEPROM Layout (256 bytes)
+ *  The node's own records (EE_*_BASE) are mapped in
+ *  node_cfg.h below EE_BOOT_BASE.
+ *---------------------------------------------------------*/
+#define EEPROM_SIZE                 256U
+
+#define EE_BOOT_BASE                0xFE    /* Bootloader flags (BOOT/boot_cfg.h) */
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+uint8_t eeprom_read(uint8_t addr);
+void    eeprom_write_start(uint8_t addr, uint8_t data);
+uint8_t eeprom_busy(void);
+
+#endif /* EEPROM_H */
@@ -0,0 +1,60 @@
+/***********************************************************************
+ *  File name   : hal.h
+ *  Description : Shared drivers and modules (HAL/), compile-time
+ *                configuration.
+ *
+ *                One copy of the CAN, ADC, CLCD and keypad drivers
+ *                and of the common modules (XCP, profiler, E2E,
+ *                time sync, NM, EEPROM, boot request, calibration,
+ *                slot scheduler) serves every application node.
+ *                Each node directory holds a generated hal_cfg.h
+ *                (tools/gen_hal_cfg.py, table tools/hal_nodes.csv)
+ *                with its node ID, time-sync role and the drivers,
+ *                modules and variants it uses. Everything is decided
+ *                by the preprocessor: a disabled driver compiles to
+ *                an empty object and its API is not declared, a
+ *                variant that is not selected is not compiled in,
+ *                and no driver branches on its configuration at run
+ *                time.
+ *
+ *                Settings that are more than a switch live in the
+ *                node's hand-written node_cfg.h: EEPROM map, XCP
+ *                event channels, profiler probes, calibration set.
+ *
+ *                A node project compiles the HAL/ sources and searches its
+ *                own directory before HAL/, so the shared code picks
+ *                up the node's hal_cfg.h, node_cfg.h, clock.h and
+ *                power.h.
+ *
+ *                The bootloader (BOOT/) is a separate resident image
+ *                and keeps its own minimal CAN driver; it shares only
+ *                the bit-timing solver can_timing.h.
+ *
+ ***********************************************************************/
+
+#ifndef HAL_H
+#define HAL_H
+
+#include "hal_cfg.h"
+
+/*---------------------------------------------------------
+ * Configuration Checks
+ *---------------------------------------------------------*/
+#if !defined(HAL_NODE_ID) || !defined(HAL_TSYNC_MASTER) || \
+    !defined(HAL_CAN_RX_IRQ) || !defined(HAL_CAN_FILTER_NODE) || !defined(HAL_CAN_TX_WAIT_LOOPS) || \
+    !defined(HAL_ADC) || !defined(HAL_CLCD) || !defined(HAL_DIGITAL_KEYPAD) || \
+    !defined(HAL_CALIB) || !defined(HAL_TTSCHED)
+#error "hal_cfg.h is incomplete, regenerate it with tools/gen_hal_cfg.py"
+#endif
+
+/* The digital keypad reads RC0..RC3, the CLCD strobes RC0..RC2 */
+#if HAL_DIGITAL_KEYPAD && HAL_CLCD
+#error "HAL_DIGITAL_KEYPAD and HAL_CLCD both use RC0..RC2"
+#endif
+
+/* The slot scheduler spins on the slave clock (Timer3) */
+#if HAL_TTSCHED && HAL_TSYNC_MASTER
+#error "HAL_TTSCHED runs on the time-sync slaves (Timer3 clock)"
+#endif
+
+#endif /* HAL_H */
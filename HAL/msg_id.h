@@ -0,0 +1,66 @@
+#ifndef MSG_ID_H
+#define MSG_ID_H
+
+/*---------------------------------------------------------
+ * CAN Message Identifiers
+ *---------------------------------------------------------*/
+#define SPEED_MSG_ID               0x10
+#define GEAR_MSG_ID                0x20
+#define RPM_MSG_ID                 0x30
+#define ENG_TEMP_MSG_ID            0x40
+#define INDICATOR_MSG_ID           0x50
+
+/*---------------------------------------------------------
+ * Network Time Synchronization (SYNC / FUP from ECU3)
+ *---------------------------------------------------------*/
+#define TIME_SYNC_MSG_ID           0x08
+
+/*---------------------------------------------------------
+ * Network Management Heartbeats (NM_MSG_ID_BASE + node ID)
+ *---------------------------------------------------------*/
+#define NM_MSG_ID_BASE             0x500
+#define NM_ECU1_MSG_ID             0x501
+#define NM_ECU2_MSG_ID             0x502
+#define NM_ECU3_MSG_ID             0x503
+
+/*---------------------------------------------------------
+ * Diagnostic Transport (ISO-TP) Identifiers
+ *---------------------------------------------------------*/
+#define DIAG_REQ_MSG_ID            0x7E0    /* Tester -> ECU3 */
+#define DIAG_RESP_MSG_ID           0x7E8    /* ECU3 -> Tester */
+
+/*---------------------------------------------------------
+ * XCP Measurement / Calibration Identifiers (CRO / DTO)
+ *---------------------------------------------------------*/
+#define XCP_CRO_MSG_ID_BASE        0x640    /* + node ID */
+#define XCP_DTO_MSG_ID_BASE        0x650
+#define XCP_CRO_ECU1_MSG_ID        0x641
+#define XCP_DTO_ECU1_MSG_ID        0x651
+#define XCP_CRO_ECU2_MSG_ID        0x642
+#define XCP_DTO_ECU2_MSG_ID        0x652
+#define XCP_CRO_ECU3_MSG_ID        0x643
+#define XCP_DTO_ECU3_MSG_ID        0x653
+
+/*---------------------------------------------------------
+ * Bootloader (BOOT/): command, data and response per node
+ *---------------------------------------------------------*/
+#define BOOT_CMD_MSG_ID_BASE       0x6C0
+#define BOOT_CMD_ECU1_MSG_ID       0x6C1    /* Host -> node */
+#define BOOT_CMD_ECU2_MSG_ID       0x6C2
+#define BOOT_CMD_ECU3_MSG_ID       0x6C3
+#define BOOT_DATA_MSG_ID_BASE      0x6D0    /* Host -> node, image bytes */
+#define BOOT_RESP_MSG_ID_BASE      0x6E0    /* Node -> host */
+
+/*---------------------------------------------------------
+ * Instrumentation Reports
+ *---------------------------------------------------------*/
+#define BOOT_REPORT_MSG_ID         0x7F3    /* Boot timeline (4 x u16 ms) */
+#define SELFTEST_REPORT_MSG_ID     0x7F4    /* CAN loopback benchmark (page + 3 x u16) */
+#define SELFTEST_MSG_ID            0x7F5    /* Loopback test frames (never on the bus) */
+#define PROFILE_MSG_ID_BASE        0x7F5    /* + node ID */
+#define PROFILE_ECU1_MSG_ID        0x7F6    /* CPU load + probe table (page + 6 bytes) */
+#define PROFILE_ECU2_MSG_ID        0x7F7
+#define PROFILE_ECU3_MSG_ID        0x7F8
+#define IRQ_LATENCY_MSG_ID         0x7F9    /* Max IRQ latency (3 x u16 cycles) + RX overruns */
+
+#endif /* MSG_ID_H */
\ No newline at end of file
@@ -0,0 +1,315 @@
+/***********************************************************************
+ *  File name   : nm.c
+ *  Description : Network management: node heartbeat, presence
+ *                tracking and coordinated bus sleep / wake-up.
+ *
+ *                Every awake node sends a heartbeat each NM_CYCLE_US
+ *                with its NM state, a ready-to-sleep flag and its
+ *                CAN error counters. Each node keeps a presence
+ *                table from the heartbeats it hears; a node that
+ *                stays silent for NM_TIMEOUT_US is marked missing
+ *                and counted again when it rejoins.
+ *
+ *                Sleep: a node that no longer needs the bus (see
+ *                nm_network_release()) flags its heartbeat ready.
+ *                Once every present node has been ready for
+ *                NM_READY_CONFIRM_US, application traffic stops
+ *                (nm_tx_allowed() = 0) and heartbeats stop; after
+ *                NM_WAIT_SLEEP_US of silence the node is in bus
+ *                sleep and transmits nothing at all.
+ *
+ *                Wake-up: a local request, or a heartbeat from a
+ *                node that needs the bus, puts the node in the
+ *                repeat state for NM_REPEAT_US, so nodes that wake
+ *                together see each other before anyone sleeps.
+ *
+ *                The node ID is HAL_NODE_ID (hal_cfg.h). Time is
+ *                the time-sync local clock.
+ *
+ *  API:
+ *      - nm_init()
+ *      - nm_poll()
+ *      - nm_on_frame()
+ *      - nm_is_nm_frame()
+ *      - nm_network_request()
+ *      - nm_network_release()
+ *      - nm_tx_allowed()
+ *      - nm_node_present()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "nm.h"
+#include "can.h"
+#include "timesync.h"
+
+/*---------------------------------------------------------
+ * Presence Table and State
+ *---------------------------------------------------------*/
+nm_node_t g_nm_nodes[NM_NODE_COUNT];
+uint8_t   g_nm_state;
+
+static uint8_t  g_requested;
+static uint8_t  g_all_ready;
+static uint32_t g_all_ready_since_us;
+static uint32_t g_state_since_us;
+static uint32_t g_next_tx_us;
+
+/*---------------------------------------------------------
+ *  Local Helper : Switch state
+ *---------------------------------------------------------*/
+static void nm_enter(uint8_t state, uint32_t now)
+{
+    g_nm_state       = state;
+    g_state_since_us = now;
+    g_all_ready      = 0;
+
+    /* Announce a wake-up at once */
+    if (state == e_nm_repeat)
+    {
+        g_next_tx_us = now;
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Send this node's heartbeat
+ *---------------------------------------------------------*/
+static void nm_send_heartbeat(void)
+{
+    nm_node_t *self = &g_nm_nodes[NM_NODE_ID - 1];
+    uint8_t    frame[NM_FRAME_LEN];
+
+    self->flags = 0;
+
+    if (!g_requested)
+    {
+        self->flags |= NM_FLAG_READY_SLEEP;
+    }
+
+    if (g_nm_state == e_nm_repeat)
+    {
+        self->flags |= NM_FLAG_REPEAT;
+    }
+
+    self->state = g_nm_state;
+    self->tec   = TXERRCNT;
+    self->rec   = RXERRCNT;
+
+    frame[0] = NM_NODE_ID;
+    frame[1] = self->flags;
+    frame[2] = self->state;
+    frame[3] = self->tec;
+    frame[4] = self->rec;
+
+    can_transmit(NM_MSG_ID_BASE + NM_NODE_ID, frame, NM_FRAME_LEN);
+}
+
+/*---------------------------------------------------------
+ * Function : nm_init
+ * Description :
+ *    Power-on counts as a wake-up: the node starts in the
+ *    repeat state without a network request. Needs the
+ *    time-sync clock (tsync_init()) running.
+ *---------------------------------------------------------*/
+void nm_init(void)
+{
+    for (uint8_t i = 0; i < NM_NODE_COUNT; i++)
+    {
+        g_nm_nodes[i].present = 0;
+        g_nm_nodes[i].flags   = 0;
+        g_nm_nodes[i].state   = e_nm_bus_sleep;
+        g_nm_nodes[i].joins   = 0;
+    }
+
+    g_nm_nodes[NM_NODE_ID - 1].present = 1;
+    g_nm_nodes[NM_NODE_ID - 1].joins   = 1;
+
+    g_requested = 0;
+    nm_enter(e_nm_repeat, tsync_local_us());
+}
+
+/*---------------------------------------------------------
+ * Function : nm_is_nm_frame
+ *---------------------------------------------------------*/
+uint8_t nm_is_nm_frame(uint16_t msg_id)
+{
+    return (uint8_t)(msg_id > NM_MSG_ID_BASE && msg_id <= NM_MSG_ID_BASE + NM_NODE_COUNT);
+}
+
+/*---------------------------------------------------------
+ * Function : nm_on_frame
+ * Description :
+ *    Heartbeat from another node: refresh its presence and
+ *    wake up if it needs the bus.
+ *---------------------------------------------------------*/
+void nm_on_frame(uint16_t msg_id, const uint8_t *data, uint8_t len)
+{
+    nm_node_t *node;
+    uint32_t   now;
+
+    if (!nm_is_nm_frame(msg_id) || len < NM_FRAME_LEN ||
+        data[0] != (uint8_t)(msg_id - NM_MSG_ID_BASE) || data[0] == NM_NODE_ID)
+    {
+        return;
+    }
+
+    now  = tsync_local_us();
+    node = &g_nm_nodes[data[0] - 1];
+
+    if (!node->present)
+    {
+        node->present = 1;
+        node->joins++;
+    }
+
+    node->flags   = data[1];
+    node->state   = data[2];
+    node->tec     = data[3];
+    node->rec     = data[4];
+    node->last_us = now;
+
+    /* Passive wake-up */
+    if (!(node->flags & NM_FLAG_READY_SLEEP) && g_nm_state <= e_nm_prepare_sleep)
+    {
+        nm_enter(e_nm_repeat, now);
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : nm_poll
+ * Description :
+ *    Ages the presence table, runs the state machine and
+ *    sends the heartbeat when due and TXB0 is free. Call
+ *    from the main loop.
+ *---------------------------------------------------------*/
+void nm_poll(void)
+{
+    uint32_t   now = tsync_local_us();
+    uint8_t    all_ready = 1;
+    nm_node_t *node;
+
+    for (uint8_t i = 0; i < NM_NODE_COUNT; i++)
+    {
+        node = &g_nm_nodes[i];
+
+        if (i == NM_NODE_ID - 1 || !node->present)
+        {
+            continue;
+        }
+
+        if ((now - node->last_us) > NM_TIMEOUT_US)
+        {
+            node->present = 0;
+        }
+        else if (!(node->flags & NM_FLAG_READY_SLEEP) || (node->flags & NM_FLAG_REPEAT))
+        {
+            all_ready = 0;
+        }
+    }
+
+    switch (g_nm_state)
+    {
+        case e_nm_repeat:
+            if ((now - g_state_since_us) >= NM_REPEAT_US)
+            {
+                nm_enter(g_requested ? e_nm_normal : e_nm_ready_sleep, now);
+            }
+            break;
+
+        case e_nm_normal:
+            if (!g_requested)
+            {
+                nm_enter(e_nm_ready_sleep, now);
+            }
+            break;
+
+        case e_nm_ready_sleep:
+            if (g_requested)
+            {
+                nm_enter(e_nm_normal, now);
+            }
+            else if (!all_ready)
+            {
+                g_all_ready = 0;
+            }
+            else if (!g_all_ready)
+            {
+                g_all_ready          = 1;
+                g_all_ready_since_us = now;
+            }
+            else if ((now - g_all_ready_since_us) >= NM_READY_CONFIRM_US)
+            {
+                nm_enter(e_nm_prepare_sleep, now);
+            }
+            break;
+
+        case e_nm_prepare_sleep:
+            if (g_requested)
+            {
+                nm_enter(e_nm_repeat, now);
+            }
+            else if ((now - g_state_since_us) >= NM_WAIT_SLEEP_US)
+            {
+                nm_enter(e_nm_bus_sleep, now);
+            }
+            break;
+
+        default:
+            if (g_requested)
+            {
+                nm_enter(e_nm_repeat, now);
+            }
+            break;
+    }
+
+    if (g_nm_state >= e_nm_ready_sleep && (int32_t)(now - g_next_tx_us) >= 0 && !ECAN_TX0_BUSY)
+    {
+        nm_send_heartbeat();
+
+        g_next_tx_us += NM_CYCLE_US;
+
+        /* Fell behind (long blocking call): do not burst */
+        if ((int32_t)(now - g_next_tx_us) >= 0)
+        {
+            g_next_tx_us = now + NM_CYCLE_US;
+        }
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : nm_network_request / nm_network_release
+ * Description :
+ *    The application needs the bus (vehicle in use) or no
+ *    longer does (parked). Both may be called every loop.
+ *---------------------------------------------------------*/
+void nm_network_request(void)
+{
+    g_requested = 1;
+}
+
+void nm_network_release(void)
+{
+    g_requested = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : nm_tx_allowed
+ *  Application / periodic frames may be sent.
+ *---------------------------------------------------------*/
+uint8_t nm_tx_allowed(void)
+{
+    return (uint8_t)(g_nm_state >= e_nm_ready_sleep);
+}
+
+/*---------------------------------------------------------
+ * Function : nm_node_present
+ *---------------------------------------------------------*/
+uint8_t nm_node_present(uint8_t node)
+{
+    if (node == 0 || node > NM_NODE_COUNT)
+    {
+        return 0;
+    }
+
+    return g_nm_nodes[node - 1].present;
+}
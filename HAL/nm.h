@@ -0,0 +1,89 @@
+#ifndef NM_H
+#define NM_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "hal.h"
+#include "msg_id.h"
+
+/*---------------------------------------------------------
+ * This Node (HAL_NODE_ID; its role is noted in node_cfg.h)
+ *---------------------------------------------------------*/
+#define NM_NODE_ID                  HAL_NODE_ID
+#define NM_NODE_COUNT               3       /* Node IDs 1 .. NM_NODE_COUNT */
+
+#if NM_NODE_ID < 1 || NM_NODE_ID > NM_NODE_COUNT
+#error "HAL_NODE_ID must be 1 .. NM_NODE_COUNT"
+#endif
+
+/*---------------------------------------------------------
+ * Heartbeat (NM_MSG_ID_BASE + node ID, NM_FRAME_LEN bytes)
+ *
+ *  byte 0 : source node ID
+ *  byte 1 : flags (NM_FLAG_*)
+ *  byte 2 : NM state (NmState)
+ *  byte 3 : CAN transmit error counter (TXERRCNT)
+ *  byte 4 : CAN receive error counter  (RXERRCNT)
+ *---------------------------------------------------------*/
+#define NM_FRAME_LEN                5
+
+#define NM_FLAG_READY_SLEEP         0x01    /* Sender does not need the bus */
+#define NM_FLAG_REPEAT              0x02    /* Sender has just woken up */
+
+/*---------------------------------------------------------
+ * Timing (microseconds of the time-sync local clock)
+ *---------------------------------------------------------*/
+#define NM_CYCLE_US                 200000UL    /* Heartbeat period */
+#define NM_TIMEOUT_US               1000000UL   /* Node missing after this */
+#define NM_REPEAT_US                1500000UL   /* Stay awake after a wake-up */
+#define NM_READY_CONFIRM_US         1000000UL   /* Everyone ready this long -> sleep */
+#define NM_WAIT_SLEEP_US            500000UL    /* Silent bus before bus sleep */
+
+/*---------------------------------------------------------
+ * Network Management States (AUTOSAR CanNm style)
+ *
+ *  repeat  : just woke up, heartbeats, always awake
+ *  normal  : this node needs the bus
+ *  ready   : this node could sleep, others may not
+ *  prepare : everyone agreed, application TX stopped
+ *  sleep   : bus sleep, nothing is sent
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_nm_bus_sleep = 0,
+    e_nm_prepare_sleep,
+    e_nm_ready_sleep,
+    e_nm_normal,
+    e_nm_repeat
+} NmState;
+
+/*---------------------------------------------------------
+ * Per-Node Presence (from heartbeats, readable over XCP)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  present;
+    uint8_t  flags;
+    uint8_t  state;
+    uint8_t  tec;
+    uint8_t  rec;
+    uint8_t  joins;                 /* Absent -> present transitions */
+    uint32_t last_us;
+} nm_node_t;
+
+extern nm_node_t g_nm_nodes[NM_NODE_COUNT];
+extern uint8_t   g_nm_state;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void    nm_init(void);
+void    nm_poll(void);
+void    nm_on_frame(uint16_t msg_id, const uint8_t *data, uint8_t len);
+uint8_t nm_is_nm_frame(uint16_t msg_id);
+void    nm_network_request(void);
+void    nm_network_release(void);
+uint8_t nm_tx_allowed(void);
+uint8_t nm_node_present(uint8_t node);
+
+#endif /* NM_H */
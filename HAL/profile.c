@@ -0,0 +1,274 @@
+/***********************************************************************
+ *  File name   : profile.c
+ *  Description : CPU load meter and per-function cycle profiler.
+ *
+ *                Load: the main loop gives spare time to
+ *                profile_idle(), which puts the core into IDLE mode
+ *                (power.h) until the next interrupt and adds the
+ *                Timer1 cycles spent there to the window. The load
+ *                of each 100 ms window is then
+ *
+ *                    load = 100 - 100 * idle_cycles / window_cycles
+ *
+ *                The interrupt that ends an idle period runs
+ *                before the core resumes, so its own cost counts
+ *                as idle; the number of wake-ups is reported too.
+ *
+ *                Probes: PROFILE_ENTER/EXIT bracket a hot function
+ *                and record min / avg / max Timer1 cycles into a
+ *                static table. The cost of an empty probe pair is
+ *                measured at boot and reported with the table, so
+ *                it can be subtracted from the figures.
+ *
+ *                The table is sent on PROFILE_REPORT_ID (summary
+ *                page + one page per probe) and then cleared.
+ *                Timer1 wraps every 65536 cycles; profile_poll()
+ *                or profile_idle() must run more often than that,
+ *                and an interrupt must wake the core from IDLE at
+ *                least that often (1 ms tick / wake-up timer).
+ *
+ *  API:
+ *      - profile_init()
+ *      - profile_record()
+ *      - profile_idle()
+ *      - profile_delay_ms()
+ *      - profile_poll()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "profile.h"
+#include "power.h"
+#include "can.h"
+
+#if PROFILE_ENABLE
+
+/* Report page 0 : load, peak load, idle wake-ups, probe overhead */
+#define PROFILE_PAGE_SUMMARY        0
+
+/*---------------------------------------------------------
+ * Probe Table and Load
+ *---------------------------------------------------------*/
+profile_probe_t g_profile[PROFILE_PROBES];
+uint8_t         g_profile_load;
+uint8_t         g_profile_windows;
+
+static uint8_t  g_peak_load;
+static uint16_t g_overhead;
+static uint16_t g_idle_entries;         /* Wake-ups in this window */
+static uint16_t g_idle_wakeups;         /* Wake-ups in the last window */
+static uint32_t g_idle_cycles;
+static uint32_t g_window_cycles;
+static uint16_t g_last_cycles;
+static uint8_t  g_report_windows;
+static uint8_t  g_report_page = PROFILE_PROBES;
+
+/*---------------------------------------------------------
+ *  Local Helper : Clear one probe
+ *---------------------------------------------------------*/
+static void profile_clear(uint8_t id)
+{
+    g_profile[id].min   = 0xFFFF;
+    g_profile[id].max   = 0;
+    g_profile[id].count = 0;
+    g_profile[id].sum   = 0;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Close a load window
+ *---------------------------------------------------------*/
+static void profile_end_window(void)
+{
+    uint32_t idle_pct;
+
+    idle_pct = (g_window_cycles != 0) ? (g_idle_cycles * 100UL) / g_window_cycles : 100UL;
+
+    g_idle_wakeups = g_idle_entries;
+
+    g_profile_load = (idle_pct >= 100UL) ? 0 : (uint8_t)(100UL - idle_pct);
+
+    if (g_profile_load > g_peak_load)
+    {
+        g_peak_load = g_profile_load;
+    }
+
+    g_profile_windows++;
+
+    if (++g_report_windows >= PROFILE_REPORT_WINDOWS)
+    {
+        g_report_windows = 0;
+        g_report_page    = PROFILE_PAGE_SUMMARY;
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Account elapsed Timer1 cycles
+ *---------------------------------------------------------*/
+static void profile_advance(void)
+{
+    uint16_t now = CYCLES_NOW();
+
+    g_window_cycles += (uint16_t)(now - g_last_cycles);
+    g_last_cycles    = now;
+
+    if (g_window_cycles >= PROFILE_WINDOW_CYCLES)
+    {
+        profile_end_window();
+        g_idle_cycles   = 0;
+        g_idle_entries  = 0;
+        g_window_cycles = 0;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : profile_init
+ * Description :
+ *    Starts Timer1, measures the probe overhead and opens
+ *    the first load window.
+ *---------------------------------------------------------*/
+void profile_init(void)
+{
+    CYCLES_INIT();
+
+    for (uint8_t id = 0; id < PROFILE_PROBES; id++)
+    {
+        profile_clear(id);
+    }
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        PROFILE_ENTER(PROF_OVERHEAD);
+        PROFILE_EXIT(PROF_OVERHEAD);
+    }
+    g_overhead = g_profile[PROF_OVERHEAD].min;
+
+    g_idle_cycles   = 0;
+    g_idle_entries  = 0;
+    g_idle_wakeups  = 0;
+    g_window_cycles = 0;
+    g_last_cycles   = CYCLES_NOW();
+}
+
+/*---------------------------------------------------------
+ * Function : profile_record
+ * Description :
+ *    Adds one measurement to a probe (PROFILE_EXIT).
+ *---------------------------------------------------------*/
+void profile_record(uint8_t id, uint16_t cycles)
+{
+    profile_probe_t *probe = &g_profile[id];
+
+    if (cycles < probe->min)
+    {
+        probe->min = cycles;
+    }
+    if (cycles > probe->max)
+    {
+        probe->max = cycles;
+    }
+
+    probe->count++;
+    probe->sum += cycles;
+}
+
+/*---------------------------------------------------------
+ * Function : profile_idle
+ * Description :
+ *    Sleeps in IDLE mode until the next interrupt and
+ *    counts the time as idle. Called wherever the
+ *    application has nothing else to do.
+ *---------------------------------------------------------*/
+void profile_idle(void)
+{
+    uint16_t t0 = CYCLES_NOW();
+
+    POWER_IDLE();
+
+    g_idle_cycles += (uint16_t)(CYCLES_NOW() - t0);
+    g_idle_entries++;
+    profile_advance();
+}
+
+/*---------------------------------------------------------
+ * Function : profile_delay_ms
+ * Description :
+ *    Drop-in for a busy __delay_ms() that spends the wait
+ *    in profile_idle(), so it is accounted as idle time
+ *    (and the core sleeps). Resolution is one wake-up.
+ *---------------------------------------------------------*/
+void profile_delay_ms(uint16_t ms)
+{
+    uint32_t target  = (uint32_t)ms * (_XTAL_FREQ / 4000UL);
+    uint32_t elapsed = 0;
+    uint16_t last    = CYCLES_NOW();
+    uint16_t now;
+
+    while (elapsed < target)
+    {
+        profile_idle();
+
+        now      = CYCLES_NOW();
+        elapsed += (uint16_t)(now - last);
+        last     = now;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : profile_poll
+ * Description :
+ *    Advances the load window and sends one report page
+ *    whenever TX buffer 0 is free. Call once per main loop.
+ *---------------------------------------------------------*/
+void profile_poll(void)
+{
+    uint8_t  report[7];
+    profile_probe_t *probe;
+
+    profile_advance();
+
+    if (g_report_page >= PROFILE_PROBES || ECAN_TX0_BUSY)
+    {
+        return;
+    }
+
+    report[0] = g_report_page;
+
+    if (g_report_page == PROFILE_PAGE_SUMMARY)
+    {
+        report[1] = g_profile_load;
+        report[2] = g_peak_load;
+        report[3] = (uint8_t)g_idle_wakeups;
+        report[4] = (uint8_t)(g_idle_wakeups >> 8);
+        report[5] = (uint8_t)g_overhead;
+        report[6] = (uint8_t)(g_overhead >> 8);
+
+        g_peak_load = 0;
+    }
+    else
+    {
+        uint16_t avg;
+
+        probe = &g_profile[g_report_page];
+        avg   = (probe->count != 0) ? (uint16_t)(probe->sum / probe->count) : 0;
+
+        if (probe->count == 0)
+        {
+            probe->min = 0;
+        }
+
+        /* min, avg, max (cycles, probe overhead included) */
+        report[1] = (uint8_t)probe->min;
+        report[2] = (uint8_t)(probe->min >> 8);
+        report[3] = (uint8_t)avg;
+        report[4] = (uint8_t)(avg >> 8);
+        report[5] = (uint8_t)probe->max;
+        report[6] = (uint8_t)(probe->max >> 8);
+
+        profile_clear(g_report_page);
+    }
+
+    can_transmit(PROFILE_REPORT_ID, report, sizeof(report));
+    g_report_page++;
+}
+
+#endif /* PROFILE_ENABLE */
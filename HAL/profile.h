@@ -0,0 +1,86 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "node_cfg.h"
+#include "msg_id.h"
+#include "clock.h"
+#include "cycles.h"
+#include "power.h"
+
+/*---------------------------------------------------------
+ * Build Switch
+ *  0 removes every probe, the load meter and the report
+ *  (macros expand to nothing, profile.c compiles empty);
+ *  profile_idle() still puts the core into IDLE mode.
+ *---------------------------------------------------------*/
+#ifndef PROFILE_ENABLE
+#define PROFILE_ENABLE              1
+#endif
+
+/* Show the CPU load (%) on the LCD */
+#ifndef PROFILE_SHOW_LOAD
+#define PROFILE_SHOW_LOAD           0
+#endif
+
+/*---------------------------------------------------------
+ * Probe Table (PROF_*, PROFILE_PROBES) : node_cfg.h
+ *---------------------------------------------------------*/
+#if !defined(PROF_OVERHEAD) || !defined(PROFILE_PROBES)
+#error "node_cfg.h must define PROF_OVERHEAD and PROFILE_PROBES"
+#endif
+
+#define PROFILE_REPORT_ID           (PROFILE_MSG_ID_BASE + HAL_NODE_ID)
+
+/*---------------------------------------------------------
+ * Load Measurement
+ *  The CPU load is measured over windows of 100 ms from
+ *  the Timer1 cycles spent in IDLE mode (profile_idle()).
+ *  One summary + one page per probe is sent every
+ *  PROFILE_REPORT_WINDOWS windows.
+ *---------------------------------------------------------*/
+#define PROFILE_WINDOW_CYCLES       (_XTAL_FREQ / 4UL / 10UL)
+#define PROFILE_REPORT_WINDOWS      10
+
+/*---------------------------------------------------------
+ * Per-Probe Statistics (instruction cycles, since the
+ * last report)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint16_t min;
+    uint16_t max;
+    uint16_t count;
+    uint32_t sum;
+} profile_probe_t;
+
+#if PROFILE_ENABLE
+
+extern profile_probe_t g_profile[PROFILE_PROBES];
+extern uint8_t         g_profile_load;          /* Last window, % */
+extern uint8_t         g_profile_windows;       /* Completed windows (wraps) */
+
+/* Bracket a section; ENTER declares a local, so use once per scope */
+#define PROFILE_ENTER(id)           uint16_t prof_t0_##id = CYCLES_NOW()
+#define PROFILE_EXIT(id)            profile_record((id), (uint16_t)(CYCLES_NOW() - prof_t0_##id))
+
+void profile_init(void);
+void profile_record(uint8_t id, uint16_t cycles);
+void profile_idle(void);
+void profile_delay_ms(uint16_t ms);
+void profile_poll(void);
+
+#else
+
+#define PROFILE_ENTER(id)
+#define PROFILE_EXIT(id)
+
+#define profile_init()
+#define profile_idle()              POWER_IDLE()
+#define profile_delay_ms(ms)        __delay_ms(ms)
+#define profile_poll()
+
+#endif /* PROFILE_ENABLE */
+
+#endif /* PROFILE_H */
@@ -0,0 +1,444 @@
+/***********************************************************************
+ *  File name   : timesync.c
+ *  Description : Network time synchronization (SYNC / FUP).
+ *
+ *                Every node keeps a 32-bit microsecond local clock:
+ *                a 16-bit hardware timer extended by its overflow
+ *                interrupt, read as a seqlock snapshot.
+ *
+ *                Master (ECU3): every TSYNC_PERIOD_MS it sends SYNC,
+ *                timestamps the moment the frame has left the bus
+ *                (TXB0 interrupt) and sends that time in FUP.
+ *
+ *                Slaves (ECU1, ECU2): SYNC is timestamped in the
+ *                RXB0 interrupt. With the matching FUP the slave
+ *                knows the global time of that instant and updates
+ *
+ *                    offset : global - local at the last SYNC
+ *                    drift  : rate error between two SYNCs, in
+ *                             2^-20 units, low-pass filtered
+ *
+ *                tsync_now_us() then returns the global time
+ *                without any per-call division:
+ *
+ *                    global = sync_global + dt + dt * drift / 2^20
+ *
+ *                All arithmetic is integer fixed point.
+ *
+ *  API:
+ *      - tsync_init()
+ *      - tsync_local_us()
+ *      - tsync_now_us()
+ *      - tsync_synced()
+ *      - tsync_timer_isr()
+ *      - tsync_tx_isr()          (master)
+ *      - tsync_poll()            (master)
+ *      - tsync_rx_isr()          (slave)
+ *      - tsync_rx_stamp()        (slave)
+ *      - tsync_on_frame()        (slave)
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "timesync.h"
+#include "atomic.h"
+#include "can.h"
+
+/* Drift estimate limits (2^-20 units, about +/- 3900 ppm) */
+#define TSYNC_DRIFT_LIMIT           4096
+#define TSYNC_ERR_LIMIT_US          16384L
+
+tsync_state_t g_tsync;
+
+/*---------------------------------------------------------
+ * Local Clock (extended by tsync_timer_isr)
+ *---------------------------------------------------------*/
+static volatile uint32_t g_clock_base_us;
+static volatile uint8_t  g_clock_rem;
+static seqlock_t         g_clock_seq;
+
+/*---------------------------------------------------------
+ * Function : tsync_timer_isr
+ * Description :
+ *    Timer overflow: advances the clock base by one timer
+ *    period, carrying the fractional microseconds.
+ *---------------------------------------------------------*/
+void tsync_timer_isr(void)
+{
+    SEQLOCK_WRITE_BEGIN(g_clock_seq);
+
+    g_clock_base_us += TSYNC_WRAP_US;
+    g_clock_rem     += TSYNC_WRAP_REM;
+
+    if (g_clock_rem >= TSYNC_US_DEN)
+    {
+        g_clock_rem -= TSYNC_US_DEN;
+        g_clock_base_us++;
+    }
+
+    SEQLOCK_WRITE_END(g_clock_seq);
+
+    TSYNC_TIMER_IF = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_local_us
+ * Description :
+ *    Returns the local clock in microseconds.
+ *    Seqlock read of base + timer; an overflow that is
+ *    flagged but not yet serviced is added here, so the
+ *    clock is monotonic also inside other ISRs.
+ *---------------------------------------------------------*/
+uint32_t tsync_local_us(void)
+{
+    uint32_t base;
+    uint8_t  rem;
+    uint16_t raw;
+    uint8_t  pending;
+    uint8_t  seq;
+
+    do
+    {
+        seq     = g_clock_seq;
+        base    = g_clock_base_us;
+        rem     = g_clock_rem;
+        raw     = TSYNC_TIMER();
+        pending = TSYNC_TIMER_IF;
+    }
+    while ((seq & 1U) || seq != g_clock_seq);
+
+    if (pending && raw < 0x8000U)
+    {
+        base += TSYNC_WRAP_US;
+        rem  += TSYNC_WRAP_REM;
+    }
+
+    return base + ((uint32_t)rem + (uint32_t)raw * TSYNC_US_NUM) / TSYNC_US_DEN;
+}
+
+#if TSYNC_MASTER
+
+/*---------------------------------------------------------
+ * Master State
+ *---------------------------------------------------------*/
+typedef enum
+{
+    e_tsync_idle = 0,
+    e_tsync_wait_tx,
+    e_tsync_wait_fup
+} TsyncMasterState;
+
+/* Give up on a SYNC that has not left TXB0 after this long */
+#define TSYNC_TX_TIMEOUT_US         10000UL
+
+static uint8_t           g_master_state;
+static uint32_t          g_next_sync_us;
+static uint32_t          g_state_since_us;
+static volatile uint8_t  g_tx_done;
+static volatile uint32_t g_tx_stamp_us;
+
+/*---------------------------------------------------------
+ *  Local Helper : Send a SYNC or FUP frame
+ *---------------------------------------------------------*/
+static void tsync_send(uint8_t type, uint32_t time_us)
+{
+    uint8_t frame[TSYNC_FRAME_LEN];
+
+    frame[0] = type;
+    frame[1] = g_tsync.sync_seq;
+    frame[2] = (uint8_t)time_us;
+    frame[3] = (uint8_t)(time_us >> 8);
+    frame[4] = (uint8_t)(time_us >> 16);
+    frame[5] = (uint8_t)(time_us >> 24);
+
+    can_transmit(TIME_SYNC_MSG_ID, frame, TSYNC_FRAME_LEN);
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_init
+ *---------------------------------------------------------*/
+void tsync_init(void)
+{
+    TSYNC_TIMER_START();
+    TSYNC_TIMER_IF = 0;
+    TSYNC_TIMER_IE = 1;
+
+    g_tsync.synced   = 1;
+    g_tsync.sync_seq = 0;
+    g_tsync.syncs    = 0;
+
+    g_master_state = e_tsync_idle;
+    g_next_sync_us = tsync_local_us();
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_now_us / tsync_synced
+ *  The master's local clock is the global time.
+ *---------------------------------------------------------*/
+uint32_t tsync_now_us(void)
+{
+    return tsync_local_us();
+}
+
+uint8_t tsync_synced(void)
+{
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_tx_isr
+ * Description :
+ *    TXB0 interrupt (enabled only for SYNC): records the
+ *    time the SYNC frame completed on the bus.
+ *---------------------------------------------------------*/
+void tsync_tx_isr(void)
+{
+    g_tx_stamp_us = tsync_local_us();
+    g_tx_done     = 1;
+
+    TXB0IE = 0;
+    TXB0IF = 0;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_poll
+ * Description :
+ *    Master schedule: SYNC, wait for its completion, then
+ *    FUP after TSYNC_FUP_DELAY_MS. Call from the main loop.
+ *---------------------------------------------------------*/
+void tsync_poll(void)
+{
+    uint32_t now = tsync_local_us();
+
+    switch (g_master_state)
+    {
+        case e_tsync_idle:
+            /* Back from bus sleep: restart the schedule, no burst */
+            if ((int32_t)(now - g_next_sync_us) > (int32_t)(TSYNC_PERIOD_MS * 1000UL))
+            {
+                g_next_sync_us = now;
+            }
+
+            if ((int32_t)(now - g_next_sync_us) >= 0 && !ECAN_TX0_BUSY)
+            {
+                g_tsync.sync_seq = (uint8_t)((g_tsync.sync_seq + 1) & 0x0F);
+
+                g_tx_done = 0;
+                TXB0IF = 0;
+                TXB0IE = 1;
+                tsync_send(TSYNC_TYPE_SYNC, now);
+
+                g_state_since_us = now;
+                g_master_state   = e_tsync_wait_tx;
+            }
+            break;
+
+        case e_tsync_wait_tx:
+            if (g_tx_done)
+            {
+                g_state_since_us = g_tx_stamp_us;
+                g_master_state   = e_tsync_wait_fup;
+            }
+            else if ((now - g_state_since_us) > TSYNC_TX_TIMEOUT_US)
+            {
+                /* No ACK (bus idle / off): try again next period */
+                TXB0IE = 0;
+                TXB0CONbits.TXREQ = 0;
+
+                g_next_sync_us += TSYNC_PERIOD_MS * 1000UL;
+                g_master_state  = e_tsync_idle;
+            }
+            break;
+
+        default:
+            if ((now - g_state_since_us) >= TSYNC_FUP_DELAY_MS * 1000UL && !ECAN_TX0_BUSY)
+            {
+                tsync_send(TSYNC_TYPE_FUP, g_tx_stamp_us);
+
+                g_tsync.sync_global_us = g_tx_stamp_us;
+                g_tsync.syncs++;
+
+                g_next_sync_us += TSYNC_PERIOD_MS * 1000UL;
+                g_master_state  = e_tsync_idle;
+            }
+            break;
+    }
+}
+
+#else /* Slave */
+
+/*---------------------------------------------------------
+ * Slave State
+ *---------------------------------------------------------*/
+static volatile uint32_t g_rx_stamp_us;
+static uint8_t           g_pending_seq;
+static uint8_t           g_pending_valid;
+static uint32_t          g_pending_local_us;
+static uint8_t           g_have_drift;
+
+/*---------------------------------------------------------
+ *  Local Helper : Little-endian u32
+ *---------------------------------------------------------*/
+static uint32_t tsync_get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Global time at a local instant
+ *---------------------------------------------------------*/
+static uint32_t tsync_global_at(uint32_t local_us)
+{
+    uint32_t elapsed = local_us - g_tsync.sync_local_us;
+    int32_t  corr    = ((int32_t)(elapsed >> 4) * g_tsync.drift_q20) >> 16;
+
+    return g_tsync.sync_global_us + elapsed + (uint32_t)corr;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_init
+ *---------------------------------------------------------*/
+void tsync_init(void)
+{
+    TSYNC_TIMER_START();
+    TSYNC_TIMER_IF = 0;
+    TSYNC_TIMER_IE = 1;
+
+    g_tsync.synced    = 0;
+    g_tsync.drift_q20 = 0;
+    g_tsync.syncs     = 0;
+    g_pending_valid   = 0;
+    g_have_drift      = 0;
+
+    /* Timestamp every frame that lands in RXB0 */
+    RXB0IF = 0;
+    RXB0IE = 1;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_rx_isr / tsync_rx_stamp
+ * Description :
+ *    RXB0 interrupt: timestamps the frame now in RXB0. The
+ *    next frame cannot enter RXB0 before this one has been
+ *    read, so the stamp stays with it. Read the stamp with
+ *    RXB0IE masked around can_receive().
+ *---------------------------------------------------------*/
+void tsync_rx_isr(void)
+{
+    g_rx_stamp_us = tsync_local_us();
+    RXB0IF = 0;
+}
+
+uint32_t tsync_rx_stamp(void)
+{
+    return g_rx_stamp_us;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_now_us
+ * Description :
+ *    Synchronized global time (local time until the first
+ *    SYNC/FUP pair has been received).
+ *---------------------------------------------------------*/
+uint32_t tsync_now_us(void)
+{
+    uint32_t local = tsync_local_us();
+
+    if (!tsync_synced())
+    {
+        return local;
+    }
+
+    return tsync_global_at(local);
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_synced
+ *    0 before the first pair or after TSYNC_TIMEOUT_US
+ *    without one (master lost).
+ *---------------------------------------------------------*/
+uint8_t tsync_synced(void)
+{
+    if (g_tsync.synced && (tsync_local_us() - g_tsync.sync_local_us) > TSYNC_TIMEOUT_US)
+    {
+        g_tsync.synced = 0;
+        g_have_drift   = 0;
+    }
+
+    return g_tsync.synced;
+}
+
+/*---------------------------------------------------------
+ * Function : tsync_on_frame
+ * Description :
+ *    Handles a SYNC or FUP frame with its receive stamp.
+ *---------------------------------------------------------*/
+void tsync_on_frame(const uint8_t *data, uint8_t len, uint32_t rx_local_us)
+{
+    uint32_t global;
+    uint32_t d_local;
+    int32_t  err;
+    int32_t  drift;
+
+    if (len < TSYNC_FRAME_LEN)
+    {
+        return;
+    }
+
+    if (data[0] == TSYNC_TYPE_SYNC)
+    {
+        g_pending_seq      = data[1];
+        g_pending_local_us = rx_local_us;
+        g_pending_valid    = 1;
+        return;
+    }
+
+    if (data[0] != TSYNC_TYPE_FUP || !g_pending_valid || data[1] != g_pending_seq)
+    {
+        return;
+    }
+
+    g_pending_valid = 0;
+    global = tsync_get_u32(&data[2]);
+
+    if (tsync_synced())
+    {
+        /* Residual error of the old estimate at this SYNC */
+        g_tsync.offset_us = (int32_t)(global - tsync_global_at(g_pending_local_us));
+
+        /* Rate error over the last interval */
+        d_local = g_pending_local_us - g_tsync.sync_local_us;
+        err     = (int32_t)((global - g_tsync.sync_global_us) - d_local);
+
+        if (d_local >= (TSYNC_PERIOD_MS * 1000UL) / 2 &&
+            err > -TSYNC_ERR_LIMIT_US && err < TSYNC_ERR_LIMIT_US)
+        {
+            drift = (err << 16) / (int32_t)(d_local >> 4);
+
+            if (drift >  TSYNC_DRIFT_LIMIT) drift =  TSYNC_DRIFT_LIMIT;
+            if (drift < -TSYNC_DRIFT_LIMIT) drift = -TSYNC_DRIFT_LIMIT;
+
+            /* First estimate taken as is, then filtered (1/4) */
+            if (g_have_drift)
+            {
+                drift = g_tsync.drift_q20 + (drift - g_tsync.drift_q20) / 4;
+            }
+
+            g_tsync.drift_q20 = (int16_t)drift;
+            g_have_drift = 1;
+        }
+    }
+    else
+    {
+        g_tsync.offset_us = (int32_t)(global - g_pending_local_us);
+    }
+
+    g_tsync.sync_local_us  = g_pending_local_us;
+    g_tsync.sync_global_us = global;
+    g_tsync.sync_seq       = g_pending_seq;
+    g_tsync.synced         = 1;
+    g_tsync.syncs++;
+}
+
+#endif /* TSYNC_MASTER */
@@ -0,0 +1,105 @@
+#ifndef TIMESYNC_H
+#define TIMESYNC_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "clock.h"
+#include "hal.h"
+#include "msg_id.h"
+
+/*---------------------------------------------------------
+ * Role and Local Clock (HAL_TSYNC_MASTER)
+ *
+ *  Master (ECU3): the local clock is Timer1 (Fosc/4, 1:1,
+ *  shared with cycles.h), extended to 32 bits by the TMR1IF
+ *  interrupt.
+ *  Slave: the local clock is Timer3 (Fosc/4, 1:8, 16-bit
+ *  reads), extended to 32 bits by the TMR3IF interrupt.
+ *  Timer1 stays free for the profiler (cycles.h).
+ *---------------------------------------------------------*/
+#define TSYNC_MASTER                HAL_TSYNC_MASTER
+
+#if TSYNC_MASTER
+#define TSYNC_TIMER_START()         { T1CON = 0x81; }
+#define TSYNC_TIMER()               ((uint16_t)TMR1)
+#define TSYNC_TIMER_IF              TMR1IF
+#define TSYNC_TIMER_IE              TMR1IE
+#define TSYNC_TIMER_PRESCALE        1UL
+#else
+#define TSYNC_TIMER_START()         { T3CON = 0xB1; }
+#define TSYNC_TIMER()               ((uint16_t)TMR3)
+#define TSYNC_TIMER_IF              TMR3IF
+#define TSYNC_TIMER_IE              TMR3IE
+#define TSYNC_TIMER_PRESCALE        8UL
+#endif
+
+/*---------------------------------------------------------
+ * Protocol (SYNC / FUP on TIME_SYNC_MSG_ID, AUTOSAR CanTSyn
+ * style, time in microseconds)
+ *
+ *  SYNC : type, seq, master time when the send was queued
+ *  FUP  : type, seq, master time when SYNC left the bus
+ *
+ *  The slave timestamps SYNC on reception; FUP then gives
+ *  the exact global time of that instant.
+ *---------------------------------------------------------*/
+#define TSYNC_TYPE_SYNC             0x10
+#define TSYNC_TYPE_FUP              0x18
+#define TSYNC_FRAME_LEN             6
+
+#define TSYNC_PERIOD_MS             1000U
+#define TSYNC_FUP_DELAY_MS          30U     /* Lets slaves drain RXB0 first */
+
+/* Slave: no SYNC/FUP pair for this long -> not synchronized */
+#define TSYNC_TIMEOUT_US            3000000UL
+
+/*---------------------------------------------------------
+ * Timer counts -> microseconds
+ *  us = counts * TSYNC_US_NUM / TSYNC_US_DEN
+ *---------------------------------------------------------*/
+#define TSYNC_US_NUM                (4UL * TSYNC_TIMER_PRESCALE)
+#define TSYNC_US_DEN                (_XTAL_FREQ / 1000000UL)
+#define TSYNC_WRAP_US               ((65536UL * TSYNC_US_NUM) / TSYNC_US_DEN)
+#define TSYNC_WRAP_REM              ((65536UL * TSYNC_US_NUM) % TSYNC_US_DEN)
+
+#if (_XTAL_FREQ % 1000000UL) != 0
+#error "TSYNC: _XTAL_FREQ must be a whole number of MHz"
+#endif
+
+/*---------------------------------------------------------
+ * Slave State (readable over XCP)
+ *  drift is the slave clock rate error in 2^-20 units
+ *  (~0.95 ppm), positive when the slave runs slow.
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  synced;
+    uint8_t  sync_seq;
+    uint32_t sync_local_us;         /* Local time of last SYNC */
+    uint32_t sync_global_us;        /* Global time of last SYNC */
+    int32_t  offset_us;             /* Last correction applied */
+    int16_t  drift_q20;
+    uint16_t syncs;
+} tsync_state_t;
+
+extern tsync_state_t g_tsync;
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void     tsync_init(void);
+uint32_t tsync_local_us(void);
+uint32_t tsync_now_us(void);
+uint8_t  tsync_synced(void);
+void     tsync_timer_isr(void);
+
+#if TSYNC_MASTER
+void     tsync_tx_isr(void);
+void     tsync_poll(void);
+#else
+void     tsync_rx_isr(void);
+uint32_t tsync_rx_stamp(void);
+void     tsync_on_frame(const uint8_t *data, uint8_t len, uint32_t rx_local_us);
+#endif
+
+#endif /* TIMESYNC_H */
@@ -0,0 +1,85 @@
+#ifndef TT_MATRIX_H
+#define TT_MATRIX_H
+
+#include "can.h"
+
+/*---------------------------------------------------------
+ * Transmit Matrix (network wide, same file on every node
+ * that is slotted)
+ *
+ *  The matrix cycle is laid over the synchronized global
+ *  time (timesync, master ECU3): a cycle starts whenever
+ *  the low bits of the global microsecond clock are zero.
+ *  Its length is a power of two, so the phase survives the
+ *  32-bit wrap and needs no division.
+ *
+ *  Time is counted in granules of TT_GRANULE_US. Each slot
+ *  is an exclusive window owned by one node; the owner
+ *  starts its frame at the window start and may send its
+ *  housekeeping (XCP, NM, profile) in the rest of it.
+ *  Granules not covered by a slot are arbitrating windows
+ *  (ECU3, diagnostics, bootloader).
+ *
+ *      granule  0   4        16  20          31
+ *               |GEAR|RPM|....|SPEED|IND|......|
+ *                ECU1 ECU2     ECU1  ECU2
+ *---------------------------------------------------------*/
+#define TT_GRANULE_US               512UL
+#define TT_CYCLE_GRANULES           32
+#define TT_CYCLE_US                 (TT_GRANULE_US * TT_CYCLE_GRANULES)
+
+/*---------------------------------------------------------
+ * Slots : owner node (NM node ID), start and length in
+ * granules
+ *---------------------------------------------------------*/
+#define TT_GEAR_OWNER               1
+#define TT_GEAR_START               0
+#define TT_GEAR_LEN                 3
+
+#define TT_RPM_OWNER                2
+#define TT_RPM_START                4
+#define TT_RPM_LEN                  3
+
+#define TT_SPEED_OWNER              1
+#define TT_SPEED_START              16
+#define TT_SPEED_LEN                3
+
+#define TT_INDICATOR_OWNER          2
+#define TT_INDICATOR_START          20
+#define TT_INDICATOR_LEN            3
+
+#define TT_MATRIX(X)                X(GEAR) X(RPM) X(SPEED) X(INDICATOR)
+
+/*---------------------------------------------------------
+ * Compile-Time Checks
+ *
+ *  Window : every slot holds a worst-case 8-byte frame
+ *           (135 bits), one frame already on the bus when
+ *           the slot opens, plus the clock error margin.
+ *  Fit    : every slot lies inside the cycle.
+ *  Overlap: as bit masks over the granules, the slots are
+ *           disjoint exactly when their sum equals their OR.
+ *---------------------------------------------------------*/
+#define TT_SYNC_ERROR_US            100UL
+#define TT_MIN_WINDOW_US            (2UL * 135UL * 1000000UL / CAN_BITRATE + TT_SYNC_ERROR_US)
+
+#define TT_SLOT_MASK(s)             (((1UL << TT_##s##_LEN) - 1UL) << TT_##s##_START)
+#define TT_MASK_SUM(s)              TT_SLOT_MASK(s) +
+#define TT_MASK_OR(s)               TT_SLOT_MASK(s) |
+
+#define TT_SLOT_CHECK(s)                                                        \
+    typedef char tt_##s##_fits_t[(TT_##s##_LEN > 0 &&                           \
+                                  TT_##s##_START + TT_##s##_LEN <= TT_CYCLE_GRANULES) ? 1 : -1]; \
+    typedef char tt_##s##_window_t[(TT_##s##_LEN * TT_GRANULE_US >= TT_MIN_WINDOW_US) ? 1 : -1];
+
+TT_MATRIX(TT_SLOT_CHECK)
+
+/* Fails to compile when two slots share a granule */
+typedef char tt_matrix_no_overlap_t[((TT_MATRIX(TT_MASK_SUM) 0UL) ==
+                                     (TT_MATRIX(TT_MASK_OR) 0UL)) ? 1 : -1];
+
+#if (TT_CYCLE_US & (TT_CYCLE_US - 1UL)) != 0
+#error "TT_CYCLE_US must be a power of two"
+#endif
+
+#endif /* TT_MATRIX_H */
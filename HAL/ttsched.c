@@ -0,0 +1,126 @@
+/***********************************************************************
+ *  File name   : ttsched.c
+ *  Description : Time-triggered transmit slots (TTCAN-like).
+ *
+ *                The matrix cycle of tt_matrix.h repeats on the
+ *                synchronized global time, so the reference is the
+ *                SYNC/FUP exchange of the time master (ECU3): every
+ *                node computes the same cycle start from its own
+ *                corrected clock, without a per-cycle frame.
+ *
+ *                ttsched_wait() returns at the next start of a slot
+ *                owned by this node. It sleeps in profile_idle()
+ *                until the slot is close, then spins on the raw
+ *                Timer3 count for the last stretch, so the frame is
+ *                queued within a few microseconds of the window
+ *                start and never meets another slotted frame in
+ *                arbitration.
+ *
+ *                Before the first SYNC/FUP pair (or with the master
+ *                lost) the global time is the local clock: the node
+ *                still keeps its own slot period but is not aligned
+ *                to the other nodes; g_ttsched.aligned shows this.
+ *
+ *                Compiled only on slotted nodes (HAL_TTSCHED);
+ *                HAL_NODE_ID names the node, tt_matrix.h the slots.
+ *
+ *  API:
+ *      - ttsched_wait()
+ *      - TTSCHED_WAIT()          (ttsched.h, checks slot owner)
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "ttsched.h"
+
+#if HAL_TTSCHED
+
+#include "timesync.h"
+#include "profile.h"
+
+ttsched_state_t g_ttsched;
+
+#if TTSCHED_ENABLE
+
+static uint32_t g_last_target_us;           /* Start of the last slot taken */
+
+/*---------------------------------------------------------
+ *  Local Helper : Book a slot taken at 'target'
+ *   Consecutive slots of a node are less than one cycle
+ *   apart; a longer gap means one was skipped.
+ *---------------------------------------------------------*/
+static void ttsched_take(uint32_t target)
+{
+    if (g_ttsched.slots != 0 && (target - g_last_target_us) > TT_CYCLE_US)
+    {
+        g_ttsched.missed++;
+    }
+
+    g_last_target_us  = target;
+    g_ttsched.aligned = tsync_synced();
+    g_ttsched.slots++;
+}
+
+/*---------------------------------------------------------
+ * Function : ttsched_wait
+ * Description :
+ *    Returns at the next start of the slot beginning at
+ *    granule 'start'. A slot already running for less than
+ *    TTSCHED_LATE_TOL_US is used at once, otherwise the
+ *    next cycle's is awaited.
+ *---------------------------------------------------------*/
+void ttsched_wait(uint8_t start)
+{
+    uint32_t now    = tsync_now_us();
+    uint32_t target = (now & ~(TT_CYCLE_US - 1UL)) + (uint32_t)start * TT_GRANULE_US;
+    int32_t  left   = (int32_t)(target - now);
+    uint16_t counts;
+    uint16_t t0;
+
+    if (left <= -TTSCHED_LATE_TOL_US)
+    {
+        target += TT_CYCLE_US;
+    }
+    else if (left <= 0)
+    {
+        if ((uint16_t)-left > g_ttsched.late_max_us)
+        {
+            g_ttsched.late_max_us = (uint16_t)-left;
+        }
+
+        ttsched_take(target);
+        return;
+    }
+
+    /* Coarse: sleep until the 1 ms wake-up can no longer overshoot */
+    do
+    {
+        left = (int32_t)(target - tsync_now_us());
+
+        if (left > TTSCHED_SPIN_US)
+        {
+            profile_idle();
+#ifdef TTSCHED_IDLE_POLL
+            TTSCHED_IDLE_POLL();
+#endif
+        }
+    }
+    while (left > TTSCHED_SPIN_US);
+
+    /* Fine: count the remainder on the raw timer (us -> counts) */
+    if (left > 0)
+    {
+        counts = (uint16_t)(((uint32_t)left * TSYNC_US_DEN) / TSYNC_US_NUM);
+        t0     = TSYNC_TIMER();
+
+        while ((uint16_t)(TSYNC_TIMER() - t0) < counts)
+        {
+        }
+    }
+
+    ttsched_take(target);
+}
+
+#endif /* TTSCHED_ENABLE */
+
+#endif /* HAL_TTSCHED */
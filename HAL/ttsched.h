@@ -0,0 +1,76 @@
+#ifndef TTSCHED_H
+#define TTSCHED_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "tt_matrix.h"
+#include "profile.h"
+
+#if HAL_TTSCHED
+
+/*---------------------------------------------------------
+ * Build Switch
+ *  1 : time-triggered, frames start in this node's slots
+ *  0 : free-running, the loop is paced by plain delays
+ *---------------------------------------------------------*/
+#ifndef TTSCHED_ENABLE
+#define TTSCHED_ENABLE              1
+#endif
+
+/*---------------------------------------------------------
+ * This Node (owner ID in tt_matrix.h)
+ *---------------------------------------------------------*/
+#define TTSCHED_NODE_ID             HAL_NODE_ID
+
+/*---------------------------------------------------------
+ * Timing
+ *  LATE_TOL : a slot reached this late is still used
+ *  SPIN     : final approach on the raw timer, not in IDLE
+ *             (covers one 1 ms wake-up plus the clock read)
+ *  FREE_MS  : delay per slot when TTSCHED_ENABLE is 0
+ *
+ *  TTSCHED_IDLE_POLL() (optional, node_cfg.h) runs after
+ *  every wake-up of the coarse wait, so a polled node
+ *  empties its receive buffers every 1 ms, not once a loop.
+ *---------------------------------------------------------*/
+#define TTSCHED_LATE_TOL_US         200L
+#define TTSCHED_SPIN_US             1500L
+#define TTSCHED_FREE_MS             10
+
+/*---------------------------------------------------------
+ * Statistics (readable over XCP)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  aligned;               /* Last slot taken on global time */
+    uint16_t slots;                 /* Slots taken */
+    uint16_t missed;                /* Slots skipped (loop overran) */
+    uint16_t late_max_us;           /* Worst lateness within tolerance */
+} ttsched_state_t;
+
+extern ttsched_state_t g_ttsched;
+
+#if TTSCHED_ENABLE
+
+void ttsched_wait(uint8_t start);
+
+/*
+ * Waits for the next start of one of this node's slots.
+ * Fails to compile (negative array size) for a slot owned
+ * by another node.
+ */
+#define TTSCHED_WAIT(slot)                                                      \
+{                                                                               \
+    (void)sizeof(char[(TT_##slot##_OWNER == TTSCHED_NODE_ID) ? 1 : -1]);        \
+    ttsched_wait(TT_##slot##_START);                                            \
+}
+
+#else
+
+#define TTSCHED_WAIT(slot)          profile_delay_ms(TTSCHED_FREE_MS)
+
+#endif /* TTSCHED_ENABLE */
+
+#endif /* HAL_TTSCHED */
+
+#endif /* TTSCHED_H */
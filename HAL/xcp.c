@@ -0,0 +1,721 @@
+/***********************************************************************
+ *  File name   : xcp.c
+ *  Description : Lightweight XCP-on-CAN slave (measurement and
+ *                calibration).
+ *                Supports CONNECT/DISCONNECT/GET_STATUS, memory upload
+ *                and download through the MTA, and dynamic DAQ lists
+ *                allocated from a static pool. DAQ lists sample RAM
+ *                addresses when the application raises an event
+ *                channel; samples are queued and sent from xcp_poll()
+ *                whenever TX buffer 0 is free.
+ *
+ *                Addresses are 16-bit data-memory addresses (address
+ *                extension 0), byte order is Intel.
+ *
+ *                Nodes with a calibration set (HAL_CALIB) also take
+ *                SET_REQUEST STORE_CAL_REQ to persist calibration RAM;
+ *                GET_STATUS reports the store until it has finished,
+ *                and a DOWNLOAD that would take the calibration out
+ *                of range is refused.
+ *                Identifiers follow HAL_NODE_ID, the event channels
+ *                are listed in the node's node_cfg.h.
+ *
+ *  API:
+ *      - xcp_init()
+ *      - xcp_on_frame()
+ *      - xcp_event()
+ *      - xcp_poll()
+ *
+ ***********************************************************************/
+
+#include <xc.h>
+#include "xcp.h"
+#include "can.h"
+
+/*---------------------------------------------------------
+ * Session Status Bits
+ *---------------------------------------------------------*/
+#define XCP_SESSION_STORE_CAL_REQ   0x01
+#define XCP_SESSION_DAQ_RUNNING     0x40
+
+/* CONNECT response: CAL/PAG + DAQ resources, Intel, byte granularity */
+#define XCP_RESOURCE                0x05
+#define XCP_COMM_MODE_BASIC         0x00
+
+/* DAQ list mode bits */
+#define XCP_DAQ_MODE_SELECTED       0x01
+#define XCP_DAQ_MODE_RUNNING        0x02
+
+/*---------------------------------------------------------
+ * DAQ Structures
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint16_t addr;
+    uint8_t  size;
+} xcp_odt_entry_t;
+
+typedef struct
+{
+    uint8_t         entry_count;
+    xcp_odt_entry_t entry[XCP_MAX_ODT_ENTRIES];
+} xcp_odt_t;
+
+typedef struct
+{
+    uint8_t   odt_count;
+    uint8_t   mode;
+    uint8_t   event;
+    uint8_t   prescaler;
+    uint8_t   prescale_count;
+    uint8_t   first_pid;
+    xcp_odt_t odt[XCP_MAX_ODT];
+} xcp_daq_t;
+
+/*---------------------------------------------------------
+ * Slave State
+ *---------------------------------------------------------*/
+static uint8_t   g_xcp_connected;
+static uint16_t  g_xcp_mta;
+
+static xcp_daq_t g_xcp_daq[XCP_MAX_DAQ];
+static uint8_t   g_xcp_daq_count;
+static uint8_t   g_xcp_ptr_daq;
+static uint8_t   g_xcp_ptr_odt;
+static uint8_t   g_xcp_ptr_entry;
+
+/* Pending command response */
+static uint8_t   g_xcp_crm[CAN_MAX_DLC];
+static uint8_t   g_xcp_crm_len;
+
+/* Queued DAQ packets */
+static uint8_t   g_xcp_dto[XCP_DTO_QUEUE_LEN][CAN_MAX_DLC];
+static uint8_t   g_xcp_dto_len[XCP_DTO_QUEUE_LEN];
+static uint8_t   g_xcp_dto_head;
+static uint8_t   g_xcp_dto_tail;
+
+xcp_event_stats_t g_xcp_event_stats[XCP_MAX_EVENT];
+
+/*---------------------------------------------------------
+ *  Local Helper : Read a 16-bit Intel value
+ *---------------------------------------------------------*/
+static uint16_t xcp_get_u16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Build positive / negative responses
+ *---------------------------------------------------------*/
+static void xcp_respond(uint8_t len)
+{
+    g_xcp_crm[0]  = XCP_PID_RES;
+    g_xcp_crm_len = len;
+}
+
+static void xcp_error(uint8_t code)
+{
+    g_xcp_crm[0]  = XCP_PID_ERR;
+    g_xcp_crm[1]  = code;
+    g_xcp_crm_len = 2;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Any DAQ list running?
+ *---------------------------------------------------------*/
+static uint8_t xcp_daq_running(void)
+{
+    for (uint8_t i = 0; i < g_xcp_daq_count; i++)
+    {
+        if (g_xcp_daq[i].mode & XCP_DAQ_MODE_RUNNING)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Release all DAQ lists
+ *---------------------------------------------------------*/
+static void xcp_free_daq(void)
+{
+    g_xcp_daq_count = 0;
+    g_xcp_dto_head  = 0;
+    g_xcp_dto_tail  = 0;
+
+    for (uint8_t i = 0; i < XCP_MAX_DAQ; i++)
+    {
+        g_xcp_daq[i].odt_count = 0;
+        g_xcp_daq[i].mode      = 0;
+    }
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Payload bytes sampled by an ODT
+ *---------------------------------------------------------*/
+static uint8_t xcp_odt_size(const xcp_odt_t *odt)
+{
+    uint8_t size = 0;
+
+    for (uint8_t i = 0; i < odt->entry_count; i++)
+    {
+        size = (uint8_t)(size + odt->entry[i].size);
+    }
+
+    return size;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Every ODT of a DAQ list fits one DTO
+ *---------------------------------------------------------*/
+static uint8_t xcp_daq_fits(const xcp_daq_t *daq)
+{
+    for (uint8_t o = 0; o < daq->odt_count; o++)
+    {
+        if (xcp_odt_size(&daq->odt[o]) > CAN_MAX_DLC - 1)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : Decode address (ext + Intel 32-bit)
+ *  Returns 0 if it does not fit in data memory.
+ *---------------------------------------------------------*/
+static uint8_t xcp_decode_addr(uint8_t ext, const uint8_t *p, uint16_t *addr)
+{
+    if (ext != 0 || p[2] != 0 || p[3] != 0)
+    {
+        return 0;
+    }
+
+    *addr = xcp_get_u16(p);
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ *  Local Helper : DAQ configuration commands
+ *---------------------------------------------------------*/
+static void xcp_cmd_daq(const uint8_t *cmd, uint8_t len)
+{
+    uint8_t daq = cmd[2];
+    uint8_t pid;
+
+    /* DAQ list numbers above 255 are never allocated */
+    if (len >= 4 && cmd[3] != 0 &&
+        cmd[0] != XCP_CMD_WRITE_DAQ && cmd[0] != XCP_CMD_START_STOP_SYNCH && cmd[0] != XCP_CMD_FREE_DAQ)
+    {
+        xcp_error(XCP_ERR_OUT_OF_RANGE);
+        return;
+    }
+
+    switch (cmd[0])
+    {
+        case XCP_CMD_FREE_DAQ:
+            xcp_free_daq();
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_ALLOC_DAQ:
+            if (xcp_get_u16(&cmd[2]) > XCP_MAX_DAQ)
+            {
+                xcp_error(XCP_ERR_MEMORY_OVERFLOW);
+                break;
+            }
+            g_xcp_daq_count = cmd[2];
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_ALLOC_ODT:
+            if (len < 5 || daq >= g_xcp_daq_count)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            if (cmd[4] > XCP_MAX_ODT)
+            {
+                xcp_error(XCP_ERR_MEMORY_OVERFLOW);
+                break;
+            }
+            g_xcp_daq[daq].odt_count = cmd[4];
+            for (uint8_t i = 0; i < XCP_MAX_ODT; i++)
+            {
+                g_xcp_daq[daq].odt[i].entry_count = 0;
+            }
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_ALLOC_ODT_ENTRY:
+            if (len < 6 || daq >= g_xcp_daq_count || cmd[4] >= g_xcp_daq[daq].odt_count)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            if (cmd[5] > XCP_MAX_ODT_ENTRIES)
+            {
+                xcp_error(XCP_ERR_MEMORY_OVERFLOW);
+                break;
+            }
+            g_xcp_daq[daq].odt[cmd[4]].entry_count = cmd[5];
+            for (uint8_t i = 0; i < XCP_MAX_ODT_ENTRIES; i++)
+            {
+                g_xcp_daq[daq].odt[cmd[4]].entry[i].size = 0;
+            }
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_SET_DAQ_PTR:
+            if (len < 6 || daq >= g_xcp_daq_count ||
+                cmd[4] >= g_xcp_daq[daq].odt_count ||
+                cmd[5] >= g_xcp_daq[daq].odt[cmd[4]].entry_count)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            g_xcp_ptr_daq   = daq;
+            g_xcp_ptr_odt   = cmd[4];
+            g_xcp_ptr_entry = cmd[5];
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_WRITE_DAQ:
+        {
+            xcp_odt_t *odt;
+            uint16_t   addr;
+            uint8_t    used = 0;
+
+            if (len < 8 || g_xcp_ptr_daq >= g_xcp_daq_count)
+            {
+                xcp_error(XCP_ERR_SEQUENCE);
+                break;
+            }
+
+            odt = &g_xcp_daq[g_xcp_ptr_daq].odt[g_xcp_ptr_odt];
+
+            if (g_xcp_ptr_entry >= odt->entry_count)
+            {
+                xcp_error(XCP_ERR_SEQUENCE);
+                break;
+            }
+
+            if (!xcp_decode_addr(cmd[3], &cmd[4], &addr))
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+
+            /*
+             * All entries of the ODT, including any written before
+             * a SET_DAQ_PTR moved back, must fit in 7 payload bytes
+             */
+            used = (uint8_t)(xcp_odt_size(odt) - odt->entry[g_xcp_ptr_entry].size);
+
+            if (cmd[2] == 0 || used + cmd[2] > CAN_MAX_DLC - 1)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+
+            odt->entry[g_xcp_ptr_entry].addr = addr;
+            odt->entry[g_xcp_ptr_entry].size = cmd[2];
+            g_xcp_ptr_entry++;
+            xcp_respond(1);
+            break;
+        }
+
+        case XCP_CMD_SET_DAQ_LIST_MODE:
+            if (len < 8 || daq >= g_xcp_daq_count || cmd[4] >= XCP_MAX_EVENT || cmd[5] != 0)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            if (g_xcp_daq[daq].mode & XCP_DAQ_MODE_RUNNING)
+            {
+                xcp_error(XCP_ERR_DAQ_ACTIVE);
+                break;
+            }
+            g_xcp_daq[daq].event          = cmd[4];
+            g_xcp_daq[daq].prescaler      = (cmd[6] == 0) ? 1 : cmd[6];
+            g_xcp_daq[daq].prescale_count = 0;
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_START_STOP_DAQ_LIST:
+            if (len < 4 || daq >= g_xcp_daq_count || cmd[1] > 2)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+
+            /* Absolute ODT numbering: PIDs follow list order */
+            pid = 0;
+            for (uint8_t i = 0; i < daq; i++)
+            {
+                pid += g_xcp_daq[i].odt_count;
+            }
+            g_xcp_daq[daq].first_pid = pid;
+
+            if (cmd[1] != 0 && !xcp_daq_fits(&g_xcp_daq[daq]))
+            {
+                xcp_error(XCP_ERR_DAQ_CONFIG);
+                break;
+            }
+
+            if (cmd[1] == 0)
+            {
+                g_xcp_daq[daq].mode &= (uint8_t)~XCP_DAQ_MODE_RUNNING;
+            }
+            else if (cmd[1] == 1)
+            {
+                g_xcp_daq[daq].mode |= XCP_DAQ_MODE_RUNNING;
+            }
+            else
+            {
+                g_xcp_daq[daq].mode |= XCP_DAQ_MODE_SELECTED;
+            }
+
+            g_xcp_crm[1] = pid;
+            xcp_respond(2);
+            break;
+
+        case XCP_CMD_START_STOP_SYNCH:
+            if (len < 2 || cmd[1] > 2)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            /* Start none of the selected lists if one is oversized */
+            for (pid = 0; cmd[1] == 1 && pid < g_xcp_daq_count; pid++)
+            {
+                if ((g_xcp_daq[pid].mode & XCP_DAQ_MODE_SELECTED) && !xcp_daq_fits(&g_xcp_daq[pid]))
+                {
+                    break;
+                }
+            }
+            if (cmd[1] == 1 && pid < g_xcp_daq_count)
+            {
+                xcp_error(XCP_ERR_DAQ_CONFIG);
+                break;
+            }
+            for (uint8_t i = 0; i < g_xcp_daq_count; i++)
+            {
+                if (cmd[1] == 0)
+                {
+                    g_xcp_daq[i].mode = 0;
+                }
+                else if (g_xcp_daq[i].mode & XCP_DAQ_MODE_SELECTED)
+                {
+                    if (cmd[1] == 1)
+                    {
+                        g_xcp_daq[i].mode |= XCP_DAQ_MODE_RUNNING;
+                    }
+                    else
+                    {
+                        g_xcp_daq[i].mode &= (uint8_t)~XCP_DAQ_MODE_RUNNING;
+                    }
+                    g_xcp_daq[i].mode &= (uint8_t)~XCP_DAQ_MODE_SELECTED;
+                }
+            }
+            xcp_respond(1);
+            break;
+
+        default:
+            xcp_error(XCP_ERR_CMD_UNKNOWN);
+            break;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : xcp_init
+ * Description :
+ *    Resets the slave to the disconnected state.
+ *---------------------------------------------------------*/
+void xcp_init(void)
+{
+    g_xcp_connected = 0;
+    g_xcp_crm_len   = 0;
+
+    xcp_free_daq();
+
+    XCP_TIMESTAMP_INIT();
+
+    for (uint8_t i = 0; i < XCP_MAX_EVENT; i++)
+    {
+        g_xcp_event_stats[i].min_interval = 0xFFFFFFFFUL;
+        g_xcp_event_stats[i].max_interval = 0;
+        g_xcp_event_stats[i].count        = 0;
+        g_xcp_event_stats[i].overruns     = 0;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : xcp_on_frame
+ * Description :
+ *    Processes one command frame (XCP_CRO_ID). The response
+ *    is sent from xcp_poll().
+ *---------------------------------------------------------*/
+void xcp_on_frame(const uint8_t *cmd, uint8_t len)
+{
+    uint8_t *mem;
+    uint16_t addr;
+
+    if (len == 0)
+    {
+        return;
+    }
+
+    if (!g_xcp_connected && cmd[0] != XCP_CMD_CONNECT)
+    {
+        return;
+    }
+
+    switch (cmd[0])
+    {
+        case XCP_CMD_CONNECT:
+            g_xcp_connected = 1;
+            g_xcp_crm[1] = XCP_RESOURCE;
+            g_xcp_crm[2] = XCP_COMM_MODE_BASIC;
+            g_xcp_crm[3] = CAN_MAX_DLC;         /* MAX_CTO */
+            g_xcp_crm[4] = CAN_MAX_DLC;         /* MAX_DTO (Intel) */
+            g_xcp_crm[5] = 0;
+            g_xcp_crm[6] = 1;                   /* Protocol layer version */
+            g_xcp_crm[7] = 1;                   /* Transport layer version */
+            xcp_respond(8);
+            break;
+
+        case XCP_CMD_DISCONNECT:
+            xcp_free_daq();
+            g_xcp_connected = 0;
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_GET_STATUS:
+            g_xcp_crm[1] = xcp_daq_running() ? XCP_SESSION_DAQ_RUNNING : 0;
+#ifdef XCP_STORE_CAL
+            if (XCP_STORE_CAL_PENDING())
+            {
+                g_xcp_crm[1] |= XCP_SESSION_STORE_CAL_REQ;
+            }
+#endif
+            g_xcp_crm[2] = 0;                   /* No protection */
+            g_xcp_crm[3] = 0;
+            g_xcp_crm[4] = 0;
+            g_xcp_crm[5] = 0;
+            xcp_respond(6);
+            break;
+
+#ifdef XCP_STORE_CAL
+        case XCP_CMD_SET_REQUEST:
+            if (len < 2 || (cmd[1] & ~XCP_SESSION_STORE_CAL_REQ) != 0)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            if (cmd[1] && !XCP_STORE_CAL())
+            {
+                xcp_error(XCP_ERR_CMD_BUSY);
+                break;
+            }
+            xcp_respond(1);
+            break;
+#endif
+
+        case XCP_CMD_SET_MTA:
+            if (len < 8 || !xcp_decode_addr(cmd[3], &cmd[4], &addr))
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            g_xcp_mta = addr;
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_SHORT_UPLOAD:
+            if (len < 8 || !xcp_decode_addr(cmd[3], &cmd[4], &addr))
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            g_xcp_mta = addr;
+            /* fall through */
+
+        case XCP_CMD_UPLOAD:
+            if (len < 2 || cmd[1] == 0 || cmd[1] > CAN_MAX_DLC - 1)
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            mem = XCP_PTR(g_xcp_mta);
+            for (uint8_t i = 0; i < cmd[1]; i++)
+            {
+                g_xcp_crm[1 + i] = mem[i];
+            }
+            g_xcp_mta += cmd[1];
+            xcp_respond((uint8_t)(1 + cmd[1]));
+            break;
+
+        case XCP_CMD_DOWNLOAD:
+            if (len < 2 || cmd[1] == 0 || cmd[1] > CAN_MAX_DLC - 2 || len < 2 + cmd[1])
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+            mem = XCP_PTR(g_xcp_mta);
+#ifdef XCP_WRITE_OK
+            if (!XCP_WRITE_OK(mem, &cmd[2], cmd[1]))
+            {
+                xcp_error(XCP_ERR_OUT_OF_RANGE);
+                break;
+            }
+#endif
+            for (uint8_t i = 0; i < cmd[1]; i++)
+            {
+                mem[i] = cmd[2 + i];
+            }
+            g_xcp_mta += cmd[1];
+            xcp_respond(1);
+            break;
+
+        case XCP_CMD_FREE_DAQ:
+        case XCP_CMD_ALLOC_DAQ:
+        case XCP_CMD_ALLOC_ODT:
+        case XCP_CMD_ALLOC_ODT_ENTRY:
+        case XCP_CMD_SET_DAQ_PTR:
+        case XCP_CMD_WRITE_DAQ:
+        case XCP_CMD_SET_DAQ_LIST_MODE:
+        case XCP_CMD_START_STOP_DAQ_LIST:
+        case XCP_CMD_START_STOP_SYNCH:
+            if (len < 4 && cmd[0] != XCP_CMD_FREE_DAQ && cmd[0] != XCP_CMD_START_STOP_SYNCH)
+            {
+                xcp_error(XCP_ERR_CMD_SYNTAX);
+                break;
+            }
+            xcp_cmd_daq(cmd, len);
+            break;
+
+        default:
+            xcp_error(XCP_ERR_CMD_UNKNOWN);
+            break;
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : xcp_event
+ * Description :
+ *    Samples every running DAQ list bound to the event
+ *    channel. Call from the code that owns the event (timer
+ *    callback, loop iteration). Sampling copies RAM into the
+ *    DTO queue only; CAN transmission happens in xcp_poll().
+ *---------------------------------------------------------*/
+void xcp_event(uint8_t channel)
+{
+    xcp_event_stats_t *stats;
+    uint32_t           now;
+    uint32_t           interval;
+
+    if (channel >= XCP_MAX_EVENT)
+    {
+        return;
+    }
+
+    /* Sampling jitter statistics */
+    stats = &g_xcp_event_stats[channel];
+    now   = XCP_TIMESTAMP();
+
+    if (stats->count != 0)
+    {
+        interval = now - stats->last;
+
+        if (interval < stats->min_interval)
+        {
+            stats->min_interval = interval;
+        }
+
+        if (interval > stats->max_interval)
+        {
+            stats->max_interval = interval;
+        }
+    }
+
+    stats->last = now;
+    stats->count++;
+
+    for (uint8_t d = 0; d < g_xcp_daq_count; d++)
+    {
+        xcp_daq_t *daq = &g_xcp_daq[d];
+
+        if (!(daq->mode & XCP_DAQ_MODE_RUNNING) || daq->event != channel)
+        {
+            continue;
+        }
+
+        if (++daq->prescale_count < daq->prescaler)
+        {
+            continue;
+        }
+
+        daq->prescale_count = 0;
+
+        for (uint8_t o = 0; o < daq->odt_count; o++)
+        {
+            xcp_odt_t *odt  = &daq->odt[o];
+            uint8_t    next = (uint8_t)((g_xcp_dto_head + 1) % XCP_DTO_QUEUE_LEN);
+            uint8_t   *pkt;
+            uint8_t    pos  = 1;
+
+            if (next == g_xcp_dto_tail)
+            {
+                stats->overruns++;
+                continue;
+            }
+
+            pkt    = g_xcp_dto[g_xcp_dto_head];
+            pkt[0] = (uint8_t)(daq->first_pid + o);
+
+            /* Clamped to the DTO slot whatever the configuration says */
+            for (uint8_t e = 0; e < odt->entry_count; e++)
+            {
+                const uint8_t *src = XCP_PTR(odt->entry[e].addr);
+
+                for (uint8_t b = 0; b < odt->entry[e].size && pos < CAN_MAX_DLC; b++)
+                {
+                    pkt[pos++] = src[b];
+                }
+            }
+
+            g_xcp_dto_len[g_xcp_dto_head] = pos;
+            g_xcp_dto_head = next;
+        }
+    }
+}
+
+/*---------------------------------------------------------
+ * Function : xcp_poll
+ * Description :
+ *    Sends the pending command response, otherwise the oldest
+ *    queued DAQ packet, if TX buffer 0 is free.
+ *---------------------------------------------------------*/
+void xcp_poll(void)
+{
+    if (ECAN_TX0_BUSY)
+    {
+        return;
+    }
+
+    if (g_xcp_crm_len != 0)
+    {
+        can_transmit(XCP_DTO_ID, g_xcp_crm, g_xcp_crm_len);
+        g_xcp_crm_len = 0;
+    }
+    else if (g_xcp_dto_tail != g_xcp_dto_head)
+    {
+        can_transmit(XCP_DTO_ID, g_xcp_dto[g_xcp_dto_tail], g_xcp_dto_len[g_xcp_dto_tail]);
+        g_xcp_dto_tail = (uint8_t)((g_xcp_dto_tail + 1) % XCP_DTO_QUEUE_LEN);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef XCP_H
+#define XCP_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "node_cfg.h"
+#include "msg_id.h"
+#include "timesync.h"
+
+/*---------------------------------------------------------
+ * XCP-on-CAN Identifiers (base + HAL_NODE_ID)
+ *---------------------------------------------------------*/
+#define XCP_CRO_ID                  (XCP_CRO_MSG_ID_BASE + HAL_NODE_ID)   /* Master -> slave */
+#define XCP_DTO_ID                  (XCP_DTO_MSG_ID_BASE + HAL_NODE_ID)   /* Slave -> master */
+
+/*---------------------------------------------------------
+ * Static DAQ Resources
+ *---------------------------------------------------------*/
+#define XCP_MAX_DAQ                 2
+#define XCP_MAX_ODT                 2       /* per DAQ list */
+#define XCP_MAX_ODT_ENTRIES         7       /* per ODT (7 payload bytes) */
+#define XCP_DTO_QUEUE_LEN           4
+
+/* Event channels (XCP_MAX_EVENT, XCP_EVENT_*) are in node_cfg.h */
+#if !defined(XCP_MAX_EVENT) || XCP_MAX_EVENT < 1
+#error "node_cfg.h must define XCP_MAX_EVENT and the node's event channels"
+#endif
+
+/*
+ * Timestamp source for event jitter statistics:
+ * network-synchronized time in us (timesync.c)
+ */
+#define XCP_TIMESTAMP_INIT()
+#define XCP_TIMESTAMP()             tsync_now_us()
+
+/* 16-bit data-memory address (MTA, DAQ entry) to pointer */
+#ifndef XCP_PTR
+#define XCP_PTR(addr)               ((uint8_t *)(addr))
+#endif
+
+/* SET_REQUEST STORE_CAL_REQ: RAM calibration cache -> EEPROM */
+#if HAL_CALIB
+#include "calib.h"
+#define XCP_STORE_CAL()             calib_store_request()
+#define XCP_STORE_CAL_PENDING()     calib_store_pending()
+#define XCP_WRITE_OK(mem, data, n)  calib_write_ok(mem, data, n)
+#endif
+
+/*---------------------------------------------------------
+ * Command Codes
+ *---------------------------------------------------------*/
+#define XCP_CMD_CONNECT             0xFF
+#define XCP_CMD_DISCONNECT          0xFE
+#define XCP_CMD_GET_STATUS          0xFD
+#define XCP_CMD_SET_REQUEST         0xF9
+#define XCP_CMD_SET_MTA             0xF6
+#define XCP_CMD_UPLOAD              0xF5
+#define XCP_CMD_SHORT_UPLOAD        0xF4
+#define XCP_CMD_DOWNLOAD            0xF0
+#define XCP_CMD_SET_DAQ_PTR         0xE2
+#define XCP_CMD_WRITE_DAQ           0xE1
+#define XCP_CMD_SET_DAQ_LIST_MODE   0xE0
+#define XCP_CMD_START_STOP_DAQ_LIST 0xDE
+#define XCP_CMD_START_STOP_SYNCH    0xDD
+#define XCP_CMD_FREE_DAQ            0xD6
+#define XCP_CMD_ALLOC_DAQ           0xD5
+#define XCP_CMD_ALLOC_ODT           0xD4
+#define XCP_CMD_ALLOC_ODT_ENTRY     0xD3
+
+/*---------------------------------------------------------
+ * Response / Error Codes
+ *---------------------------------------------------------*/
+#define XCP_PID_RES                 0xFF
+#define XCP_PID_ERR                 0xFE
+
+#define XCP_ERR_CMD_BUSY            0x10
+#define XCP_ERR_DAQ_ACTIVE          0x11
+#define XCP_ERR_CMD_UNKNOWN         0x20
+#define XCP_ERR_CMD_SYNTAX          0x21
+#define XCP_ERR_OUT_OF_RANGE        0x22
+#define XCP_ERR_SEQUENCE            0x29
+#define XCP_ERR_DAQ_CONFIG          0x2A
+#define XCP_ERR_MEMORY_OVERFLOW     0x30
+
+/*---------------------------------------------------------
+ * Per-Event Sampling Statistics (readable via upload)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint32_t last;                  /* Timestamp of last event (us) */
+    uint32_t min_interval;
+    uint32_t max_interval;
+    uint16_t count;
+    uint8_t  overruns;              /* DTOs dropped (queue full) */
+} xcp_event_stats_t;
+
+extern xcp_event_stats_t g_xcp_event_stats[XCP_MAX_EVENT];
+
+/*---------------------------------------------------------
+ * Function Prototypes
+ *---------------------------------------------------------*/
+void xcp_init(void);
+void xcp_on_frame(const uint8_t *data, uint8_t len);
+void xcp_event(uint8_t channel);
+void xcp_poll(void);
+
+#endif /* XCP_H */
@@ -0,0 +1,37 @@
+/***********************************************************************
+ *  File name   : can_timing_case.h
+ *  Description : One run of the compile-time bit-timing solver per
+ *                inclusion (test_can_timing.c). The includer defines
+ *                _XTAL_FREQ and CAN_BITRATE; the solved registers are
+ *                appended to g_cases[] and both inputs are undefined
+ *                again for the next case.
+ *
+ ***********************************************************************/
+
+#undef CAN_TIMING_H
+#undef CAN_TQ_BUDGET
+#undef CAN_FITS
+#undef CAN_BIT_TQ
+#undef CAN_BRP
+#undef CAN_PS2
+#undef CAN_TSEG1
+#undef CAN_PS1
+#undef CAN_PROPSEG
+#undef CAN_SJW
+#undef CAN_SAMPLE_POINT_PERMILLE
+#undef CAN_BRGCON1
+#undef CAN_BRGCON2
+#undef CAN_BRGCON3
+
+#include "can_timing.h"
+
+g_cases[g_case_count].fosc         = _XTAL_FREQ;
+g_cases[g_case_count].bitrate      = CAN_BITRATE;
+g_cases[g_case_count].brgcon[0]    = CAN_BRGCON1;
+g_cases[g_case_count].brgcon[1]    = CAN_BRGCON2;
+g_cases[g_case_count].brgcon[2]    = CAN_BRGCON3;
+g_cases[g_case_count].sample_point = CAN_SAMPLE_POINT_PERMILLE;
+g_case_count++;
+
+#undef _XTAL_FREQ
+#undef CAN_BITRATE
@@ -0,0 +1,41 @@
+/***********************************************************************
+ *  File name   : node.h
+ *  Description : Entry points of the node under test. Each test
+ *                program links one node directory (ECUn/) with
+ *                the shared HAL/ sources; the node's main() is
+ *                renamed node_main() by the Makefile.
+ *                With BOOT_NODE_ID the node is the bootloader
+ *                (BOOT/), built on its own and run polled.
+ *
+ ***********************************************************************/
+
+#ifndef NODE_H
+#define NODE_H
+
+#ifdef BOOT_NODE_ID
+
+#include "sim.h"
+#include "boot_cfg.h"
+
+void node_main(void);
+
+#else
+
+#include "hal.h"
+#include "sim.h"
+
+void node_main(void);
+
+/* Interrupt vectors (ECUn/isr.c): ECU3 uses both priorities */
+#if HAL_NODE_ID == 3
+void isr_high(void);
+void isr_low(void);
+#define NODE_ISR_INSTALL()          sim_set_isr(isr_high, isr_low)
+#else
+void isr(void);
+#define NODE_ISR_INSTALL()          sim_set_isr(isr, NULL)
+#endif
+
+#endif /* BOOT_NODE_ID */
+
+#endif /* NODE_H */
@@ -0,0 +1,1346 @@
+/***********************************************************************
+ *  File name   : sim.c
+ *  Description : PIC18F4580 peripheral model for the host tests.
+ *                Only the behaviour the nodes rely on is modelled:
+ *
+ *                - Timer1 / Timer3 (16 bit, prescaler, overflow IF)
+ *                - Timer2 (prescaler, PR2 period, postscaler IF)
+ *                - Interrupt priorities (IPEN, GIEH/GIEL, xxIP) with
+ *                  the high vector preempting the low one
+ *                - ECAN legacy mode: TXB0 with the worst-case frame
+ *                  time, RXB0/RXB1 with masks, filters, double
+ *                  buffering and overflow, loopback, disable mode
+ *                  wake-up, CCP1 capture of Timer1 on receive
+ *                - Data EEPROM read and timed byte write, wear count
+ *                - Program flash: table reads, holding registers,
+ *                  timed row erase / group write, boot block write
+ *                  protection
+ *                - ADC conversion time and result registers
+ *                - HD44780 CLCD command time (busy flag on RD7)
+ *                - IDLE (peripherals run) and SLEEP (clocks stop)
+ *
+ *                The node's main() runs on its own stack (ucontext)
+ *                so a test can let it execute for a stretch of
+ *                simulated time, inject bus traffic and look at the
+ *                result.
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "sim.h"
+
+/*---------------------------------------------------------
+ * Register Storage
+ *---------------------------------------------------------*/
+#define SIM_REG(name)               volatile uint8_t name;
+#define SIM_REG16(name)             volatile uint16_t name;
+#define SIM_BITS(name)              volatile sim_bits_t name;
+#include "regs.def"
+#undef SIM_REG
+#undef SIM_REG16
+#undef SIM_BITS
+
+volatile uint8_t sim_rxb[2][SIM_CANBUF_SIZE];
+volatile uint8_t sim_txb0[SIM_CANBUF_SIZE];
+
+static volatile uint8_t      g_canstat;
+static volatile sim_txbcon_t g_txb0con;
+static volatile sim_eecon1_t g_eecon1;
+static volatile uint8_t      g_eedata;
+static volatile uint8_t      g_adc_go;
+static volatile uint8_t      g_tmr2_view;
+static uint8_t               g_tmr2_shown;
+
+sim_stats_t g_sim;
+uint8_t     g_sim_eeprom[256];
+uint32_t    g_sim_eeprom_writes[256];
+uint8_t     g_sim_flash[SIM_FLASH_SIZE];
+
+/*---------------------------------------------------------
+ * Model State
+ *---------------------------------------------------------*/
+#define SIM_NEVER                   UINT64_MAX
+
+/* CANCON / CANSTAT operation mode bits */
+#define CAN_MODE_NORMAL_BITS        0x00
+#define CAN_MODE_DISABLE_BITS       0x20
+#define CAN_MODE_LOOP_BITS          0x40
+#define CAN_MODE_CONFIG_BITS        0x80
+
+typedef struct
+{
+    uint64_t frac;                  /* Cycles not yet a prescaled count */
+    uint32_t count;
+    uint32_t post;                  /* Timer2: matches since the last IF */
+} sim_timer_t;
+
+static uint64_t    g_now;
+static sim_timer_t g_t1, g_t2, g_t3;
+
+static void (*g_isr_high)(void);
+static void (*g_isr_low)(void);
+static uint8_t g_level;             /* 0 main, 1 low ISR, 2 high ISR */
+
+static uint8_t  g_tx_busy;
+static uint64_t g_tx_end;
+static void   (*g_tx_hook)(const sim_frame_t *frame);
+static sim_frame_t g_tx_log[SIM_CAN_LOG_SIZE];
+static uint32_t    g_tx_count;
+
+static sim_frame_t g_rx_queue[SIM_CAN_RX_QUEUE];
+static uint32_t    g_rx_queued;
+
+static uint8_t  g_ee_busy;
+static uint8_t  g_ee_addr;
+static uint8_t  g_ee_data;
+static uint64_t g_ee_done;
+static uint64_t g_ee_write_cycles = SIM_MS(4);
+
+/* Program flash: WR with EEPGD erases a row (FREE) or programs
+ * the holding registers into one group; cells only clear bits */
+typedef enum
+{
+    e_sim_nvm_eeprom,
+    e_sim_nvm_flash_write,
+    e_sim_nvm_flash_erase
+} sim_nvm_op_t;
+
+static sim_nvm_op_t g_nvm_op;
+static uint32_t     g_flash_addr;
+static uint32_t     g_flash_protect;                /* [0, end) write protected */
+static uint8_t      g_flash_hold[SIM_FLASH_GROUP];
+static uint32_t     g_goto = SIM_NO_GOTO;
+
+static uint8_t  g_adc_busy;
+static uint64_t g_adc_done;
+static uint16_t g_adc_value[16];
+
+/* EUSART transmitter: TXREG (written only) feeds the shift
+ * register, which sends one 8N1 byte per 10 bit times */
+static volatile uint8_t g_txreg;
+static uint8_t  g_txreg_full;
+static uint8_t  g_tsr_busy;
+static uint8_t  g_tsr_byte;
+static uint64_t g_tsr_end;
+static void   (*g_uart_hook)(uint8_t byte);
+
+/* HD44780: E (RC2) strobed with RW (RC0) low starts a command;
+ * clear / home take SIM_LCD_HOME_US, the rest SIM_LCD_CMD_US */
+#define SIM_LCD_CMD_US              37U
+#define SIM_LCD_HOME_US             1520U
+
+static volatile uint8_t g_lcd_en;
+static volatile uint8_t g_lcd_busy;
+static uint64_t         g_lcd_done;
+
+/* DDRAM (line 1 at 0x00, line 2 at 0x40); data after a CGRAM
+ * address command goes to the glyphs and is not kept */
+static uint8_t g_lcd_ddram[0x80];
+static uint8_t g_lcd_addr;
+static uint8_t g_lcd_cgram;
+
+/* Data memory: 4 KB image plus host variables mapped into it */
+typedef struct
+{
+    uint16_t addr;
+    uint16_t size;
+    uint8_t *host;
+} sim_data_map_t;
+
+static uint8_t        g_data_ram[0x1000];
+static sim_data_map_t g_data_map[SIM_DATA_MAPS];
+static uint8_t        g_data_maps;
+
+/* Node coroutine */
+static ucontext_t g_test_ctx;
+static ucontext_t g_node_ctx;
+static uint8_t    g_node_stack[1u << 20];
+static void     (*g_node_entry)(void);
+static uint8_t    g_in_node;
+static uint8_t    g_node_done;
+static uint8_t    g_stalled;
+static uint8_t    g_reset_restarts;
+static uint8_t    g_reset_pending;
+static uint64_t   g_stop_at = SIM_NEVER;
+
+/*---------------------------------------------------------
+ * Interrupt Sources (flag, enable, priority)
+ *---------------------------------------------------------*/
+typedef struct
+{
+    volatile uint8_t *ie;
+    volatile uint8_t *flag;
+    volatile uint8_t *ip;
+} sim_irq_src_t;
+
+static const sim_irq_src_t g_irq_src[] =
+{
+    { &TMR1IE, &TMR1IF, &TMR1IP },
+    { &TMR2IE, &TMR2IF, &TMR2IP },
+    { &TMR3IE, &TMR3IF, &TMR3IP },
+    { &RXB0IE, &RXB0IF, &RXB0IP },
+    { &RXB1IE, &RXB1IF, &RXB1IP },
+    { &TXB0IE, &TXB0IF, &TXB0IP },
+    { &WAKIE,  &WAKIF,  &WAKIP  },
+    { &TXIE,   &TXIF,   &TXIP   },
+};
+
+#define SIM_IRQ_SOURCES             (sizeof(g_irq_src) / sizeof(g_irq_src[0]))
+
+/* 1 if a source of the given priority (0 low, 1 high, 2 any) is raised */
+static uint8_t sim_irq_raised(uint8_t priority)
+{
+    for (uint32_t i = 0; i < SIM_IRQ_SOURCES; i++)
+    {
+        const sim_irq_src_t *src = &g_irq_src[i];
+
+        if (*src->ie && *src->flag && (priority == 2 || (*src->ip != 0) == priority))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------
+ * Interrupt Dispatch
+ *  Runs every interrupt the current level lets through;
+ *  without IPEN all sources go to the high vector and
+ *  need GIE and PEIE.
+ *---------------------------------------------------------*/
+static void sim_irq_enter(uint8_t level)
+{
+    uint8_t prev = g_level;
+    void  (*handler)(void) = (level == 2) ? g_isr_high : g_isr_low;
+
+    g_level = level;
+    g_sim.irq_entries[level - 1]++;
+
+    if (level == 2 && prev == 1)
+    {
+        g_sim.irq_preempted++;
+    }
+
+    sim_advance(SIM_ISR_ENTRY_CYCLES);
+    handler();
+
+    g_level = prev;
+}
+
+static void sim_dispatch(void)
+{
+    for (;;)
+    {
+        if (RCONbits.IPEN)
+        {
+            if (g_level < 2 && g_isr_high && GIE && sim_irq_raised(1))
+            {
+                sim_irq_enter(2);
+                continue;
+            }
+
+            if (g_level < 1 && g_isr_low && GIE && PEIE && sim_irq_raised(0))
+            {
+                sim_irq_enter(1);
+                continue;
+            }
+        }
+        else if (g_level < 2 && g_isr_high && GIE && PEIE && sim_irq_raised(2))
+        {
+            sim_irq_enter(2);
+            continue;
+        }
+
+        break;
+    }
+}
+
+/*---------------------------------------------------------
+ * Timers
+ *---------------------------------------------------------*/
+static uint32_t sim_t13_prescale(uint8_t con)
+{
+    return 1u << ((con >> 4) & 0x03);
+}
+
+static uint32_t sim_t2_prescale(void)
+{
+    static const uint32_t prescale[4] = { 1, 4, 16, 16 };
+
+    return prescale[T2CON & 0x03];
+}
+
+static uint8_t sim_t2_on(void)
+{
+    return (uint8_t)(TMR2ON || (T2CON & 0x04));
+}
+
+static void sim_t16_step(sim_timer_t *t, uint8_t con, volatile uint8_t *flag, uint64_t cycles)
+{
+    uint32_t prescale = sim_t13_prescale(con);
+    uint64_t total;
+
+    if (!(con & 0x01))
+    {
+        return;
+    }
+
+    t->frac += cycles;
+    total    = t->count + t->frac / prescale;
+    t->frac %= prescale;
+
+    if (total >= 0x10000)
+    {
+        *flag = 1;
+    }
+
+    t->count = (uint32_t)(total & 0xFFFF);
+}
+
+static uint64_t sim_t16_next(const sim_timer_t *t, uint8_t con)
+{
+    if (!(con & 0x01))
+    {
+        return SIM_NEVER;
+    }
+
+    return (0x10000 - t->count) * (uint64_t)sim_t13_prescale(con) - t->frac;
+}
+
+static void sim_t2_step(uint64_t cycles)
+{
+    uint32_t period   = (uint32_t)PR2 + 1;
+    uint32_t post_n   = ((T2CON >> 3) & 0x0F) + 1u;
+    uint32_t prescale = sim_t2_prescale();
+    uint64_t count;
+
+    /* A write to TMR2 since the last look restarts the count */
+    if (g_tmr2_view != g_tmr2_shown)
+    {
+        g_t2.count  = g_tmr2_view;
+        g_t2.frac   = 0;
+        g_tmr2_shown = g_tmr2_view;
+    }
+
+    if (!sim_t2_on())
+    {
+        return;
+    }
+
+    g_t2.frac += cycles;
+    count      = g_t2.count + g_t2.frac / prescale;
+    g_t2.frac %= prescale;
+
+    g_t2.post += (uint32_t)(count / period);
+    g_t2.count = (uint32_t)(count % period);
+
+    if (g_t2.post >= post_n)
+    {
+        TMR2IF = 1;
+        g_t2.post %= post_n;
+    }
+
+    g_tmr2_view = g_tmr2_shown = (uint8_t)g_t2.count;
+}
+
+static uint64_t sim_t2_next(void)
+{
+    uint64_t period = (uint64_t)PR2 + 1;
+    uint64_t post_n = ((T2CON >> 3) & 0x0F) + 1u;
+    uint64_t counts;
+
+    if (!sim_t2_on())
+    {
+        return SIM_NEVER;
+    }
+
+    if (g_t2.post >= post_n)
+    {
+        g_t2.post %= post_n;
+    }
+
+    counts = (post_n - g_t2.post) * period - ((g_t2.count < period) ? g_t2.count : 0);
+
+    return counts * sim_t2_prescale() - g_t2.frac;
+}
+
+/*---------------------------------------------------------
+ * ECAN
+ *---------------------------------------------------------*/
+static uint8_t sim_can_mode(void)
+{
+    return (uint8_t)(CANCON & 0xE0);
+}
+
+uint64_t sim_can_frame_cycles(uint8_t dlc)
+{
+    uint64_t len  = (dlc > 8) ? 8 : dlc;
+    uint64_t bits = 47 + 8 * len + (34 + 8 * len - 1) / 4;
+
+    return bits * SIM_CAN_CYCLES_PER_BIT;
+}
+
+static uint16_t sim_can_filter_id(uint8_t sidh, uint8_t sidl)
+{
+    return (uint16_t)(((uint16_t)sidh << 3) | (sidl >> 5));
+}
+
+static uint8_t sim_can_match(uint16_t id, uint8_t msidh, uint8_t msidl, uint8_t fsidh, uint8_t fsidl)
+{
+    uint16_t mask = sim_can_filter_id(msidh, msidl);
+
+    return (uint8_t)(((id ^ sim_can_filter_id(fsidh, fsidl)) & mask) == 0);
+}
+
+static uint8_t sim_can_accepts(uint8_t buf, uint16_t id)
+{
+    if (((sim_rxb[buf][0] >> 5) & 0x03) == 0x03)
+    {
+        return 1;
+    }
+
+    if (buf == 0)
+    {
+        return (uint8_t)(sim_can_match(id, RXM0SIDH, RXM0SIDL, RXF0SIDH, RXF0SIDL) ||
+                         sim_can_match(id, RXM0SIDH, RXM0SIDL, RXF1SIDH, RXF1SIDL));
+    }
+
+    return (uint8_t)(sim_can_match(id, RXM1SIDH, RXM1SIDL, RXF2SIDH, RXF2SIDL) ||
+                     sim_can_match(id, RXM1SIDH, RXM1SIDL, RXF3SIDH, RXF3SIDL) ||
+                     sim_can_match(id, RXM1SIDH, RXM1SIDL, RXF4SIDH, RXF4SIDL) ||
+                     sim_can_match(id, RXM1SIDH, RXM1SIDL, RXF5SIDH, RXF5SIDL));
+}
+
+/* Receive buffer flags without the cost of a node access */
+#define SIM_RXBCON(buf)             ((volatile sim_rxbcon_t *)&sim_rxb[buf][0])
+
+static void sim_can_load(uint8_t buf, const sim_frame_t *frame)
+{
+    volatile uint8_t *rxb = sim_rxb[buf];
+    uint8_t           len = (frame->dlc > 8) ? 8 : frame->dlc;
+
+    rxb[1] = (uint8_t)(frame->id >> 3);
+    rxb[2] = (uint8_t)((frame->id & 0x07) << 5);
+    rxb[5] = (uint8_t)(frame->dlc & 0x0F);
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        rxb[6 + i] = frame->data[i];
+    }
+
+    rxb[0] |= 0x80;                             /* RXFUL */
+
+    if (buf == 0)
+    {
+        RXB0IF = 1;
+    }
+    else
+    {
+        RXB1IF = 1;
+    }
+
+    CCPR1 = (uint16_t)g_t1.count;               /* CANCAP */
+    g_sim.can_rx_delivered++;
+}
+
+/* Frame seen by the receiver (bus or loopback) */
+static void sim_can_receive(const sim_frame_t *frame)
+{
+    if (sim_can_accepts(0, frame->id))
+    {
+        if (!SIM_RXBCON(0)->RXFUL)
+        {
+            sim_can_load(0, frame);
+        }
+        else if (SIM_RXBCON(0)->RXB0DBEN && !SIM_RXBCON(1)->RXFUL)
+        {
+            sim_can_load(1, frame);
+        }
+        else
+        {
+            COMSTATbits.RXB0OVFL = 1;
+            g_sim.can_rx_overflow++;
+        }
+    }
+    else if (sim_can_accepts(1, frame->id))
+    {
+        if (!SIM_RXBCON(1)->RXFUL)
+        {
+            sim_can_load(1, frame);
+        }
+        else
+        {
+            COMSTATbits.RXB1OVFL = 1;
+            g_sim.can_rx_overflow++;
+        }
+    }
+}
+
+/* Frame from another node has ended on the bus */
+static void sim_can_bus_frame(const sim_frame_t *frame)
+{
+    uint8_t mode = sim_can_mode();
+
+    if (mode == CAN_MODE_NORMAL_BITS)
+    {
+        sim_can_receive(frame);
+        return;
+    }
+
+    if (mode == CAN_MODE_DISABLE_BITS)
+    {
+        WAKIF = 1;
+    }
+
+    g_sim.can_rx_lost++;
+}
+
+static void sim_can_tx_done(void)
+{
+    sim_frame_t frame;
+    uint8_t     len;
+
+    g_tx_busy = 0;
+
+    if (!g_txb0con.TXREQ)
+    {
+        g_sim.can_tx_aborted++;
+        return;
+    }
+
+    frame.at  = g_now;
+    frame.id  = sim_can_filter_id(TXB0SIDH, TXB0SIDL);
+    frame.dlc = (uint8_t)(TXB0DLC & 0x0F);
+    len       = (frame.dlc > 8) ? 8 : frame.dlc;
+    memset(frame.data, 0, sizeof(frame.data));
+    memcpy(frame.data, (const uint8_t *)&sim_txb0[6], len);
+
+    g_txb0con.TXREQ = 0;
+    TXB0IF = 1;
+
+    if (sim_can_mode() == CAN_MODE_LOOP_BITS)
+    {
+        g_sim.can_loopback++;
+        sim_can_receive(&frame);
+        return;
+    }
+
+    g_tx_log[g_tx_count % SIM_CAN_LOG_SIZE] = frame;
+    g_tx_count++;
+
+    if (g_tx_hook)
+    {
+        g_tx_hook(&frame);
+    }
+}
+
+/*---------------------------------------------------------
+ * Data EEPROM and Program Flash
+ *---------------------------------------------------------*/
+static uint32_t sim_tblptr(void)
+{
+    return ((uint32_t)(TBLPTRU & 0x3F) << 16) | ((uint32_t)TBLPTRH << 8) | TBLPTRL;
+}
+
+static void sim_nvm_done(void)
+{
+    uint32_t base;
+
+    switch (g_nvm_op)
+    {
+        case e_sim_nvm_eeprom:
+            g_sim_eeprom[g_ee_addr] = g_ee_data;
+            g_sim_eeprom_writes[g_ee_addr]++;
+            break;
+
+        case e_sim_nvm_flash_erase:
+            base = g_flash_addr & ~(uint32_t)(SIM_FLASH_ROW - 1);
+
+            if (base >= g_flash_protect && base < SIM_FLASH_SIZE)
+            {
+                memset(&g_sim_flash[base], 0xFF, SIM_FLASH_ROW);
+                g_sim.flash_erases++;
+            }
+            break;
+
+        case e_sim_nvm_flash_write:
+            base = g_flash_addr & ~(uint32_t)(SIM_FLASH_GROUP - 1);
+
+            if (base >= g_flash_protect && base < SIM_FLASH_SIZE)
+            {
+                for (uint32_t i = 0; i < SIM_FLASH_GROUP; i++)
+                {
+                    g_sim_flash[base + i] &= g_flash_hold[i];
+                }
+                g_sim.flash_writes++;
+            }
+
+            /* Holding registers read 0xFF again after a write */
+            memset(g_flash_hold, 0xFF, sizeof(g_flash_hold));
+            break;
+    }
+}
+
+/*---------------------------------------------------------
+ * EUSART
+ *  Fosc per bit: 4, 16 or 64 x (SPBRG + 1) after BRG16 /
+ *  BRGH, i.e. a quarter of that in instruction cycles.
+ *---------------------------------------------------------*/
+static uint64_t sim_uart_byte_cycles(void)
+{
+    uint32_t brg = BAUDCONbits.BRG16 ? ((uint32_t)SPBRGH << 8 | SPBRG) : SPBRG;
+    uint32_t div = BAUDCONbits.BRG16 ? (TXSTAbits.BRGH ? 4U : 16U)
+                                     : (TXSTAbits.BRGH ? 16U : 64U);
+
+    return 10ULL * div * (brg + 1U) / 4U;
+}
+
+static void sim_uart_tx_done(void)
+{
+    g_tsr_busy     = 0;
+    TXSTAbits.TRMT = 1;
+    g_sim.uart_tx_bytes++;
+
+    if (g_uart_hook)
+    {
+        g_uart_hook(g_tsr_byte);
+    }
+}
+
+/*---------------------------------------------------------
+ * Starts of Timed Operations (TXREQ, EEPROM WR, ADC GO,
+ * TXREG)
+ *---------------------------------------------------------*/
+static void sim_start_pending(void)
+{
+    uint8_t mode = sim_can_mode();
+
+    if (g_txb0con.TXREQ && !g_tx_busy && (mode == CAN_MODE_NORMAL_BITS || mode == CAN_MODE_LOOP_BITS))
+    {
+        g_tx_busy = 1;
+        g_tx_end  = g_now + sim_can_frame_cycles(TXB0DLC & 0x0F);
+    }
+
+    if (g_eecon1.WR && !g_ee_busy)
+    {
+        if (!g_eecon1.WREN)
+        {
+            g_eecon1.WR = 0;
+        }
+        else if (g_eecon1.EEPGD)
+        {
+            g_ee_busy    = 1;
+            g_nvm_op     = g_eecon1.FREE ? e_sim_nvm_flash_erase : e_sim_nvm_flash_write;
+            g_flash_addr = sim_tblptr();
+            g_ee_done    = g_now + SIM_FLASH_CYCLES;
+        }
+        else
+        {
+            g_ee_busy = 1;
+            g_nvm_op  = e_sim_nvm_eeprom;
+            g_ee_addr = EEADR;
+            g_ee_data = g_eedata;
+            g_ee_done = g_now + g_ee_write_cycles;
+        }
+    }
+
+    if (g_adc_go && !g_adc_busy)
+    {
+        g_adc_busy = 1;
+        g_adc_done = g_now + SIM_ADC_CYCLES;
+    }
+
+    if (g_txreg_full && !g_tsr_busy && TXSTAbits.TXEN && RCSTAbits.SPEN)
+    {
+        g_tsr_busy     = 1;
+        g_tsr_byte     = g_txreg;
+        g_tsr_end      = g_now + sim_uart_byte_cycles();
+        g_txreg_full   = 0;
+        TXIF           = 1;
+        TXSTAbits.TRMT = 0;
+    }
+}
+
+/*---------------------------------------------------------
+ * Time Step
+ *  frozen = 1: SLEEP, the oscillator is stopped, so the
+ *  timers hold; bus, EEPROM and ADC still complete.
+ *---------------------------------------------------------*/
+static uint64_t sim_next_event(uint8_t frozen)
+{
+    uint64_t next = SIM_NEVER;
+    uint64_t t;
+
+#define SIM_NEXT(at)    { t = (at); if (t < next) { next = t; } }
+
+    if (!frozen)
+    {
+        SIM_NEXT(sim_t16_next(&g_t1, T1CON));
+        SIM_NEXT(sim_t16_next(&g_t3, T3CON));
+        SIM_NEXT(sim_t2_next());
+    }
+
+    if (g_tx_busy)
+    {
+        SIM_NEXT((g_tx_end > g_now) ? g_tx_end - g_now : 1);
+    }
+
+    if (g_ee_busy)
+    {
+        SIM_NEXT((g_ee_done > g_now) ? g_ee_done - g_now : 1);
+    }
+
+    if (g_adc_busy)
+    {
+        SIM_NEXT((g_adc_done > g_now) ? g_adc_done - g_now : 1);
+    }
+
+    if (g_tsr_busy)
+    {
+        SIM_NEXT((g_tsr_end > g_now) ? g_tsr_end - g_now : 1);
+    }
+    else if (g_txreg_full)
+    {
+        SIM_NEXT(1);
+    }
+
+    if (g_rx_queued != 0)
+    {
+        SIM_NEXT((g_rx_queue[0].at > g_now) ? g_rx_queue[0].at - g_now : 1);
+    }
+
+#undef SIM_NEXT
+
+    return next;
+}
+
+static void sim_step(uint64_t cycles, uint8_t frozen)
+{
+    sim_start_pending();
+
+    if (!frozen)
+    {
+        sim_t16_step(&g_t1, T1CON, &TMR1IF, cycles);
+        sim_t16_step(&g_t3, T3CON, &TMR3IF, cycles);
+        sim_t2_step(cycles);
+    }
+
+    g_now += cycles;
+
+    if (g_tx_busy && g_tx_end <= g_now)
+    {
+        sim_can_tx_done();
+    }
+
+    if (g_ee_busy && g_ee_done <= g_now)
+    {
+        sim_nvm_done();
+        g_ee_busy   = 0;
+        g_eecon1.WR = 0;
+    }
+
+    if (g_adc_busy && g_adc_done <= g_now)
+    {
+        uint16_t value = g_adc_value[(ADCON0 >> 2) & 0x0F];
+
+        if (ADFM)
+        {
+            ADRESH = (uint8_t)(value >> 8);
+            ADRESL = (uint8_t)value;
+        }
+        else
+        {
+            ADRESH = (uint8_t)(value >> 2);
+            ADRESL = (uint8_t)(value << 6);
+        }
+
+        g_adc_busy = 0;
+        g_adc_go   = 0;
+    }
+
+    if (g_tsr_busy && g_tsr_end <= g_now)
+    {
+        sim_uart_tx_done();
+    }
+
+    while (g_rx_queued != 0 && g_rx_queue[0].at <= g_now)
+    {
+        sim_frame_t frame = g_rx_queue[0];
+
+        g_rx_queued--;
+        memmove(&g_rx_queue[0], &g_rx_queue[1], g_rx_queued * sizeof(g_rx_queue[0]));
+        sim_can_bus_frame(&frame);
+    }
+
+    sim_start_pending();
+}
+
+/* Hand control back to the test once the run time is used up */
+static void sim_check_stop(void)
+{
+    if (g_in_node && g_now >= g_stop_at)
+    {
+        swapcontext(&g_node_ctx, &g_test_ctx);
+    }
+}
+
+static uint64_t sim_limit(uint64_t step)
+{
+    if (g_in_node && g_stop_at > g_now && g_stop_at - g_now < step)
+    {
+        return g_stop_at - g_now;
+    }
+
+    return step;
+}
+
+/*---------------------------------------------------------
+ * Function : sim_advance
+ *  Lets the given number of instruction cycles pass,
+ *  taking interrupts on the way.
+ *---------------------------------------------------------*/
+void sim_advance(uint64_t cycles)
+{
+    uint64_t target = g_now + cycles;
+
+    sim_dispatch();
+
+    while (g_now < target)
+    {
+        uint64_t step = target - g_now;
+        uint64_t next = sim_next_event(0);
+
+        if (next < step)
+        {
+            step = next;
+        }
+
+        sim_step(sim_limit(step), 0);
+        sim_dispatch();
+        sim_check_stop();
+    }
+}
+
+static void sim_access(void)
+{
+    sim_start_pending();
+    sim_advance(SIM_ACCESS_CYCLES);
+}
+
+/*---------------------------------------------------------
+ * Low Power Modes
+ *---------------------------------------------------------*/
+static uint8_t sim_wake_pending(void)
+{
+    return sim_irq_raised(2);
+}
+
+void sim_sleep(void)
+{
+    uint8_t  idle  = (uint8_t)OSCCONbits.IDLEN;
+    uint64_t start = g_now;
+
+    g_sim.sleeps++;
+    sim_start_pending();
+
+    while (!sim_wake_pending())
+    {
+        uint64_t next = sim_next_event(!idle);
+
+        if (next == SIM_NEVER)
+        {
+            if (!g_in_node)
+            {
+                fprintf(stderr, "sim: SLEEP with no wake-up source\n");
+                abort();
+            }
+
+            /* Nothing can wake the node before the run ends */
+            g_stalled = 1;
+            next = (g_stop_at > g_now) ? g_stop_at - g_now : 1;
+        }
+
+        sim_step(sim_limit(next), !idle);
+        sim_check_stop();
+    }
+
+    g_stalled = 0;
+
+    if (idle)
+    {
+        g_sim.idle_cycles += g_now - start;
+    }
+    else
+    {
+        g_sim.sleep_cycles += g_now - start;
+    }
+
+    sim_dispatch();
+}
+
+void sim_delay_us(uint32_t us)
+{
+    sim_advance(SIM_US(us));
+}
+
+void sim_reset(void)
+{
+    g_sim.resets++;
+
+    /* Leave the node's code; sim_node_run() starts it again */
+    if (g_in_node && g_reset_restarts)
+    {
+        g_reset_pending = 1;
+        swapcontext(&g_node_ctx, &g_test_ctx);
+    }
+}
+
+/*---------------------------------------------------------
+ * Register Accessors
+ *---------------------------------------------------------*/
+volatile sim_txbcon_t *sim_txb0con(void)
+{
+    sim_access();
+
+    return &g_txb0con;
+}
+
+volatile uint8_t *sim_canstat(void)
+{
+    sim_access();
+
+    g_canstat = (uint8_t)(CANCON & 0xE0);
+
+    return &g_canstat;
+}
+
+uint16_t sim_tmr1(void)
+{
+    uint16_t count = (uint16_t)g_t1.count;
+
+    sim_access();
+
+    return count;
+}
+
+uint16_t sim_tmr3(void)
+{
+    uint16_t count = (uint16_t)g_t3.count;
+
+    sim_access();
+
+    return count;
+}
+
+volatile uint8_t *sim_tmr2(void)
+{
+    sim_access();
+
+    return &g_tmr2_view;
+}
+
+volatile sim_eecon1_t *sim_eecon1(void)
+{
+    sim_access();
+
+    return &g_eecon1;
+}
+
+volatile uint8_t *sim_eedata(void)
+{
+    sim_access();
+
+    if (g_eecon1.RD)
+    {
+        g_eedata    = g_sim_eeprom[EEADR];
+        g_eecon1.RD = 0;
+    }
+
+    return &g_eedata;
+}
+
+volatile uint8_t *sim_adc_go(void)
+{
+    sim_access();
+
+    return &g_adc_go;
+}
+
+volatile sim_rxbcon_t *sim_rxbcon(uint8_t buf)
+{
+    sim_access();
+
+    return (volatile sim_rxbcon_t *)&sim_rxb[buf][0];
+}
+
+/* Table reads and writes, and GOTO out of the node's code (the
+ * bootloader starting the application) */
+void sim_asm(const char *text)
+{
+    uint32_t addr = sim_tblptr();
+    uint8_t  post_inc = (strchr(text, '+') != NULL);
+
+    sim_access();
+
+    if (strncmp(text, "TBLRD*", 6) == 0)
+    {
+        TABLAT = (addr < SIM_FLASH_SIZE) ? g_sim_flash[addr] : 0;
+    }
+    else if (strncmp(text, "TBLWT*", 6) == 0)
+    {
+        g_flash_hold[addr & (SIM_FLASH_GROUP - 1)] = TABLAT;
+    }
+    else if (strncmp(text, "GOTO ", 5) == 0)
+    {
+        g_goto = (uint32_t)strtoul(text + 5, NULL, 0);
+
+        /* The node's own code ends here */
+        if (g_in_node)
+        {
+            g_node_done = 1;
+            swapcontext(&g_node_ctx, &g_test_ctx);
+        }
+        return;
+    }
+    else
+    {
+        fprintf(stderr, "sim: asm(\"%s\") not modelled\n", text);
+        abort();
+    }
+
+    if (post_inc)
+    {
+        addr++;
+        TBLPTRU = (uint8_t)(addr >> 16);
+        TBLPTRH = (uint8_t)(addr >> 8);
+        TBLPTRL = (uint8_t)addr;
+    }
+}
+
+/* TXREG is only written: the access loads it and clears TXIF
+ * until the shift register takes the byte (the next cycle if
+ * it is empty, so TRMT drops at once) */
+volatile uint8_t *sim_txreg(void)
+{
+    sim_access();
+
+    g_txreg_full = 1;
+    TXIF         = 0;
+
+    if (!g_tsr_busy)
+    {
+        TXSTAbits.TRMT = 0;
+    }
+
+    return &g_txreg;
+}
+
+/* Called for every RC2 access: E high in write mode means the
+ * previous access raised the strobe, this one ends it */
+volatile uint8_t *sim_lcd_en(void)
+{
+    sim_access();
+
+    if (g_lcd_en && !RC0)
+    {
+        uint8_t home = (!RC1 && PORTD != 0 && PORTD <= 0x03);
+
+        g_lcd_done = g_now + SIM_US(home ? SIM_LCD_HOME_US : SIM_LCD_CMD_US);
+
+        if (RC1)
+        {
+            if (!g_lcd_cgram)
+            {
+                g_lcd_ddram[g_lcd_addr] = PORTD;
+                g_lcd_addr = (uint8_t)((g_lcd_addr + 1) & 0x7F);
+            }
+        }
+        else if (PORTD & 0x80)
+        {
+            g_lcd_addr  = (uint8_t)(PORTD & 0x7F);
+            g_lcd_cgram = 0;
+        }
+        else if (PORTD & 0x40)
+        {
+            g_lcd_cgram = 1;
+        }
+        else if (PORTD == 0x01)
+        {
+            memset(g_lcd_ddram, ' ', sizeof(g_lcd_ddram));
+            g_lcd_addr = 0;
+        }
+    }
+
+    return &g_lcd_en;
+}
+
+volatile uint8_t *sim_lcd_busy(void)
+{
+    sim_access();
+
+    g_lcd_busy = (uint8_t)(g_now < g_lcd_done);
+
+    return &g_lcd_busy;
+}
+
+unsigned char sim_lcd_char(uint8_t row, uint8_t col)
+{
+    return g_lcd_ddram[(row ? 0x40 : 0x00) + col];
+}
+
+/*---------------------------------------------------------
+ * Model Control
+ *---------------------------------------------------------*/
+void sim_init(void)
+{
+#define SIM_REG(name)               name = 0;
+#define SIM_REG16(name)             name = 0;
+#define SIM_BITS(name)              memset((void *)&name, 0, sizeof(name));
+#include "regs.def"
+#undef SIM_REG
+#undef SIM_REG16
+#undef SIM_BITS
+
+    memset((void *)sim_rxb, 0, sizeof(sim_rxb));
+    memset((void *)sim_txb0, 0, sizeof(sim_txb0));
+    memset((void *)&g_txb0con, 0, sizeof(g_txb0con));
+    memset((void *)&g_eecon1, 0, sizeof(g_eecon1));
+    memset(&g_sim, 0, sizeof(g_sim));
+    memset(&g_t1, 0, sizeof(g_t1));
+    memset(&g_t2, 0, sizeof(g_t2));
+    memset(&g_t3, 0, sizeof(g_t3));
+    memset(g_sim_eeprom, 0xFF, sizeof(g_sim_eeprom));
+    memset(g_sim_eeprom_writes, 0, sizeof(g_sim_eeprom_writes));
+    memset(g_sim_flash, 0xFF, sizeof(g_sim_flash));
+    memset(g_flash_hold, 0xFF, sizeof(g_flash_hold));
+    memset(g_adc_value, 0, sizeof(g_adc_value));
+    memset(g_data_ram, 0, sizeof(g_data_ram));
+    g_data_maps = 0;
+
+    /* Power-on values that differ from 0 */
+    TRISA = TRISB = TRISC = TRISD = 0xFF;
+    CANCON = CAN_MODE_CONFIG_BITS;
+    TXIF   = 1;
+    TXSTAbits.TRMT = 1;
+    TMR1IP = TMR2IP = TMR3IP = RXB0IP = RXB1IP = TXB0IP = WAKIP = TXIP = 1;
+
+    g_now      = 0;
+    g_level    = 0;
+    g_isr_high = NULL;
+    g_isr_low  = NULL;
+    g_tx_busy  = 0;
+    g_tx_hook  = NULL;
+    g_tx_count = 0;
+    g_rx_queued = 0;
+    g_ee_busy  = 0;
+    g_flash_protect = 0;
+    g_goto     = SIM_NO_GOTO;
+    g_reset_restarts = 0;
+    g_eedata   = 0;
+    g_ee_write_cycles = SIM_MS(4);
+    g_adc_busy = 0;
+    g_adc_go   = 0;
+    g_txreg    = 0;
+    g_txreg_full = 0;
+    g_tsr_busy = 0;
+    g_uart_hook = NULL;
+    g_lcd_en   = 0;
+    g_lcd_busy = 0;
+    g_lcd_done = 0;
+    g_lcd_addr = 0;
+    g_lcd_cgram = 0;
+    memset(g_lcd_ddram, ' ', sizeof(g_lcd_ddram));
+    g_tmr2_view = g_tmr2_shown = 0;
+    g_node_entry = NULL;
+    g_in_node  = 0;
+    g_node_done = 0;
+    g_stalled  = 0;
+    g_stop_at  = SIM_NEVER;
+}
+
+void sim_set_isr(void (*high)(void), void (*low)(void))
+{
+    g_isr_high = high;
+    g_isr_low  = low;
+}
+
+uint64_t sim_now(void)
+{
+    return g_now;
+}
+
+void sim_eeprom_set_write_cycles(uint64_t cycles)
+{
+    g_ee_write_cycles = cycles;
+}
+
+void sim_flash_protect(uint32_t end)
+{
+    g_flash_protect = end;
+}
+
+void sim_adc_set(uint8_t channel, uint16_t value)
+{
+    g_adc_value[channel & 0x0F] = value;
+}
+
+void sim_data_map(uint16_t addr, void *host, uint16_t size)
+{
+    if (g_data_maps >= SIM_DATA_MAPS)
+    {
+        fprintf(stderr, "sim: more than %u data maps\n", SIM_DATA_MAPS);
+        abort();
+    }
+
+    g_data_map[g_data_maps].addr = addr;
+    g_data_map[g_data_maps].size = size;
+    g_data_map[g_data_maps].host = host;
+    g_data_maps++;
+}
+
+uint8_t *sim_data_ptr(uint16_t addr)
+{
+    for (uint8_t i = 0; i < g_data_maps; i++)
+    {
+        if (addr >= g_data_map[i].addr && addr - g_data_map[i].addr < g_data_map[i].size)
+        {
+            return g_data_map[i].host + (addr - g_data_map[i].addr);
+        }
+    }
+
+    return &g_data_ram[addr % sizeof(g_data_ram)];
+}
+
+/*---------------------------------------------------------
+ * CAN Bus
+ *---------------------------------------------------------*/
+void sim_can_rx(uint64_t at, uint16_t id, const uint8_t *data, uint8_t dlc)
+{
+    sim_frame_t frame;
+    uint32_t    pos;
+
+    if (g_rx_queued == SIM_CAN_RX_QUEUE)
+    {
+        fprintf(stderr, "sim: CAN receive queue full\n");
+        abort();
+    }
+
+    frame.at  = (at > g_now) ? at : g_now;
+    frame.id  = (uint16_t)(id & 0x7FF);
+    frame.dlc = (uint8_t)(dlc & 0x0F);
+    memset(frame.data, 0, sizeof(frame.data));
+
+    if (data != NULL)
+    {
+        memcpy(frame.data, data, (frame.dlc > 8) ? 8 : frame.dlc);
+    }
+
+    /* Keep the queue ordered by bus time, FIFO for equal times */
+    pos = g_rx_queued;
+
+    while (pos > 0 && g_rx_queue[pos - 1].at > frame.at)
+    {
+        g_rx_queue[pos] = g_rx_queue[pos - 1];
+        pos--;
+    }
+
+    g_rx_queue[pos] = frame;
+    g_rx_queued++;
+}
+
+uint32_t sim_can_rx_queued(void)
+{
+    return g_rx_queued;
+}
+
+uint32_t sim_can_tx_count(void)
+{
+    return g_tx_count;
+}
+
+const sim_frame_t *sim_can_tx_frame(uint32_t index)
+{
+    if (index >= g_tx_count || g_tx_count - index > SIM_CAN_LOG_SIZE)
+    {
+        return NULL;
+    }
+
+    return &g_tx_log[index % SIM_CAN_LOG_SIZE];
+}
+
+void sim_can_on_tx(void (*hook)(const sim_frame_t *frame))
+{
+    g_tx_hook = hook;
+}
+
+/*---------------------------------------------------------
+ * EUSART
+ *---------------------------------------------------------*/
+void sim_uart_on_tx(void (*hook)(uint8_t byte))
+{
+    g_uart_hook = hook;
+}
+
+/*---------------------------------------------------------
+ * Node Under Test
+ *---------------------------------------------------------*/
+static void sim_node_main(void)
+{
+    g_node_entry();
+    g_node_done = 1;
+}
+
+void sim_node_start(void (*entry)(void))
+{
+    g_node_entry = entry;
+    g_node_done  = 0;
+    g_goto       = SIM_NO_GOTO;
+
+    getcontext(&g_node_ctx);
+    g_node_ctx.uc_stack.ss_sp   = g_node_stack;
+    g_node_ctx.uc_stack.ss_size = sizeof(g_node_stack);
+    g_node_ctx.uc_link          = &g_test_ctx;
+    makecontext(&g_node_ctx, sim_node_main, 0);
+}
+
+void sim_node_run(uint64_t cycles)
+{
+    if (g_node_entry == NULL || g_node_done)
+    {
+        return;
+    }
+
+    g_stop_at = g_now + cycles;
+    g_in_node = 1;
+    swapcontext(&g_test_ctx, &g_node_ctx);
+
+    /* RESET(): from the top of main() for the rest of the run */
+    while (g_reset_pending)
+    {
+        g_reset_pending = 0;
+        sim_node_start(g_node_entry);
+        swapcontext(&g_test_ctx, &g_node_ctx);
+    }
+
+    g_in_node = 0;
+    g_stop_at = SIM_NEVER;
+}
+
+uint8_t sim_node_stalled(void)
+{
+    return g_stalled;
+}
+
+void sim_node_reset_restarts(uint8_t on)
+{
+    g_reset_restarts = on;
+}
+
+uint32_t sim_node_goto(void)
+{
+    return g_goto;
+}
@@ -0,0 +1,146 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "xc.h"
+
+/*---------------------------------------------------------
+ * Simulated Clock
+ *
+ *  Time is counted in instruction cycles (Fosc / 4, 5 per
+ *  microsecond at 20 MHz). Code between two register
+ *  accesses costs nothing; each access through a modelled
+ *  register costs SIM_ACCESS_CYCLES and an interrupt entry
+ *  SIM_ISR_ENTRY_CYCLES. Interrupts are taken wherever time
+ *  advances: at modelled register accesses, in delays and
+ *  in SLEEP().
+ *---------------------------------------------------------*/
+#define SIM_CYCLES_PER_US           5ULL
+#define SIM_ACCESS_CYCLES           2ULL
+#define SIM_ISR_ENTRY_CYCLES        40ULL
+#define SIM_ADC_CYCLES              90ULL       /* 11 Tad at Fosc/32 */
+#define SIM_US(us)                  ((uint64_t)(us) * SIM_CYCLES_PER_US)
+#define SIM_MS(ms)                  ((uint64_t)(ms) * 1000ULL * SIM_CYCLES_PER_US)
+
+/*---------------------------------------------------------
+ * CAN Bus (500 kbit/s, 10 cycles per bit)
+ *---------------------------------------------------------*/
+#define SIM_CAN_CYCLES_PER_BIT      10ULL
+#define SIM_CAN_LOG_SIZE            8192U
+#define SIM_CAN_RX_QUEUE            4096U
+
+typedef struct
+{
+    uint64_t at;                    /* Cycle the frame ended on the bus */
+    uint16_t id;
+    uint8_t  dlc;                   /* DLC field, 0..15 */
+    uint8_t  data[8];
+} sim_frame_t;
+
+/*---------------------------------------------------------
+ * Statistics
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint64_t idle_cycles;           /* SLEEP() with IDLEN = 1 */
+    uint64_t sleep_cycles;          /* SLEEP() with IDLEN = 0 */
+    uint32_t sleeps;                /* SLEEP() calls */
+    uint32_t irq_entries[2];        /* Low, high vector */
+    uint32_t irq_preempted;         /* High vector entered during low ISR */
+    uint32_t can_rx_delivered;
+    uint32_t can_rx_overflow;       /* Both buffers full */
+    uint32_t can_rx_lost;           /* Module not receiving (sleep, config, loopback) */
+    uint32_t can_tx_aborted;
+    uint32_t can_loopback;          /* Frames sent in loopback mode */
+    uint32_t uart_tx_bytes;         /* Bytes the EUSART shifted out */
+    uint32_t flash_erases;          /* Program flash rows erased */
+    uint32_t flash_writes;          /* Program flash groups written */
+    uint32_t resets;
+} sim_stats_t;
+
+extern sim_stats_t g_sim;
+
+/* Data EEPROM contents and per-byte write count */
+extern uint8_t  g_sim_eeprom[256];
+extern uint32_t g_sim_eeprom_writes[256];
+
+/*---------------------------------------------------------
+ * Model Control
+ *---------------------------------------------------------*/
+void     sim_init(void);
+void     sim_set_isr(void (*high)(void), void (*low)(void));
+uint64_t sim_now(void);
+void     sim_advance(uint64_t cycles);
+
+/* EEPROM byte write time (datasheet 4 ms; tests may shorten it) */
+void     sim_eeprom_set_write_cycles(uint64_t cycles);
+
+/*---------------------------------------------------------
+ * Program Flash (erased: 0xFF)
+ *  Row erase and group write are self-timed (2 ms); rows
+ *  below the protected end are left untouched, as with
+ *  the boot block write protection in the config words.
+ *---------------------------------------------------------*/
+#define SIM_FLASH_SIZE              0x8000U
+#define SIM_FLASH_ROW               64U
+#define SIM_FLASH_GROUP             8U
+#define SIM_FLASH_CYCLES            SIM_MS(2)
+
+extern uint8_t g_sim_flash[SIM_FLASH_SIZE];
+
+void     sim_flash_protect(uint32_t end);
+
+void     sim_adc_set(uint8_t channel, uint16_t value);
+
+/* Host variable at a data-memory address (see sim_data_ptr()) */
+#define SIM_DATA_MAPS               8U
+void     sim_data_map(uint16_t addr, void *host, uint16_t size);
+
+/* Character the CLCD shows (row 0/1, column 0..15) */
+unsigned char sim_lcd_char(uint8_t row, uint8_t col);
+
+/*---------------------------------------------------------
+ * CAN Bus
+ *---------------------------------------------------------*/
+uint64_t sim_can_frame_cycles(uint8_t dlc);
+
+/* Frame from another node, completed on the bus at 'at' (0 = now) */
+void     sim_can_rx(uint64_t at, uint16_t id, const uint8_t *data, uint8_t dlc);
+uint32_t sim_can_rx_queued(void);
+
+/* Frames sent by the node (log keeps the last SIM_CAN_LOG_SIZE) */
+uint32_t           sim_can_tx_count(void);
+const sim_frame_t *sim_can_tx_frame(uint32_t index);
+void               sim_can_on_tx(void (*hook)(const sim_frame_t *frame));
+
+/*---------------------------------------------------------
+ * EUSART
+ *  Each byte written to TXREG is passed to the hook once
+ *  its stop bit has left the shift register (10 bit times
+ *  at the SPBRG rate).
+ *---------------------------------------------------------*/
+void     sim_uart_on_tx(void (*hook)(uint8_t byte));
+
+/*---------------------------------------------------------
+ * Node Under Test
+ *  The node's main() runs as a coroutine: sim_node_run()
+ *  lets it execute for a stretch of simulated time and
+ *  returns to the test. sim_node_stalled() is set when the
+ *  node sleeps with no wake-up source left.
+ *---------------------------------------------------------*/
+void     sim_node_start(void (*entry)(void));
+void     sim_node_run(uint64_t cycles);
+uint8_t  sim_node_stalled(void);
+
+/* RESET() only counts (g_sim.resets) unless enabled here: then
+ * the node starts again from the top of main(), with RAM and
+ * registers as they were */
+void     sim_node_reset_restarts(uint8_t on);
+
+/* Address of a GOTO out of the node's code since it was last
+ * started (bootloader into the application); the node stops
+ * there */
+#define SIM_NO_GOTO                 0xFFFFFFFFUL
+uint32_t sim_node_goto(void);
+
+#endif /* SIM_H */
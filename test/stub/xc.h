@@ -0,0 +1,167 @@
+/***********************************************************************
+ *  File name   : xc.h (host test build)
+ *  Description : Register model of the PIC18F4580 for the host tests.
+ *                Replaces the XC8 device header: every SFR and bit
+ *                the nodes use is a plain variable (sim.c), except
+ *                the ones whose behaviour the code relies on, which
+ *                go through sim.c accessors:
+ *
+ *                  TMR1, TMR2, TMR3    running timers, overflow IFs
+ *                  CANSTAT             follows the CANCON request
+ *                  TXB0CONbits         frame leaves after its bit time
+ *                  EECON1bits, EEDATA  data EEPROM read / timed write
+ *                  GO                  ADC conversion (sim_adc_set())
+ *                  RC2, RD7            CLCD strobe and busy flag
+ *                  TXREG               EUSART byte out, TXIF / TRMT
+ *                  RXBnCONbits         polled receive flags
+ *                  asm()               table read / write, GOTO
+ *                  SLEEP()             IDLE / SLEEP until a wake-up
+ *
+ *                Every accessor call costs SIM_ACCESS_CYCLES, so busy
+ *                waits advance the simulated clock, and pending
+ *                interrupts are taken there (see sim.h).
+ *
+ ***********************************************************************/
+
+#ifndef XC_H
+#define XC_H
+
+#include <stdint.h>
+
+/*---------------------------------------------------------
+ * Compiler Built-ins
+ *---------------------------------------------------------*/
+#define __interrupt(...)
+#define __delay_ms(ms)              sim_delay_us((uint32_t)(ms) * 1000UL)
+#define __delay_us(us)              sim_delay_us((uint32_t)(us))
+#define SLEEP()                     sim_sleep()
+#define NOP()
+#define CLRWDT()
+#define RESET()                     sim_reset()
+#define asm(text)                   sim_asm(text)
+#define ___mkstr1(x)                #x
+#define ___mkstr(x)                 ___mkstr1(x)
+#define di()                        (GIE = 0)
+#define ei()                        (GIE = 1)
+
+void     sim_delay_us(uint32_t us);
+void     sim_sleep(void);
+void     sim_reset(void);
+void     sim_asm(const char *text);
+
+/*---------------------------------------------------------
+ * Bit Views
+ *  SFRs used only through their bits share one layout;
+ *  the ones also accessed as a byte have the datasheet
+ *  bit positions (LSB first).
+ *---------------------------------------------------------*/
+typedef struct
+{
+    unsigned BRG16 : 1, BRGH : 1, CANCAP : 1, IDLEN : 1, IPEN : 1, RXB0OVFL : 1,
+             RXB1OVFL : 1, SPEN : 1, SYNC : 1, TRMT : 1, TXEN : 1;
+} sim_bits_t;
+
+typedef struct
+{
+    unsigned char FILHIT0 : 1, JTOFF : 1, RXB0DBEN : 1, RXRTRRO : 1, : 1,
+                  RXM0 : 1, RXM1 : 1, RXFUL : 1;
+} sim_rxbcon_t;
+
+typedef struct
+{
+    unsigned char TXPRI : 2, : 1, TXREQ : 1, TXERR : 1, TXLARB : 1, TXABT : 1, : 1;
+} sim_txbcon_t;
+
+typedef struct
+{
+    unsigned char RD : 1, WR : 1, WREN : 1, WRERR : 1, FREE : 1, : 1, CFGS : 1, EEPGD : 1;
+} sim_eecon1_t;
+
+/*---------------------------------------------------------
+ * Plain Registers and Bits
+ *---------------------------------------------------------*/
+#define SIM_REG(name)               extern volatile uint8_t name;
+#define SIM_REG16(name)             extern volatile uint16_t name;
+#define SIM_BITS(name)              extern volatile sim_bits_t name;
+#include "regs.def"
+#undef SIM_REG
+#undef SIM_REG16
+#undef SIM_BITS
+
+/* Same bit under two names */
+#define GIEH                        GIE
+#define GIEL                        PEIE
+#define GODONE                      GO
+
+/*---------------------------------------------------------
+ * ECAN Buffers (RXBnCON .. RXBnD7 and TXB0CON .. TXB0D7
+ * are consecutive, as in legacy mode)
+ *---------------------------------------------------------*/
+#define SIM_CANBUF_SIZE             14
+
+extern volatile uint8_t sim_rxb[2][SIM_CANBUF_SIZE];
+extern volatile uint8_t sim_txb0[SIM_CANBUF_SIZE];
+
+#define RXB0CON                     sim_rxb[0][0]
+#define RXB0SIDH                    sim_rxb[0][1]
+#define RXB0SIDL                    sim_rxb[0][2]
+#define RXB0DLC                     sim_rxb[0][5]
+#define RXB0D0                      sim_rxb[0][6]
+#define RXB1CON                     sim_rxb[1][0]
+#define RXB1SIDH                    sim_rxb[1][1]
+#define RXB1SIDL                    sim_rxb[1][2]
+#define RXB1DLC                     sim_rxb[1][5]
+#define RXB1D0                      sim_rxb[1][6]
+#define RXB0CONbits                 (*sim_rxbcon(0))
+#define RXB1CONbits                 (*sim_rxbcon(1))
+
+volatile sim_rxbcon_t *sim_rxbcon(uint8_t buf);
+
+#define TXB0SIDH                    sim_txb0[1]
+#define TXB0SIDL                    sim_txb0[2]
+#define TXB0EIDH                    sim_txb0[3]
+#define TXB0EIDL                    sim_txb0[4]
+#define TXB0DLC                     sim_txb0[5]
+#define TXB0D0                      sim_txb0[6]
+#define TXB0CONbits                 (*sim_txb0con())
+#define TXB0REQ                     TXB0CONbits.TXREQ
+
+volatile sim_txbcon_t *sim_txb0con(void);
+
+/*---------------------------------------------------------
+ * Modelled Peripherals
+ *---------------------------------------------------------*/
+#define CANSTAT                     (*sim_canstat())
+#define TMR1                        (sim_tmr1())
+#define TMR2                        (*sim_tmr2())
+#define TMR3                        (sim_tmr3())
+#define EECON1bits                  (*sim_eecon1())
+#define EEDATA                      (*sim_eedata())
+#define GO                          (*sim_adc_go())
+#define RC2                         (*sim_lcd_en())
+#define RD7                         (*sim_lcd_busy())
+#define TXREG                       (*sim_txreg())
+
+volatile uint8_t      *sim_canstat(void);
+uint16_t               sim_tmr1(void);
+volatile uint8_t      *sim_tmr2(void);
+uint16_t               sim_tmr3(void);
+volatile sim_eecon1_t *sim_eecon1(void);
+volatile uint8_t      *sim_eedata(void);
+volatile uint8_t      *sim_adc_go(void);
+volatile uint8_t      *sim_lcd_en(void);
+volatile uint8_t      *sim_lcd_busy(void);
+volatile uint8_t      *sim_txreg(void);
+
+/*---------------------------------------------------------
+ * Data Memory
+ *  Code that turns a 16-bit data-memory address into a
+ *  pointer (XCP MTA and DAQ entries) goes through
+ *  sim_data_ptr(): addresses mapped with sim_data_map()
+ *  reach host variables, the rest a 4 KB RAM image.
+ *---------------------------------------------------------*/
+#define XCP_PTR(addr)               sim_data_ptr(addr)
+
+uint8_t *sim_data_ptr(uint16_t addr);
+
+#endif /* XC_H */
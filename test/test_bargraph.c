@@ -0,0 +1,172 @@
+/***********************************************************************
+ *  File name   : test_bargraph.c
+ *  Description : ECU3 RPM bar graph, counted in LCD bus writes
+ *                (g_screen_writes of screen.c) for a 0 -> 8000 ->
+ *                0 RPM sweep:
+ *                - CGRAM glyphs are loaded once, not per draw
+ *                - only cells whose fill level changes are written
+ *                - every drawn level matches the value
+ *                and the total against redrawing the line each time.
+ *
+ ***********************************************************************/
+
+#include "unit.h"
+#include "node.h"
+#include "bargraph.h"
+#include "screen.h"
+#include "clcd.h"
+
+UNIT_STATE
+
+#define BAR_CELLS                   5
+#define FULL_SCALE                  8000U
+#define SWEEP_STEP                  10U
+#define CGRAM_LOAD_WRITES           ((BAR_PIXELS_PER_CELL - 1) * (1 + CGRAM_ROWS))
+
+static bargraph_t g_bar;
+
+/* Level the cell must show for a value */
+static uint8_t expected_level(uint16_t value, uint8_t cell)
+{
+    uint32_t pixels = (value >= FULL_SCALE) ? BAR_CELLS * BAR_PIXELS_PER_CELL :
+                      (uint32_t)value * BAR_CELLS * BAR_PIXELS_PER_CELL / FULL_SCALE;
+    uint32_t first  = (uint32_t)cell * BAR_PIXELS_PER_CELL;
+
+    if (pixels <= first)
+    {
+        return 0;
+    }
+
+    return (uint8_t)((pixels - first >= BAR_PIXELS_PER_CELL) ? BAR_PIXELS_PER_CELL : pixels - first);
+}
+
+static void setup(void)
+{
+    sim_init();
+    screen_init();
+    screen_lcd_ready();
+    bargraph_init(&g_bar, LINE2(8), BAR_CELLS, FULL_SCALE);
+}
+
+/* Draws value, returns the bus writes it cost */
+static uint16_t draw(uint16_t value)
+{
+    uint16_t before = g_screen_writes;
+
+    bargraph_draw(&g_bar, value);
+
+    for (uint8_t cell = 0; cell < BAR_CELLS; cell++)
+    {
+        CHECK_EQ(g_bar.level[cell], expected_level(value, cell));
+    }
+
+    return (uint16_t)(g_screen_writes - before);
+}
+
+/*---------------------------------------------------------
+ * Sweep up and down, count the writes
+ *---------------------------------------------------------*/
+static void test_sweep(void)
+{
+    uint32_t first;
+    uint32_t up = 0;
+    uint32_t down = 0;
+    uint32_t draws = 0;
+    uint32_t changes = 0;
+    uint16_t max_draw = 0;
+    uint32_t line_redraw;
+
+    setup();
+
+    /* First draw: glyphs into CGRAM, then every cell once */
+    first = draw(0);
+    CHECK(first >= CGRAM_LOAD_WRITES);
+    CHECK(first <= CGRAM_LOAD_WRITES + 2 * BAR_CELLS);
+
+    for (uint16_t rpm = SWEEP_STEP; rpm <= FULL_SCALE; rpm += SWEEP_STEP)
+    {
+        uint16_t cost = draw(rpm);
+
+        up += cost;
+        draws++;
+        changes += (cost != 0);
+        max_draw = (cost > max_draw) ? cost : max_draw;
+    }
+
+    for (int32_t rpm = FULL_SCALE - SWEEP_STEP; rpm >= 0; rpm -= SWEEP_STEP)
+    {
+        uint16_t cost = draw((uint16_t)rpm);
+
+        down += cost;
+        draws++;
+        changes += (cost != 0);
+        max_draw = (cost > max_draw) ? cost : max_draw;
+    }
+
+    /* Full line rewrite per draw: address + 16 characters */
+    line_redraw = draws * (1 + 16);
+
+    printf("  first draw %u writes, sweep up %u, down %u (%u draws, %u with a change,"
+           " max %u per draw); line redraw: %u\n",
+           first, up, down, draws, changes, max_draw, line_redraw);
+
+    /* One pixel column per change: one cell, address + data at most */
+    CHECK_EQ(changes, 2 * BAR_CELLS * BAR_PIXELS_PER_CELL);
+    CHECK(max_draw <= 2);
+    CHECK(up <= 2 * BAR_CELLS * BAR_PIXELS_PER_CELL);
+    CHECK(down <= 2 * BAR_CELLS * BAR_PIXELS_PER_CELL);
+    CHECK(up + down < line_redraw / 50);
+}
+
+/*---------------------------------------------------------
+ * CGRAM stays loaded; LCD re-initialisation
+ *---------------------------------------------------------*/
+static void test_cgram_once(void)
+{
+    uint16_t cost;
+
+    setup();
+
+    draw(4000);
+    CHECK_EQ(draw(4000), 0);
+
+    /* Another instance on the other line shares the glyphs */
+    {
+        bargraph_t other;
+
+        bargraph_init(&other, LINE1(0), 4, 100);
+        cost = g_screen_writes;
+        bargraph_draw(&other, 100);
+        cost = (uint16_t)(g_screen_writes - cost);
+        CHECK(cost <= 2 * 4);
+    }
+
+    /* Invalidate alone: the screen layer still holds the cells */
+    bargraph_invalidate(&g_bar);
+    CHECK_EQ(draw(4000), 0);
+
+    /* LCD re-initialised: the screen layer redraws the cells from
+     * its shadow, the glyphs are not reloaded */
+    cost = g_screen_writes;
+    screen_lcd_ready();
+    cost = (uint16_t)(g_screen_writes - cost);
+    CHECK(cost >= 1);
+    CHECK(cost < CGRAM_LOAD_WRITES);
+    bargraph_invalidate(&g_bar);
+    CHECK_EQ(draw(4000), 0);
+
+    /* Out of range values saturate */
+    draw(65535);
+    CHECK_EQ(g_bar.level[BAR_CELLS - 1], BAR_PIXELS_PER_CELL);
+}
+
+int main(void)
+{
+    printf("Bar graph tests, node %d\n", HAL_NODE_ID);
+
+    /* First: the glyph set is loaded on the first draw ever */
+    UNIT_RUN(test_sweep);
+    UNIT_RUN(test_cgram_once);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,153 @@
+/***********************************************************************
+ *  File name   : test_boot.c
+ *  Description : ECU3 staged start-up, run from reset in the
+ *                simulator with dashboard frames on the bus from the
+ *                first millisecond:
+ *                - CAN is up before the LCD power-on wait ends
+ *                - frames received during the LCD sequence are kept
+ *                  (no ring or buffer overrun) and decoded
+ *                - the first value is drawn as soon as the LCD is
+ *                  ready, and the timeline is reported on the bus
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "can.h"
+#include "e2e.h"
+#include "boot.h"
+#include "msg_id.h"
+#include "signal_store.h"
+#include "screen.h"
+
+UNIT_STATE
+
+#define FRAME_PERIOD_MS             5U
+#define RUN_MS                      200U
+#define LCD_POWER_ON_MS             30U     /* clcd.c wait before the first step */
+#define LCD_SEQUENCE_MS             43U     /* Power-on wait + the 7 step waits */
+#define LCD_WAITS                   8U      /* Each ends one tick past its minimum */
+
+static e2e_tx_t      g_speed_tx;
+static e2e_tx_t      g_rpm_tx;
+static uint64_t      g_first_frame_at;
+static uint8_t       g_report[8];
+static uint8_t       g_reported;
+static uint16_t      g_speed;
+
+static void on_tx(const sim_frame_t *f)
+{
+    if (f->id == BOOT_REPORT_MSG_ID)
+    {
+        memcpy(g_report, f->data, sizeof(g_report));
+        g_reported++;
+    }
+}
+
+/* SPEED ("nnn") and RPM frames back to back, as ECU1/ECU2 send them */
+static void send_frames(void)
+{
+    uint8_t       frame[CAN_MAX_DLC];
+    unsigned char text[5];
+    uint8_t       len;
+
+    g_speed++;
+
+    text[0] = (unsigned char)('0' + g_speed / 100 % 10);
+    text[1] = (unsigned char)('0' + g_speed / 10 % 10);
+    text[2] = (unsigned char)('0' + g_speed % 10);
+    len = e2e_protect(&g_speed_tx, SPEED_MSG_ID, frame, text, 3);
+    sim_can_rx(0, SPEED_MSG_ID, frame, len);
+
+    memcpy(text, "3000", 5);
+    len = e2e_protect(&g_rpm_tx, RPM_MSG_ID, frame, text, 5);
+    sim_can_rx(sim_now() + sim_can_frame_cycles(len), RPM_MSG_ID, frame, len);
+
+    if (g_first_frame_at == 0)
+    {
+        g_first_frame_at = sim_now();
+    }
+}
+
+static uint16_t report_u16(uint8_t pos)
+{
+    return (uint16_t)(g_report[pos] | (g_report[pos + 1] << 8));
+}
+
+/*---------------------------------------------------------
+ * Boot timeline
+ *---------------------------------------------------------*/
+static void test_timeline(void)
+{
+    signal_t speed;
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    sim_can_on_tx(on_tx);
+    memset(&g_speed_tx, 0, sizeof(g_speed_tx));
+    memset(&g_rpm_tx, 0, sizeof(g_rpm_tx));
+
+    sim_node_start(node_main);
+
+    /* Frames from 1 ms after reset on */
+    sim_node_run(SIM_MS(1));
+
+    for (uint32_t ms = 1; ms < RUN_MS; ms++)
+    {
+        if (ms % FRAME_PERIOD_MS == 1)
+        {
+            send_frames();
+        }
+
+        sim_node_run(SIM_MS(1));
+    }
+
+    printf("  CAN ready %u ms, first frame %u ms (sent at %.1f ms), LCD ready %u ms,"
+           " first value drawn %u ms\n",
+           g_boot_timeline.can_ready_ms, g_boot_timeline.first_frame_ms,
+           (double)g_first_frame_at / SIM_MS(1), g_boot_timeline.lcd_ready_ms,
+           g_boot_timeline.first_pixel_ms);
+    printf("  %u frames received, %u ring overruns, %u buffer overflows\n",
+           g_sim.can_rx_delivered, g_can_rx_overruns, g_sim.can_rx_overflow);
+
+    /* CAN first: long before the LCD power-on wait is over */
+    CHECK(g_boot_timeline.can_ready_ms <= 2);
+    CHECK(g_boot_timeline.can_ready_ms < LCD_POWER_ON_MS);
+
+    /* The first frame is decoded at once, while the LCD powers up */
+    CHECK(g_boot_timeline.first_frame_ms <= g_first_frame_at / SIM_MS(1) + 1);
+    CHECK(g_boot_timeline.first_frame_ms < g_boot_timeline.lcd_ready_ms);
+
+    /* LCD sequence: its minimum waits, at most a tick late each */
+    CHECK(g_boot_timeline.lcd_ready_ms >= LCD_SEQUENCE_MS);
+    CHECK(g_boot_timeline.lcd_ready_ms <= LCD_SEQUENCE_MS + LCD_WAITS + 1);
+
+    /* Values held back during power-on appear with the LCD */
+    CHECK(g_boot_timeline.first_pixel_ms != BOOT_MARK_UNSET);
+    CHECK(g_boot_timeline.first_pixel_ms - g_boot_timeline.lcd_ready_ms <= 1);
+
+    /* Nothing lost, the store holds the newest value */
+    CHECK_EQ(g_can_rx_overruns, 0);
+    CHECK_EQ(g_sim.can_rx_overflow, 0);
+    signal_read(e_sig_speed, &speed);
+    CHECK(speed.valid);
+    CHECK_EQ(speed.value, g_speed % 1000);
+    CHECK(g_screen_writes > 0);
+
+    /* Timeline on the bus, once */
+    CHECK_EQ(g_reported, 1);
+    CHECK_EQ(report_u16(0), g_boot_timeline.can_ready_ms);
+    CHECK_EQ(report_u16(2), g_boot_timeline.first_frame_ms);
+    CHECK_EQ(report_u16(4), g_boot_timeline.lcd_ready_ms);
+    CHECK_EQ(report_u16(6), g_boot_timeline.first_pixel_ms);
+}
+
+int main(void)
+{
+    printf("Boot tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_timeline);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,507 @@
+/***********************************************************************
+ *  File name   : test_bootloader.c
+ *  Description : CAN bootloader (BOOT/, built for BOOT_NODE_ID) on
+ *                the register model's program flash, driven with the
+ *                frames tools/can_flash.py sends: header, data frames
+ *                back to back, one acknowledge per block.
+ *                - first image on a blank device: INFO, streaming,
+ *                  row erases and group writes (blank groups
+ *                  skipped), VERIFY, RESET into the application
+ *                - per-block CRC, range and sequence errors and the
+ *                  gap timeout; a rejected block leaves flash and
+ *                  the valid flag alone
+ *                - interrupted updates: a request nobody serves, a
+ *                  host lost after a bad block and power lost after
+ *                  some blocks; the old image runs again while it is
+ *                  intact, the node stays in the bootloader otherwise
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "crc16.h"
+
+UNIT_STATE
+
+#define IMAGE_SIZE                  0x1800U     /* 24 blocks above BOOT_APP_BASE */
+#define BLOCK_COUNT                 (IMAGE_SIZE / BOOT_BLOCK_SIZE)
+#define SLICE_CYCLES                SIM_US(100)
+#define HOST_TIMEOUT_MS             500U        /* can_flash.py Flasher timeout */
+#define TIMER1_OVF_US               104858U     /* 65536 * 8 / 5 MHz */
+#define NO_RESPONSE                 0xFFU
+#define RESP_QUEUE                  16U
+
+static uint8_t     g_image_a[IMAGE_SIZE];
+static uint8_t     g_image_b[IMAGE_SIZE];
+static uint8_t     g_boot_block[BOOT_APP_BASE];
+
+static sim_frame_t g_resp[RESP_QUEUE];
+static uint32_t    g_resp_count;
+static uint32_t    g_resp_read;
+static uint64_t    g_bus_at;        /* End of the host's last frame */
+
+static void on_tx(const sim_frame_t *f)
+{
+    if (f->id == BOOT_RESP_ID)
+    {
+        g_resp[g_resp_count++ % RESP_QUEUE] = *f;
+    }
+}
+
+/* Random code with unused stretches, as can_flash.py random_image() */
+static void make_image(uint8_t *image, uint32_t seed)
+{
+    for (uint32_t i = 0; i < IMAGE_SIZE; i++)
+    {
+        seed = seed * 1103515245U + 12345U;
+        image[i] = (uint8_t)(seed >> 16);
+    }
+
+    for (uint32_t start = 0; start < IMAGE_SIZE; start += 1024U)
+    {
+        memset(&image[start + 512U], 0xFF, (start / 1024U + 1U) * 40U);
+    }
+}
+
+static uint16_t crc_of(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = CRC16_INIT;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        crc = crc16_update(crc, data[i]);
+    }
+
+    return crc;
+}
+
+static uint32_t blank_groups(const uint8_t *image)
+{
+    static const uint8_t blank[FLASH_WRITE_GROUP] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < IMAGE_SIZE; i += FLASH_WRITE_GROUP)
+    {
+        count += (memcmp(&image[i], blank, FLASH_WRITE_GROUP) == 0);
+    }
+
+    return count;
+}
+
+/*---------------------------------------------------------
+ * Host side (can_flash.py Flasher)
+ *---------------------------------------------------------*/
+static void host_send(uint16_t id, const uint8_t *data, uint8_t len)
+{
+    uint64_t at = (sim_now() > g_bus_at) ? sim_now() : g_bus_at;
+
+    g_bus_at = at + sim_can_frame_cycles(len);
+    sim_can_rx(g_bus_at, id, data, len);
+}
+
+/* Node runs until it answers, jumps to the application or ms pass */
+static const sim_frame_t *wait_response(uint32_t ms)
+{
+    uint64_t until = sim_now() + SIM_MS(ms);
+
+    while (g_resp_read == g_resp_count && sim_now() < until &&
+           sim_node_goto() == SIM_NO_GOTO)
+    {
+        sim_node_run(SLICE_CYCLES);
+    }
+
+    if (g_resp_read == g_resp_count)
+    {
+        return NULL;
+    }
+
+    return &g_resp[g_resp_read++ % RESP_QUEUE];
+}
+
+static uint8_t status_of(const sim_frame_t *f, uint8_t cmd)
+{
+    if (f == NULL || f->data[0] != cmd)
+    {
+        return NO_RESPONSE;
+    }
+
+    return f->data[1];
+}
+
+static uint8_t host_connect(void)
+{
+    const uint8_t enter[5] = { BOOT_CMD_ENTER, 'B', 'O', 'O', 'T' };
+    uint8_t       status;
+
+    host_send(BOOT_CMD_ID, enter, sizeof(enter));
+    status = status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_CONNECT);
+
+    /* Eat the INFO a freshly reset bootloader announces on its own */
+    while (status_of(wait_response(50), BOOT_CMD_CONNECT) != NO_RESPONSE)
+    {
+        ;
+    }
+
+    return status;
+}
+
+static void send_block_header(uint32_t addr, uint8_t frames, uint16_t crc)
+{
+    const uint8_t cmd[7] =
+    {
+        BOOT_CMD_BLOCK, (uint8_t)addr, (uint8_t)(addr >> 8), (uint8_t)(addr >> 16),
+        frames, (uint8_t)crc, (uint8_t)(crc >> 8)
+    };
+
+    host_send(BOOT_CMD_ID, cmd, sizeof(cmd));
+}
+
+static uint8_t host_block(uint32_t addr, const uint8_t *data, uint16_t crc)
+{
+    const sim_frame_t *f;
+
+    send_block_header(addr, BOOT_BLOCK_FRAMES, crc);
+
+    for (uint8_t i = 0; i < BOOT_BLOCK_FRAMES; i++)
+    {
+        host_send(BOOT_DATA_ID, &data[i * 8U], 8);
+    }
+
+    f = wait_response(HOST_TIMEOUT_MS);
+
+    if (f != NULL && (uint32_t)(f->data[2] | (f->data[3] << 8) | ((uint32_t)f->data[4] << 16)) != addr)
+    {
+        return NO_RESPONSE;
+    }
+
+    return status_of(f, BOOT_CMD_BLOCK);
+}
+
+/* First 'blocks' blocks of an image; returns how many were acked */
+static uint32_t host_write(const uint8_t *image, uint32_t blocks)
+{
+    uint32_t acked = 0;
+
+    for (uint32_t b = 0; b < blocks; b++)
+    {
+        const uint8_t *data = &image[b * BOOT_BLOCK_SIZE];
+
+        if (host_block(BOOT_APP_BASE + b * BOOT_BLOCK_SIZE, data,
+                       crc_of(data, BOOT_BLOCK_SIZE)) != e_boot_ok)
+        {
+            break;
+        }
+        acked++;
+    }
+
+    return acked;
+}
+
+static uint8_t host_verify(uint16_t crc)
+{
+    const uint32_t end = BOOT_APP_BASE + IMAGE_SIZE;
+    const uint8_t  cmd[6] =
+    {
+        BOOT_CMD_VERIFY, (uint8_t)end, (uint8_t)(end >> 8), (uint8_t)(end >> 16),
+        (uint8_t)crc, (uint8_t)(crc >> 8)
+    };
+
+    host_send(BOOT_CMD_ID, cmd, sizeof(cmd));
+
+    return status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_VERIFY);
+}
+
+static uint8_t host_reset(void)
+{
+    const uint8_t cmd[1] = { BOOT_CMD_RESET };
+
+    host_send(BOOT_CMD_ID, cmd, sizeof(cmd));
+
+    return status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_RESET);
+}
+
+/* Whole image, checked and started */
+static void host_flash(const uint8_t *image)
+{
+    CHECK_EQ(host_write(image, BLOCK_COUNT), BLOCK_COUNT);
+    CHECK_EQ(host_verify(crc_of(image, IMAGE_SIZE)), e_boot_ok);
+    CHECK_EQ(host_reset(), e_boot_ok);
+
+    sim_node_run(SIM_MS(10));
+    CHECK_EQ(sim_node_goto(), BOOT_APP_BASE);
+}
+
+/*---------------------------------------------------------
+ * Device
+ *---------------------------------------------------------*/
+static void setup(void)
+{
+    sim_init();
+    sim_flash_protect(BOOT_APP_BASE);
+    sim_node_reset_restarts(1);
+    sim_can_on_tx(on_tx);
+
+    /* Boot block content, to see it is never touched */
+    for (uint32_t i = 0; i < BOOT_APP_BASE; i++)
+    {
+        g_boot_block[i] = (uint8_t)(i * 7U);
+    }
+    memcpy(g_sim_flash, g_boot_block, sizeof(g_boot_block));
+
+    make_image(g_image_a, 1);
+    make_image(g_image_b, 2);
+
+    g_resp_count = 0;
+    g_resp_read  = 0;
+    g_bus_at     = 0;
+}
+
+/* Reset pin / power: flash and EEPROM stay, the node starts over */
+static void power_on(void)
+{
+    g_resp_read = g_resp_count;
+    sim_node_start(node_main);
+}
+
+static uint8_t app_is(const uint8_t *image)
+{
+    return (uint8_t)(memcmp(&g_sim_flash[BOOT_APP_BASE], image, IMAGE_SIZE) == 0);
+}
+
+static uint8_t boot_block_intact(void)
+{
+    return (uint8_t)(memcmp(g_sim_flash, g_boot_block, sizeof(g_boot_block)) == 0);
+}
+
+/*---------------------------------------------------------
+ * CRC-16/CCITT-FALSE, as can_flash.py
+ *---------------------------------------------------------*/
+static void test_crc(void)
+{
+    CHECK_EQ(crc_of((const uint8_t *)"123456789", 9), 0x29B1);
+}
+
+/*---------------------------------------------------------
+ * First image on a blank device
+ *---------------------------------------------------------*/
+static void test_first_image(void)
+{
+    const sim_frame_t *info;
+    uint64_t           start;
+    uint64_t           took;
+
+    setup();
+    power_on();
+
+    /* Nothing valid: the bootloader announces itself */
+    info = wait_response(10);
+    CHECK(info != NULL);
+    if (info == NULL)
+    {
+        return;
+    }
+    CHECK_EQ(info->dlc, 8);
+    CHECK_EQ(info->data[0], BOOT_CMD_CONNECT);
+    CHECK_EQ(info->data[1], e_boot_ok);
+    CHECK_EQ(info->data[2], BOOT_VERSION);
+    CHECK_EQ(info->data[3], BOOT_NODE_ID);
+    CHECK_EQ(info->data[4], BOOT_APP_BASE >> 8);
+    CHECK_EQ(info->data[5], BOOT_FLASH_END >> 8);
+    CHECK_EQ(info->data[6], BOOT_BLOCK_FRAMES);
+    CHECK_EQ(info->data[7], FLASH_ERASE_ROW);
+    CHECK_EQ(sim_node_goto(), SIM_NO_GOTO);
+
+    CHECK_EQ(host_connect(), e_boot_ok);
+
+    start = sim_now();
+    CHECK_EQ(host_write(g_image_a, BLOCK_COUNT), BLOCK_COUNT);
+    took = sim_now() - start;
+
+    printf("  %u bytes in %u blocks: %llu ms, %llu B/s\n", IMAGE_SIZE, BLOCK_COUNT,
+           (unsigned long long)(took / SIM_MS(1)),
+           (unsigned long long)(IMAGE_SIZE * SIM_MS(1000) / took));
+
+    /* One erase per row, one write per group that is not blank */
+    CHECK(app_is(g_image_a));
+    CHECK(boot_block_intact());
+    CHECK_EQ(g_sim_flash[BOOT_APP_BASE + IMAGE_SIZE], 0xFF);
+    CHECK_EQ(g_sim.flash_erases, IMAGE_SIZE / FLASH_ERASE_ROW);
+    CHECK_EQ(g_sim.flash_writes, IMAGE_SIZE / FLASH_WRITE_GROUP - blank_groups(g_image_a));
+    CHECK(blank_groups(g_image_a) > 0);
+
+    /* Streamed without a reply per frame, nothing dropped */
+    CHECK_EQ(g_sim.can_rx_overflow, 0);
+    CHECK_EQ(g_resp_count, 1 + 1 + BLOCK_COUNT);
+
+    /* Not valid until the whole region checks out */
+    CHECK(g_sim_eeprom[BOOT_EE_APP_VALID] != BOOT_APP_VALID);
+    CHECK_EQ(host_reset(), e_boot_err_no_image);
+    CHECK_EQ(host_verify((uint16_t)(crc_of(g_image_a, IMAGE_SIZE) ^ 1U)), e_boot_err_verify);
+    CHECK(g_sim_eeprom[BOOT_EE_APP_VALID] != BOOT_APP_VALID);
+
+    CHECK_EQ(host_verify(crc_of(g_image_a, IMAGE_SIZE)), e_boot_ok);
+    CHECK_EQ(g_sim_eeprom[BOOT_EE_APP_VALID], BOOT_APP_VALID);
+
+    /* RESET: the bootloader starts again and goes straight on */
+    CHECK_EQ(host_reset(), e_boot_ok);
+    sim_node_run(SIM_MS(10));
+    CHECK_EQ(g_sim.resets, 1);
+    CHECK_EQ(sim_node_goto(), BOOT_APP_BASE);
+}
+
+/*---------------------------------------------------------
+ * Block errors
+ *---------------------------------------------------------*/
+static void test_block_errors(void)
+{
+    const uint8_t      data[8] = { 0 };
+    const sim_frame_t *f;
+    uint32_t           erases;
+    uint32_t           writes;
+    uint64_t           gap;
+
+    setup();
+    power_on();
+    CHECK_EQ(host_connect(), e_boot_ok);
+    CHECK_EQ(host_write(g_image_a, BLOCK_COUNT), BLOCK_COUNT);
+    CHECK_EQ(host_verify(crc_of(g_image_a, IMAGE_SIZE)), e_boot_ok);
+
+    erases = g_sim.flash_erases;
+    writes = g_sim.flash_writes;
+
+    /* CRC mismatch: rejected before anything is erased */
+    CHECK_EQ(host_block(BOOT_APP_BASE, g_image_b, (uint16_t)(crc_of(g_image_b, BOOT_BLOCK_SIZE) ^ 1U)),
+             e_boot_err_crc);
+    CHECK_EQ(g_sim.flash_erases, erases);
+    CHECK_EQ(g_sim.flash_writes, writes);
+    CHECK(app_is(g_image_a));
+    CHECK_EQ(g_sim_eeprom[BOOT_EE_APP_VALID], BOOT_APP_VALID);
+
+    /* Range: boot block, misaligned, past the end of flash */
+    send_block_header(0, BOOT_BLOCK_FRAMES, 0);
+    CHECK_EQ(status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_BLOCK), e_boot_err_range);
+    send_block_header(BOOT_APP_BASE + FLASH_WRITE_GROUP, BOOT_BLOCK_FRAMES, 0);
+    CHECK_EQ(status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_BLOCK), e_boot_err_range);
+    send_block_header(BOOT_FLASH_END - FLASH_ERASE_ROW, BOOT_BLOCK_FRAMES, 0);
+    CHECK_EQ(status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_BLOCK), e_boot_err_range);
+    send_block_header(BOOT_APP_BASE, BOOT_BLOCK_FRAMES + 1U, 0);
+    CHECK_EQ(status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_BLOCK), e_boot_err_range);
+
+    /* Data frame without a block */
+    host_send(BOOT_DATA_ID, data, sizeof(data));
+    CHECK_EQ(status_of(wait_response(HOST_TIMEOUT_MS), BOOT_CMD_BLOCK), e_boot_err_sequence);
+
+    /* Frames stop mid-block: timeout after one to two Timer1 periods */
+    send_block_header(BOOT_APP_BASE, BOOT_BLOCK_FRAMES, crc_of(g_image_b, BOOT_BLOCK_SIZE));
+    for (uint8_t i = 0; i < BOOT_BLOCK_FRAMES / 2U; i++)
+    {
+        host_send(BOOT_DATA_ID, &g_image_b[i * 8U], 8);
+    }
+
+    f = wait_response(HOST_TIMEOUT_MS);
+    CHECK_EQ(status_of(f, BOOT_CMD_BLOCK), e_boot_err_timeout);
+    if (f != NULL)
+    {
+        gap = f->at - g_bus_at;
+        printf("  data timeout after %llu ms\n", (unsigned long long)(gap / SIM_MS(1)));
+        CHECK(gap >= SIM_US(TIMER1_OVF_US));
+        CHECK(gap <= SIM_US(BOOT_DATA_TIMEOUT * TIMER1_OVF_US) + SIM_MS(1));
+    }
+
+    CHECK_EQ(g_sim.flash_erases, erases);
+    CHECK(app_is(g_image_a));
+    CHECK(boot_block_intact());
+
+    /* The session goes on: the block again, in full */
+    CHECK_EQ(host_write(g_image_b, 1), 1);
+    CHECK_EQ(memcmp(&g_sim_flash[BOOT_APP_BASE], g_image_b, BOOT_BLOCK_SIZE), 0);
+    CHECK_EQ(g_sim.can_rx_overflow, 0);
+}
+
+/*---------------------------------------------------------
+ * Interrupted updates
+ *---------------------------------------------------------*/
+static void test_interrupted_update(void)
+{
+    uint32_t tx;
+    uint64_t start;
+
+    setup();
+    power_on();
+    CHECK_EQ(host_connect(), e_boot_ok);
+    host_flash(g_image_a);
+
+    /* Valid image, no request: straight to it, not a frame sent */
+    tx = sim_can_tx_count();
+    power_on();
+    sim_node_run(SIM_MS(10));
+    CHECK_EQ(sim_node_goto(), BOOT_APP_BASE);
+    CHECK_EQ(sim_can_tx_count(), tx);
+
+    /* Requested (bootreq.c), nobody comes: back to the old image */
+    g_sim_eeprom[BOOT_EE_REQUEST] = BOOT_REQUEST;
+    power_on();
+    CHECK_EQ(status_of(wait_response(10), BOOT_CMD_CONNECT), e_boot_ok);
+    CHECK_EQ(g_sim_eeprom[BOOT_EE_REQUEST], 0xFF);
+
+    start = sim_now();
+    sim_node_run(SIM_MS(3000));
+    CHECK_EQ(sim_node_goto(), BOOT_APP_BASE);
+    CHECK(sim_now() - start >= SIM_US((BOOT_ENTRY_TIMEOUT - 1U) * TIMER1_OVF_US));
+    CHECK(sim_now() - start <= SIM_US(BOOT_ENTRY_TIMEOUT * TIMER1_OVF_US) + SIM_MS(10));
+    CHECK(app_is(g_image_a));
+
+    /* Host lost after a bad block: stays connected until a power
+     * cycle, which finds the old image still valid */
+    g_sim_eeprom[BOOT_EE_REQUEST] = BOOT_REQUEST;
+    power_on();
+    CHECK_EQ(status_of(wait_response(10), BOOT_CMD_CONNECT), e_boot_ok);
+    CHECK_EQ(host_connect(), e_boot_ok);
+    CHECK_EQ(host_block(BOOT_APP_BASE, g_image_b, (uint16_t)(crc_of(g_image_b, BOOT_BLOCK_SIZE) ^ 1U)),
+             e_boot_err_crc);
+
+    sim_node_run(SIM_MS(3000));
+    CHECK_EQ(sim_node_goto(), SIM_NO_GOTO);
+
+    power_on();
+    sim_node_run(SIM_MS(10));
+    CHECK_EQ(sim_node_goto(), BOOT_APP_BASE);
+    CHECK(app_is(g_image_a));
+
+    /* Power lost after some blocks of a new image: valid was
+     * cleared with the first erase, the node stays in the
+     * bootloader (no entry timeout) until the image is complete */
+    g_sim_eeprom[BOOT_EE_REQUEST] = BOOT_REQUEST;
+    power_on();
+    CHECK_EQ(status_of(wait_response(10), BOOT_CMD_CONNECT), e_boot_ok);
+    CHECK_EQ(host_connect(), e_boot_ok);
+    CHECK_EQ(host_write(g_image_b, 5), 5);
+
+    power_on();
+    CHECK_EQ(status_of(wait_response(10), BOOT_CMD_CONNECT), e_boot_ok);
+    CHECK(g_sim_eeprom[BOOT_EE_APP_VALID] != BOOT_APP_VALID);
+    CHECK_EQ(memcmp(&g_sim_flash[BOOT_APP_BASE], g_image_b, 5U * BOOT_BLOCK_SIZE), 0);
+
+    sim_node_run(SIM_MS(3000));
+    CHECK_EQ(sim_node_goto(), SIM_NO_GOTO);
+    CHECK_EQ(host_reset(), e_boot_err_no_image);
+
+    CHECK_EQ(host_connect(), e_boot_ok);
+    host_flash(g_image_b);
+    CHECK(app_is(g_image_b));
+    CHECK(boot_block_intact());
+    CHECK_EQ(g_sim.can_rx_overflow, 0);
+}
+
+int main(void)
+{
+    printf("Bootloader tests, node %d\n", BOOT_NODE_ID);
+
+    UNIT_RUN(test_crc);
+    UNIT_RUN(test_first_image);
+    UNIT_RUN(test_block_errors);
+    UNIT_RUN(test_interrupted_update);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,350 @@
+/***********************************************************************
+ *  File name   : test_calib.c
+ *  Description : Calibration set in data EEPROM (calib.c), built for
+ *                the nodes that have one (HAL_CALIB):
+ *                - blank EEPROM: compiled defaults
+ *                - store from the RAM cache, one byte per poll, then
+ *                  loaded back at the next boot; newer slot wins,
+ *                  sequence wraps
+ *                - layout versioning: newer, older than
+ *                  CALIB_OLDEST_VERSION or wrong length -> defaults
+ *                - corruption: a bad slot falls back to the other
+ *                  one, both bad -> defaults; a reset during a store
+ *                  leaves the previous block in charge
+ *                - range: a CRC-valid block the code cannot run with
+ *                  (zero divisor) -> defaults, never stored
+ *                - boot load time
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "crc8.h"
+#include "eeprom.h"
+#include "calib.h"
+
+UNIT_STATE
+
+/* Slot image offsets (calib.h) */
+#define SLOT_VERSION                0
+#define SLOT_SEQ                    1
+#define SLOT_LEN                    2
+#define SLOT_PAYLOAD                3
+
+/* Boot budget for calib_init(): two slots of EEPROM reads */
+#define LOAD_MAX_US                 100U
+
+/* poll() must never wait on the EEPROM */
+#define POLL_MAX_CYCLES             200U
+
+static const calib_t g_defaults = CALIB_DEFAULTS;
+
+/* Defaults with the first byte moved by 'k' */
+static calib_t calib_set(uint8_t k)
+{
+    calib_t set = g_defaults;
+
+    ((uint8_t *)&set)[0] += k;
+
+    return set;
+}
+
+static uint8_t calib_equal(const calib_t *a, const calib_t *b)
+{
+    return (uint8_t)(memcmp(a, b, sizeof(calib_t)) == 0);
+}
+
+/* Slot written straight into the EEPROM array, CRC over header + payload */
+static void write_slot(uint8_t base, uint8_t version, uint8_t seq,
+                       const void *payload, uint8_t len)
+{
+    uint8_t *slot = &g_sim_eeprom[base];
+
+    slot[SLOT_VERSION] = version;
+    slot[SLOT_SEQ]     = seq;
+    slot[SLOT_LEN]     = len;
+    memcpy(&slot[SLOT_PAYLOAD], payload, len);
+    slot[SLOT_PAYLOAD + len] = crc8(slot, (uint8_t)(SLOT_PAYLOAD + len));
+}
+
+/* Runs a store to the end; returns the worst calib_poll() cost */
+static uint16_t store(void)
+{
+    uint16_t worst = 0;
+
+    CHECK(calib_store_request());
+
+    while (calib_store_pending())
+    {
+        uint64_t at = sim_now();
+
+        calib_poll();
+
+        if (sim_now() - at > worst)
+        {
+            worst = (uint16_t)(sim_now() - at);
+        }
+
+        sim_advance(SIM_MS(1));
+    }
+
+    return worst;
+}
+
+/*---------------------------------------------------------
+ * Blank EEPROM
+ *---------------------------------------------------------*/
+static void test_blank(void)
+{
+    sim_init();
+    calib_init();
+
+    CHECK_EQ(g_calib_status, e_calib_default_blank);
+    CHECK(calib_equal(&g_calib, &g_defaults));
+    CHECK(!calib_store_pending());
+}
+
+/*---------------------------------------------------------
+ * Store and load back
+ *---------------------------------------------------------*/
+static void test_store_load(void)
+{
+    const calib_t first = calib_set(1);
+    const calib_t second = calib_set(2);
+    uint16_t      worst;
+
+    sim_init();
+    calib_init();
+
+    /* Live change, then persisted while the loop keeps polling */
+    g_calib = first;
+    worst   = store();
+    CHECK(worst <= POLL_MAX_CYCLES);
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_A + SLOT_SEQ], 1);
+
+    /* A second request is refused while one runs */
+    CHECK(calib_store_request());
+    CHECK(!calib_store_request());
+    while (calib_store_pending())
+    {
+        calib_poll();
+        sim_advance(SIM_MS(1));
+    }
+
+    g_calib = second;
+    store();
+
+    /* Slots alternate: A, B, then A again */
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_A + SLOT_SEQ], 3);
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_B + SLOT_SEQ], 2);
+
+    printf("  store of %u bytes: worst calib_poll() %u cycles\n",
+           (unsigned)(SLOT_PAYLOAD + sizeof(calib_t) + 1), worst);
+
+    /* Next boot */
+    g_calib = g_defaults;
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_loaded);
+    CHECK(calib_equal(&g_calib, &second));
+}
+
+/*---------------------------------------------------------
+ * Newer slot wins, across the sequence wrap
+ *---------------------------------------------------------*/
+static void test_sequence_wrap(void)
+{
+    const calib_t older = calib_set(3);
+    const calib_t newer = calib_set(4);
+
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 0xFF, &older, sizeof(calib_t));
+    write_slot(CALIB_SLOT_B, CALIB_LAYOUT_VERSION, 0x00, &newer, sizeof(calib_t));
+    calib_init();
+
+    CHECK_EQ(g_calib_status, e_calib_loaded);
+    CHECK(calib_equal(&g_calib, &newer));
+
+    /* The next store goes over the older slot */
+    store();
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_A + SLOT_SEQ], 0x01);
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_B + SLOT_SEQ], 0x00);
+}
+
+/*---------------------------------------------------------
+ * Layout versioning
+ *---------------------------------------------------------*/
+static void test_layout_version(void)
+{
+    const calib_t set = calib_set(5);
+    uint8_t       longer[sizeof(calib_t) + 1] = { 0 };
+
+    /* Written by a newer firmware */
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION + 1, 1, &set, sizeof(calib_t));
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_default_version);
+    CHECK(calib_equal(&g_calib, &g_defaults));
+
+    /* Older than anything migrated (v1 floats) */
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_OLDEST_VERSION - 1, 1, &set, sizeof(calib_t));
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_default_version);
+    CHECK(calib_equal(&g_calib, &g_defaults));
+
+    /* Current version, wrong length: not trusted */
+    sim_init();
+    memcpy(longer, &set, sizeof(calib_t));
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 1, longer, sizeof(longer));
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_default_version);
+    CHECK(calib_equal(&g_calib, &g_defaults));
+
+    /* A store after a version fallback writes the current layout */
+    store();
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_loaded);
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_B + SLOT_VERSION], CALIB_LAYOUT_VERSION);
+    CHECK_EQ(g_sim_eeprom[CALIB_SLOT_B + SLOT_LEN], sizeof(calib_t));
+}
+
+/*---------------------------------------------------------
+ * Corruption fallback
+ *---------------------------------------------------------*/
+static void test_corruption(void)
+{
+    const calib_t older = calib_set(6);
+    const calib_t newer = calib_set(7);
+
+    /* Newer slot damaged: the older one is used */
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 1, &older, sizeof(calib_t));
+    write_slot(CALIB_SLOT_B, CALIB_LAYOUT_VERSION, 2, &newer, sizeof(calib_t));
+    g_sim_eeprom[CALIB_SLOT_B + SLOT_PAYLOAD] ^= 0x10;
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_loaded);
+    CHECK(calib_equal(&g_calib, &older));
+
+    /* Both damaged: defaults, reported as a CRC failure */
+    g_sim_eeprom[CALIB_SLOT_A + SLOT_PAYLOAD + sizeof(calib_t)] ^= 0x01;
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_default_crc);
+    CHECK(calib_equal(&g_calib, &g_defaults));
+
+    /* Length byte out of range */
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 1, &older, sizeof(calib_t));
+    g_sim_eeprom[CALIB_SLOT_A + SLOT_LEN] = 0xF0;
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_default_crc);
+
+    /* Reset before the CRC byte of a store: the previous block stays */
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 1, &older, sizeof(calib_t));
+    calib_init();
+    g_calib = newer;
+    CHECK(calib_store_request());
+
+    for (uint8_t i = 0; i < SLOT_PAYLOAD + sizeof(calib_t); i++)
+    {
+        while (eeprom_busy())
+        {
+            sim_advance(SIM_MS(1));
+        }
+        calib_poll();
+    }
+
+    while (eeprom_busy())
+    {
+        sim_advance(SIM_MS(1));
+    }
+
+    g_calib = g_defaults;
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_loaded);
+    CHECK(calib_equal(&g_calib, &older));
+}
+
+/*---------------------------------------------------------
+ * Values out of range
+ *---------------------------------------------------------*/
+static void test_out_of_range(void)
+{
+    const calib_t good = calib_set(9);
+    calib_t       zero;
+
+    memset(&zero, 0, sizeof(zero));
+    CHECK(!CALIB_IN_RANGE(&zero));
+    CHECK(CALIB_IN_RANGE(&g_defaults));
+
+    /* Newest block CRC-valid but all zero: defaults, not the older one */
+    sim_init();
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 1, &good, sizeof(calib_t));
+    write_slot(CALIB_SLOT_B, CALIB_LAYOUT_VERSION, 2, &zero, sizeof(calib_t));
+    calib_init();
+    CHECK_EQ(g_calib_status, e_calib_default_range);
+    CHECK(calib_equal(&g_calib, &g_defaults));
+
+    /* Written live: the write is turned away, nothing is stored */
+    CHECK(!calib_write_ok((const uint8_t *)&g_calib, (const uint8_t *)&zero, sizeof(zero)));
+    CHECK(calib_write_ok((const uint8_t *)&g_calib, (const uint8_t *)&good, sizeof(good)));
+    CHECK(calib_write_ok((const uint8_t *)&zero, (const uint8_t *)&zero, sizeof(zero)));
+
+    g_calib = zero;
+    CHECK(!calib_store_request());
+    CHECK(!calib_store_pending());
+
+#if HAL_NODE_ID == 1
+    /* Per field: gear-up past reverse, reverse divisor zero */
+    g_calib = g_defaults;
+    g_calib.gear_max = 8;
+    CHECK(!CALIB_IN_RANGE(&g_calib));
+    g_calib = g_defaults;
+    g_calib.reverse_divisor = 0;
+    CHECK(!CALIB_IN_RANGE(&g_calib));
+#endif
+}
+
+/*---------------------------------------------------------
+ * Boot load time
+ *---------------------------------------------------------*/
+static void test_load_time(void)
+{
+    const calib_t set = calib_set(8);
+    uint16_t      blank;
+    uint16_t      both;
+
+    sim_init();
+    calib_init();
+    blank = g_calib_load_cycles;
+
+    write_slot(CALIB_SLOT_A, CALIB_LAYOUT_VERSION, 1, &set, sizeof(calib_t));
+    write_slot(CALIB_SLOT_B, CALIB_LAYOUT_VERSION, 2, &set, sizeof(calib_t));
+    calib_init();
+    both = g_calib_load_cycles;
+
+    printf("  calib_init(): %u cycles blank, %u cycles with two valid slots"
+           " (%u us, budget %u us)\n", blank, both,
+           (unsigned)(both / SIM_CYCLES_PER_US), LOAD_MAX_US);
+
+    CHECK_EQ(g_calib_status, e_calib_loaded);
+    CHECK(both > 0);
+    CHECK(both <= LOAD_MAX_US * SIM_CYCLES_PER_US);
+    CHECK(blank <= both);
+}
+
+int main(void)
+{
+    printf("Calibration tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_blank);
+    UNIT_RUN(test_store_load);
+    UNIT_RUN(test_sequence_wrap);
+    UNIT_RUN(test_layout_version);
+    UNIT_RUN(test_corruption);
+    UNIT_RUN(test_out_of_range);
+    UNIT_RUN(test_load_time);
+
+    return UNIT_RESULT();
+}
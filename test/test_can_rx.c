@@ -0,0 +1,385 @@
+/***********************************************************************
+ *  File name   : test_can_rx.c
+ *  Description : CAN receive with fuzzed frames, built per node:
+ *                - DLC 0..15 with random payloads: the length handed
+ *                  out is clamped to CAN_MAX_DLC, the bytes are the
+ *                  ones on the bus, nothing is written past a
+ *                  CAN_MAX_DLC buffer
+ *                - ECU3 (ring): a view stays valid until released,
+ *                  its slot is not reused meanwhile; the dashboard
+ *                  receive path takes fuzzed E2E frames; copying
+ *                  can_receive() against the zero-copy view, in
+ *                  model cycles and host time
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include <time.h>
+#include "unit.h"
+#include "node.h"
+#include "can.h"
+#include "msg_id.h"
+#include "xcp.h"
+
+#if HAL_CAN_RX_IRQ
+#include "irq.h"
+#endif
+
+#if HAL_NODE_ID == 3
+#include "e2e.h"
+#include "msg_handler.h"
+#include "signal_store.h"
+#endif
+
+UNIT_STATE
+
+#define FUZZ_FRAMES                 4000U
+#define GUARD_LEN                   8U
+#define GUARD_BYTE                  0xA5
+#define BENCH_ROUNDS                20000U
+
+/* Receive buffer with guard bytes behind it */
+typedef struct
+{
+    uint8_t data[CAN_MAX_DLC];
+    uint8_t guard[GUARD_LEN];
+} guarded_t;
+
+static uint32_t g_rand = 0x12345678UL;
+
+/* xorshift32: reproducible fuzz */
+static uint32_t fuzz_next(void)
+{
+    g_rand ^= g_rand << 13;
+    g_rand ^= g_rand >> 17;
+    g_rand ^= g_rand << 5;
+
+    return g_rand;
+}
+
+static void setup_can(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+
+#if HAL_CAN_RX_IRQ
+    init_irq();
+#endif
+
+    CHECK_EQ(init_can(), 1);
+}
+
+static void fuzz_payload(uint8_t *data, uint8_t *dlc)
+{
+    *dlc = (uint8_t)(fuzz_next() & 0x0F);
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        data[i] = (uint8_t)fuzz_next();
+    }
+}
+
+static uint8_t guard_intact(const guarded_t *buf)
+{
+    for (uint8_t i = 0; i < GUARD_LEN; i++)
+    {
+        if (buf->guard[i] != GUARD_BYTE)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Fuzzed DLC through can_receive()
+ *---------------------------------------------------------*/
+static void test_fuzz_receive(void)
+{
+    uint32_t per_dlc[16] = { 0 };
+    uint32_t bad_len = 0;
+    uint32_t bad_data = 0;
+    uint32_t overwritten = 0;
+
+    setup_can();
+
+    for (uint32_t n = 0; n < FUZZ_FRAMES; n++)
+    {
+        guarded_t buf;
+        uint8_t   sent[8];
+        uint8_t   dlc;
+        uint8_t   want;
+        uint16_t  id = 0;
+        uint8_t   len = 0;
+
+        fuzz_payload(sent, &dlc);
+        want = (dlc > CAN_MAX_DLC) ? CAN_MAX_DLC : dlc;
+
+        sim_can_rx(0, XCP_CRO_ID, sent, dlc);
+        sim_advance(SIM_US(10));
+
+        memset(&buf, GUARD_BYTE, sizeof(buf));
+        can_receive(&id, buf.data, &len);
+
+        /* DLC 0 hands out nothing: same as an empty poll */
+        if (dlc == 0)
+        {
+            bad_len += (len != 0);
+        }
+        else
+        {
+            bad_len  += (len != want || id != XCP_CRO_ID);
+            bad_data += (memcmp(buf.data, sent, want) != 0);
+        }
+
+        overwritten += !guard_intact(&buf);
+        per_dlc[dlc]++;
+    }
+
+    printf("  %u frames, DLC 0..15 (%u with DLC > 8): %u wrong lengths, %u wrong payloads,"
+           " %u buffer overruns\n", FUZZ_FRAMES,
+           FUZZ_FRAMES - (per_dlc[0] + per_dlc[1] + per_dlc[2] + per_dlc[3] + per_dlc[4] +
+                          per_dlc[5] + per_dlc[6] + per_dlc[7] + per_dlc[8]),
+           bad_len, bad_data, overwritten);
+
+    for (uint8_t dlc = 0; dlc < 16; dlc++)
+    {
+        CHECK(per_dlc[dlc] > 0);
+    }
+
+    CHECK_EQ(bad_len, 0);
+    CHECK_EQ(bad_data, 0);
+    CHECK_EQ(overwritten, 0);
+    CHECK(!can_rx_pending());
+}
+
+#if HAL_CAN_RX_IRQ
+/*---------------------------------------------------------
+ * Fuzzed DLC through the zero-copy view
+ *---------------------------------------------------------*/
+static void test_fuzz_view(void)
+{
+    uint32_t bad = 0;
+
+    setup_can();
+
+    for (uint32_t n = 0; n < FUZZ_FRAMES; n++)
+    {
+        can_rx_view_t view;
+        uint8_t       sent[8];
+        uint8_t       dlc;
+        uint8_t       want;
+
+        fuzz_payload(sent, &dlc);
+        want = (dlc > CAN_MAX_DLC) ? CAN_MAX_DLC : dlc;
+
+        sim_can_rx(0, XCP_CRO_ID, sent, dlc);
+        sim_advance(SIM_US(10));
+
+        CHECK(can_rx_acquire(&view));
+        bad += (view.len != want || view.id != XCP_CRO_ID ||
+                memcmp(view.data, sent, view.len) != 0);
+        can_rx_release(&view);
+
+        /* Released twice: no frame skipped */
+        can_rx_release(&view);
+        CHECK_EQ(view.len, 0);
+    }
+
+    CHECK_EQ(bad, 0);
+    CHECK(!can_rx_pending());
+}
+
+/*---------------------------------------------------------
+ * A held view is not overwritten
+ *---------------------------------------------------------*/
+static void test_view_held(void)
+{
+    const uint8_t first[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint8_t       other[8];
+    can_rx_view_t view;
+    can_rx_view_t next;
+
+    setup_can();
+
+    sim_can_rx(0, XCP_CRO_ID, first, sizeof(first));
+    sim_advance(SIM_US(10));
+    CHECK(can_rx_acquire(&view));
+
+    /* The bus keeps delivering until the ring is full and beyond */
+    memset(other, 0xEE, sizeof(other));
+
+    for (uint8_t i = 0; i < CAN_RX_RING_SIZE + 2; i++)
+    {
+        sim_can_rx(0, (uint16_t)(0x100 + i), other, sizeof(other));
+        sim_advance(SIM_US(10));
+    }
+
+    CHECK_EQ(view.len, 8);
+    CHECK(memcmp(view.data, first, sizeof(first)) == 0);
+
+    /* One slot is kept free, the held one is not handed out again */
+    CHECK_EQ(g_can_rx_overruns, 4);
+    CHECK(can_rx_acquire(&next));
+    CHECK_EQ(next.id, XCP_CRO_ID);
+    CHECK(next.data == view.data);
+
+    can_rx_release(&view);
+    CHECK(can_rx_acquire(&next));
+    CHECK_EQ(next.id, 0x100);
+    can_rx_release(&next);
+}
+
+/*---------------------------------------------------------
+ * Copy against view: model cycles and host time
+ *---------------------------------------------------------*/
+static double host_ns(clock_t elapsed, unsigned long count)
+{
+    return (double)elapsed * 1e9 / CLOCKS_PER_SEC / count;
+}
+
+/* Fills the ring (ISR) with full frames */
+static void fill_ring(void)
+{
+    const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+    for (uint8_t i = 0; i < CAN_RX_RING_SIZE - 1; i++)
+    {
+        sim_can_rx(0, XCP_CRO_ID, data, sizeof(data));
+        sim_advance(SIM_US(10));
+    }
+}
+
+static void test_copy_vs_view(void)
+{
+    const uint32_t frames = BENCH_ROUNDS * (CAN_RX_RING_SIZE - 1);
+    uint8_t        data[CAN_MAX_DLC];
+    uint16_t       id;
+    uint8_t        len;
+    uint32_t       sum = 0;
+    uint64_t       copy_cycles = 0;
+    uint64_t       view_cycles = 0;
+    clock_t        copy_time = 0;
+    clock_t        view_time = 0;
+    clock_t        start;
+    uint64_t       at;
+
+    setup_can();
+
+    for (uint32_t r = 0; r < BENCH_ROUNDS; r++)
+    {
+        can_rx_view_t view;
+
+        fill_ring();
+        at    = sim_now();
+        start = clock();
+        for (uint8_t i = 0; i < CAN_RX_RING_SIZE - 1; i++)
+        {
+            can_receive(&id, data, &len);
+            sum += data[len - 1];
+        }
+        copy_time   += clock() - start;
+        copy_cycles += sim_now() - at;
+
+        fill_ring();
+        at    = sim_now();
+        start = clock();
+        for (uint8_t i = 0; i < CAN_RX_RING_SIZE - 1; i++)
+        {
+            can_rx_acquire(&view);
+            sum += view.data[view.len - 1];
+            can_rx_release(&view);
+        }
+        view_time   += clock() - start;
+        view_cycles += sim_now() - at;
+    }
+
+    printf("  per 8-byte frame: can_receive %.1f ns (copies %u bytes), view %.1f ns"
+           " (0 bytes); model cycles %.1f / %.1f\n",
+           host_ns(copy_time, frames), CAN_MAX_DLC,
+           host_ns(view_time, frames),
+           (double)copy_cycles / frames, (double)view_cycles / frames);
+
+    CHECK_EQ(sum, 2 * frames * 8);
+
+    /* Both read the RAM ring only: the register model charges the
+     * receive probe (Timer1 reads) and not the copy, so the cycles
+     * match; host time shows the copy (noisy, not checked) */
+    CHECK_EQ(view_cycles, copy_cycles);
+}
+#endif
+
+#if HAL_NODE_ID == 3
+/*---------------------------------------------------------
+ * Dashboard receive path with fuzzed frames: E2E-protected
+ * random payloads of every length, some with a DLC field
+ * above 8, then the render task
+ *---------------------------------------------------------*/
+static void test_fuzz_dashboard(void)
+{
+    static const uint16_t ids[] =
+    {
+        SPEED_MSG_ID, GEAR_MSG_ID, RPM_MSG_ID, ENG_TEMP_MSG_ID, INDICATOR_MSG_ID
+    };
+    e2e_tx_t tx[sizeof(ids) / sizeof(ids[0])];
+    uint32_t handled = 0;
+    signal_t entry;
+
+    setup_can();
+    init_msg_handler();
+    msg_handler_display_ready();
+    memset(tx, 0, sizeof(tx));
+
+    for (uint32_t n = 0; n < FUZZ_FRAMES; n++)
+    {
+        uint8_t k = (uint8_t)(fuzz_next() % (sizeof(ids) / sizeof(ids[0])));
+        uint8_t payload[CAN_MAX_DLC];
+        uint8_t frame[CAN_MAX_DLC];
+        uint8_t len;
+        uint8_t dlc;
+
+        fuzz_payload(payload, &dlc);
+        len = e2e_protect(&tx[k], ids[k], frame, payload, (uint8_t)(dlc % (CAN_MAX_DLC - E2E_HEADER_LEN + 1)));
+
+        /* One in four with a DLC field of 9..15 */
+        if ((fuzz_next() & 3) == 0)
+        {
+            len = (uint8_t)(9 + fuzz_next() % 7);
+        }
+
+        sim_can_rx(0, ids[k], frame, len);
+        sim_advance(SIM_US(10));
+
+        process_canbus_data();
+        msg_handler_render_poll();
+        handled += !can_rx_pending();
+    }
+
+    CHECK_EQ(handled, FUZZ_FRAMES);
+    CHECK_EQ(g_can_rx_overruns, 0);
+
+    /* Decoded values stay in their ranges */
+    signal_read(e_sig_gear, &entry);
+    CHECK(!entry.valid || entry.value < 9);
+    signal_read(e_sig_indicator, &entry);
+    CHECK(!entry.valid || entry.value <= e_ind_hazard);
+}
+#endif
+
+int main(void)
+{
+    printf("CAN receive tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_fuzz_receive);
+#if HAL_CAN_RX_IRQ
+    UNIT_RUN(test_fuzz_view);
+    UNIT_RUN(test_view_held);
+    UNIT_RUN(test_copy_vs_view);
+#endif
+#if HAL_NODE_ID == 3
+    UNIT_RUN(test_fuzz_dashboard);
+#endif
+
+    return UNIT_RESULT();
+}
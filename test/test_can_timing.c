@@ -0,0 +1,337 @@
+/***********************************************************************
+ *  File name   : test_can_timing.c
+ *  Description : Compile-time ECAN bit-timing solver (can_timing.h),
+ *                run for every oscillator / bit rate pair below that
+ *                has an exact solution. The registers it produces
+ *                are decoded and checked against the PIC18F4580
+ *                datasheet rules (ECAN bit timing):
+ *                - Fosc = 2 * BRP * (1 + Prop + PS1 + PS2) * bit rate
+ *                - 1 <= BRP <= 64, 8 <= N <= 25 quanta per bit
+ *                - Prop, PS1 1..8; PS2 2..8, PS2 <= Prop + PS1
+ *                - 1 <= SJW <= 4, SJW <= PS2; PS2 programmable
+ *                and the sample point is the best the split rule
+ *                reaches for that pair. Pairs with no solution stop
+ *                the build (Makefile: timing_errors).
+ *
+ ***********************************************************************/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "unit.h"
+#include "node.h"
+#include "can.h"
+#include "clock.h"
+#include "can_timing.h"
+
+UNIT_STATE
+
+typedef struct
+{
+    uint32_t fosc;
+    uint32_t bitrate;
+    uint8_t  brgcon[3];
+    uint16_t sample_point;
+} timing_case_t;
+
+static timing_case_t g_cases[64];
+static uint8_t       g_case_count;
+
+/* The node's own configuration, as can.c builds it */
+static const uint8_t g_node_brgcon[3] = { CAN_BRGCON1, CAN_BRGCON2, CAN_BRGCON3 };
+
+static void collect_cases(void)
+{
+#pragma push_macro("_XTAL_FREQ")
+#pragma push_macro("CAN_BITRATE")
+#undef _XTAL_FREQ
+#undef CAN_BITRATE
+
+#define _XTAL_FREQ  4000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  4000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  4000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  8000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  8000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  8000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  8000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  10000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  10000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  10000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  10000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  12000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  12000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  12000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  12000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  16000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  16000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  16000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  16000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  16000000UL
+#define CAN_BITRATE 800000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  16000000UL
+#define CAN_BITRATE 1000000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  20000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  20000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  20000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  20000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  20000000UL
+#define CAN_BITRATE 1000000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  24000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  24000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  24000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  24000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  24000000UL
+#define CAN_BITRATE 800000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  24000000UL
+#define CAN_BITRATE 1000000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  25000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  25000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  25000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  25000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  32000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  32000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  32000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  32000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  32000000UL
+#define CAN_BITRATE 800000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  32000000UL
+#define CAN_BITRATE 1000000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  40000000UL
+#define CAN_BITRATE 100000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  40000000UL
+#define CAN_BITRATE 125000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  40000000UL
+#define CAN_BITRATE 250000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  40000000UL
+#define CAN_BITRATE 500000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  40000000UL
+#define CAN_BITRATE 800000UL
+#include "can_timing_case.h"
+
+#define _XTAL_FREQ  40000000UL
+#define CAN_BITRATE 1000000UL
+#include "can_timing_case.h"
+
+#pragma pop_macro("_XTAL_FREQ")
+#pragma pop_macro("CAN_BITRATE")
+}
+
+/* Sample point (per mille) of the solver's segment split for N quanta */
+static uint16_t split_sample_point(uint32_t n)
+{
+    uint32_t ps2 = (n >= 20) ? n - 17 : 2;
+
+    return (uint16_t)((n - ps2) * 1000 / n);
+}
+
+/*---------------------------------------------------------
+ * Every pair against the datasheet rules
+ *---------------------------------------------------------*/
+static void test_sweep(void)
+{
+    collect_cases();
+
+    printf("  %-9s %-9s BRP  N Prop PS1 PS2 SJW  sample\n", "Fosc", "bit/s");
+
+    for (uint8_t i = 0; i < g_case_count; i++)
+    {
+        const timing_case_t *c = &g_cases[i];
+        uint32_t sjw  = (c->brgcon[0] >> 6) + 1U;
+        uint32_t brp  = (c->brgcon[0] & 0x3FU) + 1U;
+        uint32_t prop = (c->brgcon[1] & 0x07U) + 1U;
+        uint32_t ps1  = ((c->brgcon[1] >> 3) & 0x07U) + 1U;
+        uint32_t ps2  = (c->brgcon[2] & 0x07U) + 1U;
+        uint32_t n    = 1 + prop + ps1 + ps2;
+        uint32_t err  = abs((int)c->sample_point - 875);
+
+        printf("  %-9u %-9u %3u %2u %4u %3u %3u %3u  %3u.%u %%\n",
+               c->fosc, c->bitrate, brp, n, prop, ps1, ps2, sjw,
+               c->sample_point / 10, c->sample_point % 10);
+
+        /* Exact bit rate */
+        CHECK_EQ(c->fosc, 2ULL * brp * n * c->bitrate);
+
+        /* Register ranges and segment rules */
+        CHECK(n >= 8 && n <= 25);
+        CHECK(ps2 >= 2);
+        CHECK(ps2 <= prop + ps1);
+        CHECK(sjw >= 1 && sjw <= 4 && sjw <= ps2);
+        CHECK(c->brgcon[1] & 0x80);                 /* SEG2PHTS: PS2 as programmed */
+        CHECK_EQ(c->brgcon[1] & 0x40, 0);           /* SAM: one sample */
+        CHECK_EQ(c->brgcon[2] & 0xF8, 0);
+
+        /* Reported sample point is the one programmed */
+        CHECK_EQ(c->sample_point, (n - ps2) * 1000 / n);
+
+        /* No other N the prescaler allows does better */
+        for (uint32_t m = 8; m <= 25; m++)
+        {
+            uint32_t budget = c->fosc / (2 * c->bitrate);
+
+            if (budget % m == 0 && budget / m <= 64)
+            {
+                CHECK(err <= (uint32_t)abs((int)split_sample_point(m) - 875));
+            }
+        }
+    }
+
+    CHECK(g_case_count >= 40);
+}
+
+/*---------------------------------------------------------
+ * This node's configuration and the simulated bus
+ *---------------------------------------------------------*/
+static void test_node_config(void)
+{
+    uint32_t brp = (g_node_brgcon[0] & 0x3FU) + 1U;
+    uint32_t n   = 1 + (g_node_brgcon[1] & 0x07U) + 1 + ((g_node_brgcon[1] >> 3) & 0x07U) + 1 +
+                   (g_node_brgcon[2] & 0x07U) + 1;
+
+    CHECK_EQ((uint64_t)_XTAL_FREQ, 2ULL * brp * n * CAN_BITRATE);
+
+    /* The simulator's bit time matches (Fosc / 4 cycles per bit) */
+    CHECK_EQ(SIM_CAN_CYCLES_PER_BIT * CAN_BITRATE, _XTAL_FREQ / 4);
+
+    /* Registers as init_can() leaves them */
+    sim_init();
+    CHECK(init_can());
+    CHECK_EQ(BRGCON1, g_node_brgcon[0]);
+    CHECK_EQ(BRGCON2, g_node_brgcon[1]);
+    CHECK_EQ(BRGCON3, g_node_brgcon[2]);
+}
+
+int main(void)
+{
+    printf("CAN bit timing tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_sweep);
+    UNIT_RUN(test_node_config);
+
+    return UNIT_RESULT();
+}
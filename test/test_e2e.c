@@ -0,0 +1,418 @@
+/***********************************************************************
+ *  File name   : test_e2e.c
+ *  Description : CRC-8 / E2E protection.
+ *                - The lookup table against the bitwise CRC-8
+ *                  (poly 0x1D) it replaces, equal results and host
+ *                  cost per byte of both
+ *                - Exhaustive error detection over a full 8-byte
+ *                  protected frame: every 1, 2, 3 and 4 bit error
+ *                  and every burst up to 8 bits
+ *                - ECU3: repeated, skipped and CRC-failed counters
+ *                  as frames go through the message handler
+ *
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unit.h"
+#include "node.h"
+#include "crc8.h"
+#include "e2e.h"
+#include "msg_id.h"
+
+#if HAL_NODE_ID == 3
+#include "irq.h"
+#include "tick.h"
+#include "can.h"
+#include "msg_handler.h"
+#include "signal_store.h"
+#endif
+
+UNIT_STATE
+
+#define FRAME_LEN                   8U
+#define FRAME_BITS                  (FRAME_LEN * 8U)
+#define BENCH_BYTES                 (16UL * 1024UL * 1024UL)
+#define BURST_MAX                   8U
+#define CRC8_POLY                   0x1D
+
+static volatile uint8_t g_sink;
+
+/* The shift-and-XOR CRC-8 the table replaces, 8 steps per byte */
+static uint8_t crc8_bitwise(uint8_t crc, const uint8_t *data, uint8_t len)
+{
+    while (len--)
+    {
+        crc ^= *data++;
+
+        for (uint8_t b = 0; b < 8; b++)
+        {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ CRC8_POLY) : (uint8_t)(crc << 1);
+        }
+    }
+
+    return crc;
+}
+
+static double host_ns(clock_t start, unsigned long count)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / count;
+}
+
+/*---------------------------------------------------------
+ * Table against bitwise CRC
+ *---------------------------------------------------------*/
+static void test_table_vs_bitwise(void)
+{
+    uint8_t buf[FRAME_LEN - 1];
+    uint8_t crc = CRC8_INIT;
+    clock_t start;
+    double  table_ns;
+    double  bitwise_ns;
+    uint8_t mismatch = 0;
+
+    /* Every single byte from every start value */
+    for (uint16_t init = 0; init < 256; init++)
+    {
+        for (uint16_t b = 0; b < 256; b++)
+        {
+            uint8_t byte = (uint8_t)b;
+
+            mismatch |= (crc8_update((uint8_t)init, &byte, 1) !=
+                         crc8_bitwise((uint8_t)init, &byte, 1));
+        }
+    }
+
+    CHECK_EQ(mismatch, 0);
+    CHECK_EQ(crc8_bitwise(CRC8_INIT, (const uint8_t *)"123456789", 9) ^ CRC8_XOR_OUT, 0x4B);
+
+    /* E2E-sized blocks (data ID excluded), chained */
+    srand(33);
+    for (uint8_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = (uint8_t)rand();
+    }
+
+    start = clock();
+    for (unsigned long n = 0; n < BENCH_BYTES / sizeof(buf); n++)
+    {
+        buf[0] = (uint8_t)n;
+        crc    = crc8_update(crc, buf, sizeof(buf));
+    }
+    table_ns = host_ns(start, BENCH_BYTES);
+    g_sink   = crc;
+
+    crc   = CRC8_INIT;
+    start = clock();
+    for (unsigned long n = 0; n < BENCH_BYTES / sizeof(buf); n++)
+    {
+        buf[0] = (uint8_t)n;
+        crc    = crc8_bitwise(crc, buf, sizeof(buf));
+    }
+    bitwise_ns = host_ns(start, BENCH_BYTES);
+
+    printf("  host: table %.2f ns/byte, bitwise %.2f ns/byte (%.1fx)\n",
+           table_ns, bitwise_ns, bitwise_ns / table_ns);
+
+    /* Same chained result, and the table is the cheaper one */
+    CHECK_EQ(crc, g_sink);
+    CHECK(table_ns < bitwise_ns);
+}
+
+/*---------------------------------------------------------
+ *  Error detection helpers
+ *---------------------------------------------------------*/
+static uint8_t  g_frame[FRAME_LEN];
+static e2e_rx_t g_rx_synced;
+
+/* A protected 6-byte payload, receiver synced to the counter before */
+static void protect_frame(void)
+{
+    const uint8_t payload[FRAME_LEN - E2E_HEADER_LEN] = { '1', '2', '3', 0x5A, 0xC3, 0x00 };
+    e2e_tx_t      tx = { 7 };
+
+    memset(&g_rx_synced, 0, sizeof(g_rx_synced));
+    g_rx_synced.synced       = 1;
+    g_rx_synced.last_counter = 6;
+
+    CHECK_EQ(e2e_protect(&tx, SPEED_MSG_ID, g_frame, payload, sizeof(payload)), FRAME_LEN);
+}
+
+/* 1 if the frame with the bits in mask[] flipped is rejected */
+static uint8_t detected(const uint8_t *mask)
+{
+    uint8_t  frame[FRAME_LEN];
+    e2e_rx_t rx = g_rx_synced;
+
+    for (uint8_t i = 0; i < FRAME_LEN; i++)
+    {
+        frame[i] = g_frame[i] ^ mask[i];
+    }
+
+    return (e2e_check(&rx, SPEED_MSG_ID, frame, FRAME_LEN) == e_e2e_crc_error);
+}
+
+/* Bit n in bus order (CRC byte first) or in CRC order (bytes 1..7,
+ * then the CRC byte, as the polynomial sees them) */
+static void flip(uint8_t *mask, uint8_t bit)
+{
+    mask[bit >> 3] ^= (uint8_t)(0x80 >> (bit & 7));
+}
+
+static void flip_crc_order(uint8_t *mask, uint8_t bit)
+{
+    flip(mask, (uint8_t)((bit + 8) % FRAME_BITS));
+}
+
+/*---------------------------------------------------------
+ * Exhaustive error detection
+ *---------------------------------------------------------*/
+static void test_error_detection(void)
+{
+    uint8_t  mask[FRAME_LEN];
+    uint32_t tried[5]  = { 0 };
+    uint32_t missed[5] = { 0 };
+    uint32_t bursts[2] = { 0 };
+    uint32_t bursts_missed[2] = { 0 };
+    uint32_t boundary = 0;
+    e2e_rx_t rx;
+
+    protect_frame();
+
+    /* Intact frame passes */
+    rx = g_rx_synced;
+    CHECK_EQ(e2e_check(&rx, SPEED_MSG_ID, g_frame, FRAME_LEN), e_e2e_ok);
+
+    /* Every combination of 1..4 flipped bits */
+    for (uint8_t a = 0; a < FRAME_BITS; a++)
+    {
+        memset(mask, 0, sizeof(mask));
+        flip(mask, a);
+        tried[1]++;
+        missed[1] += !detected(mask);
+
+        for (uint8_t b = a + 1; b < FRAME_BITS; b++)
+        {
+            flip(mask, b);
+            tried[2]++;
+            missed[2] += !detected(mask);
+
+            for (uint8_t c = b + 1; c < FRAME_BITS; c++)
+            {
+                flip(mask, c);
+                tried[3]++;
+                missed[3] += !detected(mask);
+
+                for (uint8_t d = c + 1; d < FRAME_BITS; d++)
+                {
+                    flip(mask, d);
+                    tried[4]++;
+                    missed[4] += !detected(mask);
+                    flip(mask, d);
+                }
+
+                flip(mask, c);
+            }
+
+            flip(mask, b);
+        }
+    }
+
+    /* Bursts: first and last bit flipped, any bits in between,
+     * counted in CRC order and in bus order */
+    for (uint8_t order = 0; order <= 1; order++)
+    {
+        void (*flip_at)(uint8_t *, uint8_t) = order ? flip : flip_crc_order;
+
+        for (uint8_t len = 1; len <= BURST_MAX; len++)
+        {
+            for (uint8_t start = 0; start + len <= FRAME_BITS; start++)
+            {
+                uint16_t inner = (len > 2) ? (uint16_t)(1U << (len - 2)) : 1U;
+
+                for (uint16_t p = 0; p < inner; p++)
+                {
+                    memset(mask, 0, sizeof(mask));
+                    flip_at(mask, start);
+                    if (len > 1)
+                    {
+                        flip_at(mask, (uint8_t)(start + len - 1));
+                    }
+                    for (uint8_t i = 0; len > 2 && i < len - 2; i++)
+                    {
+                        if (p & (1U << i))
+                        {
+                            flip_at(mask, (uint8_t)(start + 1 + i));
+                        }
+                    }
+
+                    bursts[order]++;
+                    if (!detected(mask))
+                    {
+                        bursts_missed[order]++;
+                        /* Only across the CRC byte / counter byte edge */
+                        boundary += (order == 1 && start < 8 && start + len > 8);
+                    }
+                }
+            }
+        }
+    }
+
+    for (uint8_t n = 1; n <= 4; n++)
+    {
+        printf("  %u-bit errors: %7u tried, %5u undetected\n", n, tried[n], missed[n]);
+    }
+    printf("  bursts <= %u bits: %u tried, %u undetected in CRC order, %u in bus order\n",
+           BURST_MAX, bursts[0], bursts_missed[0], bursts_missed[1]);
+
+    /*
+     * Hamming distance 3 over the 64-bit frame: every 1 and 2 bit
+     * error is caught, 3 and 4 bit errors with about the 2^-8 of a
+     * random pattern
+     */
+    CHECK_EQ(tried[1], FRAME_BITS);
+    CHECK_EQ(missed[1], 0);
+    CHECK_EQ(missed[2], 0);
+    CHECK(missed[3] < tried[3] / 128);
+    CHECK(missed[4] < tried[4] / 128);
+
+    /*
+     * Every burst no longer than the CRC, as the polynomial sees the
+     * frame. On the bus the CRC byte goes first, so a burst over its
+     * end and the counter byte is split into two and can slip through.
+     */
+    CHECK_EQ(bursts_missed[0], 0);
+    CHECK_EQ(bursts_missed[1], boundary);
+
+    /* Right bytes, other message: the data ID is protected too */
+    rx = g_rx_synced;
+    CHECK_EQ(e2e_check(&rx, RPM_MSG_ID, g_frame, FRAME_LEN), e_e2e_crc_error);
+}
+
+#if HAL_NODE_ID == 3
+/*---------------------------------------------------------
+ *  ECU3 receive path helpers
+ *---------------------------------------------------------*/
+static e2e_tx_t g_speed_tx;
+
+/* Protected SPEED frame "nnn" on the bus, then handled */
+static void speed_frame(uint16_t speed, uint8_t corrupt)
+{
+    uint8_t       frame[CAN_MAX_DLC];
+    unsigned char text[3];
+    uint8_t       len;
+
+    text[0] = (unsigned char)('0' + speed / 100 % 10);
+    text[1] = (unsigned char)('0' + speed / 10 % 10);
+    text[2] = (unsigned char)('0' + speed % 10);
+    len = e2e_protect(&g_speed_tx, SPEED_MSG_ID, frame, text, sizeof(text));
+    frame[3] ^= corrupt;
+
+    sim_can_rx(0, SPEED_MSG_ID, frame, len);
+    sim_advance(SIM_US(500));
+    process_canbus_data();
+}
+
+static uint16_t shown_speed(void)
+{
+    signal_t speed;
+
+    signal_read(e_sig_speed, &speed);
+    return speed.value;
+}
+
+/*---------------------------------------------------------
+ * ECU3 counters
+ *---------------------------------------------------------*/
+static void test_counters(void)
+{
+    e2e_rx_t *rx = &g_e2e_rx[0];
+    uint8_t   counter;
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+    CHECK_EQ(init_can(), 1);
+    init_msg_handler();
+    memset(g_e2e_rx, 0, sizeof(g_e2e_rx));
+    memset(&g_speed_tx, 0, sizeof(g_speed_tx));
+
+    CHECK_EQ(SPEED_MSG_ID >> 4, 1);
+
+    /* In order, across the counter wrap */
+    for (uint16_t v = 1; v <= 2 * (E2E_COUNTER_MAX + 1); v++)
+    {
+        speed_frame(v, 0);
+        CHECK_EQ(shown_speed(), v);
+    }
+    CHECK_EQ(rx->repeated, 0);
+    CHECK_EQ(rx->skipped, 0);
+    CHECK_EQ(rx->crc_failed, 0);
+
+    /* Stuck sender: the same counter again is dropped */
+    counter = g_speed_tx.counter;
+    g_speed_tx.counter = (counter == 0) ? E2E_COUNTER_MAX : (uint8_t)(counter - 1);
+    speed_frame(500, 0);
+    CHECK_EQ(rx->repeated, 1);
+    CHECK_EQ(shown_speed(), 30);
+
+    /* One frame lost: counted, payload used */
+    g_speed_tx.counter = (counter >= E2E_COUNTER_MAX) ? 0 : (uint8_t)(counter + 1);
+    speed_frame(31, 0);
+    CHECK_EQ(rx->skipped, 1);
+    CHECK_EQ(shown_speed(), 31);
+
+    /* Three lost: counted, payload dropped, next in order accepted */
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        g_speed_tx.counter = (g_speed_tx.counter >= E2E_COUNTER_MAX) ? 0 :
+                             (uint8_t)(g_speed_tx.counter + 1);
+    }
+    speed_frame(40, 0);
+    CHECK_EQ(rx->skipped, 4);
+    CHECK_EQ(shown_speed(), 31);
+    speed_frame(41, 0);
+    CHECK_EQ(shown_speed(), 41);
+
+    /* Corrupted on the bus: the next frame shows it as lost */
+    speed_frame(99, 0x01);
+    CHECK_EQ(rx->crc_failed, 1);
+    CHECK_EQ(shown_speed(), 41);
+    speed_frame(42, 0);
+    CHECK_EQ(rx->skipped, 5);
+    CHECK_EQ(shown_speed(), 42);
+
+    /* Corrupted and repeated in order: nothing lost */
+    speed_frame(98, 0x80);
+    g_speed_tx.counter = (g_speed_tx.counter == 0) ? E2E_COUNTER_MAX :
+                         (uint8_t)(g_speed_tx.counter - 1);
+    speed_frame(43, 0);
+    CHECK_EQ(rx->crc_failed, 2);
+    CHECK_EQ(rx->skipped, 5);
+    CHECK_EQ(shown_speed(), 43);
+
+    /* Other slots untouched */
+    for (uint8_t s = 1; s < E2E_RX_SLOTS; s++)
+    {
+        CHECK_EQ(g_e2e_rx[s].repeated + g_e2e_rx[s].skipped + g_e2e_rx[s].crc_failed, 0);
+    }
+
+    printf("  SPEED: %u repeated, %u skipped, %u CRC failed\n",
+           rx->repeated, rx->skipped, rx->crc_failed);
+}
+#endif
+
+int main(void)
+{
+    printf("E2E tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_table_vs_bitwise);
+    UNIT_RUN(test_error_detection);
+#if HAL_NODE_ID == 3
+    UNIT_RUN(test_counters);
+#endif
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,409 @@
+/***********************************************************************
+ *  File name   : test_hal.c
+ *  Description : Unit tests of the shared modules (HAL/), built once
+ *                per node so every hal_cfg.h / node_cfg.h variant is
+ *                covered: polled and interrupt driven CAN receive,
+ *                node acceptance filters, IDs derived from
+ *                HAL_NODE_ID, CRC-8 / E2E, data EEPROM, boot request.
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "can.h"
+#include "crc8.h"
+#include "e2e.h"
+#include "eeprom.h"
+#include "bootreq.h"
+#include "nm.h"
+#include "xcp.h"
+#include "msg_id.h"
+#include "timesync.h"
+
+#if HAL_CAN_RX_IRQ
+#include "irq.h"
+#endif
+
+UNIT_STATE
+
+/*---------------------------------------------------------
+ * Fresh model with CAN running (and the RX interrupt
+ * where the node uses it)
+ *---------------------------------------------------------*/
+static void setup_can(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+
+#if HAL_CAN_RX_IRQ
+    init_irq();
+#endif
+
+    CHECK_EQ(init_can(), 1);
+}
+
+/* Bus frame to the node, then enough time for it to land */
+static void bus_send(uint16_t id, const uint8_t *data, uint8_t dlc)
+{
+    sim_can_rx(0, id, data, dlc);
+    sim_advance(SIM_US(10));
+}
+
+/* 1 if the node received a frame, with its contents */
+static uint8_t node_receive(uint16_t *id, uint8_t *data, uint8_t *len)
+{
+    can_receive(id, data, len);
+
+    return (uint8_t)(*len != 0);
+}
+
+/*---------------------------------------------------------
+ * CRC-8 SAE J1850
+ *---------------------------------------------------------*/
+static void test_crc8(void)
+{
+    const uint8_t check[] = "123456789";
+    uint8_t       crc;
+
+    /* Catalogue check value of CRC-8/SAE-J1850 */
+    CHECK_EQ(crc8(check, 9), 0x4B);
+
+    crc = crc8_update(CRC8_INIT, check, 4);
+    crc = crc8_update(crc, &check[4], 5);
+    CHECK_EQ(crc ^ CRC8_XOR_OUT, 0x4B);
+}
+
+/*---------------------------------------------------------
+ * E2E protect / check
+ *---------------------------------------------------------*/
+static void test_e2e(void)
+{
+    const uint8_t payload[4] = { 1, 2, 3, 4 };
+    e2e_tx_t      tx = { 0 };
+    e2e_rx_t      rx;
+    uint8_t       frame[8];
+    uint8_t       len = 0;
+
+    memset(&rx, 0, sizeof(rx));
+
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        len = e2e_protect(&tx, 0x123, frame, payload, sizeof(payload));
+        CHECK_EQ(len, sizeof(payload) + E2E_HEADER_LEN);
+        CHECK_EQ(e2e_check(&rx, 0x123, frame, len), (i == 0) ? e_e2e_initial : e_e2e_ok);
+    }
+
+    /* Same frame again */
+    CHECK_EQ(e2e_check(&rx, 0x123, frame, len), e_e2e_repeated);
+    CHECK_EQ(rx.repeated, 1);
+
+    /* One frame lost */
+    e2e_protect(&tx, 0x123, frame, payload, sizeof(payload));
+    len = e2e_protect(&tx, 0x123, frame, payload, sizeof(payload));
+    CHECK_EQ(e2e_check(&rx, 0x123, frame, len), e_e2e_ok_some_lost);
+    CHECK_EQ(rx.skipped, 1);
+
+    /* Corrupted payload, wrong data ID */
+    len = e2e_protect(&tx, 0x123, frame, payload, sizeof(payload));
+    frame[3] ^= 0x10;
+    CHECK_EQ(e2e_check(&rx, 0x123, frame, len), e_e2e_crc_error);
+    frame[3] ^= 0x10;
+    CHECK_EQ(e2e_check(&rx, 0x124, frame, len), e_e2e_crc_error);
+    CHECK_EQ(rx.crc_failed, 2);
+}
+
+/*---------------------------------------------------------
+ * Data EEPROM: timed write, read back
+ *---------------------------------------------------------*/
+static void test_eeprom(void)
+{
+    uint64_t start;
+
+    sim_init();
+
+    CHECK_EQ(eeprom_read(0x10), 0xFF);
+
+    start = sim_now();
+    eeprom_write_start(0x10, 0xA5);
+    CHECK(eeprom_busy());
+
+    while (eeprom_busy())
+    {
+        ;
+    }
+
+    /* Datasheet byte write time */
+    CHECK(sim_now() - start >= SIM_MS(4));
+    CHECK(sim_now() - start < SIM_MS(4) + SIM_US(10));
+    CHECK_EQ(eeprom_read(0x10), 0xA5);
+    CHECK_EQ(g_sim_eeprom_writes[0x10], 1);
+
+    /* GIE is restored after the unlock sequence */
+    GIE = 1;
+    eeprom_write_start(0x11, 0x5A);
+    CHECK_EQ(GIE, 1);
+}
+
+/*---------------------------------------------------------
+ * CAN transmit: ID, payload, DLC clamp, bus time
+ *---------------------------------------------------------*/
+static void test_can_transmit(void)
+{
+    const uint8_t      data[9] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    const sim_frame_t *frame;
+    uint64_t           start;
+
+    setup_can();
+
+    CHECK_EQ(CANSTAT & CAN_OPMODE_MASK, CAN_OPMODE_NORMAL);
+
+    start = sim_now();
+    can_transmit(0x2A5, data, 9);
+
+    while (ECAN_TX0_BUSY)
+    {
+        ;
+    }
+
+    CHECK_EQ(sim_can_tx_count(), 1);
+    frame = sim_can_tx_frame(0);
+    CHECK_EQ(frame->id, 0x2A5);
+    CHECK_EQ(frame->dlc, CAN_MAX_DLC);
+    CHECK(memcmp(frame->data, data, CAN_MAX_DLC) == 0);
+    CHECK(frame->at - start >= sim_can_frame_cycles(8));
+
+    /* No transmission outside normal / loopback mode */
+    CHECK_EQ(can_set_mode(CAN_OPMODE_CONFIG), 1);
+    can_transmit(0x100, data, 1);
+    sim_advance(SIM_MS(1));
+    CHECK_EQ(sim_can_tx_count(), 1);
+    CHECK(ECAN_TX0_BUSY);
+}
+
+/*---------------------------------------------------------
+ * CAN receive, in the node's variant (polled / ring)
+ *---------------------------------------------------------*/
+static void test_can_receive(void)
+{
+    uint8_t  data[CAN_MAX_DLC];
+    uint8_t  sent[8] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 };
+    uint16_t id = 0;
+    uint8_t  len = 0;
+
+    setup_can();
+
+    CHECK(!can_rx_pending());
+
+    bus_send(XCP_CRO_ID, sent, 8);
+    CHECK(can_rx_pending());
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, XCP_CRO_ID);
+    CHECK_EQ(len, 8);
+    CHECK(memcmp(data, sent, 8) == 0);
+    CHECK(!can_rx_pending());
+
+    /* DLC field above 8 is clamped to the 8 bytes on the bus */
+    bus_send(XCP_CRO_ID, sent, 15);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(len, CAN_MAX_DLC);
+
+    /* Two frames back to back: RXB0 then RXB1, oldest first */
+    bus_send(XCP_CRO_ID, sent, 1);
+    bus_send(NM_MSG_ID_BASE + 1, sent, 2);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, XCP_CRO_ID);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, NM_MSG_ID_BASE + 1);
+    CHECK(!node_receive(&id, data, &len));
+
+#if HAL_CAN_RX_IRQ
+    /* The ISR drains the hardware buffers: a burst fits the ring */
+    for (uint8_t i = 0; i < CAN_RX_RING_SIZE - 1; i++)
+    {
+        bus_send((uint16_t)(0x100 + i), sent, 1);
+    }
+
+    CHECK_EQ(g_can_rx_overruns, 0);
+
+    for (uint8_t i = 0; i < CAN_RX_RING_SIZE - 1; i++)
+    {
+        CHECK(node_receive(&id, data, &len));
+        CHECK_EQ(id, 0x100 + i);
+    }
+
+    bus_send(0x100, sent, 1);
+    CHECK(g_sim.irq_entries[1] > 0);
+#elif HAL_CAN_FILTER_NODE
+    /* Polled, filtered: RXB0 holds one frame, the next is lost */
+    bus_send(XCP_CRO_ID, sent, 1);
+    bus_send(XCP_CRO_ID, sent, 2);
+    CHECK_EQ(g_sim.can_rx_overflow, 1);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(len, 1);
+#else
+    /* Polled: a third frame overflows the two hardware buffers */
+    bus_send(0x100, sent, 1);
+    bus_send(0x101, sent, 1);
+    bus_send(0x102, sent, 1);
+    CHECK_EQ(g_sim.can_rx_overflow, 1);
+#endif
+}
+
+/*---------------------------------------------------------
+ * Acceptance filters (HAL_CAN_FILTER_NODE)
+ *---------------------------------------------------------*/
+static void test_can_filters(void)
+{
+    uint8_t  data[CAN_MAX_DLC];
+    uint8_t  nm[NM_FRAME_LEN] = { 1, 0, 0, 0, 0 };
+    uint16_t id = 0;
+    uint8_t  len = 0;
+
+    setup_can();
+
+    bus_send(0x123, data, 1);
+    bus_send(XCP_CRO_ID + 1, data, 1);
+
+#if HAL_CAN_FILTER_NODE
+    /* Other nodes' traffic never reaches this node */
+    CHECK(!node_receive(&id, data, &len));
+#else
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, 0x123);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, XCP_CRO_ID + 1);
+#endif
+
+    /* Every node takes heartbeats, boot commands and time sync */
+    bus_send(NM_MSG_ID_BASE + 1, nm, NM_FRAME_LEN);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, NM_MSG_ID_BASE + 1);
+
+    bus_send(BOOTREQ_CMD_ID, data, 1);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, BOOTREQ_CMD_ID);
+
+    bus_send(TIME_SYNC_MSG_ID, data, 1);
+    CHECK(node_receive(&id, data, &len));
+    CHECK_EQ(id, TIME_SYNC_MSG_ID);
+}
+
+/*---------------------------------------------------------
+ * IDs derived from HAL_NODE_ID
+ *---------------------------------------------------------*/
+static void test_node_ids(void)
+{
+    const uint8_t      connect[2] = { XCP_CMD_CONNECT, 0 };
+    const sim_frame_t *frame;
+
+    CHECK_EQ(XCP_CRO_ID, XCP_CRO_MSG_ID_BASE + HAL_NODE_ID);
+    CHECK_EQ(XCP_DTO_ID, XCP_DTO_MSG_ID_BASE + HAL_NODE_ID);
+    CHECK_EQ(BOOTREQ_CMD_ID, BOOT_CMD_MSG_ID_BASE + HAL_NODE_ID);
+    CHECK_EQ(NM_NODE_ID, HAL_NODE_ID);
+
+    setup_can();
+    tsync_init();
+
+    /* First heartbeat goes out at once, on this node's ID */
+    nm_init();
+    nm_poll();
+    sim_advance(SIM_MS(1));
+    CHECK_EQ(sim_can_tx_count(), 1);
+    frame = sim_can_tx_frame(0);
+    CHECK_EQ(frame->id, NM_MSG_ID_BASE + HAL_NODE_ID);
+    CHECK_EQ(frame->data[0], HAL_NODE_ID);
+
+    /* XCP answers on this node's DTO */
+    xcp_init();
+    xcp_on_frame(connect, sizeof(connect));
+    xcp_poll();
+    sim_advance(SIM_MS(1));
+    CHECK_EQ(sim_can_tx_count(), 2);
+    frame = sim_can_tx_frame(1);
+    CHECK_EQ(frame->id, XCP_DTO_ID);
+    CHECK_EQ(frame->data[0], XCP_PID_RES);
+}
+
+/*---------------------------------------------------------
+ * Driver cost in this node's configuration. The model only
+ * charges register accesses, so the numbers compare the
+ * variants with each other (see tools/hal_size.py for the
+ * code size); they are not PIC18 cycle counts.
+ *---------------------------------------------------------*/
+static void test_can_cycles(void)
+{
+    uint8_t  data[CAN_MAX_DLC] = { 0 };
+    uint16_t id = 0;
+    uint8_t  len = 0;
+    uint64_t start;
+    uint64_t tx_cycles;
+    uint64_t rx_cycles;
+    uint64_t idle_cycles;
+
+    setup_can();
+
+    start = sim_now();
+    can_transmit(0x100, data, CAN_MAX_DLC);
+    tx_cycles = sim_now() - start;
+
+    while (ECAN_TX0_BUSY)
+    {
+        ;
+    }
+
+    bus_send(XCP_CRO_ID, data, CAN_MAX_DLC);
+    start = sim_now();
+    CHECK(node_receive(&id, data, &len));
+    rx_cycles = sim_now() - start;
+
+    start = sim_now();
+    CHECK(!node_receive(&id, data, &len));
+    idle_cycles = sim_now() - start;
+
+    printf("  can_transmit %llu, can_receive %llu, empty can_receive %llu cycles\n",
+           (unsigned long long)tx_cycles, (unsigned long long)rx_cycles,
+           (unsigned long long)idle_cycles);
+
+    /* Nothing to read never costs more than a frame */
+    CHECK(idle_cycles <= rx_cycles);
+}
+
+/*---------------------------------------------------------
+ * Boot request: flag in EEPROM, then reset
+ *---------------------------------------------------------*/
+static void test_bootreq(void)
+{
+    const uint8_t enter[5] = { BOOTREQ_CMD_ENTER, 'B', 'O', 'O', 'T' };
+    const uint8_t wrong[5] = { BOOTREQ_CMD_ENTER, 'B', 'O', 'O', 'X' };
+
+    sim_init();
+
+    CHECK(bootreq_is_frame(BOOTREQ_CMD_ID));
+    CHECK(!bootreq_is_frame(BOOTREQ_CMD_ID + 1));
+
+    bootreq_on_frame(BOOTREQ_CMD_ID, wrong, sizeof(wrong));
+    bootreq_on_frame(BOOTREQ_CMD_ID + 1, enter, sizeof(enter));
+    CHECK_EQ(g_sim.resets, 0);
+
+    bootreq_on_frame(BOOTREQ_CMD_ID, enter, sizeof(enter));
+    CHECK_EQ(g_sim.resets, 1);
+    CHECK_EQ(g_sim_eeprom[BOOTREQ_EE_REQUEST], BOOTREQ_REQUEST);
+}
+
+int main(void)
+{
+    printf("HAL unit tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_crc8);
+    UNIT_RUN(test_e2e);
+    UNIT_RUN(test_eeprom);
+    UNIT_RUN(test_can_transmit);
+    UNIT_RUN(test_can_receive);
+    UNIT_RUN(test_can_filters);
+    UNIT_RUN(test_node_ids);
+    UNIT_RUN(test_can_cycles);
+    UNIT_RUN(test_bootreq);
+
+    return UNIT_RESULT();
+}
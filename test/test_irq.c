@@ -0,0 +1,280 @@
+/***********************************************************************
+ *  File name   : test_irq.c
+ *  Description : ECU3 interrupt priorities on the register model's
+ *                preemption model (high vector preempts the low one):
+ *                - priority map of init_irq()
+ *                - a slow low priority handler (display pacing
+ *                  stand-in) with CAN frames arriving back to back:
+ *                  two levels against the former single vector, in
+ *                  CAN receive latency and frames lost
+ *                - a high priority handler is never preempted by
+ *                  the tick
+ *                - the latency report sent with node_main() running
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "irq.h"
+#include "tick.h"
+#include "can.h"
+#include "msg_id.h"
+#include "nm.h"
+#include "timesync.h"
+#include "cycles.h"
+
+UNIT_STATE
+
+#define SLOW_HANDLER_US             500U
+#define TRAFFIC_MS                  100U
+#define TRAFFIC_DLC                 0U
+
+/* CAN receive: entry and context save, never a whole low handler */
+#define CAN_RX_LATENCY_MAX_US       20U
+
+static uint16_t g_spin_cycles;
+
+static void spin(uint16_t cycles)
+{
+    uint16_t t0 = CYCLES_NOW();
+
+    while ((uint16_t)(CYCLES_NOW() - t0) < cycles)
+    {
+    }
+}
+
+/* Low vector with extra work after the tick (LCD pacing, say) */
+static void slow_low(void)
+{
+    uint8_t tick = TMR2IF;
+
+    isr_low();
+
+    if (tick)
+    {
+        spin(g_spin_cycles);
+    }
+}
+
+/* The single vector before the split: tick work first, then CAN */
+static void single_vector(void)
+{
+    slow_low();
+    isr_high();
+}
+
+/* High vector that takes long (never done on the node) */
+static void slow_high(void)
+{
+    isr_high();
+    spin(g_spin_cycles);
+}
+
+/* Low vector noting when it first ran */
+static uint64_t g_low_at;
+
+static void timed_low(void)
+{
+    if (g_low_at == 0)
+    {
+        g_low_at = sim_now();
+    }
+
+    isr_low();
+}
+
+static void setup(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+    tsync_init();
+    CHECK_EQ(init_can(), 1);
+}
+
+/* Back-to-back frames for TRAFFIC_MS; the main loop drains the ring */
+static uint32_t run_traffic(void)
+{
+    uint64_t frame = sim_can_frame_cycles(TRAFFIC_DLC);
+    uint64_t start = sim_now();
+    uint32_t frames = (uint32_t)(SIM_MS(TRAFFIC_MS) / frame);
+    uint32_t received = 0;
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        sim_can_rx(start + frame * (i + 1), SPEED_MSG_ID, NULL, TRAFFIC_DLC);
+    }
+
+    while (sim_now() < start + SIM_MS(TRAFFIC_MS + 1))
+    {
+        can_rx_view_t view;
+
+        if (can_rx_acquire(&view))
+        {
+            received++;
+            can_rx_release(&view);
+        }
+
+        sim_advance(SIM_US(5));
+    }
+
+    return frames - received;
+}
+
+/*---------------------------------------------------------
+ * Priority map
+ *---------------------------------------------------------*/
+static void test_priority_map(void)
+{
+    setup();
+
+    CHECK_EQ(RCONbits.IPEN, 1);
+    CHECK_EQ(GIEH, 1);
+    CHECK_EQ(GIEL, 1);
+
+    /* CAN and the time base high, tick and UART low */
+    CHECK_EQ(RXB0IP, 1);
+    CHECK_EQ(RXB1IP, 1);
+    CHECK_EQ(TMR1IP, 1);
+    CHECK_EQ(TXB0IP, 1);
+    CHECK_EQ(WAKIP, 1);
+    CHECK_EQ(TMR2IP, 0);
+    CHECK_EQ(TXIP, 0);
+}
+
+/*---------------------------------------------------------
+ * CAN during a slow low priority handler
+ *---------------------------------------------------------*/
+static void test_can_preempts_low(void)
+{
+    uint32_t lost_single;
+    uint32_t lost_two;
+    uint16_t latency_single;
+    uint16_t latency_two;
+
+    g_spin_cycles = (uint16_t)(SLOW_HANDLER_US * SIM_CYCLES_PER_US);
+
+    /* Former design: one vector, no priorities */
+    setup();
+    RCONbits.IPEN = 0;
+    sim_set_isr(single_vector, NULL);
+    lost_single    = run_traffic();
+    latency_single = g_irq_latency[e_irq_can_rx].max;
+
+    /* Two levels */
+    setup();
+    sim_set_isr(isr_high, slow_low);
+    lost_two    = run_traffic();
+    latency_two = g_irq_latency[e_irq_can_rx].max;
+
+    printf("  %u us low handler, %u ms of back-to-back frames: single vector %u lost,"
+           " CAN latency %u us; two levels %u lost, %u us (%u preemptions)\n",
+           SLOW_HANDLER_US, TRAFFIC_MS, lost_single,
+           (unsigned)(latency_single / SIM_CYCLES_PER_US), lost_two,
+           (unsigned)(latency_two / SIM_CYCLES_PER_US), g_sim.irq_preempted);
+
+    /* Frames land at any point of the slow handler */
+    CHECK(lost_single > 0);
+    CHECK(latency_single >= SLOW_HANDLER_US * SIM_CYCLES_PER_US / 2);
+
+    CHECK_EQ(lost_two, 0);
+    CHECK_EQ(g_can_rx_overruns, 0);
+    CHECK(g_sim.irq_preempted > 0);
+    CHECK(latency_two <= CAN_RX_LATENCY_MAX_US * SIM_CYCLES_PER_US);
+
+    /* The tick still ran, behind the frames */
+    CHECK(g_irq_latency[e_irq_tick].count >= TRAFFIC_MS - 1);
+}
+
+/*---------------------------------------------------------
+ * The tick waits for a high priority handler
+ *---------------------------------------------------------*/
+static void test_low_waits_for_high(void)
+{
+    uint64_t start;
+
+    g_spin_cycles = (uint16_t)(2000U * SIM_CYCLES_PER_US);
+
+    setup();
+    sim_set_isr(slow_high, timed_low);
+
+    /* One frame: 2 ms in the high vector, across a tick */
+    sim_can_rx(0, SPEED_MSG_ID, NULL, 0);
+    start    = sim_now();
+    g_low_at = 0;
+    sim_advance(SIM_MS(3));
+
+    CHECK_EQ(g_sim.irq_preempted, 0);
+    CHECK(g_low_at >= start + SIM_US(2000));
+}
+
+/*---------------------------------------------------------
+ * Latency report of the running node
+ *---------------------------------------------------------*/
+static uint8_t  g_report[7];
+static uint32_t g_reports;
+
+static void on_tx(const sim_frame_t *f)
+{
+    if (f->id == IRQ_LATENCY_MSG_ID && f->dlc == sizeof(g_report))
+    {
+        memcpy(g_report, f->data, sizeof(g_report));
+        g_reports++;
+    }
+}
+
+static uint16_t report_u16(uint8_t i)
+{
+    return (uint16_t)(g_report[2 * i] | (g_report[2 * i + 1] << 8));
+}
+
+static void test_latency_report(void)
+{
+    const uint8_t hb[NM_FRAME_LEN] = { 1, 0, e_nm_normal, 0, 0 };
+    const uint8_t data[8] = { 0 };
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    sim_can_on_tx(on_tx);
+    g_reports = 0;
+    sim_node_start(node_main);
+
+    for (uint32_t ms = 0; ms < 3500; ms++)
+    {
+        if (ms % (NM_CYCLE_US / 1000) == 0)
+        {
+            sim_can_rx(0, NM_MSG_ID_BASE + 1, hb, sizeof(hb));
+        }
+
+        sim_can_rx(0, RPM_MSG_ID, data, sizeof(data));
+        sim_node_run(SIM_MS(1));
+    }
+
+    printf("  %u reports; worst latency tick %u, time base %u, CAN RX %u cycles,"
+           " %u overruns\n", g_reports, report_u16(e_irq_tick),
+           report_u16(e_irq_timebase), report_u16(e_irq_can_rx), g_report[6]);
+
+    CHECK(g_reports >= 3);
+    CHECK(report_u16(e_irq_tick) <= g_irq_latency[e_irq_tick].max);
+    CHECK(report_u16(e_irq_can_rx) <= g_irq_latency[e_irq_can_rx].max);
+    CHECK(g_irq_latency[e_irq_tick].count > 0);
+    CHECK(g_irq_latency[e_irq_timebase].count > 0);
+    CHECK(g_irq_latency[e_irq_can_rx].count > 0);
+    CHECK(report_u16(e_irq_can_rx) <= CAN_RX_LATENCY_MAX_US * SIM_CYCLES_PER_US);
+    CHECK(report_u16(e_irq_timebase) <= CAN_RX_LATENCY_MAX_US * SIM_CYCLES_PER_US);
+    CHECK_EQ(g_report[6], 0);
+}
+
+int main(void)
+{
+    printf("Interrupt priority tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_priority_map);
+    UNIT_RUN(test_can_preempts_low);
+    UNIT_RUN(test_low_waits_for_high);
+    UNIT_RUN(test_latency_report);
+
+    return UNIT_RESULT();
+}
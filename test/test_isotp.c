@@ -0,0 +1,432 @@
+/***********************************************************************
+ *  File name   : test_isotp.c
+ *  Description : ECU3 ISO 15765-2 transport and diagnostic responder
+ *                over the simulated bus. A tester in this file talks
+ *                ISO-TP to the node (SF / FF / CF / FC with its own
+ *                block size and STmin); the node side is the real
+ *                can.c -> isotp.c -> diag.c path, stepped like the
+ *                main loop.
+ *                - Segmented response and segmented request
+ *                - Overflow, sequence error, N_Cr / N_Bs timeouts
+ *                - Throughput per flow-control setting, STmin kept
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "can.h"
+#include "tick.h"
+#include "irq.h"
+#include "isotp.h"
+#include "diag.h"
+#include "msg_id.h"
+
+UNIT_STATE
+
+/* Main loop period of the node between two isotp_poll() calls */
+#define LOOP_CYCLES                 SIM_US(100)
+
+/*---------------------------------------------------------
+ * Tester
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  bs;                    /* Flow control the tester grants */
+    uint8_t  stmin;
+    uint8_t  answer_fc;             /* 0: never send FC (N_Bs test) */
+
+    /* Reception of the node's message */
+    uint8_t  rx[4096];
+    uint16_t rx_len;
+    uint16_t rx_pos;
+    uint8_t  rx_sn;
+    uint8_t  rx_block;
+    uint8_t  rx_done;
+    uint32_t rx_messages;
+    uint64_t last_cf_at;
+    uint64_t min_cf_gap;
+
+    /* Transmission of the tester's request */
+    const uint8_t *tx;
+    uint16_t tx_len;
+    uint16_t tx_pos;
+    uint8_t  tx_sn;
+    uint8_t  last_fc[3];            /* Last FC the node sent */
+    uint8_t  fc_count;
+} tester_t;
+
+static tester_t g_tester;
+
+static void tester_send(const uint8_t *frame, uint8_t len, uint64_t at)
+{
+    sim_can_rx(at, DIAG_REQ_MSG_ID, frame, len);
+}
+
+/* Sends consecutive frames until the end or the node's block size */
+static void tester_send_block(uint64_t at, uint8_t bs)
+{
+    uint8_t count = 0;
+
+    while (g_tester.tx_pos < g_tester.tx_len && (bs == 0 || count < bs))
+    {
+        uint8_t frame[8];
+        uint8_t chunk = (uint8_t)((g_tester.tx_len - g_tester.tx_pos > 7) ?
+                                  7 : g_tester.tx_len - g_tester.tx_pos);
+
+        memset(frame, ISOTP_PAD_BYTE, sizeof(frame));
+        frame[0] = (uint8_t)(ISOTP_PCI_CF | g_tester.tx_sn);
+        memcpy(&frame[1], &g_tester.tx[g_tester.tx_pos], chunk);
+
+        at += sim_can_frame_cycles(8);
+        tester_send(frame, 8, at);
+
+        g_tester.tx_pos += chunk;
+        g_tester.tx_sn   = (uint8_t)((g_tester.tx_sn + 1) & 0x0F);
+        count++;
+    }
+}
+
+static void tester_send_fc(uint64_t at)
+{
+    uint8_t frame[8];
+
+    memset(frame, ISOTP_PAD_BYTE, sizeof(frame));
+    frame[0] = ISOTP_PCI_FC | ISOTP_FC_CTS;
+    frame[1] = g_tester.bs;
+    frame[2] = g_tester.stmin;
+
+    tester_send(frame, 8, at + sim_can_frame_cycles(8));
+}
+
+/* Node frame on the bus (sim_can_on_tx hook) */
+static void tester_on_frame(const sim_frame_t *f)
+{
+    uint8_t pci = f->data[0] & 0xF0;
+
+    if (f->id != DIAG_RESP_MSG_ID)
+    {
+        return;
+    }
+
+    switch (pci)
+    {
+        case ISOTP_PCI_SF:
+            g_tester.rx_len = f->data[0] & 0x0F;
+            memcpy(g_tester.rx, &f->data[1], g_tester.rx_len);
+            g_tester.rx_done = 1;
+            g_tester.rx_messages++;
+            break;
+
+        case ISOTP_PCI_FF:
+            g_tester.rx_len   = (uint16_t)(((f->data[0] & 0x0F) << 8) | f->data[1]);
+            memcpy(g_tester.rx, &f->data[2], 6);
+            g_tester.rx_pos   = 6;
+            g_tester.rx_sn    = 1;
+            g_tester.rx_block = 0;
+            g_tester.rx_done  = 0;
+            g_tester.last_cf_at = 0;
+
+            if (g_tester.answer_fc)
+            {
+                tester_send_fc(f->at);
+            }
+            break;
+
+        case ISOTP_PCI_CF:
+        {
+            uint16_t left  = (uint16_t)(g_tester.rx_len - g_tester.rx_pos);
+            uint8_t  chunk = (uint8_t)((left > 7) ? 7 : left);
+
+            CHECK_EQ(f->data[0] & 0x0F, g_tester.rx_sn);
+
+            if (g_tester.last_cf_at != 0 && g_tester.rx_block != 0 &&
+                f->at - g_tester.last_cf_at < g_tester.min_cf_gap)
+            {
+                g_tester.min_cf_gap = f->at - g_tester.last_cf_at;
+            }
+
+            g_tester.last_cf_at = f->at;
+            memcpy(&g_tester.rx[g_tester.rx_pos], &f->data[1], chunk);
+            g_tester.rx_pos += chunk;
+            g_tester.rx_sn   = (uint8_t)((g_tester.rx_sn + 1) & 0x0F);
+
+            if (g_tester.rx_pos >= g_tester.rx_len)
+            {
+                g_tester.rx_done = 1;
+                g_tester.rx_messages++;
+            }
+            else if (g_tester.bs != 0 && ++g_tester.rx_block >= g_tester.bs)
+            {
+                g_tester.rx_block   = 0;
+                g_tester.last_cf_at = 0;
+                tester_send_fc(f->at);
+            }
+            else if (g_tester.bs == 0)
+            {
+                g_tester.rx_block = 1;
+            }
+            break;
+        }
+
+        case ISOTP_PCI_FC:
+            memcpy(g_tester.last_fc, f->data, 3);
+            g_tester.fc_count++;
+
+            if ((f->data[0] & 0x0F) == ISOTP_FC_CTS)
+            {
+                tester_send_block(f->at, f->data[1]);
+            }
+            break;
+    }
+}
+
+/* Starts a request: SF, or FF and the rest after the node's FC */
+static void tester_request(const uint8_t *req, uint16_t len)
+{
+    uint8_t frame[8];
+
+    memset(frame, ISOTP_PAD_BYTE, sizeof(frame));
+    g_tester.rx_done = 0;
+
+    if (len <= 7)
+    {
+        frame[0] = (uint8_t)(ISOTP_PCI_SF | len);
+        memcpy(&frame[1], req, len);
+        tester_send(frame, 8, 0);
+        return;
+    }
+
+    g_tester.tx     = req;
+    g_tester.tx_len = len;
+    g_tester.tx_pos = 6;
+    g_tester.tx_sn  = 1;
+
+    frame[0] = (uint8_t)(ISOTP_PCI_FF | (len >> 8));
+    frame[1] = (uint8_t)len;
+    memcpy(&frame[2], req, 6);
+    tester_send(frame, 8, 0);
+}
+
+/*---------------------------------------------------------
+ * Node side
+ *---------------------------------------------------------*/
+static void setup(uint8_t bs, uint8_t stmin)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+    CHECK_EQ(init_can(), 1);
+    isotp_init();
+
+    memset(&g_tester, 0, sizeof(g_tester));
+    g_tester.bs         = bs;
+    g_tester.stmin      = stmin;
+    g_tester.answer_fc  = 1;
+    g_tester.min_cf_gap = UINT64_MAX;
+    sim_can_on_tx(tester_on_frame);
+}
+
+/* One main loop pass: receive, transport, responder */
+static void node_step(void)
+{
+    can_rx_view_t view;
+
+    while (can_rx_acquire(&view))
+    {
+        if (view.id == ISOTP_RX_ID)
+        {
+            isotp_on_frame(view.data, view.len);
+        }
+
+        can_rx_release(&view);
+    }
+
+    isotp_poll();
+    diag_poll();
+
+    sim_advance(LOOP_CYCLES);
+}
+
+/* Steps the node until the tester has a response (or time is up) */
+static uint8_t run_until_response(uint32_t max_ms)
+{
+    uint64_t end = sim_now() + SIM_MS(max_ms);
+
+    while (!g_tester.rx_done && sim_now() < end)
+    {
+        node_step();
+    }
+
+    return g_tester.rx_done;
+}
+
+/*---------------------------------------------------------
+ * Single frame request, segmented response
+ *---------------------------------------------------------*/
+static void test_read_did(void)
+{
+    const uint8_t req[3] = { DIAG_SID_READ_DID, 0xF1, 0x00 };
+
+    setup(0, 0);
+
+    tester_request(req, sizeof(req));
+    CHECK(run_until_response(100));
+
+    CHECK_EQ(g_tester.rx_len, 3 + 8);
+    CHECK_EQ(g_tester.rx[0], DIAG_POSITIVE(DIAG_SID_READ_DID));
+    CHECK_EQ(g_tester.rx[1], 0xF1);
+    CHECK_EQ(g_tester.rx[2], 0x00);
+    CHECK_EQ(g_diag_requests, 1);
+}
+
+/*---------------------------------------------------------
+ * Segmented request (FF, node FC, CFs)
+ *---------------------------------------------------------*/
+static void test_segmented_request(void)
+{
+    uint8_t req[ISOTP_RX_BUF_SIZE];
+
+    setup(0, 0);
+
+    /* TesterPresent with padding: full RX buffer, bad length */
+    memset(req, 0, sizeof(req));
+    req[0] = DIAG_SID_TESTER_PRESENT;
+
+    tester_request(req, sizeof(req));
+    CHECK(run_until_response(100));
+
+    CHECK_EQ(g_tester.fc_count, 1);
+    CHECK_EQ(g_tester.last_fc[0], ISOTP_PCI_FC | ISOTP_FC_CTS);
+    CHECK_EQ(g_tester.last_fc[1], ISOTP_RX_BLOCK_SIZE);
+    CHECK_EQ(g_tester.rx_len, 3);
+    CHECK_EQ(g_tester.rx[0], DIAG_NEGATIVE);
+    CHECK_EQ(g_tester.rx[2], DIAG_NRC_BAD_LENGTH);
+}
+
+/*---------------------------------------------------------
+ * Overflow, sequence error, timeouts
+ *---------------------------------------------------------*/
+static void test_errors(void)
+{
+    const uint8_t did[3] = { DIAG_SID_READ_DID, 0xF1, 0x00 };
+    uint8_t       big[ISOTP_RX_BUF_SIZE + 1];
+    uint8_t       frame[8];
+    uint32_t      served;
+
+    setup(0, 0);
+    served = g_diag_requests;
+
+    /* Longer than the RX buffer: FC overflow, nothing received */
+    memset(big, 0, sizeof(big));
+    tester_request(big, sizeof(big));
+
+    for (uint8_t i = 0; i < 20; i++)
+    {
+        node_step();
+    }
+
+    CHECK_EQ(g_tester.fc_count, 1);
+    CHECK_EQ(g_tester.last_fc[0], ISOTP_PCI_FC | ISOTP_FC_OVFLW);
+    CHECK_EQ(g_diag_requests, served);
+
+    /* Raw frames from here on: the tester sends no CFs of its own */
+    g_tester.tx_len = 0;
+
+    /* Wrong sequence number aborts the reception */
+    memset(frame, 0, sizeof(frame));
+    frame[0] = ISOTP_PCI_FF;
+    frame[1] = 20;
+    tester_send(frame, 8, 0);
+    frame[0] = ISOTP_PCI_CF | 2;
+    tester_send(frame, 8, sim_now() + SIM_MS(2));
+
+    for (uint8_t i = 0; i < 50; i++)
+    {
+        node_step();
+    }
+
+    CHECK_EQ(g_diag_requests, served);
+
+    /* N_Cr: FF without CFs, the receiver gives up, then serves again */
+    frame[0] = ISOTP_PCI_FF;
+    tester_send(frame, 8, 0);
+    run_until_response(ISOTP_TIMEOUT_CR_MS + 50);
+
+    tester_request(did, sizeof(did));
+    CHECK(run_until_response(100));
+    CHECK_EQ(g_diag_requests, served + 1);
+
+    /* N_Bs: no FC for the node's FF, the sender gives up */
+    g_tester.answer_fc = 0;
+    tester_request(did, sizeof(did));
+    run_until_response(ISOTP_TIMEOUT_BS_MS / 2);
+    CHECK(isotp_tx_busy());
+    run_until_response(ISOTP_TIMEOUT_BS_MS);
+    CHECK(!isotp_tx_busy());
+}
+
+/*---------------------------------------------------------
+ * Throughput of the segmentation per flow control setting
+ *---------------------------------------------------------*/
+static void test_throughput(void)
+{
+    static const struct
+    {
+        uint8_t bs;
+        uint8_t stmin;
+    } fc[] = { { 0, 0 }, { 8, 0 }, { 2, 0 }, { 0, 1 }, { 0, 5 } };
+    const uint32_t messages = 100;
+    uint8_t        msg[ISOTP_TX_BUF_SIZE];
+
+    for (uint16_t i = 0; i < sizeof(msg); i++)
+    {
+        msg[i] = (uint8_t)(i * 7 + 1);
+    }
+
+    for (uint8_t k = 0; k < sizeof(fc) / sizeof(fc[0]); k++)
+    {
+        uint64_t start;
+        double   seconds;
+
+        setup(fc[k].bs, fc[k].stmin);
+        start = sim_now();
+
+        for (uint32_t m = 0; m < messages; m++)
+        {
+            g_tester.rx_done = 0;
+            CHECK(isotp_send(msg, sizeof(msg)));
+            CHECK(run_until_response(1000));
+            CHECK_EQ(g_tester.rx_len, sizeof(msg));
+            CHECK(memcmp(g_tester.rx, msg, sizeof(msg)) == 0);
+        }
+
+        seconds = (double)(sim_now() - start) / SIM_MS(1000);
+
+        printf("  BS %u STmin %2u ms: %6.0f B/s, min CF gap %.2f ms\n",
+               fc[k].bs, fc[k].stmin, messages * sizeof(msg) / seconds,
+               (g_tester.min_cf_gap == UINT64_MAX) ? 0.0 :
+               (double)g_tester.min_cf_gap / SIM_MS(1));
+
+        CHECK_EQ(g_tester.rx_messages, messages);
+
+        /* STmin is a minimum between consecutive frames */
+        if (fc[k].stmin != 0)
+        {
+            CHECK(g_tester.min_cf_gap >= SIM_MS(fc[k].stmin));
+        }
+    }
+}
+
+int main(void)
+{
+    printf("ISO-TP tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_read_did);
+    UNIT_RUN(test_segmented_request);
+    UNIT_RUN(test_errors);
+    UNIT_RUN(test_throughput);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,305 @@
+/***********************************************************************
+ *  File name   : test_nm.c
+ *  Description : Network management with the node's main() running;
+ *                the test plays the two other nodes' heartbeats.
+ *                - Dropout: a silent peer is marked missing after
+ *                  NM_TIMEOUT_US, not before, while the other stays
+ *                  present; it is counted again when it rejoins
+ *                  (ECU3: its signals invalidated, warnings shown)
+ *                - Coordinated sleep: everyone ready -> the node stops
+ *                  all transmission and reaches bus sleep (ECU3: CPU
+ *                  and ECAN asleep); a peer that needs the bus wakes
+ *                  it (repeat heartbeat)
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "msg_id.h"
+#include "nm.h"
+
+#if HAL_NODE_ID == 3
+#include "signal_store.h"
+#include "warning.h"
+#endif
+
+UNIT_STATE
+
+#define STEP_CYCLES                 SIM_MS(1)
+
+/* Presence is aged once per main-loop pass */
+#if HAL_NODE_ID == 3
+#define LOOP_MS                     2U
+#else
+#define LOOP_MS                     17U
+#endif
+
+/* The two other nodes */
+#define PEER_A                      (HAL_NODE_ID % NM_NODE_COUNT + 1)
+#define PEER_B                      (PEER_A % NM_NODE_COUNT + 1)
+
+typedef struct
+{
+    uint8_t  on;
+    uint8_t  flags;
+    uint8_t  state;
+    uint64_t next;
+} peer_t;
+
+static peer_t   g_peer[NM_NODE_COUNT + 1];
+
+/* Frames the node sent */
+static uint32_t g_tx_frames;
+static uint64_t g_last_tx_at;
+static uint32_t g_heartbeats;
+static uint8_t  g_last_hb[NM_FRAME_LEN];
+
+static void on_tx(const sim_frame_t *f)
+{
+    g_tx_frames++;
+    g_last_tx_at = f->at;
+
+    if (f->id == NM_MSG_ID_BASE + HAL_NODE_ID && f->dlc == NM_FRAME_LEN)
+    {
+        memcpy(g_last_hb, f->data, NM_FRAME_LEN);
+        g_heartbeats++;
+    }
+}
+
+static void peer_set(uint8_t node, uint8_t on, uint8_t flags, uint8_t state)
+{
+    g_peer[node].on    = on;
+    g_peer[node].flags = flags;
+    g_peer[node].state = state;
+    g_peer[node].next  = sim_now();
+
+    /* Real nodes are not in phase: B half a cycle after A */
+    if (node == PEER_B)
+    {
+        g_peer[node].next += SIM_US(NM_CYCLE_US / 2);
+    }
+}
+
+static void run_ms(uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        for (uint8_t n = 1; n <= NM_NODE_COUNT; n++)
+        {
+            peer_t *p = &g_peer[n];
+
+            if (n != HAL_NODE_ID && p->on && sim_now() >= p->next)
+            {
+                const uint8_t hb[NM_FRAME_LEN] = { n, p->flags, p->state, 0, 0 };
+
+                sim_can_rx(0, NM_MSG_ID_BASE + n, hb, sizeof(hb));
+                p->next = sim_now() + SIM_US(NM_CYCLE_US);
+            }
+        }
+
+        sim_node_run(STEP_CYCLES);
+    }
+}
+
+static void start_node(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    sim_can_on_tx(on_tx);
+    memset(g_peer, 0, sizeof(g_peer));
+    g_tx_frames  = 0;
+    g_heartbeats = 0;
+
+    sim_node_start(node_main);
+}
+
+/*---------------------------------------------------------
+ * Dropout and rejoin
+ *---------------------------------------------------------*/
+static void test_dropout_rejoin(void)
+{
+    uint32_t heartbeats;
+    uint32_t missing_ms = 0;
+    uint32_t back_ms = 0;
+
+    start_node();
+    peer_set(PEER_A, 1, 0, e_nm_normal);
+    peer_set(PEER_B, 1, 0, e_nm_normal);
+
+    run_ms(3000);
+
+    CHECK(nm_node_present(PEER_A));
+    CHECK(nm_node_present(PEER_B));
+    CHECK_EQ(g_nm_nodes[PEER_A - 1].joins, 1);
+    CHECK(nm_tx_allowed());
+
+    /* Own heartbeat every NM_CYCLE_US, awake (peers need the bus) */
+    heartbeats = g_heartbeats;
+    run_ms(2000);
+    CHECK(g_heartbeats - heartbeats >= 2000000UL / NM_CYCLE_US - 1);
+    CHECK(g_heartbeats - heartbeats <= 2000000UL / NM_CYCLE_US + 1);
+    CHECK_EQ(g_last_hb[0], HAL_NODE_ID);
+    CHECK_EQ(g_last_hb[2], g_nm_state);
+
+    /* Peer A goes silent right after a heartbeat */
+    while (sim_now() + SIM_MS(1) < g_peer[PEER_A].next)
+    {
+        run_ms(1);
+    }
+    run_ms(1);
+    g_peer[PEER_A].on = 0;
+
+    while (nm_node_present(PEER_A) && missing_ms < 3000)
+    {
+        run_ms(1);
+        missing_ms++;
+    }
+
+    /* Last heartbeat a few ms before the silence started; stamped when
+     * the loop reads it and aged once per pass: up to two passes late */
+    CHECK(missing_ms + 2 >= NM_TIMEOUT_US / 1000);
+    CHECK(missing_ms <= NM_TIMEOUT_US / 1000 + 2 * LOOP_MS + 2);
+    CHECK(nm_node_present(PEER_B));
+
+#if HAL_NODE_ID == 3
+    if (PEER_A == 1)
+    {
+        signal_t speed;
+
+        run_ms(LOOP_MS);
+        signal_read(e_sig_speed, &speed);
+        CHECK(!speed.valid);
+        CHECK(warning_active(e_warn_ecu1_lost));
+    }
+#endif
+
+    /* Rejoins: counted again at its first heartbeat */
+    run_ms(2000);
+    CHECK(!nm_node_present(PEER_A));
+    peer_set(PEER_A, 1, 0, e_nm_normal);
+
+    while (!nm_node_present(PEER_A) && back_ms < 1000)
+    {
+        run_ms(1);
+        back_ms++;
+    }
+
+    printf("  peer %u missing %u ms after its last heartbeat (timeout %lu ms),"
+           " present again after %u ms\n",
+           PEER_A, missing_ms, NM_TIMEOUT_US / 1000, back_ms);
+
+    CHECK(back_ms <= LOOP_MS + 2);
+    CHECK_EQ(g_nm_nodes[PEER_A - 1].joins, 2);
+
+#if HAL_NODE_ID == 3
+    if (PEER_A == 1)
+    {
+        run_ms(LOOP_MS);
+        CHECK(!warning_active(e_warn_ecu1_lost));
+        CHECK(warning_active(e_warn_ecu1_back));
+    }
+#endif
+
+    /* Both peers stayed present through the dropout of the other */
+    run_ms(3000);
+    CHECK(nm_node_present(PEER_A));
+    CHECK(nm_node_present(PEER_B));
+}
+
+/*---------------------------------------------------------
+ * Coordinated sleep and wake-up
+ *---------------------------------------------------------*/
+static void test_sleep_wake(void)
+{
+    uint32_t ms = 0;
+    uint32_t prepare_ms;
+    uint32_t silent_frames;
+    uint32_t heartbeats;
+    uint64_t wake_at;
+#if HAL_NODE_ID == 3
+    uint32_t lost;
+#endif
+
+    /* Parked: this node releases the bus, the peers are ready */
+    start_node();
+    peer_set(PEER_A, 1, NM_FLAG_READY_SLEEP, e_nm_ready_sleep);
+    peer_set(PEER_B, 1, NM_FLAG_READY_SLEEP, e_nm_ready_sleep);
+
+    while (g_nm_state != e_nm_prepare_sleep && ms < 10000)
+    {
+        run_ms(1);
+        ms++;
+    }
+
+    /* Repeat, then everyone ready for the confirm time */
+    CHECK_EQ(g_nm_state, e_nm_prepare_sleep);
+    CHECK(ms * 1000UL >= NM_REPEAT_US);
+    CHECK(ms * 1000UL <= NM_REPEAT_US + NM_READY_CONFIRM_US + NM_CYCLE_US + 100000UL);
+
+    prepare_ms = ms;
+
+    /* The peers reach the same decision and go quiet too */
+    g_peer[PEER_A].on = 0;
+    g_peer[PEER_B].on = 0;
+
+    run_ms(NM_WAIT_SLEEP_US / 1000 + 2 * LOOP_MS);
+    CHECK_EQ(g_nm_state, e_nm_bus_sleep);
+    CHECK(!nm_tx_allowed());
+
+    /* Nothing at all on the bus while parked */
+    silent_frames = g_tx_frames;
+    heartbeats    = g_heartbeats;
+    run_ms(5000);
+    CHECK_EQ(g_tx_frames, silent_frames);
+    CHECK(sim_now() - g_last_tx_at >= SIM_MS(5000));
+
+#if HAL_NODE_ID == 3
+    lost = g_sim.can_rx_lost;
+#endif
+
+    /* A peer needs the bus (ECU3: the first frame only wakes the CAN
+     * module and is lost; the next heartbeat is heard) */
+    wake_at = sim_now();
+    peer_set(PEER_A, 1, 0, e_nm_normal);
+
+    ms = 0;
+    while (g_heartbeats == heartbeats)
+    {
+        run_ms(1);
+
+        if (++ms > 2 * NM_CYCLE_US / 1000 + LOOP_MS)
+        {
+            break;
+        }
+    }
+
+    printf("  prepare sleep after %u ms parked, silent for 5 s, awake again %llu ms"
+           " after the wake-up heartbeat\n",
+           prepare_ms,
+           (unsigned long long)((g_last_tx_at - wake_at) / SIM_MS(1)));
+
+    CHECK(g_tx_frames > silent_frames);
+#if HAL_NODE_ID == 3
+    /* CPU and ECAN module were asleep; the frame that woke them is lost */
+    CHECK(g_sim.sleep_cycles >= SIM_MS(5000));
+    CHECK_EQ(g_sim.can_rx_lost, lost + 1);
+#endif
+    CHECK(g_nm_state == e_nm_repeat);
+    CHECK(g_last_hb[1] & NM_FLAG_REPEAT);
+    CHECK(nm_tx_allowed());
+
+    /* Repeat state holds for NM_REPEAT_US even though this node is parked */
+    run_ms(NM_REPEAT_US / 1000 - 2 * NM_CYCLE_US / 1000 - LOOP_MS);
+    CHECK(g_nm_state == e_nm_repeat);
+}
+
+int main(void)
+{
+    printf("NM tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_dropout_rejoin);
+    UNIT_RUN(test_sleep_wake);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,292 @@
+/***********************************************************************
+ *  File name   : test_odometer.c
+ *  Description : ECU3 odometer and trip meter.
+ *                - Integration accuracy: long drives with a varying
+ *                  speed and jittered SPEED frame timing, against
+ *                  the exact trapezoid of the same samples
+ *                - EEPROM wear over the ring's rated distance, per
+ *                  byte, and the cost of one odometer_poll() call
+ *                - Power loss after every write of a save, with and
+ *                  without the byte being written corrupted
+ *
+ ***********************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "tick.h"
+#include "odometer.h"
+
+UNIT_STATE
+
+#define FRAME_MS                    100U
+#define SAVE_WRITES                 (ODO_RECORD_SIZE + 1U)  /* marker twice */
+#define FAST_WRITE_CYCLES           10U
+
+/* Total EEPROM byte writes so far */
+static uint32_t ee_writes(void)
+{
+    uint32_t total = 0;
+
+    for (uint16_t i = 0; i < 256; i++)
+    {
+        total += g_sim_eeprom_writes[i];
+    }
+
+    return total;
+}
+
+/* Polls the writer until 'writes' bytes are written or it idles */
+static void poll_writes(uint32_t writes)
+{
+    uint32_t target = ee_writes() + writes;
+
+    for (uint32_t i = 0; ee_writes() < target && i < 100 * SAVE_WRITES; i++)
+    {
+        odometer_poll();
+        sim_advance(SIM_US(500));
+    }
+}
+
+/* Power loss: RAM and registers lost, EEPROM kept; optionally the
+ * byte being written is left with neither value */
+static void power_cut(uint8_t corrupt)
+{
+    uint8_t image[256];
+
+    memcpy(image, g_sim_eeprom, sizeof(image));
+
+    if (corrupt && eeprom_busy())
+    {
+        image[EEADR] ^= 0x5A;
+    }
+
+    sim_init();
+    memcpy(g_sim_eeprom, image, sizeof(image));
+    odometer_init();
+}
+
+/*---------------------------------------------------------
+ * Integration accuracy
+ *---------------------------------------------------------*/
+static void test_accuracy(void)
+{
+    double   reference = 0.0;
+    uint32_t last_speed;
+    uint32_t hours = 10;
+
+    sim_init();
+    g_tick_count = 0;
+    odometer_init();
+    srand(30);
+
+    /* Constant 100 km/h for an hour: exactly 100 km */
+    for (uint32_t t = 0; t <= 36000; t++)
+    {
+        odometer_on_speed(100);
+        g_tick_count += TICK_FROM_MS(FRAME_MS);
+    }
+
+    CHECK_EQ(odometer_total_m(), 100000UL);
+
+    /* Urban / motorway cycle, frames 100 ms +-5 ms apart */
+    odometer_init();
+    g_tick_count += 5000;
+    last_speed = 0;
+    odometer_on_speed(0);
+
+    for (uint32_t t = 0; t < hours * 3600UL * 1000UL; )
+    {
+        uint32_t dt    = FRAME_MS - 5 + (uint32_t)(rand() % 11);
+        uint32_t speed = (uint32_t)(65.0 + 60.0 * sin(t / 90000.0) + 5.0 * sin(t / 7000.0));
+
+        t            += dt;
+        g_tick_count += TICK_FROM_MS(dt);
+        reference    += (last_speed + speed) * dt / 7200.0;
+        last_speed    = speed;
+
+        odometer_on_speed((uint16_t)speed);
+    }
+
+    printf("  %u h drive: %u m integrated, %.1f m exact (error %.4f%%)\n",
+           hours, odometer_total_m(), reference,
+           100.0 * (odometer_total_m() - reference) / reference);
+
+    /* Only the carried remainder (< 1 m) is missing */
+    CHECK(odometer_total_m() <= reference);
+    CHECK(reference - odometer_total_m() < 1.0);
+    CHECK_EQ(odometer_trip_m(), odometer_total_m());
+
+    /* Sender lost: a long gap is not extrapolated */
+    {
+        uint32_t before = odometer_total_m();
+
+        g_tick_count += TICK_FROM_MS(ODO_MAX_FRAME_GAP_MS + 1);
+        odometer_on_speed(200);
+        CHECK_EQ(odometer_total_m(), before);
+    }
+}
+
+/*---------------------------------------------------------
+ * Wear over the rated distance, non-blocking writer
+ *---------------------------------------------------------*/
+static void test_wear(void)
+{
+    uint32_t km = ODO_ENDURANCE_KM;
+    uint32_t max_writes = 0;
+    uint32_t min_marker = UINT32_MAX;
+    uint64_t worst_poll = 0;
+
+    sim_init();
+    g_tick_count = 0;
+    odometer_init();
+
+    /* 3600 km/h frames 1 s apart: one kilometre per frame */
+    odometer_on_speed(3600);
+
+    for (uint32_t i = 0; i < km; i++)
+    {
+        g_tick_count += TICK_FROM_MS(1000);
+        odometer_on_speed(3600);
+
+        /* The first saves with the real 4 ms byte write */
+        if (i == 100)
+        {
+            sim_eeprom_set_write_cycles(FAST_WRITE_CYCLES);
+        }
+
+        for (uint8_t p = 0; p < 3 * SAVE_WRITES; p++)
+        {
+            uint64_t start = sim_now();
+
+            odometer_poll();
+
+            if (sim_now() - start > worst_poll)
+            {
+                worst_poll = sim_now() - start;
+            }
+
+            sim_advance((i < 100) ? SIM_MS(5) : FAST_WRITE_CYCLES);
+        }
+    }
+
+    for (uint16_t a = 0; a < 256; a++)
+    {
+        max_writes = (g_sim_eeprom_writes[a] > max_writes) ? g_sim_eeprom_writes[a] : max_writes;
+    }
+
+    for (uint8_t s = 0; s < ODO_RECORD_COUNT; s++)
+    {
+        uint32_t w = g_sim_eeprom_writes[EE_ODO_BASE + s * ODO_RECORD_SIZE];
+
+        min_marker = (w < min_marker) ? w : min_marker;
+    }
+
+    printf("  %u km, %u slots: most worn byte %u writes (rated %lu), markers %u..%u,"
+           " longest odometer_poll() %llu cycles\n",
+           km, ODO_RECORD_COUNT, max_writes, ODO_EE_MIN_CYCLES, min_marker, max_writes,
+           (unsigned long long)worst_poll);
+
+    CHECK(max_writes <= ODO_EE_MIN_CYCLES);
+    CHECK(max_writes - min_marker <= 2);
+    CHECK(worst_poll < SIM_US(20));
+
+    /* Nothing outside the ring */
+    for (uint16_t a = EE_ODO_BASE + ODO_RECORD_COUNT * ODO_RECORD_SIZE; a < 256; a++)
+    {
+        CHECK_EQ(g_sim_eeprom_writes[a], 0);
+    }
+
+    /* Sequence numbers have wrapped many times; the newest wins */
+    power_cut(0);
+    CHECK_EQ(odometer_total_m(), km * 1000UL);
+}
+
+/*---------------------------------------------------------
+ * Power loss during a save
+ *---------------------------------------------------------*/
+static void test_torn_writes(void)
+{
+    uint32_t restored_old = 0;
+    uint32_t restored_new = 0;
+
+    for (uint8_t corrupt = 0; corrupt <= 1; corrupt++)
+    {
+        for (uint8_t cut = 0; cut <= SAVE_WRITES; cut++)
+        {
+            uint32_t old_m;
+            uint32_t new_m;
+
+            sim_init();
+            g_tick_count = 0;
+            sim_eeprom_set_write_cycles(FAST_WRITE_CYCLES);
+
+            /* Random contents never pass as a record */
+            srand(cut);
+            for (uint16_t a = 0; a < 256; a++)
+            {
+                g_sim_eeprom[a] = (uint8_t)rand();
+            }
+
+            odometer_init();
+            CHECK_EQ(odometer_total_m(), 0);
+
+            /* A few saves so the ring has history, then one more */
+            odometer_on_speed(3600);
+            for (uint8_t k = 0; k < 3 + cut; k++)
+            {
+                g_tick_count += TICK_FROM_MS(1000);
+                odometer_on_speed(3600);
+                poll_writes(SAVE_WRITES);
+                odometer_poll();
+            }
+
+            old_m = odometer_total_m();
+            g_tick_count += TICK_FROM_MS(1000);
+            odometer_on_speed(3600);
+            new_m = odometer_total_m();
+
+            poll_writes(cut);
+
+            /* Cut with the next byte write under way */
+            if (cut < SAVE_WRITES)
+            {
+                odometer_poll();
+            }
+
+            power_cut(corrupt);
+
+            CHECK(odometer_total_m() == old_m || odometer_total_m() == new_m);
+            CHECK_EQ(odometer_total_m() == new_m, cut == SAVE_WRITES);
+
+            restored_old += (odometer_total_m() == old_m);
+            restored_new += (odometer_total_m() == new_m);
+
+            /* Counting and saving go on from the restored record */
+            g_tick_count += TICK_FROM_MS(1000);
+            odometer_on_speed(3600);
+            g_tick_count += TICK_FROM_MS(1000);
+            odometer_on_speed(3600);
+            poll_writes(SAVE_WRITES);
+            odometer_poll();
+            power_cut(0);
+            CHECK(odometer_total_m() > old_m);
+        }
+    }
+
+    printf("  %u cuts: previous record restored %u times, new one %u times\n",
+           2 * (SAVE_WRITES + 1), restored_old, restored_new);
+}
+
+int main(void)
+{
+    printf("Odometer tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_accuracy);
+    UNIT_RUN(test_wear);
+    UNIT_RUN(test_torn_writes);
+
+    return UNIT_RESULT();
+}
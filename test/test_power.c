@@ -0,0 +1,222 @@
+/***********************************************************************
+ *  File name   : test_power.c
+ *  Description : Idle share of each node under a standard traffic
+ *                profile, with the node's main() running. The test
+ *                plays the other nodes on the TT matrix cycle:
+ *                  ECU1  GEAR, SPEED + heartbeat   (tt_matrix.h slots)
+ *                  ECU2  RPM, INDICATOR + heartbeat
+ *                  ECU3  heartbeat every NM_CYCLE_US, drifting
+ *                        through the cycle
+ *                (signals E2E protected)
+ *                - the register model's IDLE time against the run,
+ *                  and the node's own load figure against it
+ *                - no frame lost while the core idles: no buffer
+ *                  overflow, ring overrun or (ECU3) E2E skip, peers
+ *                  present throughout
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "can.h"
+#include "msg_id.h"
+#include "nm.h"
+#include "e2e.h"
+#include "profile.h"
+#include "tt_matrix.h"
+#include "timesync.h"
+
+#if HAL_NODE_ID == 3
+#include "msg_handler.h"
+#endif
+
+UNIT_STATE
+
+#define STEP_CYCLES                 SIM_MS(1)
+#define WARMUP_MS                   2000U
+#define MEASURE_MS                  10000U
+
+/* Idle share the nodes reach with this profile (percent) */
+#if HAL_NODE_ID == 3
+#define IDLE_MIN_PCT                85U
+#else
+#define IDLE_MIN_PCT                75U
+#endif
+
+typedef struct
+{
+    uint8_t  node;                  /* Sender */
+    uint16_t id;
+    uint8_t  len;
+    uint8_t  granule;               /* Slot start in the TT cycle */
+} profile_msg_t;
+
+static const profile_msg_t g_msgs[] =
+{
+    { TT_GEAR_OWNER,      GEAR_MSG_ID,      1, TT_GEAR_START      },
+    { TT_RPM_OWNER,       RPM_MSG_ID,       4, TT_RPM_START       },
+    { TT_SPEED_OWNER,     SPEED_MSG_ID,     3, TT_SPEED_START     },
+    { TT_INDICATOR_OWNER, INDICATOR_MSG_ID, 1, TT_INDICATOR_START },
+};
+
+#define MSG_COUNT                   (sizeof(g_msgs) / sizeof(g_msgs[0]))
+
+/* ECU3 sends in the arbitrating granules, on its own 200 ms */
+#define ECU3_HB_GRANULE             26U
+
+static e2e_tx_t g_tx[MSG_COUNT];
+static uint32_t g_sent;
+static uint64_t g_cycle_at;         /* Start of the next TT cycle */
+static uint64_t g_hb_at[NM_NODE_COUNT + 1];
+
+static void send_frame(uint64_t at, uint16_t id, const uint8_t *data, uint8_t len)
+{
+    sim_can_rx(at, id, data, len);
+    g_sent++;
+}
+
+static void send_heartbeat(uint64_t at, uint8_t node)
+{
+    const uint8_t hb[NM_FRAME_LEN] = { node, 0, e_nm_normal, 0, 0 };
+
+    send_frame(at, NM_MSG_ID_BASE + node, hb, sizeof(hb));
+}
+
+/* One TT cycle of the other nodes' frames */
+static void send_cycle(uint64_t at)
+{
+    for (uint8_t i = 0; i < MSG_COUNT; i++)
+    {
+        uint64_t slot = at + SIM_US(TT_GRANULE_US * g_msgs[i].granule);
+        uint8_t  payload[4] = { '0', '4', '2', '0' };
+        uint8_t  frame[CAN_MAX_DLC];
+        uint8_t  len;
+
+        if (g_msgs[i].node == HAL_NODE_ID)
+        {
+            continue;
+        }
+
+        /* Gear 2, indicator off */
+        if (g_msgs[i].len == 1)
+        {
+            payload[0] = (g_msgs[i].id == GEAR_MSG_ID) ? 3 : 0;
+        }
+
+        len = e2e_protect(&g_tx[i], g_msgs[i].id, frame, payload, g_msgs[i].len);
+        send_frame(slot, g_msgs[i].id, frame, len);
+
+        /* Slotted nodes send their heartbeat behind the second slot */
+        if (g_msgs[i].granule >= TT_SPEED_START && slot >= g_hb_at[g_msgs[i].node])
+        {
+            send_heartbeat(slot + sim_can_frame_cycles(len), g_msgs[i].node);
+            g_hb_at[g_msgs[i].node] = slot + SIM_US(NM_CYCLE_US);
+        }
+    }
+
+    /* ECU3 drifts through the cycle: sometimes in the same pass as ECU2 */
+    if (HAL_NODE_ID != 3 && at + SIM_US(TT_CYCLE_US) > g_hb_at[3])
+    {
+        send_heartbeat(g_hb_at[3], 3);
+        g_hb_at[3] += SIM_US(NM_CYCLE_US);
+    }
+}
+
+/* Traffic for one millisecond, then the node */
+static void run_ms(void)
+{
+    if (sim_now() + SIM_MS(1) >= g_cycle_at)
+    {
+        send_cycle(g_cycle_at);
+        g_cycle_at += SIM_US(TT_CYCLE_US);
+    }
+
+    sim_node_run(STEP_CYCLES);
+}
+
+/*---------------------------------------------------------
+ * Idle share under the standard profile
+ *---------------------------------------------------------*/
+static void test_idle_share(void)
+{
+    uint64_t start;
+    uint64_t idle;
+    uint32_t idle_pct;
+    uint32_t wake_pct;
+    uint32_t sleeps;
+    uint32_t sent;
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    memset(g_tx, 0, sizeof(g_tx));
+    memset(g_hb_at, 0, sizeof(g_hb_at));
+    g_sent = 0;
+    sim_node_start(node_main);
+    sim_node_run(SIM_MS(1));
+
+    /* Cycles on the node's clock, as on a synchronized bus */
+    g_cycle_at = sim_now() + SIM_US(TT_CYCLE_US - tsync_now_us() % TT_CYCLE_US);
+    g_hb_at[3] = g_cycle_at + SIM_US(TT_GRANULE_US * ECU3_HB_GRANULE);
+
+    for (uint32_t ms = 0; ms < WARMUP_MS; ms++)
+    {
+        run_ms();
+    }
+
+    start  = sim_now();
+    idle   = g_sim.idle_cycles;
+    sleeps = g_sim.sleeps;
+    sent   = g_sent;
+
+    for (uint32_t ms = 0; ms < MEASURE_MS; ms++)
+    {
+        run_ms();
+    }
+
+    idle     = g_sim.idle_cycles - idle;
+    idle_pct = (uint32_t)(idle * 100 / (sim_now() - start));
+
+    printf("  %u frames in %u s: idle %u%% of the time, %u idle entries;"
+           " node reports %u%% load\n",
+           g_sent - sent, MEASURE_MS / 1000, idle_pct, g_sim.sleeps - sleeps,
+           g_profile_load);
+
+    CHECK(nm_tx_allowed());
+
+    for (uint8_t n = 1; n <= NM_NODE_COUNT; n++)
+    {
+        CHECK(n == HAL_NODE_ID || nm_node_present(n));
+    }
+    CHECK(idle_pct >= IDLE_MIN_PCT);
+
+    /* The node's own window: busy = 100 - idle, to a few percent, less
+     * the ISR entries that end an idle period (profile.c counts them
+     * as idle; on ECU3 each telemetry byte is one) */
+    wake_pct = (uint32_t)((uint64_t)(g_sim.sleeps - sleeps) * SIM_ISR_ENTRY_CYCLES * 100 /
+                          (sim_now() - start));
+    CHECK(g_profile_load + idle_pct + wake_pct >= 95);
+    CHECK(g_profile_load + idle_pct <= 105);
+
+    /* Nothing lost to the core being stopped */
+    CHECK_EQ(g_sim.can_rx_overflow, 0);
+#if HAL_CAN_RX_IRQ
+    CHECK_EQ(g_can_rx_overruns, 0);
+#endif
+#if HAL_NODE_ID == 3
+    for (uint8_t slot = 0; slot < E2E_RX_SLOTS; slot++)
+    {
+        CHECK_EQ(g_e2e_rx[slot].skipped, 0);
+        CHECK_EQ(g_e2e_rx[slot].crc_failed, 0);
+    }
+#endif
+}
+
+int main(void)
+{
+    printf("Power mode tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_idle_share);
+
+    return UNIT_RESULT();
+}
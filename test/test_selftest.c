@@ -0,0 +1,181 @@
+/***********************************************************************
+ *  File name   : test_selftest.c
+ *  Description : ECU3 CAN loopback self-test and driver benchmark on
+ *                the register model:
+ *                - every frame comes back intact through the loopback,
+ *                  none reaches the bus, bus frames are not mixed in
+ *                - frames per second against the bit time of the
+ *                  frames sent, Timer1 cycle figures
+ *                - the report pages on SELFTEST_REPORT_MSG_ID
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "irq.h"
+#include "tick.h"
+#include "can.h"
+#include "msg_id.h"
+#include "can_selftest.h"
+
+UNIT_STATE
+
+#define RUN_FRAMES                  CAN_SELFTEST_FRAMES
+
+static uint32_t g_bus_frames;
+static uint8_t  g_pages[CAN_SELFTEST_PAGES][7];
+static uint8_t  g_page_count;
+
+static void on_tx(const sim_frame_t *f)
+{
+    if (f->id == SELFTEST_REPORT_MSG_ID && f->dlc == 7 && f->data[0] < CAN_SELFTEST_PAGES)
+    {
+        memcpy(g_pages[f->data[0]], f->data, 7);
+        g_page_count++;
+        return;
+    }
+
+    g_bus_frames++;
+}
+
+static void setup(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+    CHECK_EQ(init_can(), 1);
+
+    g_bus_frames = 0;
+    g_page_count = 0;
+    memset(g_pages, 0, sizeof(g_pages));
+    sim_can_on_tx(on_tx);
+}
+
+static uint16_t page_u16(uint8_t page, uint8_t i)
+{
+    return (uint16_t)(g_pages[page][1 + 2 * i] | (g_pages[page][2 + 2 * i] << 8));
+}
+
+/*---------------------------------------------------------
+ * Loopback run
+ *---------------------------------------------------------*/
+static void test_loopback(void)
+{
+    uint64_t bus_cycles = 0;
+    uint32_t bus_fps;
+
+    setup();
+
+    CHECK_EQ(can_selftest_run(RUN_FRAMES), 1);
+
+    CHECK_EQ(g_can_selftest.frames, RUN_FRAMES);
+    CHECK_EQ(g_can_selftest.lost, 0);
+    CHECK_EQ(g_can_selftest.mismatches, 0);
+    CHECK_EQ(g_can_selftest.mode_ok, 1);
+
+    /* All internal, nothing on the bus */
+    CHECK_EQ(g_sim.can_loopback, RUN_FRAMES);
+    CHECK_EQ(g_bus_frames, 0);
+
+    /* Back in normal mode: bus frames are received again */
+    sim_can_rx(0, SPEED_MSG_ID, (const uint8_t *)"\0\0" "123", 5);
+    sim_advance(SIM_MS(1));
+    CHECK(can_rx_pending());
+
+    /* The rate is bounded by the frames' bit time (DLC 0..8 in turn) */
+    for (uint16_t n = 0; n < RUN_FRAMES; n++)
+    {
+        bus_cycles += sim_can_frame_cycles((uint8_t)(n % (CAN_MAX_DLC + 1)));
+    }
+    bus_fps = (uint32_t)(RUN_FRAMES * SIM_MS(1000) / bus_cycles);
+
+    printf("  %u frames in %u ms: %u frames/s (bit time allows %u)\n",
+           g_can_selftest.frames, g_can_selftest.elapsed_ms,
+           g_can_selftest.frames_per_s, bus_fps);
+    printf("  can_transmit %u/%u/%u, can_receive %u/%u/%u cycles (min/avg/max)\n",
+           g_can_selftest.tx_cycles_min, g_can_selftest.tx_cycles_avg,
+           g_can_selftest.tx_cycles_max, g_can_selftest.rx_cycles_min,
+           g_can_selftest.rx_cycles_avg, g_can_selftest.rx_cycles_max);
+
+    /* Elapsed time has 1 ms resolution */
+    CHECK(g_can_selftest.frames_per_s <= bus_fps * 105 / 100);
+    CHECK(g_can_selftest.frames_per_s >= bus_fps * 80 / 100);
+
+    /* Timer1 figures are ordered and match the driver's size */
+    CHECK(g_can_selftest.tx_cycles_min > 0);
+    CHECK(g_can_selftest.tx_cycles_min <= g_can_selftest.tx_cycles_avg);
+    CHECK(g_can_selftest.tx_cycles_avg <= g_can_selftest.tx_cycles_max);
+    CHECK(g_can_selftest.rx_cycles_min > 0);
+    CHECK(g_can_selftest.rx_cycles_min <= g_can_selftest.rx_cycles_avg);
+    CHECK(g_can_selftest.rx_cycles_avg <= g_can_selftest.rx_cycles_max);
+    CHECK(g_can_selftest.tx_cycles_max < 200);
+    CHECK(g_can_selftest.rx_cycles_max < 200);
+}
+
+/*---------------------------------------------------------
+ * Bus traffic during the run
+ *---------------------------------------------------------*/
+static void test_bus_traffic(void)
+{
+    uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+    setup();
+
+    /* Another node keeps sending while the module is in loopback */
+    for (uint8_t i = 0; i < 50; i++)
+    {
+        sim_can_rx(SIM_US(200) * i, RPM_MSG_ID, data, sizeof(data));
+    }
+
+    CHECK_EQ(can_selftest_run(64), 1);
+    CHECK_EQ(g_can_selftest.mismatches, 0);
+    CHECK_EQ(g_can_selftest.lost, 0);
+    CHECK(g_sim.can_rx_lost > 0);
+}
+
+/*---------------------------------------------------------
+ * Report pages
+ *---------------------------------------------------------*/
+static void test_report(void)
+{
+    setup();
+
+    /* Nothing to report before a run */
+    can_selftest_report_poll();
+    sim_advance(SIM_MS(1));
+    CHECK_EQ(g_page_count, 0);
+
+    can_selftest_run(RUN_FRAMES);
+
+    /* One page per free TXB0, from the main loop */
+    for (uint8_t i = 0; i < 10 * CAN_SELFTEST_PAGES; i++)
+    {
+        can_selftest_report_poll();
+        sim_advance(SIM_US(100));
+    }
+    sim_advance(SIM_MS(1));
+
+    CHECK_EQ(g_page_count, CAN_SELFTEST_PAGES);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RESULT, 0), RUN_FRAMES);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RESULT, 1), 0);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RESULT, 2), 0);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RATE, 0), g_can_selftest.elapsed_ms);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RATE, 1), g_can_selftest.frames_per_s);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RATE, 2), 1);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_TX, 1), g_can_selftest.tx_cycles_avg);
+    CHECK_EQ(page_u16(CAN_SELFTEST_PAGE_RX, 1), g_can_selftest.rx_cycles_avg);
+}
+
+int main(void)
+{
+    printf("CAN self-test tests, node %d\n", HAL_NODE_ID);
+
+    /* First: the report state is static, "no run yet" only holds once */
+    UNIT_RUN(test_report);
+    UNIT_RUN(test_loopback);
+    UNIT_RUN(test_bus_traffic);
+
+    return UNIT_RESULT();
+}
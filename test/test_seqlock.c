@@ -0,0 +1,347 @@
+/***********************************************************************
+ *  File name   : test_seqlock.c
+ *  Description : ISR / main-loop sharing primitives (atomic.h).
+ *                A 4-byte value is loaded and stored one byte at a
+ *                time, as the 8-bit core does, with every byte equal
+ *                so a torn copy shows at once.
+ *                - Preemption model: a complete writer "ISR" run at
+ *                  every point of the reader, once and twice
+ *                - Threads: a second thread interrupts the reader
+ *                  (a signal, its handler is the writer ISR)
+ *                - The time-sync clock (tsync_local_us()) under the
+ *                  register model's timer interrupt
+ *                - Critical sections mask one enable bit and nest
+ *
+ ***********************************************************************/
+
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include "unit.h"
+#include "node.h"
+#include "atomic.h"
+#include "timesync.h"
+
+#if HAL_NODE_ID == 3
+#include "irq.h"
+#endif
+
+UNIT_STATE
+
+#define WIDE_LEN                    4U
+#define THREAD_IRQS                 5000U
+#define THREAD_IRQ_PERIOD_NS        20000L
+#define THREAD_BYTE_DELAY           200U
+#define CLOCK_RUN_MS                300U
+
+typedef struct
+{
+    uint8_t b[WIDE_LEN];
+} wide_t;
+
+static volatile uint8_t g_wide[WIDE_LEN];
+static seqlock_t        g_wide_seq;
+
+static uint8_t wide_torn(const wide_t *w)
+{
+    for (uint8_t i = 1; i < WIDE_LEN; i++)
+    {
+        if (w->b[i] != w->b[0])
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*---------------------------------------------------------
+ *  Preemption model: the hook runs the whole writer before
+ *  the chosen reader access (numbered from 0)
+ *---------------------------------------------------------*/
+static int g_fire_at[2];
+static int g_access;
+
+static void isr_write(void)
+{
+    uint8_t v = (uint8_t)(g_wide[0] + 1);
+
+    SEQLOCK_WRITE_BEGIN(g_wide_seq);
+    for (uint8_t i = 0; i < WIDE_LEN; i++)
+    {
+        g_wide[i] = v;
+    }
+    SEQLOCK_WRITE_END(g_wide_seq);
+}
+
+static void model_access(void)
+{
+    if (g_access == g_fire_at[0] || g_access == g_fire_at[1])
+    {
+        isr_write();
+    }
+
+    g_access++;
+}
+
+static uint8_t model_seq(void)
+{
+    model_access();
+    return g_wide_seq;
+}
+
+static wide_t model_copy(void)
+{
+    wide_t w;
+
+    for (uint8_t i = 0; i < WIDE_LEN; i++)
+    {
+        model_access();
+        w.b[i] = g_wide[i];
+    }
+
+    return w;
+}
+
+/*---------------------------------------------------------
+ * Preemption at every point
+ *---------------------------------------------------------*/
+static void test_preemption_model(void)
+{
+    /* Seqlock read: seq, 4 bytes, seq; retries add accesses */
+    const int points = 2 * (2 + WIDE_LEN) + 1;
+    uint32_t  runs = 0;
+    uint32_t  torn_plain = 0;
+    uint32_t  torn_locked = 0;
+    uint32_t  stale = 0;
+
+    for (int a = -1; a < points; a++)
+    {
+        for (int b = a; b < points; b++)
+        {
+            wide_t  w;
+            uint8_t before;
+
+            memset((void *)g_wide, 0x30, sizeof(g_wide));
+            g_wide_seq = 0;
+
+            /* Without the lock */
+            g_fire_at[0] = a;
+            g_fire_at[1] = (b == a) ? -1 : b;
+            g_access     = 0;
+            w = model_copy();
+            torn_plain += wide_torn(&w);
+
+            /* With it: a whole value, the one current at the end */
+            g_access = 0;
+            before   = g_wide[0];
+            SEQLOCK_READ(model_seq(), w, model_copy());
+            torn_locked += wide_torn(&w);
+            stale       += (w.b[0] != g_wide[0]);
+            runs++;
+
+            CHECK((uint8_t)(w.b[0] - before) <= 2);
+        }
+    }
+
+    printf("  %u interleavings: %u torn without the lock, %u with it\n",
+           runs, torn_plain, torn_locked);
+
+    CHECK(torn_plain > 0);
+    CHECK_EQ(torn_locked, 0);
+    CHECK_EQ(stale, 0);
+}
+
+/*---------------------------------------------------------
+ *  Threads: an interrupt source thread signals the reader
+ *  thread at random points; the handler is the ISR and runs
+ *  to completion on the reader's stack, as on the core
+ *---------------------------------------------------------*/
+static pthread_t        g_reader;
+static volatile uint8_t g_stop;
+static volatile uint32_t g_interrupts;
+
+static void isr_signal(int sig)
+{
+    (void)sig;
+
+    isr_write();
+    g_interrupts++;
+}
+
+static void *irq_source_thread(void *arg)
+{
+    const struct timespec period = { 0, THREAD_IRQ_PERIOD_NS };
+
+    (void)arg;
+
+    while (!g_stop)
+    {
+        pthread_kill(g_reader, SIGUSR1);
+        nanosleep(&period, NULL);
+    }
+
+    return NULL;
+}
+
+/* Byte loads spread out, so the copy is most of the reader's time */
+static wide_t slow_copy(void)
+{
+    wide_t w;
+
+    for (uint8_t i = 0; i < WIDE_LEN; i++)
+    {
+        w.b[i] = g_wide[i];
+
+        for (volatile uint16_t d = 0; d < THREAD_BYTE_DELAY; d++)
+        {
+        }
+    }
+
+    return w;
+}
+
+/*---------------------------------------------------------
+ * Interrupts from another thread
+ *---------------------------------------------------------*/
+static void test_threads(void)
+{
+    struct sigaction sa;
+    pthread_t source;
+    uint32_t  reads = 0;
+    uint32_t  torn_plain = 0;
+    uint32_t  torn_locked = 0;
+
+    memset((void *)g_wide, 0, sizeof(g_wide));
+    g_wide_seq   = 0;
+    g_interrupts = 0;
+    g_stop       = 0;
+    g_reader     = pthread_self();
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = isr_signal;
+    sa.sa_flags   = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    CHECK_EQ(sigaction(SIGUSR1, &sa, NULL), 0);
+
+    CHECK_EQ(pthread_create(&source, NULL, irq_source_thread, NULL), 0);
+
+    while (g_interrupts < THREAD_IRQS)
+    {
+        wide_t w = slow_copy();
+
+        torn_plain += wide_torn(&w);
+
+        SEQLOCK_READ(g_wide_seq, w, slow_copy());
+        torn_locked += wide_torn(&w);
+        reads++;
+    }
+
+    g_stop = 1;
+    pthread_join(source, NULL);
+    signal(SIGUSR1, SIG_DFL);
+
+    printf("  %u interrupts, %u reads each: %u torn without the lock, %u with it\n",
+           g_interrupts, reads, torn_plain, torn_locked);
+
+    CHECK(torn_plain > 0);
+    CHECK_EQ(torn_locked, 0);
+}
+
+/*---------------------------------------------------------
+ * Time-sync clock against the timer overflow interrupt
+ *---------------------------------------------------------*/
+static void test_local_clock(void)
+{
+    const uint32_t tol_us = (uint32_t)(TSYNC_US_NUM / TSYNC_US_DEN + 1);
+    uint64_t start;
+    uint32_t first;
+    uint32_t last;
+    uint32_t calls = 0;
+    uint32_t backwards = 0;
+    uint32_t worst = 0;
+
+    sim_init();
+    NODE_ISR_INSTALL();
+#if HAL_NODE_ID == 3
+    init_irq();
+#endif
+    tsync_init();
+    PEIE = 1;
+    GIE  = 1;
+
+    start = sim_now();
+    first = last = tsync_local_us();
+
+    while (sim_now() - start < SIM_MS(CLOCK_RUN_MS))
+    {
+        uint32_t now = tsync_local_us();
+        uint32_t ref = first + (uint32_t)((sim_now() - start) / SIM_CYCLES_PER_US);
+        uint32_t err = (now > ref) ? now - ref : ref - now;
+
+        backwards += (now < last);
+        worst      = (err > worst) ? err : worst;
+        last       = now;
+        calls++;
+
+        /* Shift the reads against the overflow by one cycle */
+        if (calls % 97 == 0)
+        {
+            sim_advance(1);
+        }
+    }
+
+    printf("  %u reads over %u timer overflows: %u backwards, worst error %u us\n",
+           calls, g_sim.irq_entries[0] + g_sim.irq_entries[1], backwards, worst);
+
+    CHECK(g_sim.irq_entries[0] + g_sim.irq_entries[1] >= 2);
+    CHECK_EQ(backwards, 0);
+    CHECK(worst <= tol_us);
+}
+
+/*---------------------------------------------------------
+ * Critical sections
+ *---------------------------------------------------------*/
+static void test_critical(void)
+{
+    uint8_t outer;
+    uint8_t inner;
+
+    sim_init();
+    GIE    = 1;
+    TMR2IE = 1;
+    TMR1IE = 1;
+
+    CRITICAL_ENTER(outer, TMR2IE);
+    CHECK_EQ(TMR2IE, 0);
+
+    /* Only the shared source is masked */
+    CHECK_EQ(GIE, 1);
+    CHECK_EQ(TMR1IE, 1);
+
+    CRITICAL_ENTER(inner, TMR2IE);
+    CRITICAL_EXIT(inner, TMR2IE);
+    CHECK_EQ(TMR2IE, 0);
+
+    CRITICAL_EXIT(outer, TMR2IE);
+    CHECK_EQ(TMR2IE, 1);
+
+    /* Not enabled yet: stays off */
+    TMR2IE = 0;
+    CRITICAL_ENTER(outer, TMR2IE);
+    CRITICAL_EXIT(outer, TMR2IE);
+    CHECK_EQ(TMR2IE, 0);
+}
+
+int main(void)
+{
+    printf("Seqlock tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_preemption_model);
+    UNIT_RUN(test_threads);
+    UNIT_RUN(test_local_clock);
+    UNIT_RUN(test_critical);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,258 @@
+/***********************************************************************
+ *  File name   : test_signal_store.c
+ *  Description : ECU3 receive path against LCD speed, with the CLCD
+ *                busy time of the register model (37 us a command).
+ *                SPEED frames, each a new value, are offered at
+ *                rising rates; the highest rate with no frame lost
+ *                is the sustained rate:
+ *                - decoupled: the receive path only writes the
+ *                  signal store, msg_handler_render_poll() draws
+ *                  at most once per RENDER_SPEED_MS
+ *                - coupled: every frame drawn from the receive
+ *                  path, as handle_speed_data() did before the
+ *                  signal store
+ *                Also the store itself: versions, stamps, the value
+ *                left on screen after a burst.
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "irq.h"
+#include "tick.h"
+#include "can.h"
+#include "clcd.h"
+#include "screen.h"
+#include "msg_id.h"
+#include "e2e.h"
+#include "msg_handler.h"
+#include "signal_store.h"
+
+UNIT_STATE
+
+#define BURST_FRAMES                1500U
+#define SPEED_FRAME_LEN             (E2E_HEADER_LEN + 3)
+
+static e2e_tx_t g_speed_tx;
+static uint8_t  g_coupled;
+static uint8_t  g_direct_version;
+
+static void setup(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+    CHECK_EQ(init_can(), 1);
+    init_msg_handler();
+
+    clcd_init_start();
+    while (!clcd_init_poll())
+    {
+        sim_advance(SIM_MS(1));
+    }
+    msg_handler_display_ready();
+
+    memset(&g_speed_tx, 0, sizeof(g_speed_tx));
+    g_direct_version = signal_version(e_sig_speed);
+}
+
+static void speed_text(uint16_t speed, unsigned char *text)
+{
+    text[0] = (unsigned char)('0' + speed / 100 % 10);
+    text[1] = (unsigned char)('0' + speed / 10 % 10);
+    text[2] = (unsigned char)('0' + speed % 10);
+}
+
+/* Protected SPEED frame completing on the bus at 'at' */
+static void speed_frame(uint64_t at, uint16_t speed)
+{
+    uint8_t       frame[CAN_MAX_DLC];
+    unsigned char text[3];
+    uint8_t       len;
+
+    speed_text(speed, text);
+    len = e2e_protect(&g_speed_tx, SPEED_MSG_ID, frame, text, sizeof(text));
+    sim_can_rx(at, SPEED_MSG_ID, frame, len);
+}
+
+/* Draw the field from the receive path, every frame */
+static void draw_direct(void)
+{
+    signal_t      entry;
+    unsigned char text[4];
+
+    if (signal_version(e_sig_speed) == g_direct_version)
+    {
+        return;
+    }
+
+    signal_read(e_sig_speed, &entry);
+    g_direct_version = entry.version;
+
+    speed_text(entry.value, text);
+    text[3] = '\0';
+    clcd_print(text, LINE2(0));
+}
+
+/* One main-loop pass */
+static void loop_pass(void)
+{
+    process_canbus_data();
+
+    if (g_coupled)
+    {
+        draw_direct();
+    }
+    else
+    {
+        msg_handler_render_poll();
+    }
+}
+
+/*
+ * Offer BURST_FRAMES at 'fps'; returns the frames lost (ring
+ * or hardware buffers full). *lcd_writes gets the LCD bus
+ * writes the burst cost.
+ */
+static uint32_t offer(uint32_t fps, uint32_t *lcd_writes)
+{
+    uint64_t period = SIM_MS(1000) / fps;
+    uint64_t start = sim_now() + SIM_MS(1);
+    uint64_t end = start + period * BURST_FRAMES;
+    uint32_t lost = g_can_rx_overruns + g_sim.can_rx_overflow;
+    uint16_t writes = g_screen_writes;
+    uint32_t clcd_writes = 0;
+    uint8_t  last_version = signal_version(e_sig_speed);
+    uint32_t versions = 0;
+
+    for (uint32_t i = 0; i < BURST_FRAMES; i++)
+    {
+        speed_frame(start + period * i, (uint16_t)(i % 1000));
+    }
+
+    while (sim_now() < end + SIM_MS(2 * RENDER_SPEED_MS))
+    {
+        loop_pass();
+
+        if (signal_version(e_sig_speed) != last_version)
+        {
+            versions += (uint8_t)(signal_version(e_sig_speed) - last_version);
+            last_version = signal_version(e_sig_speed);
+
+            /* Direct draws bypass the screen layer: 4 commands */
+            clcd_writes += g_coupled ? 4 : 0;
+        }
+
+        /* Core idles until the next interrupt */
+        sim_advance(SIM_US(1));
+    }
+
+    /* Every frame that was not lost reached the store */
+    lost = g_can_rx_overruns + g_sim.can_rx_overflow - lost;
+    CHECK_EQ(versions + lost, BURST_FRAMES);
+
+    *lcd_writes = (uint16_t)(g_screen_writes - writes) + clcd_writes;
+
+    return lost;
+}
+
+/* Highest rate in steps of 250 frames/s with nothing lost */
+static uint32_t sustained(uint8_t coupled, uint32_t bus_fps, uint32_t *lcd_writes)
+{
+    uint32_t best = 0;
+
+    setup();
+    g_coupled = coupled;
+
+    for (uint32_t fps = 250; fps <= bus_fps; fps += 250)
+    {
+        uint32_t writes;
+
+        if (offer(fps, &writes) != 0)
+        {
+            break;
+        }
+
+        best        = fps;
+        *lcd_writes = writes;
+    }
+
+    return best;
+}
+
+/*---------------------------------------------------------
+ * Sustained frame rate with and without the store
+ *---------------------------------------------------------*/
+static void test_throughput(void)
+{
+    uint32_t bus_fps = (uint32_t)(SIM_MS(1000) / sim_can_frame_cycles(SPEED_FRAME_LEN));
+    uint32_t coupled_writes = 0;
+    uint32_t decoupled_writes = 0;
+    uint32_t coupled = sustained(1, bus_fps, &coupled_writes);
+    uint32_t decoupled = sustained(0, bus_fps, &decoupled_writes);
+    uint32_t burst_ms;
+
+    printf("  SPEED frames sustained: %u/s drawn per frame, %u/s through the store"
+           " (bus allows %u/s)\n", coupled, decoupled, bus_fps);
+    printf("  LCD writes for %u frames at that rate: %u drawn per frame, %u"
+           " through the store\n", BURST_FRAMES, coupled_writes, decoupled_writes);
+
+    /* The store keeps up with the bus; the direct path never does
+     * better and pays an LCD field per frame for it */
+    CHECK(decoupled + 250 > bus_fps);
+    CHECK(coupled > 0);
+    CHECK(coupled <= decoupled);
+    CHECK(decoupled_writes * 50 < coupled_writes);
+
+    /* Each burst lasts at least BURST_FRAMES / bus_fps: the render task
+     * draws about once per RENDER_SPEED_MS meanwhile, 4 writes at most */
+    burst_ms = BURST_FRAMES * 1000U / decoupled;
+    CHECK(decoupled_writes <= 4 * (burst_ms / RENDER_SPEED_MS + 2));
+}
+
+/*---------------------------------------------------------
+ * Store contents after a burst
+ *---------------------------------------------------------*/
+static void test_latest_value(void)
+{
+    signal_t entry;
+    uint8_t  version;
+    uint32_t writes;
+
+    setup();
+    g_coupled = 0;
+
+    version = signal_version(e_sig_speed);
+    CHECK_EQ(offer(1000, &writes), 0);
+
+    /* Version moved once per frame, stamp from the last one */
+    signal_read(e_sig_speed, &entry);
+    CHECK_EQ((uint8_t)(entry.version - version), (uint8_t)BURST_FRAMES);
+    CHECK(entry.valid);
+    CHECK_EQ(entry.value, (BURST_FRAMES - 1) % 1000);
+    CHECK(tick_now() - entry.stamp <= TICK_FROM_MS(2 * RENDER_SPEED_MS) + 1);
+
+    /* The last value is on screen once the render period ran out */
+    CHECK_EQ(sim_lcd_char(1, 0), '0' + entry.value / 100 % 10);
+    CHECK_EQ(sim_lcd_char(1, 1), '0' + entry.value / 10 % 10);
+    CHECK_EQ(sim_lcd_char(1, 2), '0' + entry.value % 10);
+
+    /* Invalidation is a change too */
+    version = signal_version(e_sig_speed);
+    signal_invalidate(e_sig_speed);
+    CHECK(signal_version(e_sig_speed) != version);
+    signal_read(e_sig_speed, &entry);
+    CHECK(!entry.valid);
+}
+
+int main(void)
+{
+    printf("Signal store tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_throughput);
+    UNIT_RUN(test_latest_value);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,225 @@
+/***********************************************************************
+ *  File name   : test_sw_timer.c
+ *  Description : ECU3 system tick and timer wheel.
+ *                - Timer2 tick: interrupt rate and CPU share of the
+ *                  tick ISR, against the old 50 us Timer0 interrupt
+ *                - Host cost of the tick ISR body and of one wheel
+ *                  step with thousands of armed timers
+ *                - Expiry accuracy: thousands of one-shot and
+ *                  periodic timers, every expiry on its exact tick
+ *
+ ***********************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "unit.h"
+#include "node.h"
+#include "tick.h"
+#include "irq.h"
+#include "sw_timer.h"
+
+UNIT_STATE
+
+#define TIMERS                      4000U
+#define RUN_TICKS                   70000UL     /* Beyond the longest delay */
+#define OLD_TIMER0_IRQ_PER_S        20000UL     /* TMR0 + 9 reload, 50 us */
+
+static sw_timer_t g_timers[TIMERS];
+static uint32_t   g_expected[RUN_TICKS + 1];
+static uint32_t   g_fired[RUN_TICKS + 1];
+
+static void on_expiry(void)
+{
+    uint32_t now = tick_now();
+
+    if (now <= RUN_TICKS)
+    {
+        g_fired[now]++;
+    }
+}
+
+static double host_ns(clock_t start, uint32_t count)
+{
+    return (double)(clock() - start) * 1e9 / CLOCKS_PER_SEC / count;
+}
+
+/*---------------------------------------------------------
+ * Tick interrupt rate and CPU share
+ *---------------------------------------------------------*/
+static void test_tick_rate(void)
+{
+    uint32_t irq_per_s;
+    double   share;
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+
+    sim_advance(SIM_MS(1000));
+
+    irq_per_s = g_sim.irq_entries[0];
+    share     = 100.0 * irq_per_s * SIM_ISR_ENTRY_CYCLES / SIM_MS(1000);
+
+    printf("  tick: %u IRQ/s, %.2f%% CPU in entry/exit (Timer0 design: %lu IRQ/s, %.2f%%)\n",
+           irq_per_s, share, OLD_TIMER0_IRQ_PER_S,
+           100.0 * OLD_TIMER0_IRQ_PER_S * SIM_ISR_ENTRY_CYCLES / SIM_MS(1000));
+
+    CHECK_EQ(tick_now(), 1000);
+    CHECK_EQ(irq_per_s, 1000000UL / TICK_PERIOD_US);
+    CHECK(share < 1.0);
+}
+
+/*---------------------------------------------------------
+ * Host cost of the tick ISR body (seqlock + increment)
+ *---------------------------------------------------------*/
+static void test_tick_isr_cost(void)
+{
+    const uint32_t loops = 10000000UL;
+    clock_t        start;
+
+    sim_init();
+    g_tick_count = 0;
+
+    start = clock();
+
+    for (uint32_t i = 0; i < loops; i++)
+    {
+        TICK_ISR();
+    }
+
+    printf("  TICK_ISR body: %.2f ns on the host\n", host_ns(start, loops));
+
+    CHECK_EQ(g_tick_count, loops);
+    CHECK_EQ(tick_now(), loops);
+}
+
+/*---------------------------------------------------------
+ * Thousands of timers, every expiry on its exact tick
+ *---------------------------------------------------------*/
+static void test_expiry_accuracy(void)
+{
+    uint32_t periodic = 0;
+    uint32_t total = 0;
+    uint32_t wrong = 0;
+    uint32_t worst_step = 0;
+    clock_t  start;
+
+    sim_init();
+    srand(26);
+
+    memset(g_expected, 0, sizeof(g_expected));
+    memset(g_fired, 0, sizeof(g_fired));
+    memset(g_timers, 0, sizeof(g_timers));
+
+    g_tick_count = 0;
+    sw_timer_init();
+
+    for (uint32_t i = 0; i < TIMERS; i++)
+    {
+        /* Delays across all three wheel levels and past their range */
+        uint16_t delay  = (uint16_t)(1 + rand() % ((i % 4 == 0) ? 65535 : 2000));
+        uint16_t period = (i % 3 == 0) ? (uint16_t)(1 + rand() % 5000) : 0;
+
+        sw_timer_start(&g_timers[i], delay, period, on_expiry);
+
+        for (uint32_t at = delay; at <= RUN_TICKS; at += period)
+        {
+            g_expected[at]++;
+
+            if (period == 0)
+            {
+                break;
+            }
+        }
+
+        periodic += (period != 0);
+    }
+
+    start = clock();
+
+    for (uint32_t now = 1; now <= RUN_TICKS; now++)
+    {
+        clock_t step = clock();
+
+        g_tick_count = now;
+        sw_timer_poll();
+
+        step = clock() - step;
+
+        if ((uint32_t)step > worst_step)
+        {
+            worst_step = (uint32_t)step;
+        }
+    }
+
+    printf("  %u timers (%u periodic), %.0f ns per wheel step, worst %.0f us\n",
+           TIMERS, periodic, host_ns(start, RUN_TICKS),
+           (double)worst_step * 1e6 / CLOCKS_PER_SEC);
+
+    for (uint32_t t = 0; t <= RUN_TICKS; t++)
+    {
+        total += g_fired[t];
+        wrong += (g_fired[t] != g_expected[t]);
+    }
+
+    CHECK_EQ(wrong, 0);
+    CHECK(total > TIMERS);
+
+    /* One-shots are disarmed after expiry, periodic ones stay armed */
+    for (uint32_t i = 0; i < TIMERS; i++)
+    {
+        CHECK_EQ(sw_timer_active(&g_timers[i]), g_timers[i].period != 0);
+        sw_timer_stop(&g_timers[i]);
+    }
+}
+
+/*---------------------------------------------------------
+ * Stop and restart from a callback, late polling
+ *---------------------------------------------------------*/
+static sw_timer_t g_self;
+static uint32_t   g_self_runs;
+
+static void on_self(void)
+{
+    g_self_runs++;
+
+    /* Re-arm with a different delay from inside the callback */
+    sw_timer_start(&g_self, 7, 0, on_self);
+}
+
+static void test_rearm_and_catch_up(void)
+{
+    sim_init();
+    g_tick_count = 0;
+    g_self_runs  = 0;
+    memset(&g_self, 0, sizeof(g_self));
+
+    sw_timer_init();
+    sw_timer_start(&g_self, 3, 0, on_self);
+
+    /* Polled late: the wheel catches up tick by tick */
+    g_tick_count = 3 + 7 * 9;
+    sw_timer_poll();
+
+    CHECK_EQ(g_self_runs, 10);
+    CHECK(sw_timer_active(&g_self));
+
+    sw_timer_stop(&g_self);
+    g_tick_count += 100;
+    sw_timer_poll();
+    CHECK_EQ(g_self_runs, 10);
+}
+
+int main(void)
+{
+    printf("Timer wheel tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_tick_rate);
+    UNIT_RUN(test_tick_isr_cost);
+    UNIT_RUN(test_expiry_accuracy);
+    UNIT_RUN(test_rearm_and_catch_up);
+
+    return UNIT_RESULT();
+}
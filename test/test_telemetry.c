@@ -0,0 +1,472 @@
+/***********************************************************************
+ *  File name   : test_telemetry.c
+ *  Description : ECU3 serial telemetry on the register model's
+ *                EUSART, decoded by the host viewer: the bytes the
+ *                TX interrupt shifts out are written to a pty and
+ *                tools/telemetry_view.py --raw reads the other end.
+ *                - every record type and signal, payloads with
+ *                  zeros (COBS), decoded back to the same values
+ *                - the TX-interrupt ring keeps the line busy: one
+ *                  byte time between bytes, TXIE off once drained
+ *                - ring full: whole records dropped, the viewer
+ *                  sees the same count as sequence gaps
+ *                - a corrupted and a cut record: CRC and framing
+ *                  errors, the records around them still decoded
+ *                - node_main() mirroring the bus traffic it gets
+ *
+ ***********************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "unit.h"
+#include "node.h"
+#include "irq.h"
+#include "uart.h"
+#include "telemetry.h"
+#include "can.h"
+#include "msg_id.h"
+#include "e2e.h"
+
+UNIT_STATE
+
+/* Tests run from test/ (make -C test) */
+#define VIEWER                      "python3 -u ../tools/telemetry_view.py --raw"
+#define VIEWER_TIMEOUT_MS           10000
+
+/* 8N1: 10 bit times per byte */
+#define BYTE_CYCLES                 (10ULL * _XTAL_FREQ / 4ULL / UART_ACTUAL_BAUD)
+
+#define MAX_BYTES                   4096U
+#define MAX_LINES                   64U
+#define LINE_LEN                    64U
+
+/*---------------------------------------------------------
+ * EUSART capture
+ *---------------------------------------------------------*/
+static uint8_t  g_bytes[MAX_BYTES];
+static uint32_t g_byte_count;
+static uint64_t g_byte_at;
+static uint64_t g_gap_max;
+
+static void on_uart_byte(uint8_t byte)
+{
+    if (g_byte_count != 0 && sim_now() - g_byte_at > g_gap_max)
+    {
+        g_gap_max = sim_now() - g_byte_at;
+    }
+
+    g_byte_at = sim_now();
+
+    if (g_byte_count < MAX_BYTES)
+    {
+        g_bytes[g_byte_count++] = byte;
+    }
+}
+
+static void setup(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_telemetry();
+    sim_uart_on_tx(on_uart_byte);
+
+    g_byte_count = 0;
+    g_gap_max    = 0;
+}
+
+/* Lets the TX interrupt drain the ring */
+static void drain(void)
+{
+    while (!uart_tx_idle() && sim_now() < SIM_MS(60000))
+    {
+        sim_advance(SIM_US(100));
+    }
+}
+
+/*---------------------------------------------------------
+ * Expected viewer output (format_record())
+ *---------------------------------------------------------*/
+static char     g_expect[MAX_LINES][LINE_LEN];
+static uint32_t g_expected;
+
+static void expect_can(uint16_t id, const uint8_t *data, uint8_t len)
+{
+    char *line = g_expect[g_expected++];
+    int   n    = sprintf(line, "CAN 0x%03X [%u] ", id, len);
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        n += sprintf(line + n, (i == 0) ? "%02x" : " %02x", data[i]);
+    }
+}
+
+static void expect_signal(const char *name, uint16_t value)
+{
+    sprintf(g_expect[g_expected++], "SIG %-9s %u", name, value);
+}
+
+/*---------------------------------------------------------
+ * Viewer on a pty
+ *  The bytes go to the master side, the viewer reads the
+ *  slave side; once it has printed 'records' lines the
+ *  master is closed and the viewer prints its totals.
+ *---------------------------------------------------------*/
+static char     g_lines[MAX_LINES + 1][LINE_LEN];
+static uint32_t g_line_count;
+
+static void split_lines(char *text)
+{
+    char *line = strtok(text, "\n");
+
+    g_line_count = 0;
+
+    while (line != NULL && g_line_count <= MAX_LINES)
+    {
+        snprintf(g_lines[g_line_count++], LINE_LEN, "%s", line);
+        line = strtok(NULL, "\n");
+    }
+}
+
+static uint8_t run_viewer(const uint8_t *bytes, uint32_t len, uint32_t records)
+{
+    static char    out[(MAX_LINES + 1) * LINE_LEN];
+    size_t         out_len = 0;
+    uint32_t       lines   = 0;
+    struct termios raw;
+    char           cmd[256];
+    FILE          *viewer;
+    int            master;
+    int            slave;
+    int            fd;
+
+    /* Neither end may leak into the viewer, or closing the master
+     * would not hang up the slave */
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        return 0;
+    }
+
+    /* Raw before the first byte, so nothing is translated */
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave < 0)
+    {
+        close(master);
+        return 0;
+    }
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+
+    snprintf(cmd, sizeof(cmd), VIEWER " %s", ptsname(master));
+    viewer = popen(cmd, "r");
+    if (viewer == NULL)
+    {
+        close(slave);
+        close(master);
+        return 0;
+    }
+    fd = fileno(viewer);
+
+    for (uint32_t done = 0; done < len; )
+    {
+        ssize_t n = write(master, bytes + done, len - done);
+
+        if (n <= 0)
+        {
+            break;
+        }
+        done += (uint32_t)n;
+    }
+
+    /* Wait for the records, then hang up and collect the totals */
+    for (;;)
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        ssize_t       n;
+
+        if (lines >= records && master >= 0)
+        {
+            close(master);
+            master = -1;
+        }
+
+        if (poll(&pfd, 1, VIEWER_TIMEOUT_MS) <= 0)
+        {
+            break;
+        }
+
+        n = read(fd, out + out_len, sizeof(out) - 1 - out_len);
+        if (n <= 0)
+        {
+            break;
+        }
+
+        for (ssize_t i = 0; i < n; i++)
+        {
+            lines += (out[out_len + i] == '\n');
+        }
+        out_len += (size_t)n;
+    }
+
+    if (master >= 0)
+    {
+        close(master);
+    }
+    close(slave);
+    pclose(viewer);
+
+    out[out_len] = '\0';
+    split_lines(out);
+
+    return 1;
+}
+
+/* Every expected record, in order, then the given totals */
+static uint8_t viewer_shows(const char *totals)
+{
+    if (g_line_count != g_expected + 1)
+    {
+        printf("  viewer printed %u lines, expected %u\n", g_line_count, g_expected + 1);
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < g_expected; i++)
+    {
+        if (strcmp(g_lines[i], g_expect[i]) != 0)
+        {
+            printf("  line %u: \"%s\", expected \"%s\"\n", i, g_lines[i], g_expect[i]);
+            return 0;
+        }
+    }
+
+    if (strcmp(g_lines[g_expected], totals) != 0)
+    {
+        printf("  totals: \"%s\", expected \"%s\"\n", g_lines[g_expected], totals);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Records decoded by the viewer
+ *---------------------------------------------------------*/
+static void test_records(void)
+{
+    static const uint8_t zeros[8]  = { 0 };
+    static const uint8_t speed[3]  = { '0', '4', '2' };
+    static const uint8_t mixed[8]  = { 0x00, 0x01, 0x00, 0xFF, 0x00, 0x00, 0x7E, 0x00 };
+    static const uint8_t nine[9]   = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    uint64_t start;
+    char     totals[LINE_LEN];
+
+    setup();
+    g_expected = 0;
+    start = sim_now();
+
+    telemetry_can_frame(SPEED_MSG_ID, speed, sizeof(speed));
+    expect_can(SPEED_MSG_ID, speed, sizeof(speed));
+    telemetry_can_frame(0x000, zeros, sizeof(zeros));
+    expect_can(0x000, zeros, sizeof(zeros));
+    telemetry_can_frame(0x7FF, mixed, sizeof(mixed));
+    expect_can(0x7FF, mixed, sizeof(mixed));
+
+    /* DLC above 8 is cut to 8 */
+    telemetry_can_frame(0x123, nine, sizeof(nine));
+    expect_can(0x123, nine, 8);
+
+    telemetry_signal(TELE_SIG_SPEED, 42);
+    expect_signal("speed", 42);
+    telemetry_signal(TELE_SIG_GEAR, 0);
+    expect_signal("gear", 0);
+    telemetry_signal(TELE_SIG_RPM, 0xFFFF);
+    expect_signal("rpm", 0xFFFF);
+    telemetry_signal(TELE_SIG_INDICATOR, 3);
+    expect_signal("indicator", 3);
+    telemetry_signal(TELE_SIG_COLLISION, 256);
+    expect_signal("collision", 256);
+
+    /* Queued in one go, nothing sent yet */
+    CHECK_EQ(g_tele_dropped, 0);
+    CHECK_EQ(g_byte_count, 0);
+    CHECK_EQ(TXIE, 1);
+
+    drain();
+
+    /* Back to back on the line, the interrupt off once drained */
+    printf("  %u records, %u bytes in %llu us, %llu cycles between bytes at most\n",
+           g_expected, g_byte_count,
+           (unsigned long long)((sim_now() - start) / SIM_CYCLES_PER_US),
+           (unsigned long long)g_gap_max);
+    CHECK_EQ(g_sim.uart_tx_bytes, g_byte_count);
+    CHECK_EQ(g_gap_max, BYTE_CYCLES);
+    CHECK_EQ(TXIE, 0);
+    CHECK_EQ(uart_tx_free(), UART_TX_RING_SIZE - 1);
+
+    /* Only the delimiters are zero */
+    {
+        uint32_t delimiters = 0;
+
+        for (uint32_t i = 0; i < g_byte_count; i++)
+        {
+            delimiters += (g_bytes[i] == 0x00);
+        }
+        CHECK_EQ(delimiters, g_expected);
+        CHECK_EQ(g_bytes[g_byte_count - 1], 0x00);
+    }
+
+    CHECK(run_viewer(g_bytes, g_byte_count, g_expected));
+    sprintf(totals, "records %u  lost 0  crc errors 0  framing errors 0", g_expected);
+    CHECK(viewer_shows(totals));
+}
+
+/*---------------------------------------------------------
+ * Ring full: whole records dropped, seen as a gap
+ *---------------------------------------------------------*/
+static void test_ring_full(void)
+{
+    static const uint8_t data[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    uint16_t queued = 0;
+    char     totals[LINE_LEN];
+
+    setup();
+    g_expected = 0;
+
+    /* 16 bytes per 8-byte frame: 15 fit in the ring */
+    for (uint8_t i = 0; i < 30; i++)
+    {
+        uint16_t dropped = g_tele_dropped;
+
+        telemetry_can_frame((uint16_t)(0x100 + i), data, sizeof(data));
+
+        if (g_tele_dropped == dropped)
+        {
+            expect_can((uint16_t)(0x100 + i), data, sizeof(data));
+            queued++;
+        }
+    }
+
+    CHECK_EQ(queued, (UART_TX_RING_SIZE - 1) / TELE_MAX_FRAME);
+    CHECK_EQ(g_tele_dropped, 30 - queued);
+
+    /* Room again once sent: the next record shows the gap */
+    drain();
+    telemetry_signal(TELE_SIG_SPEED, 7);
+    expect_signal("speed", 7);
+    drain();
+
+    /* Nothing half-sent: every record on the line is whole */
+    CHECK_EQ(g_byte_count, (uint32_t)queued * TELE_MAX_FRAME + 8);
+
+    CHECK(run_viewer(g_bytes, g_byte_count, g_expected));
+    sprintf(totals, "records %u  lost %u  crc errors 0  framing errors 0",
+            g_expected, g_tele_dropped);
+    CHECK(viewer_shows(totals));
+}
+
+/*---------------------------------------------------------
+ * Damaged bytes on the line
+ *---------------------------------------------------------*/
+static void test_line_errors(void)
+{
+    uint8_t  stream[MAX_BYTES];
+    uint32_t len = 0;
+    uint32_t second;
+
+    setup();
+    g_expected = 0;
+
+    telemetry_signal(TELE_SIG_SPEED, 10);
+    drain();
+    second = g_byte_count;
+    telemetry_signal(TELE_SIG_SPEED, 20);
+    drain();
+    telemetry_signal(TELE_SIG_SPEED, 30);
+    drain();
+
+    /* Tail of a record the viewer joined in the middle of */
+    stream[len++] = 0x11;
+    stream[len++] = 0x22;
+    stream[len++] = 0x00;
+
+    memcpy(stream + len, g_bytes, g_byte_count);
+
+    /* Second record: the value byte changed on the line */
+    stream[len + second + 4] ^= 0x40;
+    len += g_byte_count;
+
+    expect_signal("speed", 10);
+    expect_signal("speed", 30);
+
+    CHECK(run_viewer(stream, len, g_expected));
+    CHECK(viewer_shows("records 2  lost 1  crc errors 1  framing errors 1"));
+}
+
+/*---------------------------------------------------------
+ * node_main() mirroring received frames
+ *---------------------------------------------------------*/
+static void test_node_bridge(void)
+{
+    static const uint8_t speed[3] = { '0', '4', '2' };
+    static const uint8_t gear[1]  = { 3 };
+    e2e_tx_t speed_tx;
+    e2e_tx_t gear_tx;
+    uint8_t  speed_frame[CAN_MAX_DLC];
+    uint8_t  gear_frame[CAN_MAX_DLC];
+    uint8_t  speed_len;
+    uint8_t  gear_len;
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    sim_uart_on_tx(on_uart_byte);
+    g_byte_count = 0;
+    g_gap_max    = 0;
+    g_expected   = 0;
+
+    sim_node_start(node_main);
+    sim_node_run(SIM_MS(100));
+
+    memset(&speed_tx, 0, sizeof(speed_tx));
+    memset(&gear_tx, 0, sizeof(gear_tx));
+    speed_len = e2e_protect(&speed_tx, SPEED_MSG_ID, speed_frame, speed, sizeof(speed));
+    gear_len  = e2e_protect(&gear_tx, GEAR_MSG_ID, gear_frame, gear, sizeof(gear));
+
+    sim_can_rx(0, SPEED_MSG_ID, speed_frame, speed_len);
+    sim_node_run(SIM_MS(20));
+    sim_can_rx(0, GEAR_MSG_ID, gear_frame, gear_len);
+    sim_node_run(SIM_MS(20));
+
+    /* Raw frame first, then the decoded value */
+    expect_can(SPEED_MSG_ID, speed_frame, speed_len);
+    expect_signal("speed", 42);
+    expect_can(GEAR_MSG_ID, gear_frame, gear_len);
+    expect_signal("gear", 3);
+
+    CHECK_EQ(g_tele_dropped, 0);
+    CHECK(uart_tx_idle());
+
+    CHECK(run_viewer(g_bytes, g_byte_count, g_expected));
+    CHECK(viewer_shows("records 4  lost 0  crc errors 0  framing errors 0"));
+}
+
+int main(void)
+{
+    printf("Telemetry tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_records);
+    UNIT_RUN(test_ring_full);
+    UNIT_RUN(test_line_errors);
+    UNIT_RUN(test_node_bridge);
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,290 @@
+/***********************************************************************
+ *  File name   : test_timesync.c
+ *  Description : SYNC/FUP network time, with the node's main() running.
+ *                - ECU1/ECU2 (slaves): the test is the time master,
+ *                  its crystal deliberately off by up to +-3000 ppm
+ *                  and its clock far from the slave's; after the
+ *                  first few pairs the slave's tsync_now_us() is
+ *                  compared with the master clock every millisecond
+ *                  (residual error) and the drift estimate with the
+ *                  skew
+ *                - ECU3 (master): each FUP carries the time its SYNC
+ *                  left the bus, on the master's local clock
+ *
+ ***********************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "msg_id.h"
+#include "nm.h"
+#include "timesync.h"
+
+UNIT_STATE
+
+#define STEP_CYCLES                 SIM_MS(1)
+
+/* Peer heartbeat keeps the node out of bus sleep */
+#define PEER_NODE                   (HAL_NODE_ID % NM_NODE_COUNT + 1)
+
+static uint64_t g_next_heartbeat;
+
+static void heartbeat(void)
+{
+    const uint8_t hb[NM_FRAME_LEN] = { PEER_NODE, 0, e_nm_normal, 0, 0 };
+
+    if (sim_now() >= g_next_heartbeat)
+    {
+        sim_can_rx(0, NM_MSG_ID_BASE + PEER_NODE, hb, sizeof(hb));
+        g_next_heartbeat = sim_now() + SIM_US(NM_CYCLE_US);
+    }
+}
+
+static void start_node(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    g_next_heartbeat = 0;
+
+    sim_node_start(node_main);
+}
+
+#if !TSYNC_MASTER
+/*---------------------------------------------------------
+ *  Slave: the test is the master
+ *---------------------------------------------------------*/
+#define RUN_S                       30U
+#define CONVERGE_S                  8U
+#define MASTER_START_US             1234567890UL
+
+/* Residual error bound after convergence: the RX interrupt's
+ * stamp latency, Timer3 resolution (1.6 us) and the drift
+ * estimate's rounding */
+#define RESIDUAL_MAX_US             25
+
+typedef struct
+{
+    double   ppm;                   /* Master crystal error */
+    uint8_t  seq;
+    uint64_t next_sync;
+    uint64_t fup_at;                /* 0 = no FUP pending */
+    uint32_t fup_time;
+} master_t;
+
+static master_t g_master;
+
+/* Master clock at a simulated instant */
+static uint32_t master_us(uint64_t cycles)
+{
+    double us = (double)cycles / SIM_CYCLES_PER_US * (1.0 + g_master.ppm * 1e-6);
+
+    return MASTER_START_US + (uint32_t)llround(us);
+}
+
+static void master_send(uint8_t type, uint32_t time_us)
+{
+    uint8_t frame[TSYNC_FRAME_LEN];
+
+    frame[0] = type;
+    frame[1] = g_master.seq;
+    frame[2] = (uint8_t)time_us;
+    frame[3] = (uint8_t)(time_us >> 8);
+    frame[4] = (uint8_t)(time_us >> 16);
+    frame[5] = (uint8_t)(time_us >> 24);
+
+    sim_can_rx(0, TIME_SYNC_MSG_ID, frame, sizeof(frame));
+}
+
+/* SYNC every period, its FUP with the end-of-frame time later */
+static void master_poll(void)
+{
+    uint64_t now = sim_now();
+
+    if (now >= g_master.next_sync)
+    {
+        g_master.seq = (uint8_t)((g_master.seq + 1) & 0x0F);
+        master_send(TSYNC_TYPE_SYNC, master_us(now));
+
+        /* sim_can_rx(0, ...) completes the frame now */
+        g_master.fup_time  = master_us(now);
+        g_master.fup_at    = now + SIM_MS(TSYNC_FUP_DELAY_MS);
+        g_master.next_sync = now + SIM_MS(TSYNC_PERIOD_MS);
+    }
+
+    if (g_master.fup_at != 0 && now >= g_master.fup_at)
+    {
+        master_send(TSYNC_TYPE_FUP, g_master.fup_time);
+        g_master.fup_at = 0;
+    }
+}
+
+/*---------------------------------------------------------
+ * Skewed master clock
+ *---------------------------------------------------------*/
+static void run_skew(double ppm)
+{
+    int32_t  worst = 0;
+    double   sum = 0.0;
+    uint32_t samples = 0;
+    int32_t  drift_expected;
+
+    start_node();
+    memset(&g_master, 0, sizeof(g_master));
+    g_master.ppm       = ppm;
+    g_master.next_sync = SIM_MS(100);
+
+    for (uint32_t ms = 0; ms < RUN_S * 1000U; ms++)
+    {
+        heartbeat();
+        master_poll();
+        sim_node_run(STEP_CYCLES);
+
+        /* Local time until the first pair */
+        if (ms == 50)
+        {
+            CHECK(!tsync_synced());
+        }
+
+        if (ms >= CONVERGE_S * 1000U)
+        {
+            uint32_t now = tsync_now_us();
+            int32_t  err = (int32_t)(now - master_us(sim_now()));
+
+            worst = (labs(err) > worst) ? (int32_t)labs(err) : worst;
+            sum  += err;
+            samples++;
+        }
+    }
+
+    /* Slave slow against the master: positive, 2^-20 units */
+    drift_expected = (int32_t)lround(ppm * 1.048576);
+
+    printf("  master %+6.0f ppm: drift %+5d (expected %+5d), residual mean %+5.1f us,"
+           " worst %u us, %u syncs\n",
+           ppm, g_tsync.drift_q20, drift_expected, sum / samples, worst, g_tsync.syncs);
+
+    CHECK(tsync_synced());
+    CHECK_EQ(g_tsync.syncs, RUN_S);
+    CHECK(labs(g_tsync.drift_q20 - drift_expected) <= 2);
+    CHECK(worst <= RESIDUAL_MAX_US);
+}
+
+static void test_skewed_clocks(void)
+{
+    const double skews[] = { 0.0, 100.0, -100.0, 1000.0, -1000.0, 3000.0, -3000.0 };
+
+    for (uint8_t i = 0; i < sizeof(skews) / sizeof(skews[0]); i++)
+    {
+        run_skew(skews[i]);
+    }
+}
+
+#else
+/*---------------------------------------------------------
+ *  Master: SYNC end times and the FUPs that carry them
+ *---------------------------------------------------------*/
+#define RUN_S                       10U
+#define LOG_SIZE                    32U
+
+/* SYNC sent from the main loop: on schedule within a pass */
+#define SYNC_LATE_MAX_US            1000
+
+static uint64_t g_sync_at[LOG_SIZE];
+static uint32_t g_sync_count;
+static uint32_t g_fup_time[LOG_SIZE];
+static uint64_t g_fup_at[LOG_SIZE];
+static uint32_t g_fup_count;
+
+static uint32_t frame_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void on_tx(const sim_frame_t *f)
+{
+    if (f->id != TIME_SYNC_MSG_ID || f->dlc != TSYNC_FRAME_LEN)
+    {
+        return;
+    }
+
+    if (f->data[0] == TSYNC_TYPE_SYNC && g_sync_count < LOG_SIZE)
+    {
+        g_sync_at[g_sync_count++] = f->at;
+    }
+    else if (f->data[0] == TSYNC_TYPE_FUP && g_fup_count < LOG_SIZE)
+    {
+        g_fup_time[g_fup_count] = frame_u32(&f->data[2]);
+        g_fup_at[g_fup_count++] = f->at;
+    }
+}
+
+/*---------------------------------------------------------
+ * FUP times against the bus
+ *---------------------------------------------------------*/
+static void test_master_fup(void)
+{
+    int64_t  first = 0;
+    int64_t  spread = 0;
+    int64_t  late = 0;
+
+    start_node();
+    g_sync_count = 0;
+    g_fup_count  = 0;
+    sim_can_on_tx(on_tx);
+
+    for (uint32_t ms = 0; ms < RUN_S * 1000U; ms++)
+    {
+        heartbeat();
+        sim_node_run(STEP_CYCLES);
+    }
+
+    CHECK(g_sync_count >= RUN_S - 1);
+    CHECK(g_fup_count >= g_sync_count - 1);
+
+    for (uint32_t k = 0; k < g_fup_count; k++)
+    {
+        /* Master clock minus bus time at the SYNC's end: constant */
+        int64_t diff = (int64_t)g_fup_time[k] - (int64_t)(g_sync_at[k] / SIM_CYCLES_PER_US);
+
+        if (k == 0)
+        {
+            first = diff;
+        }
+
+        spread = (llabs(diff - first) > spread) ? llabs(diff - first) : spread;
+
+        CHECK(g_fup_at[k] - g_sync_at[k] >= SIM_MS(TSYNC_FUP_DELAY_MS));
+
+        if (k > 0)
+        {
+            int64_t d = (int64_t)(g_fup_time[k] - g_fup_time[k - 1]) - TSYNC_PERIOD_MS * 1000L;
+
+            late = (llabs(d) > late) ? llabs(d) : late;
+        }
+    }
+
+    printf("  %u SYNC / %u FUP: FUP time vs SYNC end on the bus, spread %lld us;"
+           " period off by up to %lld us\n",
+           g_sync_count, g_fup_count, (long long)spread, (long long)late);
+
+    /* Stamped in the TX interrupt: entry latency only */
+    CHECK(spread <= 2);
+    CHECK(late <= SYNC_LATE_MAX_US);
+}
+#endif
+
+int main(void)
+{
+    printf("Time sync tests, node %d\n", HAL_NODE_ID);
+
+#if !TSYNC_MASTER
+    UNIT_RUN(test_skewed_clocks);
+#else
+    UNIT_RUN(test_master_fup);
+#endif
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,298 @@
+/***********************************************************************
+ *  File name   : test_warning.c
+ *  Description : ECU3 warning overlay on the CLCD register model,
+ *                over the dashboard labels and values:
+ *                - arbitration: a higher class preempts, a lower one
+ *                  waits; clearing shows the highest remaining one
+ *                - rotation every WARN_ROTATE_MS in table order, a
+ *                  collision is never rotated out; info messages
+ *                  expire after WARN_INFO_MS
+ *                - LCD writes and LCD time per transition, against
+ *                  the former clear and full redraw; the cells
+ *                  outside the region and the values on line 2 stay
+ *
+ ***********************************************************************/
+
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "irq.h"
+#include "tick.h"
+#include "sw_timer.h"
+#include "clcd.h"
+#include "screen.h"
+#include "warning.h"
+
+UNIT_STATE
+
+/* Former collision screen: clear, then two full lines (address + 16) */
+#define FULL_REDRAW_WRITES          (1 + 2 * (1 + SCREEN_COLS))
+
+/* One region: cursor address + a row of cells, twice if split */
+#define REGION_MAX_WRITES           (2 + SCREEN_COLS)
+
+/* HD44780 clear command */
+#define CLEAR_US                    1520U
+
+static const char g_labels[]  = "SP  GR  RPM  IND";
+static const char g_values[]  = "042 G2  1500  ..";
+
+static void run_ms(uint32_t ms)
+{
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        sim_advance(SIM_MS(1));
+        sw_timer_poll();
+    }
+}
+
+/* Dashboard up, labels and values drawn, no warning */
+static void setup(void)
+{
+    sim_init();
+    NODE_ISR_INSTALL();
+    init_irq();
+    init_tick();
+    sw_timer_init();
+    screen_init();
+    warning_init();
+
+    clcd_init_start();
+    while (!clcd_init_poll())
+    {
+        sim_advance(SIM_MS(1));
+    }
+
+    screen_lcd_ready();
+    screen_print((const unsigned char *)g_labels, LINE1(0));
+    screen_print((const unsigned char *)g_values, LINE2(0));
+}
+
+/* LCD row against a string, over [col, col + n) */
+static uint8_t lcd_shows(uint8_t row, uint8_t col, const char *text, uint8_t n)
+{
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (sim_lcd_char(row, (uint8_t)(col + i)) != (unsigned char)text[i])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*---------------------------------------------------------
+ * Preemption and fallback
+ *---------------------------------------------------------*/
+static void test_arbitration(void)
+{
+    setup();
+    CHECK_EQ(g_warning.shown, WARN_NONE);
+
+    /* Stale sensor over RPM / IND, SP / GR stay */
+    warning_raise(e_warn_ecu2_lost);
+    CHECK_EQ(g_warning.shown, e_warn_ecu2_lost);
+    CHECK(lcd_shows(0, 8, "NO ECU2 ", 8));
+    CHECK(lcd_shows(0, 0, g_labels, 8));
+
+    /* Info is lower: waits */
+    warning_raise(e_warn_ecu1_back);
+    CHECK_EQ(g_warning.shown, e_warn_ecu2_lost);
+    CHECK(warning_active(e_warn_ecu1_back));
+
+    /* Overheat, then collision, preempt at once */
+    warning_raise(e_warn_overheat);
+    CHECK_EQ(g_warning.shown, e_warn_overheat);
+    CHECK(lcd_shows(0, 0, "Engine Overheat ", 16));
+
+    warning_raise(e_warn_collision);
+    CHECK_EQ(g_warning.shown, e_warn_collision);
+    CHECK(lcd_shows(0, 0, "Collision !     ", 16));
+
+    /* Lower classes raised meanwhile do not take over */
+    warning_raise(e_warn_ecu1_lost);
+    CHECK_EQ(g_warning.shown, e_warn_collision);
+
+    /* Raising the shown one again changes nothing */
+    {
+        uint16_t transitions = g_warning.transitions;
+
+        warning_raise(e_warn_collision);
+        CHECK_EQ(g_warning.transitions, transitions);
+    }
+
+    /* Collision gone: the highest remaining class comes back */
+    warning_clear(e_warn_collision);
+    CHECK_EQ(g_warning.shown, e_warn_overheat);
+
+    /* Values on line 2 were never touched */
+    CHECK(lcd_shows(1, 0, g_values, 16));
+
+    /* Everything cleared: the labels are back */
+    warning_clear(e_warn_overheat);
+    warning_clear(e_warn_ecu1_lost);
+    warning_clear(e_warn_ecu2_lost);
+    warning_clear(e_warn_ecu1_back);
+    CHECK_EQ(g_warning.shown, WARN_NONE);
+    CHECK_EQ(g_warning.active, 0);
+    CHECK(lcd_shows(0, 0, g_labels, 16));
+
+    /* Out of range IDs are ignored */
+    warning_raise(WARN_COUNT);
+    warning_clear(WARN_COUNT);
+    CHECK_EQ(g_warning.active, 0);
+    CHECK(!warning_active(WARN_COUNT));
+}
+
+/*---------------------------------------------------------
+ * Rotation and expiry
+ *---------------------------------------------------------*/
+static void test_rotation(void)
+{
+    uint8_t order[6];
+    uint8_t seen = 0;
+
+    setup();
+
+    warning_raise(e_warn_collision);
+    warning_raise(e_warn_overheat);
+    warning_raise(e_warn_ecu1_lost);
+    warning_raise(e_warn_ecu2_lost);
+
+    /* Collision holds the screen */
+    run_ms(5 * WARN_ROTATE_MS);
+    CHECK_EQ(g_warning.shown, e_warn_collision);
+
+    /* Then the others take turns in table order */
+    warning_clear(e_warn_collision);
+
+    while (seen < sizeof(order))
+    {
+        uint8_t shown = g_warning.shown;
+
+        order[seen++] = shown;
+
+        while (g_warning.shown == shown && sim_now() < SIM_MS(60000))
+        {
+            run_ms(1);
+        }
+    }
+
+    CHECK_EQ(order[0], e_warn_overheat);
+    CHECK_EQ(order[1], e_warn_ecu1_lost);
+    CHECK_EQ(order[2], e_warn_ecu2_lost);
+    CHECK_EQ(order[3], e_warn_overheat);
+    CHECK_EQ(order[4], e_warn_ecu1_lost);
+    CHECK_EQ(order[5], e_warn_ecu2_lost);
+
+    /* A lone warning stays without rewrites */
+    warning_clear(e_warn_overheat);
+    warning_clear(e_warn_ecu2_lost);
+    CHECK_EQ(g_warning.shown, e_warn_ecu1_lost);
+    {
+        uint16_t writes = g_screen_writes;
+
+        run_ms(3 * WARN_ROTATE_MS);
+        CHECK_EQ(g_warning.shown, e_warn_ecu1_lost);
+        CHECK_EQ(g_screen_writes, writes);
+    }
+
+    /* Info expires on its own, re-raising restarts its lifetime */
+    warning_clear(e_warn_ecu1_lost);
+    warning_raise(e_warn_ecu2_back);
+    CHECK_EQ(g_warning.shown, e_warn_ecu2_back);
+
+    run_ms(WARN_INFO_MS / 2);
+    warning_raise(e_warn_ecu2_back);
+    run_ms(WARN_INFO_MS / 2 + WARN_POLL_MS);
+    CHECK(warning_active(e_warn_ecu2_back));
+
+    run_ms(WARN_INFO_MS / 2 + WARN_POLL_MS);
+    CHECK(!warning_active(e_warn_ecu2_back));
+    CHECK_EQ(g_warning.shown, WARN_NONE);
+    CHECK(lcd_shows(0, 0, g_labels, 16));
+}
+
+/*---------------------------------------------------------
+ * LCD writes and time per transition
+ *---------------------------------------------------------*/
+static uint16_t g_cost_max;
+static uint64_t g_time_max;
+static uint32_t g_cost_sum;
+static uint32_t g_steps;
+
+/* Runs one transition, books its writes and LCD time */
+#define TRANSITION(call)                                                    \
+{                                                                           \
+    uint16_t writes = g_screen_writes;                                      \
+    uint64_t at     = sim_now();                                            \
+    uint16_t cost;                                                          \
+                                                                            \
+    call;                                                                   \
+    cost = (uint16_t)(g_screen_writes - writes);                            \
+    CHECK_EQ(cost, g_warning.last_writes);                                  \
+    g_cost_max  = (cost > g_cost_max) ? cost : g_cost_max;                  \
+    g_time_max  = (sim_now() - at > g_time_max) ? sim_now() - at : g_time_max; \
+    g_cost_sum += cost;                                                     \
+    g_steps++;                                                              \
+}
+
+static void test_writes_per_transition(void)
+{
+    setup();
+    g_cost_max = 0;
+    g_time_max = 0;
+    g_cost_sum = 0;
+    g_steps    = 0;
+
+    TRANSITION(warning_raise(e_warn_ecu1_lost));    /* none -> half row */
+    TRANSITION(warning_raise(e_warn_overheat));     /* half -> full row */
+    TRANSITION(warning_raise(e_warn_collision));    /* full -> full */
+    TRANSITION(warning_clear(e_warn_collision));    /* full -> full */
+    TRANSITION(warning_clear(e_warn_overheat));     /* full -> half */
+    TRANSITION(warning_clear(e_warn_ecu1_lost));    /* half -> none */
+
+    /* Collision on and off straight over the labels */
+    TRANSITION(warning_raise(e_warn_collision));
+    TRANSITION(warning_clear(e_warn_collision));
+
+    printf("  %u transitions: %u LCD writes on average, %u at most, %llu us of LCD time"
+           " at most; clear + redraw: %u writes, over %u us\n",
+           g_steps, g_cost_sum / g_steps, g_cost_max,
+           (unsigned long long)(g_time_max / SIM_CYCLES_PER_US),
+           FULL_REDRAW_WRITES, CLEAR_US);
+
+    CHECK_EQ(g_warning.max_writes, g_cost_max);
+    CHECK(g_cost_max <= REGION_MAX_WRITES);
+    CHECK(g_cost_max < FULL_REDRAW_WRITES);
+
+    /* Never a clear: shorter than the clear command alone */
+    CHECK(g_time_max < SIM_US(CLEAR_US));
+
+    CHECK(lcd_shows(0, 0, g_labels, 16));
+    CHECK(lcd_shows(1, 0, g_values, 16));
+
+    /* Values drawn under a warning appear around it and come back
+     * with the labels from the shadow, not a redraw */
+    warning_raise(e_warn_ecu2_lost);
+    screen_print((const unsigned char *)"099", LINE2(0));
+    CHECK(lcd_shows(1, 0, "099", 3));
+    screen_print((const unsigned char *)"IX", LINE1(13));
+    CHECK(lcd_shows(0, 8, "NO ECU2 ", 8));
+
+    TRANSITION(warning_clear(e_warn_ecu2_lost));
+    CHECK(lcd_shows(0, 8, "RPM  IX", 7));
+    CHECK(g_warning.last_writes <= 1 + 8);
+}
+
+int main(void)
+{
+    printf("Warning overlay tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_arbitration);
+    UNIT_RUN(test_rotation);
+    UNIT_RUN(test_writes_per_transition);
+
+    return UNIT_RESULT();
+}
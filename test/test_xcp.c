@@ -0,0 +1,422 @@
+/***********************************************************************
+ *  File name   : test_xcp.c
+ *  Description : XCP-on-CAN slave of every node, driven by a simulated
+ *                master while the node's own main() runs:
+ *                - CONNECT, SHORT_UPLOAD / DOWNLOAD through the MTA
+ *                - DAQ list on event channel 0 streaming a mapped
+ *                  variable, per-event sampling jitter from the
+ *                  slave's statistics (read over XCP) and from the
+ *                  DTO arrival times on the bus
+ *                - DAQ resource bounds and queue overruns
+ *                - ECU1: live calibration of the speed scale
+ *
+ ***********************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include "unit.h"
+#include "node.h"
+#include "xcp.h"
+#include "msg_id.h"
+#include "nm.h"
+#if HAL_NODE_ID == 3
+#include "tick.h"
+#else
+#include "ttsched.h"
+#endif
+#if HAL_CALIB
+#include "calib.h"
+#endif
+#if HAL_NODE_ID == 1
+#include "adc.h"
+#include "sensor.h"
+#endif
+
+UNIT_STATE
+
+/* Data-memory addresses of the mapped variables */
+#define ADDR_MEASURE                0x0100
+#define ADDR_STATS                  0x0200
+#define ADDR_CALIB                  0x0300
+
+#define STEP_CYCLES                 SIM_MS(1)
+#define RESPONSE_MS                 100U
+#define DAQ_LOG_SIZE                4096U
+
+/* Event 0: loop pass in its TT slot (ECU1/2), 10 ms timer on the tick (ECU3) */
+#if HAL_NODE_ID == 3
+#define MAX_JITTER_US               TICK_PERIOD_US
+#else
+#define MAX_JITTER_US               TTSCHED_LATE_TOL_US
+#endif
+
+/* Peer heartbeat keeps the node out of bus sleep */
+#define PEER_NODE                   (HAL_NODE_ID % NM_NODE_COUNT + 1)
+
+/*---------------------------------------------------------
+ * Master
+ *---------------------------------------------------------*/
+typedef struct
+{
+    uint8_t  res[8];
+    uint8_t  res_len;
+    uint8_t  got;
+
+    uint32_t daq_count;
+    uint64_t daq_at[DAQ_LOG_SIZE];
+    uint8_t  daq[DAQ_LOG_SIZE][8];
+    uint8_t  daq_len[DAQ_LOG_SIZE];
+} master_t;
+
+static master_t g_master;
+static uint8_t  g_measure[16];
+static uint64_t g_next_heartbeat;
+
+static void master_on_frame(const sim_frame_t *f)
+{
+    if (f->id != XCP_DTO_ID || f->dlc == 0)
+    {
+        return;
+    }
+
+    if (f->data[0] >= XCP_PID_ERR)
+    {
+        memcpy(g_master.res, f->data, 8);
+        g_master.res_len = f->dlc;
+        g_master.got     = 1;
+    }
+    else if (g_master.daq_count < DAQ_LOG_SIZE)
+    {
+        g_master.daq_at[g_master.daq_count] = f->at;
+        memcpy(g_master.daq[g_master.daq_count], f->data, 8);
+        g_master.daq_len[g_master.daq_count] = f->dlc;
+        g_master.daq_count++;
+    }
+}
+
+/* Runs the node for a while, heartbeating as the peer */
+static void run_ms(uint32_t ms)
+{
+    const uint8_t hb[NM_FRAME_LEN] = { PEER_NODE, 0, e_nm_normal, 0, 0 };
+
+    for (uint32_t i = 0; i < ms; i++)
+    {
+        if (sim_now() >= g_next_heartbeat)
+        {
+            sim_can_rx(0, NM_MSG_ID_BASE + PEER_NODE, hb, sizeof(hb));
+            g_next_heartbeat = sim_now() + SIM_US(NM_CYCLE_US);
+        }
+
+        sim_node_run(STEP_CYCLES);
+    }
+}
+
+/* Sends a command, returns 1 on a positive response */
+static uint8_t xcp(const uint8_t *cmd, uint8_t len)
+{
+    g_master.got = 0;
+    sim_can_rx(0, XCP_CRO_ID, cmd, len);
+
+    for (uint32_t ms = 0; !g_master.got && ms < RESPONSE_MS; ms++)
+    {
+        run_ms(1);
+    }
+
+    return g_master.got && g_master.res[0] == XCP_PID_RES;
+}
+
+/* Command with an expected error code */
+static uint8_t xcp_err(const uint8_t *cmd, uint8_t len)
+{
+    if (xcp(cmd, len) || !g_master.got)
+    {
+        return 0;
+    }
+
+    return g_master.res[1];
+}
+
+static uint8_t set_mta(uint16_t addr)
+{
+    const uint8_t cmd[8] = { XCP_CMD_SET_MTA, 0, 0, 0, (uint8_t)addr, (uint8_t)(addr >> 8), 0, 0 };
+
+    return xcp(cmd, sizeof(cmd));
+}
+
+static uint8_t short_upload(uint16_t addr, uint8_t size)
+{
+    const uint8_t cmd[8] = { XCP_CMD_SHORT_UPLOAD, size, 0, 0, (uint8_t)addr, (uint8_t)(addr >> 8), 0, 0 };
+
+    return xcp(cmd, sizeof(cmd));
+}
+
+static uint32_t res_u32(uint8_t pos)
+{
+    return (uint32_t)g_master.res[pos] | ((uint32_t)g_master.res[pos + 1] << 8) |
+           ((uint32_t)g_master.res[pos + 2] << 16) | ((uint32_t)g_master.res[pos + 3] << 24);
+}
+
+/* One DAQ list, one ODT per entry size list, on event 0 */
+static uint8_t daq_setup(uint8_t lists, uint8_t odts, uint8_t entry_size, uint8_t prescaler)
+{
+    const uint8_t free_daq[1]  = { XCP_CMD_FREE_DAQ };
+    const uint8_t alloc_daq[4] = { XCP_CMD_ALLOC_DAQ, 0, lists, 0 };
+    uint8_t       ok           = xcp(free_daq, 1) && xcp(alloc_daq, 4);
+
+    for (uint8_t d = 0; d < lists; d++)
+    {
+        const uint8_t alloc_odt[5] = { XCP_CMD_ALLOC_ODT, 0, d, 0, odts };
+        const uint8_t mode[8]      = { XCP_CMD_SET_DAQ_LIST_MODE, 0, d, 0, 0, 0, prescaler, 0 };
+        const uint8_t select[4]    = { XCP_CMD_START_STOP_DAQ_LIST, 2, d, 0 };
+
+        ok = ok && xcp(alloc_odt, 5);
+
+        for (uint8_t o = 0; o < odts; o++)
+        {
+            const uint8_t alloc_entry[6] = { XCP_CMD_ALLOC_ODT_ENTRY, 0, d, 0, o, 1 };
+            const uint8_t ptr[6]         = { XCP_CMD_SET_DAQ_PTR, 0, d, 0, o, 0 };
+            const uint8_t write[8]       = { XCP_CMD_WRITE_DAQ, 0xFF, entry_size, 0,
+                                             (uint8_t)ADDR_MEASURE, (uint8_t)(ADDR_MEASURE >> 8), 0, 0 };
+
+            ok = ok && xcp(alloc_entry, 6) && xcp(ptr, 6) && xcp(write, 8);
+        }
+
+        ok = ok && xcp(mode, 8) && xcp(select, 4);
+    }
+
+    return ok;
+}
+
+static void setup(void)
+{
+    const uint8_t connect[2] = { XCP_CMD_CONNECT, 0 };
+
+    sim_init();
+    NODE_ISR_INSTALL();
+    memset(&g_master, 0, sizeof(g_master));
+    g_next_heartbeat = 0;
+
+    for (uint8_t i = 0; i < sizeof(g_measure); i++)
+    {
+        g_measure[i] = (uint8_t)(0xA0 + i);
+    }
+
+    sim_data_map(ADDR_MEASURE, g_measure, sizeof(g_measure));
+    sim_data_map(ADDR_STATS, g_xcp_event_stats, sizeof(g_xcp_event_stats));
+#if HAL_CALIB
+    sim_data_map(ADDR_CALIB, &g_calib, sizeof(g_calib));
+#endif
+    sim_can_on_tx(master_on_frame);
+
+    sim_node_start(node_main);
+    run_ms(50);
+
+    CHECK(xcp(connect, sizeof(connect)));
+}
+
+/*---------------------------------------------------------
+ * Upload and download through the MTA
+ *---------------------------------------------------------*/
+static void test_upload_download(void)
+{
+    const uint8_t download[8] = { XCP_CMD_DOWNLOAD, 4, 0x11, 0x22, 0x33, 0x44, 0, 0 };
+    const uint8_t upload[2]   = { XCP_CMD_UPLOAD, 7 };
+    const uint8_t far[8]      = { XCP_CMD_SHORT_UPLOAD, 1, 0, 0, 0, 0, 1, 0 };
+
+    setup();
+
+    CHECK(short_upload(ADDR_MEASURE + 2, 3));
+    CHECK_EQ(g_master.res_len, 4);
+    CHECK_EQ(g_master.res[1], 0xA2);
+    CHECK_EQ(g_master.res[3], 0xA4);
+
+    CHECK(set_mta(ADDR_MEASURE + 8));
+    CHECK(xcp(download, sizeof(download)));
+    CHECK_EQ(g_measure[8], 0x11);
+    CHECK_EQ(g_measure[11], 0x44);
+
+    /* MTA moved on by the download */
+    CHECK(xcp(upload, sizeof(upload)));
+    CHECK_EQ(g_master.res[1], 0xAC);
+
+    /* Beyond 16-bit data memory */
+    CHECK_EQ(xcp_err(far, sizeof(far)), XCP_ERR_OUT_OF_RANGE);
+}
+
+/*---------------------------------------------------------
+ * DAQ streaming and per-event sampling jitter
+ *---------------------------------------------------------*/
+static void test_daq_jitter(void)
+{
+    const uint8_t start[2] = { XCP_CMD_START_STOP_SYNCH, 1 };
+    const uint8_t stop[2]  = { XCP_CMD_START_STOP_SYNCH, 0 };
+    uint32_t      min_us;
+    uint32_t      max_us;
+    uint32_t      count;
+    uint64_t      bus_min = UINT64_MAX;
+    uint64_t      bus_max = 0;
+    uint32_t      wrong   = 0;
+
+    setup();
+
+    CHECK(daq_setup(1, 1, 4, 1));
+    CHECK(xcp(start, sizeof(start)));
+
+    g_master.daq_count = 0;
+    run_ms(2000);
+    count = g_master.daq_count;
+
+    CHECK(xcp(stop, sizeof(stop)));
+
+    /* The master reads the slave's statistics of event 0 */
+    CHECK(short_upload(ADDR_STATS + offsetof(xcp_event_stats_t, min_interval), 4));
+    min_us = res_u32(1);
+    CHECK(short_upload(ADDR_STATS + offsetof(xcp_event_stats_t, max_interval), 4));
+    max_us = res_u32(1);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        wrong += (g_master.daq_len[i] != 5 || g_master.daq[i][0] != 0 ||
+                  memcmp(&g_master.daq[i][1], g_measure, 4) != 0);
+
+        if (i > 0)
+        {
+            uint64_t gap = g_master.daq_at[i] - g_master.daq_at[i - 1];
+
+            bus_min = (gap < bus_min) ? gap : bus_min;
+            bus_max = (gap > bus_max) ? gap : bus_max;
+        }
+    }
+
+    printf("  event 0: %u DTOs in 2 s, sampling interval %u..%u us (jitter %u us),"
+           " on the bus %llu..%llu us, %u overruns\n",
+           count, min_us, max_us, max_us - min_us,
+           (unsigned long long)(bus_min / SIM_CYCLES_PER_US),
+           (unsigned long long)(bus_max / SIM_CYCLES_PER_US),
+           g_xcp_event_stats[0].overruns);
+
+    CHECK(count > 100);
+    CHECK_EQ(wrong, 0);
+    CHECK_EQ(g_xcp_event_stats[0].overruns, 0);
+    CHECK(min_us <= max_us);
+    CHECK(max_us - min_us <= MAX_JITTER_US);
+
+    /* Stopped: once the queue has drained, no more samples */
+    run_ms(50);
+    count = g_master.daq_count;
+    run_ms(200);
+    CHECK_EQ(g_master.daq_count, count);
+}
+
+/*---------------------------------------------------------
+ * DAQ resource bounds, queue overruns
+ *---------------------------------------------------------*/
+static void test_daq_bounds(void)
+{
+    const uint8_t start[2]       = { XCP_CMD_START_STOP_SYNCH, 1 };
+    const uint8_t too_many[4]    = { XCP_CMD_ALLOC_DAQ, 0, XCP_MAX_DAQ + 1, 0 };
+    const uint8_t one_daq[4]     = { XCP_CMD_ALLOC_DAQ, 0, 1, 0 };
+    const uint8_t odt_over[5]    = { XCP_CMD_ALLOC_ODT, 0, 0, 0, XCP_MAX_ODT + 1 };
+    const uint8_t odt_one[5]     = { XCP_CMD_ALLOC_ODT, 0, 0, 0, 1 };
+    const uint8_t entry_over[6]  = { XCP_CMD_ALLOC_ODT_ENTRY, 0, 0, 0, 0, XCP_MAX_ODT_ENTRIES + 1 };
+    const uint8_t entry_two[6]   = { XCP_CMD_ALLOC_ODT_ENTRY, 0, 0, 0, 0, 2 };
+    const uint8_t ptr[6]         = { XCP_CMD_SET_DAQ_PTR, 0, 0, 0, 0, 0 };
+    const uint8_t write5[8]      = { XCP_CMD_WRITE_DAQ, 0xFF, 5, 0, (uint8_t)ADDR_MEASURE, ADDR_MEASURE >> 8, 0, 0 };
+    const uint8_t write3[8]      = { XCP_CMD_WRITE_DAQ, 0xFF, 3, 0, (uint8_t)ADDR_MEASURE, ADDR_MEASURE >> 8, 0, 0 };
+    const uint8_t event_over[8]  = { XCP_CMD_SET_DAQ_LIST_MODE, 0, 0, 0, XCP_MAX_EVENT, 0, 1, 0 };
+    const uint8_t daq_over[5]    = { XCP_CMD_ALLOC_ODT, 0, 1, 0, 1 };
+    uint32_t      overruns;
+
+    setup();
+
+    CHECK_EQ(xcp_err(too_many, 4), XCP_ERR_MEMORY_OVERFLOW);
+    CHECK(xcp(one_daq, 4));
+    CHECK_EQ(xcp_err(daq_over, 5), XCP_ERR_OUT_OF_RANGE);
+    CHECK_EQ(xcp_err(odt_over, 5), XCP_ERR_MEMORY_OVERFLOW);
+    CHECK(xcp(odt_one, 5));
+    CHECK_EQ(xcp_err(entry_over, 6), XCP_ERR_MEMORY_OVERFLOW);
+    CHECK(xcp(entry_two, 6));
+    CHECK_EQ(xcp_err(event_over, 8), XCP_ERR_OUT_OF_RANGE);
+
+    /* 5 + 3 bytes do not fit the 7 payload bytes of one DTO */
+    CHECK(xcp(ptr, 6));
+    CHECK(xcp(write5, 8));
+    CHECK_EQ(xcp_err(write3, 8), XCP_ERR_OUT_OF_RANGE);
+
+    /* Pointer past the allocated entries */
+    CHECK_EQ(xcp_err(write5, 8), XCP_ERR_OUT_OF_RANGE);
+
+    /* More ODTs per event than the DTO queue holds: counted, not sent */
+    CHECK(daq_setup(XCP_MAX_DAQ, XCP_MAX_ODT, 7, 1));
+    CHECK(xcp(start, sizeof(start)));
+
+    g_master.daq_count = 0;
+    run_ms(500);
+    overruns = g_xcp_event_stats[0].overruns;
+
+    printf("  %u ODTs per event, queue of %u: %u DTOs sent, %u overruns in 500 ms\n",
+           XCP_MAX_DAQ * XCP_MAX_ODT, XCP_DTO_QUEUE_LEN, g_master.daq_count, overruns);
+
+    CHECK(overruns > 0);
+    CHECK(g_master.daq_count > 0);
+
+    for (uint32_t i = 0; i < g_master.daq_count; i++)
+    {
+        CHECK(g_master.daq_len[i] <= 8);
+        CHECK(g_master.daq[i][0] < XCP_MAX_DAQ * XCP_MAX_ODT);
+    }
+}
+
+#if HAL_NODE_ID == 1
+/*---------------------------------------------------------
+ * Live calibration of the speed scale (ECU1)
+ *---------------------------------------------------------*/
+static void test_live_calibration(void)
+{
+    const uint16_t div      = 2 * g_calib.speed_div_x100;
+    const uint8_t  write[4] = { XCP_CMD_DOWNLOAD, 2, (uint8_t)div, (uint8_t)(div >> 8) };
+
+    setup();
+    sim_adc_set(CHANNEL4, 1000);
+
+    CHECK_EQ(get_speed(1), 1000UL * 100 / g_calib.speed_div_x100);
+
+    CHECK(set_mta(ADDR_CALIB + offsetof(calib_t, speed_div_x100)));
+    CHECK(xcp(write, sizeof(write)));
+
+    CHECK_EQ(g_calib.speed_div_x100, div);
+    CHECK_EQ(get_speed(1), 1000UL * 100 / div);
+
+    /* A zero divisor is refused, the cache keeps the old value */
+    {
+        const uint8_t zero[4] = { XCP_CMD_DOWNLOAD, 2, 0, 0 };
+
+        CHECK(set_mta(ADDR_CALIB + offsetof(calib_t, speed_div_x100)));
+        CHECK_EQ(xcp_err(zero, sizeof(zero)), XCP_ERR_OUT_OF_RANGE);
+        CHECK_EQ(g_calib.speed_div_x100, div);
+    }
+
+    /* A small one is in range: speed stays within 3 digits */
+    {
+        const uint8_t small[4] = { XCP_CMD_DOWNLOAD, 2, 10, 0 };
+
+        CHECK(set_mta(ADDR_CALIB + offsetof(calib_t, speed_div_x100)));
+        CHECK(xcp(small, sizeof(small)));
+        CHECK_EQ(get_speed(1), SPEED_MAX);
+    }
+}
+#endif
+
+int main(void)
+{
+    printf("XCP tests, node %d\n", HAL_NODE_ID);
+
+    UNIT_RUN(test_upload_download);
+    UNIT_RUN(test_daq_jitter);
+    UNIT_RUN(test_daq_bounds);
+#if HAL_NODE_ID == 1
+    UNIT_RUN(test_live_calibration);
+#endif
+
+    return UNIT_RESULT();
+}
@@ -0,0 +1,57 @@
+/***********************************************************************
+ *  File name   : unit.h
+ *  Description : Minimal assertions for the host tests. A failed check
+ *                prints its location and the test carries on; the
+ *                test program returns UNIT_RESULT() from main().
+ *
+ ***********************************************************************/
+
+#ifndef UNIT_H
+#define UNIT_H
+
+#include <stdio.h>
+
+extern int g_unit_checks;
+extern int g_unit_failed;
+
+/* Define once, in the file holding main() */
+#define UNIT_STATE                  int g_unit_checks; int g_unit_failed;
+
+#define CHECK(cond)                                                     \
+    do                                                                  \
+    {                                                                   \
+        g_unit_checks++;                                                \
+        if (!(cond))                                                    \
+        {                                                               \
+            g_unit_failed++;                                            \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+        }                                                               \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                      \
+    do                                                                  \
+    {                                                                   \
+        long long unit_a = (long long)(actual);                         \
+        long long unit_e = (long long)(expected);                       \
+        g_unit_checks++;                                                \
+        if (unit_a != unit_e)                                           \
+        {                                                               \
+            g_unit_failed++;                                            \
+            printf("%s:%d: %s = %lld, expected %lld\n",                 \
+                   __FILE__, __LINE__, #actual, unit_a, unit_e);        \
+        }                                                               \
+    } while (0)
+
+#define UNIT_RUN(test)                                                  \
+    do                                                                  \
+    {                                                                   \
+        int unit_before = g_unit_failed;                                \
+        test();                                                         \
+        printf("%-40s %s\n", #test, (g_unit_failed == unit_before) ? "ok" : "FAILED"); \
+    } while (0)
+
+#define UNIT_RESULT()                                                   \
+    (printf("%d checks, %d failed\n", g_unit_checks, g_unit_failed),    \
+     (g_unit_failed != 0))
+
+#endif /* UNIT_H */
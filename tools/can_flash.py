@@ -0,0 +1,597 @@
+#!/usr/bin/env python3
+"""
+Host side of the CAN bootloader (BOOT/).
+
+Flashes an application Intel HEX file into one ECU over the bus. The
+node is asked to enter its bootloader, the image is streamed in
+blocks of whole erase rows (no reply per frame, one acknowledge per
+block), the whole application region is CRC checked and the node is
+restarted into the new image.
+
+    can_flash.py app.hex --node 3 --channel can0     # real bus (SocketCAN)
+    can_flash.py app.hex --node 3 --simulate         # bootloader model in-process
+    can_flash.py --node 3 --simulate --power-fail-after 20 --drop-rate 0.01
+    can_flash.py --node 3 --emulate vcan0            # bootloader model on a bus
+
+--simulate runs the same protocol against a model of BOOT/main.c on a
+model of the PIC18F4580 flash (row erase, group writes that can only
+clear bits, write protected boot block) and reports the time the
+update would take on the target. Without a HEX file a random image is
+used. --emulate serves the model on a SocketCAN interface so the tool
+can be run against it from another shell (vcan, no hardware).
+
+The model is a quick stand-in; the bootloader itself is tested by
+test/test_bootloader.c, which builds the BOOT/ sources against the
+host register model's flash and plays this tool's frames to them.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import sys
+import time
+
+# Memory map and protocol (BOOT/boot_cfg.h)
+APP_BASE = 0x0800
+FLASH_END = 0x8000
+ERASE_ROW = 64
+WRITE_GROUP = 8
+BLOCK_SIZE = 256
+BLOCK_FRAMES = BLOCK_SIZE // 8
+
+EE_APP_VALID = 0xFE
+EE_REQUEST = 0xFF
+APP_VALID = 0xA5
+REQUEST = 0x5A
+
+CMD_ID_BASE = 0x6C0
+DATA_ID_BASE = 0x6D0
+RESP_ID_BASE = 0x6E0
+
+CMD_ENTER = 0x01
+CMD_CONNECT = 0x02
+CMD_BLOCK = 0x03
+CMD_VERIFY = 0x04
+CMD_RESET = 0x05
+
+STATUS_NAMES = [
+    "ok", "range", "crc", "timeout", "verify", "sequence", "command", "no image",
+]
+ST_OK, ST_RANGE, ST_CRC, ST_TIMEOUT, ST_VERIFY, ST_SEQUENCE, ST_COMMAND, ST_NO_IMAGE = range(8)
+
+# Target timing (DS39637: self-timed erase / write ~2 ms, EEPROM ~4 ms)
+BITRATE = 500000
+FLASH_ERASE_S = 0.002
+FLASH_WRITE_S = 0.002
+EEPROM_WRITE_S = 0.004
+DATA_TIMEOUT_S = 2 * 0.105
+ENTRY_TIMEOUT_S = 20 * 0.105
+
+
+# ---------------------------------------------------------------------
+# CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), as BOOT/crc16.c
+# ---------------------------------------------------------------------
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def frame_bits(length):
+    """Standard data frame incl. interframe space, worst-case stuffing."""
+    return 47 + 8 * length + (34 + 8 * length - 1) // 4
+
+
+# ---------------------------------------------------------------------
+# Image
+# ---------------------------------------------------------------------
+def read_hex(path):
+    data = {}
+    upper = 0
+    with open(path) as fh:
+        for lineno, line in enumerate(fh, 1):
+            line = line.strip()
+            if not line:
+                continue
+            if not line.startswith(":"):
+                raise SystemExit("%s:%d: not an Intel HEX record" % (path, lineno))
+            raw = bytes.fromhex(line[1:])
+            if len(raw) < 5 or len(raw) != raw[0] + 5 or sum(raw) & 0xFF:
+                raise SystemExit("%s:%d: bad record length or checksum" % (path, lineno))
+            count, addr, rtype, payload = raw[0], (raw[1] << 8) | raw[2], raw[3], raw[4:-1]
+            if rtype == 0x00:
+                for i, byte in enumerate(payload):
+                    data[upper + addr + i] = byte
+            elif rtype == 0x01:
+                break
+            elif rtype == 0x02:
+                upper = ((payload[0] << 8) | payload[1]) << 4
+            elif rtype == 0x04:
+                upper = ((payload[0] << 8) | payload[1]) << 16
+    return data
+
+
+def build_image(data):
+    """Program memory bytes -> contiguous image from APP_BASE, row padded."""
+    code = {a: b for a, b in data.items() if a < FLASH_END}
+    skipped = len(data) - len(code)
+    if skipped:
+        print("note: %d bytes outside program memory (config / EEPROM) not flashed" % skipped)
+    if not code:
+        raise SystemExit("image has no program memory data")
+    low = min(code)
+    if low < APP_BASE:
+        raise SystemExit("image touches the boot block at 0x%04X (link with -mcodeoffset=0x%X)"
+                         % (low, APP_BASE))
+    end = (max(code) + ERASE_ROW) // ERASE_ROW * ERASE_ROW
+    image = bytearray(b"\xFF" * (end - APP_BASE))
+    for addr, byte in code.items():
+        image[addr - APP_BASE] = byte
+    return bytes(image)
+
+
+def random_image(size):
+    rng = random.Random(size)
+    image = bytearray(rng.getrandbits(8) for _ in range(size))
+    # Unused code space, as a linker would leave it
+    for start in range(0, size, 1024):
+        gap = rng.randint(0, 192)
+        image[start + 512:start + 512 + gap] = b"\xFF" * len(image[start + 512:start + 512 + gap])
+    return bytes(image)
+
+
+# ---------------------------------------------------------------------
+# Target model: PIC18F4580 flash + data EEPROM
+# ---------------------------------------------------------------------
+class FlashModel:
+    def __init__(self, protected=APP_BASE):
+        self.flash = bytearray(b"\xFF" * FLASH_END)
+        self.eeprom = bytearray(b"\xFF" * 256)
+        self.protected = protected
+        self.erases = 0
+        self.writes = 0
+        self.busy_s = 0.0
+
+    def erase_row(self, addr):
+        addr -= addr % ERASE_ROW
+        self.busy_s += FLASH_ERASE_S
+        if addr < self.protected:
+            return
+        self.flash[addr:addr + ERASE_ROW] = b"\xFF" * ERASE_ROW
+        self.erases += 1
+
+    def write_group(self, addr, data):
+        assert addr % WRITE_GROUP == 0 and len(data) == WRITE_GROUP
+        self.busy_s += FLASH_WRITE_S
+        if addr < self.protected:
+            return
+        for i, byte in enumerate(data):
+            self.flash[addr + i] &= byte        # programming only clears bits
+        self.writes += 1
+
+    def eeprom_write(self, addr, value):
+        if self.eeprom[addr] != value:
+            self.eeprom[addr] = value
+            self.busy_s += EEPROM_WRITE_S
+
+
+class NodeModel:
+    """BOOT/main.c plus the application's bootreq.c on one node."""
+
+    def __init__(self, node, flash):
+        self.node = node
+        self.flash = flash
+        self.cmd_id = CMD_ID_BASE + node
+        self.data_id = DATA_ID_BASE + node
+        self.resp_id = RESP_ID_BASE + node
+        self.power_on()
+
+    # -- reset path -----------------------------------------------------
+    def power_on(self):
+        ee = self.flash.eeprom
+        requested = ee[EE_REQUEST] == REQUEST
+        self.app_valid = ee[EE_APP_VALID] == APP_VALID
+        self.in_app = not requested and self.app_valid
+        self.connected = False
+        self.invalidated = False
+        self.block = None
+        self.idle_s = 0.0
+        self.out = []
+        if self.in_app:
+            return
+        if requested:
+            self.flash.eeprom_write(EE_REQUEST, 0xFF)
+        self._send_info()
+
+    def _respond(self, cmd, status, value=0, value_len=0):
+        self.out.append((self.resp_id, bytes([cmd, status]) + value.to_bytes(3, "little")[:value_len]))
+
+    def _send_info(self):
+        self.out.append((self.resp_id, bytes([CMD_CONNECT, ST_OK, 1, self.node, APP_BASE >> 8,
+                                              FLASH_END >> 8, BLOCK_FRAMES, ERASE_ROW])))
+
+    # -- frames -----------------------------------------------------------
+    def on_frame(self, msg_id, data):
+        if self.in_app:
+            if (msg_id == self.cmd_id and len(data) >= 5 and data[0] == CMD_ENTER
+                    and data[1:5] == b"BOOT"):
+                self.flash.eeprom_write(EE_REQUEST, REQUEST)
+                self.power_on()
+            return
+        if msg_id == self.data_id:
+            self.idle_s = 0.0
+            self._on_data(data)
+        elif msg_id == self.cmd_id and data:
+            self.idle_s = 0.0
+            self._on_command(data)
+
+    def _on_command(self, cmd):
+        op = cmd[0]
+        if op in (CMD_ENTER, CMD_CONNECT):
+            self.connected = True
+            self.block = None
+            self._send_info()
+        elif op == CMD_BLOCK:
+            self.block = None
+            if len(cmd) < 7:
+                self._respond(CMD_BLOCK, ST_COMMAND, 0, 3)
+                return
+            addr = int.from_bytes(cmd[1:4], "little")
+            frames = cmd[4]
+            size = frames * 8
+            if (frames == 0 or frames > BLOCK_FRAMES or size % ERASE_ROW or addr % ERASE_ROW
+                    or addr < APP_BASE or addr + size > FLASH_END):
+                self._respond(CMD_BLOCK, ST_RANGE, addr, 3)
+                return
+            self.block = {"addr": addr, "frames": frames,
+                          "crc": cmd[5] | (cmd[6] << 8), "data": bytearray()}
+        elif op == CMD_VERIFY:
+            if len(cmd) < 6:
+                self._respond(CMD_VERIFY, ST_COMMAND, 0, 2)
+                return
+            end = int.from_bytes(cmd[1:4], "little")
+            if end <= APP_BASE or end > FLASH_END:
+                self._respond(CMD_VERIFY, ST_RANGE, 0, 2)
+                return
+            crc = crc16(self.flash.flash[APP_BASE:end])
+            if crc != (cmd[4] | (cmd[5] << 8)):
+                self._respond(CMD_VERIFY, ST_VERIFY, crc, 2)
+                return
+            self.flash.eeprom_write(EE_APP_VALID, APP_VALID)
+            self._respond(CMD_VERIFY, ST_OK, crc, 2)
+        elif op == CMD_RESET:
+            if self.flash.eeprom[EE_APP_VALID] != APP_VALID:
+                self._respond(CMD_RESET, ST_NO_IMAGE)
+                return
+            self._respond(CMD_RESET, ST_OK)
+            out = self.out
+            self.power_on()
+            self.out = out + self.out
+        else:
+            self._respond(op, ST_COMMAND)
+
+    def _on_data(self, data):
+        block = self.block
+        if block is None or len(data) != 8:
+            self.block = None
+            self._respond(CMD_BLOCK, ST_SEQUENCE, block["addr"] if block else 0, 3)
+            return
+        block["data"] += data
+        if len(block["data"]) == block["frames"] * 8:
+            self.block = None
+            self._respond(CMD_BLOCK, self._program(block), block["addr"], 3)
+
+    def _program(self, block):
+        data, addr = bytes(block["data"]), block["addr"]
+        if crc16(data) != block["crc"]:
+            return ST_CRC
+        if not self.invalidated:
+            self.flash.eeprom_write(EE_APP_VALID, 0xFF)
+            self.invalidated = True
+        for off in range(0, len(data), WRITE_GROUP):
+            if off % ERASE_ROW == 0:
+                self.flash.erase_row(addr + off)
+            group = data[off:off + WRITE_GROUP]
+            if group != b"\xFF" * WRITE_GROUP:
+                self.flash.write_group(addr + off, group)
+        if bytes(self.flash.flash[addr:addr + len(data)]) != data:
+            return ST_VERIFY
+        return ST_OK
+
+    # -- time -----------------------------------------------------------
+    def idle(self, seconds):
+        if self.in_app:
+            return
+        self.idle_s += seconds
+        if self.block is not None and self.idle_s >= DATA_TIMEOUT_S:
+            addr = self.block["addr"]
+            self.block = None
+            self._respond(CMD_BLOCK, ST_TIMEOUT, addr, 3)
+        if not self.connected and self.app_valid and self.idle_s >= ENTRY_TIMEOUT_S:
+            self.power_on()
+
+    def take_output(self):
+        out, self.out = self.out, []
+        return out
+
+
+# ---------------------------------------------------------------------
+# Buses
+# ---------------------------------------------------------------------
+class SocketCanBus:
+    FMT = "=IB3x8s"
+
+    def __init__(self, channel, rx_ids):
+        self.sock = socket.socket(socket.PF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        filters = b"".join(struct.pack("=II", i, socket.CAN_SFF_MASK) for i in rx_ids)
+        self.sock.setsockopt(socket.SOL_CAN_RAW, socket.CAN_RAW_FILTER, filters)
+        self.sock.bind((channel,))
+        self.frames = 0
+        self.bits = 0
+
+    def send(self, msg_id, data):
+        self.sock.send(struct.pack(self.FMT, msg_id, len(data), bytes(data).ljust(8, b"\x00")))
+        self.frames += 1
+        self.bits += frame_bits(len(data))
+
+    def recv(self, timeout):
+        self.sock.settimeout(timeout)
+        try:
+            raw = self.sock.recv(16)
+        except socket.timeout:
+            return None
+        msg_id, length, data = struct.unpack(self.FMT, raw)
+        self.bits += frame_bits(length)
+        return msg_id & socket.CAN_SFF_MASK, data[:length]
+
+    def now(self):
+        return time.monotonic()
+
+
+class SimBus:
+    """Host <-> NodeModel on a simulated clock (bus time + flash time)."""
+
+    def __init__(self, model, drop_rate=0.0, power_fail_after=None, seed=1):
+        self.model = model
+        self.drop_rate = drop_rate
+        self.power_fail_after = power_fail_after
+        self.rng = random.Random(seed)
+        self.clock = 0.0
+        self.pending = []
+        self.frames = 0
+        self.bits = 0
+        self.dropped = 0
+        self.blocks_acked = 0
+
+    def _wire(self, length):
+        self.frames += 1
+        self.bits += frame_bits(length)
+        self.clock += frame_bits(length) / BITRATE
+
+    def send(self, msg_id, data):
+        self._wire(len(data))
+        if msg_id == self.model.data_id and self.rng.random() < self.drop_rate:
+            self.dropped += 1                   # RX overrun on the node
+            return
+        busy = self.model.flash.busy_s
+        self.model.on_frame(msg_id, bytes(data))
+        self.clock += self.model.flash.busy_s - busy
+        for msg in self.model.take_output():
+            self._wire(len(msg[1]))
+            self.pending.append(msg)
+            if msg[1][0] == CMD_BLOCK and msg[1][1] == ST_OK:
+                self.blocks_acked += 1
+                if self.power_fail_after is not None and self.blocks_acked == self.power_fail_after:
+                    print("sim: power lost after block %d" % self.blocks_acked)
+                    self.pending = []
+                    self.model.power_on()
+                    print("sim: node restarted in the %s"
+                          % ("application" if self.model.in_app else "bootloader"))
+                    self.pending += self.model.take_output()
+
+    def recv(self, timeout):
+        if not self.pending:
+            self.clock += timeout
+            self.model.idle(timeout)
+            self.pending += self.model.take_output()
+        return self.pending.pop(0) if self.pending else None
+
+    def now(self):
+        return self.clock
+
+
+# ---------------------------------------------------------------------
+# Flashing
+# ---------------------------------------------------------------------
+class FlashError(Exception):
+    pass
+
+
+class Flasher:
+    def __init__(self, bus, node, timeout=0.5, retries=3):
+        self.bus = bus
+        self.node = node
+        self.cmd_id = CMD_ID_BASE + node
+        self.data_id = DATA_ID_BASE + node
+        self.resp_id = RESP_ID_BASE + node
+        self.timeout = timeout
+        self.retries = retries
+
+    def _wait(self, cmd, timeout=None):
+        deadline = self.bus.now() + (timeout or self.timeout)
+        while self.bus.now() < deadline:
+            msg = self.bus.recv(max(0.001, deadline - self.bus.now()))
+            if msg is None:
+                continue
+            msg_id, data = msg
+            if msg_id == self.resp_id and len(data) >= 2 and data[0] == cmd:
+                return data
+        return None
+
+    def connect(self):
+        """Application -> bootloader, or an idle bootloader -> session."""
+        for attempt in range(self.retries + 2):
+            op = CMD_ENTER if attempt % 2 == 0 else CMD_CONNECT
+            self.bus.send(self.cmd_id, bytes([op]) + b"BOOT")
+            info = self._wait(CMD_CONNECT, 1.0)
+            if info is not None and len(info) == 8:
+                # Eat the INFO a freshly reset bootloader announces on its own
+                while self._wait(CMD_CONNECT, 0.05) is not None:
+                    pass
+                return info
+        raise FlashError("node %d does not answer" % self.node)
+
+    def write_block(self, addr, data):
+        frames = len(data) // 8
+        header = bytes([CMD_BLOCK]) + addr.to_bytes(3, "little") + bytes([frames]) \
+            + crc16(data).to_bytes(2, "little")
+        for attempt in range(self.retries + 1):
+            self.bus.send(self.cmd_id, header)
+            for i in range(frames):
+                self.bus.send(self.data_id, data[i * 8:i * 8 + 8])
+            # Erase + write + read-back of up to 4 rows: allow for it
+            resp = self._wait(CMD_BLOCK, self.timeout + 0.2)
+            if resp is None:
+                raise FlashError("no answer to block 0x%05X" % addr)
+            status = resp[1]
+            if status == ST_OK:
+                return attempt
+            if status not in (ST_CRC, ST_TIMEOUT, ST_SEQUENCE):
+                raise FlashError("block 0x%05X: %s" % (addr, STATUS_NAMES[status]))
+            # A timed-out block may still answer late: drain
+            while self._wait(CMD_BLOCK, 0.05) is not None:
+                pass
+        raise FlashError("block 0x%05X failed %d times" % (addr, self.retries + 1))
+
+    def flash(self, image, log=print):
+        info = self.connect()
+        log("node %d: bootloader v%d, app 0x%04X..0x%04X, %d frames/block"
+            % (info[3], info[2], info[4] << 8, info[5] << 8, info[6]))
+        if info[6] < BLOCK_FRAMES or info[7] != ERASE_ROW:
+            raise FlashError("bootloader block geometry differs from this tool")
+
+        start = self.bus.now()
+        resent = 0
+        for off in range(0, len(image), BLOCK_SIZE):
+            resent += self.write_block(APP_BASE + off, image[off:off + BLOCK_SIZE])
+        end = APP_BASE + len(image)
+
+        self.bus.send(self.cmd_id, bytes([CMD_VERIFY]) + end.to_bytes(3, "little")
+                      + crc16(image).to_bytes(2, "little"))
+        resp = self._wait(CMD_VERIFY, 2.0)
+        if resp is None or resp[1] != ST_OK:
+            raise FlashError("image verify failed (%s)"
+                             % (STATUS_NAMES[resp[1]] if resp else "no answer"))
+        elapsed = self.bus.now() - start
+
+        self.bus.send(self.cmd_id, bytes([CMD_RESET]))
+        resp = self._wait(CMD_RESET)
+        if resp is None or resp[1] != ST_OK:
+            raise FlashError("reset refused")
+        return elapsed, resent
+
+
+def run_flash(flasher, image, bus):
+    attempt = 0
+    while True:
+        try:
+            return flasher.flash(image)
+        except FlashError as err:
+            attempt += 1
+            if attempt > 2:
+                raise
+            print("retrying whole image: %s" % err)
+
+
+# ---------------------------------------------------------------------
+# Bootloader model served on SocketCAN (--emulate)
+# ---------------------------------------------------------------------
+def emulate(channel, node):
+    flash = FlashModel()
+    model = NodeModel(node, flash)
+    bus = SocketCanBus(channel, [model.cmd_id, model.data_id])
+    print("emulating node %d bootloader on %s (Ctrl-C to stop)" % (node, channel))
+    for msg in model.take_output():
+        bus.send(*msg)
+    last = time.monotonic()
+    try:
+        while True:
+            msg = bus.recv(0.05)
+            now = time.monotonic()
+            if msg is None:
+                model.idle(now - last)
+            else:
+                model.on_frame(*msg)
+            last = now
+            for out in model.take_output():
+                bus.send(*out)
+            if model.in_app:
+                print("application running (%d rows erased, %d groups written)"
+                      % (flash.erases, flash.writes))
+                flash.erases = flash.writes = 0
+    except KeyboardInterrupt:
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ECU CAN bootloader host")
+    parser.add_argument("hexfile", nargs="?", help="application Intel HEX (linked at 0x%X)" % APP_BASE)
+    parser.add_argument("--node", type=int, required=True, choices=(1, 2, 3))
+    parser.add_argument("--channel", help="SocketCAN interface, e.g. can0 / vcan0")
+    parser.add_argument("--simulate", action="store_true", help="flash a bootloader model in-process")
+    parser.add_argument("--emulate", metavar="CHANNEL", help="serve the bootloader model on CHANNEL")
+    parser.add_argument("--drop-rate", type=float, default=0.0, help="sim: lost data frame probability")
+    parser.add_argument("--power-fail-after", type=int, help="sim: power cycle after N acked blocks")
+    parser.add_argument("--size", type=int, default=16384, help="sim: random image size without HEX")
+    args = parser.parse_args()
+
+    if args.emulate:
+        emulate(args.emulate, args.node)
+        return
+
+    if args.hexfile:
+        image = build_image(read_hex(args.hexfile))
+    elif args.simulate:
+        size = min(args.size, FLASH_END - APP_BASE)
+        image = random_image(size - size % ERASE_ROW)
+    else:
+        parser.error("a HEX file is required unless --simulate is given")
+
+    if args.simulate:
+        flash = FlashModel()
+        # A node already running some older application
+        flash.flash[APP_BASE:APP_BASE + 4096] = bytes(random.Random(7).getrandbits(8) for _ in range(4096))
+        flash.eeprom[EE_APP_VALID] = APP_VALID
+        model = NodeModel(args.node, flash)
+        bus = SimBus(model, args.drop_rate, args.power_fail_after)
+    elif args.channel:
+        bus = SocketCanBus(args.channel, [RESP_ID_BASE + args.node])
+    else:
+        parser.error("--channel or --simulate is required")
+
+    flasher = Flasher(bus, args.node)
+    try:
+        elapsed, resent = run_flash(flasher, image, bus)
+    except FlashError as err:
+        raise SystemExit("flash failed: %s" % err)
+
+    rate = len(image) / elapsed if elapsed else 0.0
+    print("%d bytes in %.2f s (%.1f kB/s), %d frames, bus load %.0f %%, %d blocks resent"
+          % (len(image), elapsed, rate / 1024, bus.frames, 100.0 * bus.bits / BITRATE / elapsed,
+             resent))
+
+    if args.simulate:
+        ok = bytes(flash.flash[APP_BASE:APP_BASE + len(image)]) == image
+        print("sim: %d rows erased, %d groups written, %d data frames dropped, flash busy %.2f s"
+              % (flash.erases, flash.writes, bus.dropped, flash.busy_s))
+        print("sim: image %s, node running %s"
+              % ("matches" if ok else "DIFFERS", "application" if model.in_app else "bootloader"))
+        if not ok or not model.in_app:
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
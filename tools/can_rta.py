@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+"""
+Worst-case response-time analysis for the CAN message set.
+
+Reads the message table (tools/can_messages.csv by default: ID, DLC,
+period, jitter, deadline per frame) and applies the revised CAN
+schedulability analysis of Davis, Burns, Bril and Lukkien (2007),
+which corrects Tindell's original test:
+
+    C_m   = (g + 8 s_m + 13 + floor((g + 8 s_m - 1) / 4)) tau_bit   g = 34
+    B_m   = max C_k over lower priority frames (non-preemptive)
+    t_m   = B_m + sum_{k in hep(m)} ceil((t_m + J_k) / T_k) C_k       busy period
+    w_m(q)= B_m + q C_m + sum_{k in hp(m)} ceil((w + J_k + tau_bit) / T_k) C_k
+    R_m   = max_{q < ceil((t_m + J_m) / T_m)} J_m + w_m(q) - q T_m + C_m
+
+Each frame is schedulable if R_m <= D_m. With --suggest the tool
+searches a priority order with Audsley's optimal priority assignment
+(valid for this test) and maps it onto the IDs already in use.
+With --simulate the set is run on a discrete-event model of the bus
+(bitwise arbitration, exact bit stuffing of random payloads, random
+phases and jitter) and the observed worst response times are checked
+against the analytic bounds.
+
+    can_rta.py                          # analyse tools/can_messages.csv
+    can_rta.py my_table.csv --suggest   # plus an ID ordering that fits
+    can_rta.py --simulate --runs 20     # check bounds on the virtual bus
+
+Every ECU sends through the single buffer TXB0, shared by its signal,
+NM, XCP and profile frames: can_transmit() waits for the buffer, so a
+node's frames leave in the order they were queued, not by ID. By
+default a node is analysed as a FIFO queue (Davis, Kollmann, Pollex
+and Slomka 2011): each of its frames competes on the bus at the
+priority of the node's lowest-priority frame and may wait behind one
+instance of every other frame of the node,
+
+    w_m   = B_L + sum_{k in node(m), k != m} C_k
+                + sum_{j in hp(L), other nodes} ceil((w + J_j + tau_bit) / T_j) C_j
+    R_m   = J_m + w_m + C_m                           L = lowest of node(m)
+
+which holds while R_m <= T_m (at most one queued instance per frame).
+--tx-queue priority restores the priority-queued node model above.
+"""
+
+import argparse
+import csv
+import os
+import random
+import sys
+from fractions import Fraction
+from math import ceil
+
+DEFAULT_TABLE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "can_messages.csv")
+DEFAULT_BITRATE = 500000
+
+
+# ---------------------------------------------------------------------
+# Message table
+# ---------------------------------------------------------------------
+class Message:
+    def __init__(self, name, msg_id, dlc, period, jitter, deadline, node):
+        self.name = name
+        self.id = msg_id
+        self.dlc = dlc
+        self.period = period            # seconds (Fraction)
+        self.jitter = jitter
+        self.deadline = deadline
+        self.node = node
+
+
+def read_table(path):
+    rows = []
+    with open(path) as fh:
+        lines = [line for line in fh if line.strip() and not line.lstrip().startswith("#")]
+    for row in csv.DictReader(lines):
+        try:
+            msg = Message(row["name"].strip(), int(row["id"], 0), int(row["dlc"]),
+                          Fraction(row["period_ms"]) / 1000, Fraction(row["jitter_ms"]) / 1000,
+                          Fraction(row["deadline_ms"]) / 1000, row.get("node", "").strip())
+        except (KeyError, ValueError) as err:
+            raise SystemExit("%s: bad row %r (%s)" % (path, row, err))
+        if not 0 <= msg.id <= 0x7FF or not 0 <= msg.dlc <= 8 or msg.period <= 0:
+            raise SystemExit("%s: %s out of range" % (path, msg.name))
+        rows.append(msg)
+    ids = [m.id for m in rows]
+    if len(set(ids)) != len(ids):
+        raise SystemExit("%s: duplicate IDs (priorities must be unique)" % path)
+    return rows
+
+
+# ---------------------------------------------------------------------
+# Frame length
+# ---------------------------------------------------------------------
+def worst_case_bits(dlc):
+    """Standard-ID data frame with worst-case stuffing, incl. 3-bit IFS."""
+    g = 34
+    return g + 8 * dlc + 13 + (g + 8 * dlc - 1) // 4
+
+
+def _crc15(bits):
+    crc = 0
+    for bit in bits:
+        nxt = bit ^ ((crc >> 14) & 1)
+        crc = (crc << 1) & 0x7FFF
+        if nxt:
+            crc ^= 0x4599
+    return crc
+
+
+def exact_bits(msg_id, data):
+    """Bits on the wire for this frame, stuff bits counted exactly."""
+    fields = [0]                                            # SOF
+    fields += [(msg_id >> (10 - i)) & 1 for i in range(11)]
+    fields += [0, 0, 0]                                     # RTR, IDE, r0
+    fields += [(len(data) >> (3 - i)) & 1 for i in range(4)]
+    for byte in data:
+        fields += [(byte >> (7 - i)) & 1 for i in range(8)]
+    crc = _crc15(fields)
+    fields += [(crc >> (14 - i)) & 1 for i in range(15)]
+
+    stuffed = 0
+    run_bit, run_len = None, 0
+    for bit in fields:
+        if bit == run_bit:
+            run_len += 1
+        else:
+            run_bit, run_len = bit, 1
+        if run_len == 5:
+            stuffed += 1
+            run_bit, run_len = 1 - bit, 1                   # stuff bit starts a new run
+    # CRC delimiter, ACK slot + delimiter, EOF, intermission
+    return len(fields) + stuffed + 1 + 2 + 7 + 3
+
+
+# ---------------------------------------------------------------------
+# Analysis (Davis et al. 2007)
+# ---------------------------------------------------------------------
+def analyse(messages, order, bitrate, fifo=True):
+    """order: messages highest priority first. Returns {name: result}."""
+    if fifo:
+        return analyse_fifo(messages, order, bitrate)
+
+    tau = Fraction(1, bitrate)
+    cost = {m.name: worst_case_bits(m.dlc) * tau for m in messages}
+    results = {}
+
+    for level, m in enumerate(order):
+        hp = order[:level]
+        lp = order[level + 1:]
+        c_m = cost[m.name]
+        blocking = max([cost[k.name] for k in lp], default=Fraction(0))
+
+        # Level-m busy period
+        hep = hp + [m]
+        if sum(cost[k.name] / k.period for k in hep) >= 1:
+            results[m.name] = {"C": c_m, "B": blocking, "R": None, "ok": False}
+            continue
+        t = c_m
+        while True:
+            nxt = blocking + sum(ceil((t + k.jitter) / k.period) * cost[k.name] for k in hep)
+            if nxt == t:
+                break
+            t = nxt
+
+        instances = ceil((t + m.jitter) / m.period)
+        worst = Fraction(0)
+        for q in range(instances):
+            w = blocking + q * c_m
+            while True:
+                nxt = blocking + q * c_m + sum(
+                    ceil((w + k.jitter + tau) / k.period) * cost[k.name] for k in hp)
+                if nxt == w:
+                    break
+                w = nxt                                     # converges: hp load < 1
+            worst = max(worst, m.jitter + w - q * m.period + c_m)
+
+        results[m.name] = {"C": c_m, "B": blocking, "R": worst, "ok": worst <= m.deadline}
+    return results
+
+
+def analyse_fifo(messages, order, bitrate):
+    """Nodes sending through one buffer: FIFO-queued analysis."""
+    tau = Fraction(1, bitrate)
+    cost = {m.name: worst_case_bits(m.dlc) * tau for m in messages}
+    level = {m.name: i for i, m in enumerate(order)}
+    results = {}
+
+    for m in order:
+        own = [k for k in order if k.node == m.node]
+        lowest = max(level[k.name] for k in own)
+        hp = [j for j in order[:lowest] if j.node != m.node]
+        lp = [j for j in order[lowest + 1:] if j.node != m.node]
+        c_m = cost[m.name]
+        blocking = max([cost[j.name] for j in lp], default=Fraction(0))
+        ahead = sum((cost[k.name] for k in own if k is not m), Fraction(0))
+
+        if sum(cost[j.name] / j.period for j in hp) >= 1:
+            results[m.name] = {"C": c_m, "B": blocking, "R": None, "ok": False}
+            continue
+        w = blocking + ahead
+        while True:
+            nxt = blocking + ahead + sum(
+                ceil((w + j.jitter + tau) / j.period) * cost[j.name] for j in hp)
+            if nxt == w:
+                break
+            w = nxt
+        worst = m.jitter + w + c_m
+
+        # One queued instance per frame, or the bound does not hold
+        ok = worst <= m.deadline and worst <= m.period
+        results[m.name] = {"C": c_m, "B": blocking, "R": worst, "ok": ok}
+    return results
+
+
+def audsley(messages, bitrate, fifo=True):
+    """Optimal priority assignment: fill levels from the lowest up."""
+    unassigned = list(messages)
+    lowest_first = []
+    while unassigned:
+        # Try the current lowest priority first so that feasible IDs stay put
+        for m in sorted(unassigned, key=lambda x: -x.id):
+            rest = [k for k in unassigned if k is not m]
+            order = sorted(rest, key=lambda x: x.id) + [m] + list(reversed(lowest_first))
+            if analyse(messages, order, bitrate, fifo)[m.name]["ok"]:
+                lowest_first.append(m)
+                unassigned = rest
+                break
+        else:
+            return None
+    return list(reversed(lowest_first))
+
+
+# ---------------------------------------------------------------------
+# Virtual bus
+# ---------------------------------------------------------------------
+def simulate(messages, bitrate, duration, rng, critical=False, fifo=True):
+    """Discrete-event CAN bus: returns {name: worst observed response (s)}.
+
+    With fifo each node offers only the oldest of its queued frames
+    (one transmit buffer); otherwise all queued frames arbitrate."""
+    tau = 1.0 / bitrate
+    releases = []
+    for m in messages:
+        period = float(m.period)
+        phase = 0.0 if critical else rng.uniform(0, period)
+        k = 0
+        while True:
+            nominal = phase + k * period
+            if nominal > duration:
+                break
+            jitter = float(m.jitter) if critical else rng.uniform(0, float(m.jitter))
+            releases.append((nominal + jitter, nominal, m))
+            k += 1
+    releases.sort(key=lambda r: r[0])
+
+    worst = {m.name: 0.0 for m in messages}
+    pending = []
+    now = 0.0
+    i = 0
+    while i < len(releases) or pending:
+        while i < len(releases) and releases[i][0] <= now:
+            pending.append(releases[i])
+            i += 1
+        if not pending:
+            now = releases[i][0]
+            continue
+        # Arbitration: lowest ID wins among frames queued before the SOF
+        if fifo:
+            heads = {}
+            for r in pending:
+                if r[2].node not in heads:
+                    heads[r[2].node] = r                    # pending is in release order
+            candidates = heads.values()
+        else:
+            candidates = pending
+        winner = min(candidates, key=lambda r: r[2].id)
+        pending.remove(winner)
+        m = winner[2]
+        data = bytes(rng.getrandbits(8) for _ in range(m.dlc))
+        bits = worst_case_bits(m.dlc) if critical else exact_bits(m.id, data)
+        now += bits * tau
+        worst[m.name] = max(worst[m.name], now - winner[1])
+    return worst
+
+
+# ---------------------------------------------------------------------
+# Report
+# ---------------------------------------------------------------------
+def ms(value):
+    return "   -   " if value is None else "%7.3f" % (float(value) * 1000)
+
+
+def report(messages, order, results, bitrate, title):
+    print(title)
+    print("  %-14s %5s %3s %7s %7s %7s %7s %7s %7s  %s"
+          % ("message", "id", "dlc", "C ms", "T ms", "J ms", "D ms", "B ms", "R ms", "ok"))
+    for m in order:
+        r = results[m.name]
+        print("  %-14s 0x%03X %3d %s %s %s %s %s %s  %s"
+              % (m.name, m.id, m.dlc, ms(r["C"]), ms(m.period), ms(m.jitter), ms(m.deadline),
+                 ms(r["B"]), ms(r["R"]), "yes" if r["ok"] else "NO"))
+    util = sum(worst_case_bits(m.dlc) / float(m.period) for m in messages) / bitrate
+    missed = [m.name for m in order if not results[m.name]["ok"]]
+    print("  bus utilisation %.1f %% (worst-case stuffing) at %d bit/s, %s"
+          % (100 * util, bitrate, "schedulable" if not missed else "misses: " + ", ".join(missed)))
+    print()
+    return not missed
+
+
+def main():
+    parser = argparse.ArgumentParser(description="CAN worst-case response-time analysis")
+    parser.add_argument("table", nargs="?", default=DEFAULT_TABLE, help="message table (CSV)")
+    parser.add_argument("--bitrate", type=int, default=DEFAULT_BITRATE)
+    parser.add_argument("--suggest", action="store_true", help="search a schedulable ID ordering")
+    parser.add_argument("--simulate", action="store_true", help="check bounds on the virtual bus")
+    parser.add_argument("--duration", type=float, default=5.0, help="simulated seconds per run")
+    parser.add_argument("--runs", type=int, default=5)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--tx-queue", choices=("fifo", "priority"), default="fifo",
+                        help="per-node transmit queueing (fifo: one shared TXB0)")
+    args = parser.parse_args()
+    fifo = args.tx_queue == "fifo"
+
+    messages = read_table(args.table)
+    order = sorted(messages, key=lambda m: m.id)
+    results = analyse(messages, order, args.bitrate, fifo)
+    print("Node transmit queues: %s" % ("one shared TXB0 per node, frames leave in FIFO order"
+                                        if fifo else "by priority (TXB0 sharing not modelled)"))
+    print()
+    ok = report(messages, order, results, args.bitrate, "Current IDs (%s)" % args.table)
+
+    if args.suggest or not ok:
+        best = audsley(messages, args.bitrate, fifo)
+        if best is None:
+            print("No priority order makes this set schedulable at %d bit/s." % args.bitrate)
+        else:
+            ids = sorted(m.id for m in messages)
+            moved = [m for new_id, m in zip(ids, best) if m.id != new_id]
+            if not moved:
+                print("Current ID order is already a feasible assignment.")
+                print()
+                best = None
+        if best is not None:
+            print("Suggested order (existing IDs reassigned by priority):")
+            for new_id, m in zip(ids, best):
+                print("  %-14s 0x%03X -> 0x%03X" % (m.name, m.id, new_id))
+            print("  (update msg_id.h and the RXF/RXM acceptance filters on every node)")
+            print()
+            report(messages, best, analyse(messages, best, args.bitrate, fifo), args.bitrate,
+                   "Suggested order")
+
+    if args.simulate:
+        rng = random.Random(args.seed)
+        observed = {m.name: 0.0 for m in messages}
+        runs = [simulate(messages, args.bitrate, args.duration, rng, critical=True, fifo=fifo)]
+        runs += [simulate(messages, args.bitrate, args.duration, rng, fifo=fifo)
+                 for _ in range(args.runs)]
+        for run in runs:
+            for name, value in run.items():
+                observed[name] = max(observed[name], value)
+        print("Virtual bus: %d runs x %.1f s (first run: critical instant, worst-case stuffing)"
+              % (len(runs), args.duration))
+        print("  %-14s %9s %9s %6s" % ("message", "seen ms", "bound ms", "used"))
+        violated = []
+        for m in order:
+            bound = results[m.name]["R"]
+            seen = observed[m.name]
+            if bound is not None and seen > float(bound) + 1e-9:
+                violated.append(m.name)
+            print("  %-14s %9.3f %s %5.0f%%"
+                  % (m.name, seen * 1000, "  " + ms(bound),
+                     100 * seen / float(bound) if bound else 0))
+        print("  %s" % ("all observed response times within the analytic bounds" if not violated
+                        else "BOUND EXCEEDED: " + ", ".join(violated)))
+        if violated:
+            sys.exit(1)
+
+    if not ok:
+        sys.exit(2)
+
+
+if __name__ == "__main__":
+    main()
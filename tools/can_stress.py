@@ -0,0 +1,553 @@
+#!/usr/bin/env python3
+"""
+High-load CAN traffic generator and ECU3 receive-path model.
+
+Loads the virtual bus to 80..95 % (or beyond) with the real message set
+(can_messages.csv) plus hundreds of synthetic nodes, and measures how
+ECU3 copes:
+
+  frame loss        frames complete on the bus but never handled by
+                    ECU3: RX ring full (g_can_rx_overruns) or both
+                    hardware buffers full (RXBnOVFL)
+  display latency   end of a dashboard frame (SPEED, GEAR, RPM,
+                    INDICATOR) to the LCD write showing its value,
+                    p50 / p99 / p99.9 / max
+  recovery          after an overload window (offered load > 100 %),
+                    time until ECU3 stops losing frames and the
+                    display latency is back near its baseline
+
+Bus: bitwise arbitration over every queued frame (each node queues by
+priority), non-preemptive frames, exact stuff bits per payload, error
+frames (frame aborted at a random bit, 6+6+8 bit error frame, 3 bit
+IFS, automatic retransmission). Synthetic nodes own 1..N IDs with a
+configurable distribution, random periods scaled to the target load,
+release jitter and bursts of back-to-back frames.
+
+ECU3: the receive path of ECU3/main.c, isr.c, HAL/can.c and msg_handler.c.
+RXB0/RXB1 are drained by the high priority ISR into the RX ring
+(CAN_RX_RING_SIZE from HAL/can.h). The main loop handles at most one
+frame per pass, then renders changed signals (RENDER_*_MS from
+ECU3/msg_handler.h, blocking LCD writes) and idles when the ring is
+empty. ISRs steal time from whatever the main loop is doing. Per-step
+costs are estimates in microseconds (ECU3_COST); set measured figures
+from the profile reports with --cost name=us.
+
+Every (load, run) scenario is simulated in its own worker process, so
+a sweep scales with the cores available. Each scenario derives its
+own seed from --seed, so the results do not depend on --jobs.
+
+    can_stress.py                                   # 80,85,90,95 %, 2 runs each
+    can_stress.py --loads 90 --nodes 400 --ids low --error-rate 1e-3
+    can_stress.py --loads 85 --overload 130:1.0 --runs 8 --jobs 8
+    can_stress.py --loads 90 --emit vcan0           # play one run onto SocketCAN
+
+--emit replays the generated bus trace of the first scenario in real
+time on a SocketCAN interface (vcan or hardware), so a real ECU3 or
+another tool can be fed the same traffic. Error frames exist in the
+model only.
+"""
+
+import argparse
+import csv
+import heapq
+import os
+import random
+import re
+import sys
+import time
+from concurrent.futures import ProcessPoolExecutor
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from can_rta import exact_bits  # noqa: E402
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+TABLE = os.path.join(HERE, "can_messages.csv")
+ECU3_CAN_H = os.path.join(HERE, "..", "ECU3", "can.h")
+ECU3_MSG_HANDLER_H = os.path.join(HERE, "..", "ECU3", "msg_handler.h")
+
+BITRATE = 500000
+TAU = 1.0 / BITRATE
+ERROR_FRAME_BITS = 6 + 6 + 8 + 3        # flag, echoed flags, delimiter, IFS
+
+DASHBOARD = {0x010: "SPEED", 0x020: "GEAR", 0x030: "RPM", 0x050: "INDICATOR"}
+LCD_WRITES = {"SPEED": 4, "GEAR": 3, "RPM": 3, "INDICATOR": 4}
+
+# Never handed to synthetic nodes: XCP, bootloader, diagnostics, reports
+RESERVED = set(range(0x640, 0x660)) | set(range(0x6C0, 0x6F0)) | set(range(0x7E0, 0x800))
+
+# ECU3 per-step CPU cost, microseconds (20 MHz, 5 MIPS)
+ECU3_COST = {
+    "isr_entry": 3.0,       # high priority vector, context save
+    "isr_rx": 25.0,         # can_rx_isr(): latency record + ring copy
+    "isr_tick": 8.0,        # 1 ms tick (low priority)
+    "frame": 110.0,         # can_rx_acquire/release + telemetry_can_frame + routing
+    "frame_dash": 80.0,     # + E2E check, decode, signal store, telemetry signal
+    "pass": 100.0,          # timers, ISO-TP, XCP, odometer, NM, presence, reports
+    "lcd_write": 45.0,      # one HD44780 write incl. busy-flag polling
+}
+
+
+# ---------------------------------------------------------------------
+# Configuration from the source tree
+# ---------------------------------------------------------------------
+def read_define(path, name):
+    match = re.search(r"#define\s+%s\s+(\d+)" % name, open(path).read())
+    if not match:
+        raise SystemExit("%s: %s not found" % (path, name))
+    return int(match.group(1))
+
+
+def read_base_table(path):
+    with open(path) as fh:
+        rows = [line for line in fh if line.strip() and not line.lstrip().startswith("#")]
+    table = []
+    for row in csv.DictReader(rows):
+        table.append({"id": int(row["id"], 0), "dlc": int(row["dlc"]),
+                      "period": float(row["period_ms"]) / 1000,
+                      "jitter": float(row["jitter_ms"]) / 1000, "node": row["node"].strip()})
+    return table
+
+
+# ---------------------------------------------------------------------
+# Traffic generation
+# ---------------------------------------------------------------------
+def pick_ids(rng, count, dist, taken):
+    free = [i for i in range(1, 0x7FF) if i not in taken and i not in RESERVED]
+    if dist.startswith("range:"):
+        low, high = (int(x, 0) for x in dist[6:].split("-"))
+        pool = [i for i in free if low <= i <= high]
+        if len(pool) < count:
+            raise SystemExit("--ids %s: only %d free IDs for %d messages" % (dist, len(pool), count))
+        return rng.sample(pool, count)
+    if len(free) < count:
+        raise SystemExit("only %d free IDs for %d messages" % (len(free), count))
+    if dist == "uniform":
+        return rng.sample(free, count)
+    # Weighted picks without replacement: low = high priority heavy, zipf = few hot ranges
+    if dist == "low":
+        weight = lambda i: 1.0 / (1 + i / 128.0) ** 2        # noqa: E731
+    elif dist == "high":
+        weight = lambda i: (1 + i / 128.0) ** 2              # noqa: E731
+    elif dist == "zipf":
+        weight = lambda i: 1.0 / (1 + (i % 256))             # noqa: E731
+    else:
+        raise SystemExit("unknown --ids %s" % dist)
+    keyed = sorted(free, key=lambda i: rng.random() ** (1.0 / weight(i)), reverse=True)
+    return keyed[:count]
+
+
+def bit_variants(dlc, msg_id, rng, samples=8):
+    """Frame lengths for a few random payloads of this ID."""
+    return [exact_bits(msg_id, bytes(rng.getrandbits(8) for _ in range(dlc)))
+                for _ in range(samples)]
+
+
+def build_messages(cfg, rng):
+    """Base set + synthetic nodes, synthetic periods scaled to the target load."""
+    messages = []
+    for row in read_base_table(cfg["table"]):
+        messages.append(dict(row, kind="base", bits=bit_variants(row["dlc"], row["id"], rng),
+                             burst=0.0))
+    taken = {m["id"] for m in messages}
+
+    per_node = [rng.randint(cfg["msgs_min"], cfg["msgs_max"]) for _ in range(cfg["nodes"])]
+    ids = pick_ids(rng, sum(per_node), cfg["ids"], taken)
+    k = 0
+    for node, count in enumerate(per_node):
+        for _ in range(count):
+            msg_id = ids[k]
+            k += 1
+            dlc = rng.randint(cfg["dlc_min"], cfg["dlc_max"])
+            period = rng.choice(cfg["periods"]) / 1000.0
+            messages.append({"id": msg_id, "dlc": dlc, "period": period,
+                             "jitter": period * cfg["jitter"], "node": "N%03d" % node,
+                             "kind": "synthetic", "bits": bit_variants(dlc, msg_id, rng),
+                             "burst": cfg["burst_prob"]})
+
+    def load(m):
+        extra = m["burst"] * ((cfg["burst_min"] + cfg["burst_max"]) / 2.0 - 1)
+        return (1 + extra) * (sum(m["bits"]) / len(m["bits"])) * TAU / m["period"]
+
+    base = sum(load(m) for m in messages if m["kind"] == "base")
+    synthetic = sum(load(m) for m in messages if m["kind"] == "synthetic")
+    want = cfg["load"] / 100.0 - base
+    if want <= 0 or synthetic == 0:
+        raise SystemExit("target load %.1f %% is below the base set (%.1f %%)"
+                         % (cfg["load"], 100 * base))
+    scale = synthetic / want
+    for m in messages:
+        if m["kind"] == "synthetic":
+            m["period"] *= scale
+            m["jitter"] *= scale
+    return messages, base
+
+
+def releases(messages, cfg, rng):
+    """(time, id, seq, message index, value) for every queued frame.
+
+    The overload adds extra instances of the synthetic messages on top of
+    their normal schedule; the normal schedule keeps its phases, so the
+    traffic after the window is the same mix as before it."""
+    out = []
+    seq = 0
+    over_start, over_len, over_load = cfg["over_start"], cfg["over_len"], cfg["over_load"]
+    extra = over_load / cfg["load"] - 1.0 if over_len else 0.0
+    for index, m in enumerate(messages):
+        starts = [(rng.uniform(0, m["period"]), m["period"], 0.0, cfg["duration"])]
+        if extra > 0 and m["kind"] == "synthetic":
+            period = m["period"] / extra
+            starts.append((over_start + rng.uniform(0, period), period,
+                           over_start, over_start + over_len))
+        value = 0
+        for t, period, lo, hi in starts:
+            while t < hi:
+                burst = 1
+                if m["burst"] and rng.random() < m["burst"]:
+                    burst = rng.randint(cfg["burst_min"], cfg["burst_max"])
+                release = t + rng.uniform(0, m["jitter"])
+                for _ in range(burst):
+                    value += 1
+                    out.append((release, m["id"], seq, index, value))
+                    seq += 1
+                t += period
+    out.sort()
+    return out
+
+
+def run_bus(messages, queue, cfg, rng):
+    """Returns (received frames [(t_rx, id, index, value, t_start)], busy time, error frames)."""
+    pending = []
+    received = []
+    busy = 0.0
+    errors = 0
+    now = 0.0
+    i = 0
+    n = len(queue)
+    error_rate = cfg["error_rate"]
+    while i < n or pending:
+        if not pending and queue[i][0] > now:
+            now = queue[i][0]
+        while i < n and queue[i][0] <= now:
+            t, msg_id, seq, index, value = queue[i]
+            heapq.heappush(pending, (msg_id, seq, index, value))
+            i += 1
+        msg_id, seq, index, value = pending[0]
+        bits = rng.choice(messages[index]["bits"])
+        if error_rate and rng.random() < error_rate:
+            # Destroyed at a random bit, error frame, then arbitration again
+            spent = (rng.randint(1, bits - 10) + ERROR_FRAME_BITS) * TAU
+            errors += 1
+        else:
+            heapq.heappop(pending)
+            spent = bits * TAU
+            received.append((now + (bits - 3) * TAU, msg_id, index, value, now))
+        now += spent
+        busy += spent
+    return received, busy, errors
+
+
+# ---------------------------------------------------------------------
+# ECU3 receive path
+# ---------------------------------------------------------------------
+class Ecu3:
+    def __init__(self, received, messages, cfg):
+        self.rx = received
+        self.messages = messages
+        self.cost = {k: v * 1e-6 for k, v in cfg["cost"].items()}
+        self.ring_cap = cfg["ring_size"] - 1                # one slot kept free
+        self.render_period = cfg["render_ms"]
+        self.ring = []
+        self.ring_head = 0
+        self.rx_next = 0
+        self.isr_free = 0.0                                 # high priority ISR busy until
+        self.hw = []                                        # frames waiting in RXB0/RXB1
+        self.next_tick = 1e-3
+        self.lost_ring = 0
+        self.lost_hw = 0
+        self.lost_dash = 0
+        self.drops = []                                     # times of losses
+        self.ring_max = 0
+        self.latency = []                                   # (draw time, latency)
+        self.store = {}                                     # name -> (version, t_rx)
+        self.drawn = {}
+        self.due = {}
+
+    # ISRs in time order up to 'end'; each one pushes 'end' out by its own cost
+    def _next_isr(self):
+        rx = self.rx[self.rx_next][0] + self.cost["isr_entry"] if self.rx_next < len(self.rx) else None
+        tick = self.next_tick
+        if rx is not None and rx <= tick:
+            return rx, "rx"
+        return tick, "tick"
+
+    def _isr(self, when, kind):
+        start = max(when, self.isr_free)
+        if kind == "tick":
+            self.next_tick += 1e-3
+            self.isr_free = start + self.cost["isr_tick"]
+            return self.cost["isr_tick"]
+        frame = self.rx[self.rx_next]
+        self.rx_next += 1
+        # Both hardware buffers still full when the next frame completes
+        self.hw = [h for h in self.hw if h > frame[0]]
+        if len(self.hw) >= 2:
+            self._drop(frame, hw=True)
+            return 0.0
+        self.hw.append(start)
+        self.isr_free = start + self.cost["isr_rx"]
+        if len(self.ring) - self.ring_head >= self.ring_cap:
+            self._drop(frame, hw=False)
+        else:
+            self.ring.append(frame)
+            self.ring_max = max(self.ring_max, len(self.ring) - self.ring_head)
+        return self.cost["isr_rx"]
+
+    def _drop(self, frame, hw):
+        if hw:
+            self.lost_hw += 1
+        else:
+            self.lost_ring += 1
+        if frame[1] in DASHBOARD:
+            self.lost_dash += 1
+        self.drops.append(frame[0])
+
+    def run(self, t, demand):
+        end = t + demand
+        while True:
+            when, kind = self._next_isr()
+            if when >= end:
+                return end
+            end += self._isr(when, kind)
+
+    def wait_event(self, t):
+        """IDLE until the next interrupt."""
+        when, kind = self._next_isr()
+        when = max(when, t)
+        return when + self._isr(when, kind)
+
+    def simulate(self, duration):
+        t = 0.0
+        while t < duration:
+            t = self.run(t, 0.0)
+            # process_canbus_data(): at most one frame
+            if self.ring_head < len(self.ring):
+                t_rx, msg_id, index, value = self.ring[self.ring_head][:4]
+                self.ring_head += 1
+                name = DASHBOARD.get(msg_id)
+                t = self.run(t, self.cost["frame"] + (self.cost["frame_dash"] if name else 0.0))
+                if name:
+                    self.store[name] = (value, t_rx)
+            # msg_handler_render_poll()
+            for name, (version, t_rx) in self.store.items():
+                if self.drawn.get(name) == version or t < self.due.get(name, 0.0):
+                    continue
+                self.drawn[name] = version
+                self.due[name] = t + self.render_period[name]
+                t = self.run(t, LCD_WRITES[name] * self.cost["lcd_write"])
+                self.latency.append((t, t - t_rx))
+            t = self.run(t, self.cost["pass"])
+            if self.ring_head >= len(self.ring):
+                t = self.wait_event(t)
+        return self
+
+
+# ---------------------------------------------------------------------
+# One scenario
+# ---------------------------------------------------------------------
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    return values[min(len(values) - 1, int(p * len(values)))]
+
+
+def recovery(cfg, received, ecu, window=0.1, settle=3):
+    """Time from the end of the overload until loss and latency are back to baseline.
+
+    Baseline: loss fraction and p99 display latency between warm-up and
+    the overload. Recovered at the first window after the overload that,
+    with the next settle-1 windows, has a loss fraction within 2 points
+    of the baseline and no draw later than max(2 x p99, p99 + 1 ms).
+    Returns None if the run ends first.
+    """
+    o0, o1 = cfg["over_start"], cfg["over_start"] + cfg["over_len"]
+    count = int(cfg["duration"] / window) + 1
+    frames = [0] * count
+    drops = [0] * count
+    worst = [0.0] * count
+    for r in received:
+        frames[min(count - 1, int(r[0] / window))] += 1
+    for t in ecu.drops:
+        drops[min(count - 1, int(t / window))] += 1
+    for t, l in ecu.latency:
+        w = min(count - 1, int(t / window))
+        worst[w] = max(worst[w], l)
+
+    first = int(0.5 / window)
+    last = int(o0 / window)
+    base_loss = sum(drops[first:last]) / max(1, sum(frames[first:last]))
+    before = sorted(l for t, l in ecu.latency if 0.5 <= t < o0)
+    p99 = percentile(before, 0.99)
+    limit = max(2 * p99, p99 + 1e-3)
+
+    def good(w):
+        return drops[w] <= (base_loss + 0.02) * max(1, frames[w]) and worst[w] <= limit
+
+    for w in range(int(o1 / window), count - settle):
+        if all(good(w + k) for k in range(settle)):
+            return max(0.0, w * window - o1)
+    return None
+
+
+def scenario(cfg):
+    rng = random.Random("%s:%s:%s" % (cfg["seed"], cfg["load"], cfg["run"]))
+    messages, base = build_messages(cfg, rng)
+    queue = releases(messages, cfg, rng)
+    received, busy, errors = run_bus(messages, queue, cfg, rng)
+    ecu = Ecu3(received, messages, cfg).simulate(cfg["duration"])
+
+    sent = len(received)
+    dash_sent = sum(1 for r in received if r[1] in DASHBOARD)
+    lat = sorted(l for _, l in ecu.latency)
+    result = {
+        "load": cfg["load"], "run": cfg["run"], "nodes": cfg["nodes"],
+        "messages": len(messages), "bus": busy / max(cfg["duration"], received[-1][0]),
+        "frames": sent, "errors": errors,
+        "loss": (ecu.lost_ring + ecu.lost_hw) / sent, "lost_hw": ecu.lost_hw,
+        "dash_loss": ecu.lost_dash / dash_sent if dash_sent else 0.0,
+        "ring_max": ecu.ring_max,
+        "lat": [percentile(lat, p) for p in (0.5, 0.99, 0.999)] + [lat[-1] if lat else float("nan")],
+    }
+
+    if cfg["over_len"]:
+        result["recovery"] = recovery(cfg, received, ecu)
+    if cfg.get("keep_trace"):
+        result["trace"] = [(r[4], r[1], messages[r[2]]["dlc"], r[3]) for r in received]
+    return result
+
+
+# ---------------------------------------------------------------------
+# SocketCAN replay
+# ---------------------------------------------------------------------
+def emit(channel, trace):
+    import socket
+    import struct
+
+    try:
+        sock = socket.socket(socket.PF_CAN, socket.SOCK_RAW, socket.CAN_RAW)
+        sock.bind((channel,))
+    except (AttributeError, OSError) as exc:
+        raise SystemExit("cannot open SocketCAN interface %s: %s" % (channel, exc))
+    start = time.monotonic()
+    late = 0
+    for t, msg_id, dlc, value in trace:
+        delay = start + t - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        else:
+            late += 1
+        data = value.to_bytes(4, "little") * 2
+        try:
+            sock.send(struct.pack("=IB3x8s", msg_id, dlc, data[:8]))
+        except OSError:                                     # TX queue full, host too slow
+            late += 1
+    print("emitted %d frames on %s in %.1f s (%d behind schedule)"
+          % (len(trace), channel, time.monotonic() - start, late))
+
+
+# ---------------------------------------------------------------------
+# Report
+# ---------------------------------------------------------------------
+def main():
+    parser = argparse.ArgumentParser(description="High-load CAN traffic generator / ECU3 stress model")
+    parser.add_argument("--loads", default="80,85,90,95", help="target bus loads in %%")
+    parser.add_argument("--runs", type=int, default=2, help="runs per load (different seeds)")
+    parser.add_argument("--duration", type=float, default=10.0, help="simulated seconds per run")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--jobs", type=int, default=os.cpu_count() or 1)
+    parser.add_argument("--table", default=TABLE, help="real message set (CSV)")
+    parser.add_argument("--nodes", type=int, default=200, help="synthetic nodes")
+    parser.add_argument("--msgs", default="1-3", help="messages per synthetic node, min-max")
+    parser.add_argument("--dlc", default="0-8", help="synthetic DLC range, min-max")
+    parser.add_argument("--ids", default="uniform",
+                        help="synthetic ID distribution: uniform, low, high, zipf, range:0xA-0xB")
+    parser.add_argument("--periods", default="10,20,50,100,200,500,1000",
+                        help="synthetic periods to pick from (ms, before scaling)")
+    parser.add_argument("--jitter", type=float, default=0.1, help="release jitter, fraction of period")
+    parser.add_argument("--burst-prob", type=float, default=0.02, help="chance a release is a burst")
+    parser.add_argument("--burst-len", default="2-8", help="frames per burst, min-max")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="chance a frame is hit by an error")
+    parser.add_argument("--overload", default=None,
+                        help="LOAD:SECONDS, synthetic traffic raised to LOAD %% mid-run")
+    parser.add_argument("--cost", action="append", default=[],
+                        help="override an ECU3 step cost, name=us (%s)" % ", ".join(ECU3_COST))
+    parser.add_argument("--emit", metavar="IFACE", help="replay the first run on SocketCAN")
+    args = parser.parse_args()
+
+    def span(text):
+        low, _, high = text.partition("-")
+        return int(low), int(high or low)
+
+    cost = dict(ECU3_COST)
+    for item in args.cost:
+        name, _, value = item.partition("=")
+        if name not in cost:
+            raise SystemExit("unknown cost %s" % name)
+        cost[name] = float(value)
+
+    render_ms = {name: read_define(ECU3_MSG_HANDLER_H, "RENDER_%s_MS" % name) / 1000.0
+                 for name in LCD_WRITES}
+    msgs_min, msgs_max = span(args.msgs)
+    dlc_min, dlc_max = span(args.dlc)
+    burst_min, burst_max = span(args.burst_len)
+    over_load, over_len = 0.0, 0.0
+    if args.overload:
+        over_load, over_len = (float(x) for x in args.overload.split(":"))
+    base_cfg = {
+        "duration": args.duration, "seed": args.seed, "table": args.table,
+        "nodes": args.nodes, "msgs_min": msgs_min, "msgs_max": msgs_max,
+        "dlc_min": dlc_min, "dlc_max": dlc_max, "ids": args.ids,
+        "periods": [float(p) for p in args.periods.split(",")], "jitter": args.jitter,
+        "burst_prob": args.burst_prob, "burst_min": burst_min, "burst_max": burst_max,
+        "error_rate": args.error_rate, "over_load": over_load, "over_len": over_len,
+        "over_start": (args.duration - over_len) / 2.0, "cost": cost,
+        "ring_size": read_define(ECU3_CAN_H, "CAN_RX_RING_SIZE"), "render_ms": render_ms,
+    }
+    scenarios = []
+    for load in (float(x) for x in args.loads.split(",")):
+        for run in range(args.runs):
+            cfg = dict(base_cfg, load=load, run=run)
+            cfg["keep_trace"] = bool(args.emit) and not scenarios
+            scenarios.append(cfg)
+
+    start = time.monotonic()
+    if args.jobs > 1 and len(scenarios) > 1:
+        with ProcessPoolExecutor(max_workers=args.jobs) as pool:
+            results = list(pool.map(scenario, scenarios))
+    else:
+        results = [scenario(cfg) for cfg in scenarios]
+    wall = time.monotonic() - start
+
+    print("ECU3 RX ring %d slots, %d synthetic nodes (%s IDs), %.0f s per run, seed %d"
+          % (base_cfg["ring_size"], args.nodes, args.ids, args.duration, args.seed))
+    print("%5s %3s %6s %7s %6s %7s %6s %7s %4s %8s %8s %8s %8s %9s"
+          % ("load", "run", "bus%", "frames", "errors", "loss%", "hwlost", "dash%", "ring",
+             "lat p50", "p99", "p99.9", "max", "recovery"))
+    for r in results:
+        p50, p99, p999, worst = (x * 1e3 for x in r["lat"])
+        if "recovery" not in r:
+            recovery = "-"
+        elif r["recovery"] is None:
+            recovery = "> run"
+        else:
+            recovery = "%.0f ms" % (r["recovery"] * 1e3)
+        print("%5.0f %3d %6.1f %7d %6d %7.3f %6d %7.3f %4d %6.2fms %6.2fms %6.2fms %6.2fms %9s"
+              % (r["load"], r["run"], 100 * r["bus"], r["frames"], r["errors"], 100 * r["loss"],
+                 r["lost_hw"], 100 * r["dash_loss"], r["ring_max"], p50, p99, p999, worst, recovery))
+    print("%d scenarios in %.1f s on %d worker(s)" % (len(scenarios), wall, min(args.jobs, len(scenarios))))
+
+    if args.emit:
+        emit(args.emit, results[0]["trace"])
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""
+Generates the per-node configuration header of the shared drivers and
+modules.
+
+Reads tools/hal_nodes.csv (one row per node) and writes <dir>/hal_cfg.h
+for every node, which HAL/hal.h includes. The header only holds
+preprocessor switches and the node ID; the drivers and modules select
+their code from them at compile time.
+
+    gen_hal_cfg.py                  # regenerate every node's hal_cfg.h
+    gen_hal_cfg.py --check          # exit 1 if a header is out of date
+    gen_hal_cfg.py --sources ECU3   # HAL sources that compile to code
+
+--sources lists the HAL/*.c files that are not empty for a node, for
+project files that want to leave the others out (they also build as
+empty objects).
+"""
+
+import argparse
+import csv
+import os
+import sys
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(TOOLS)
+TABLE = os.path.join(TOOLS, "hal_nodes.csv")
+
+CHOICES = {
+    "tsync": {"master": 1, "slave": 0},
+    "can_rx": {"irq": 1, "poll": 0},
+    "can_filter": {"node": 1, "all": 0},
+}
+FLAGS = ("adc", "clcd", "digital_keypad", "calib", "ttsched")
+NODE_IDS = range(1, 4)
+
+SOURCES = (
+    ("can.c", None),
+    ("adc.c", "adc"),
+    ("clcd.c", "clcd"),
+    ("digital_keypad.c", "digital_keypad"),
+    ("crc8.c", None),
+    ("e2e.c", None),
+    ("eeprom.c", None),
+    ("bootreq.c", None),
+    ("timesync.c", None),
+    ("nm.c", None),
+    ("profile.c", None),
+    ("xcp.c", None),
+    ("calib.c", "calib"),
+    ("ttsched.c", "ttsched"),
+)
+
+
+def read_table(path):
+    with open(path, newline="") as f:
+        rows = [line for line in f if line.strip() and not line.lstrip().startswith("#")]
+    nodes = []
+    for row in csv.DictReader(rows):
+        node = {"node": row["node"].strip(), "dir": row["dir"].strip()}
+        node["node_id"] = int(row["node_id"])
+        if node["node_id"] not in NODE_IDS:
+            raise SystemExit("%s: node_id must be %d..%d"
+                             % (node["node"], NODE_IDS[0], NODE_IDS[-1]))
+        for key, values in CHOICES.items():
+            value = row[key].strip()
+            if value not in values:
+                raise SystemExit("%s: %s must be one of %s, not %r"
+                                 % (node["node"], key, "/".join(values), value))
+            node[key] = values[value]
+        node["can_tx_wait"] = int(row["can_tx_wait"])
+        if not 0 <= node["can_tx_wait"] <= 0xFFFF:
+            raise SystemExit("%s: can_tx_wait must fit in 16 bits" % node["node"])
+        for key in FLAGS:
+            if row[key].strip() not in ("0", "1"):
+                raise SystemExit("%s: %s must be 0 or 1" % (node["node"], key))
+            node[key] = int(row[key])
+        nodes.append(node)
+    ids = [n["node_id"] for n in nodes]
+    if len(set(ids)) != len(ids):
+        raise SystemExit("node_id values must be unique")
+    if sum(n["tsync"] for n in nodes) != 1:
+        raise SystemExit("exactly one node must be the time-sync master")
+    return nodes
+
+
+def render(node):
+    define = lambda name, value, note: "#define %-27s %-6s/* %s */" % (name, value, note)
+    lines = [
+        "/* Generated by tools/gen_hal_cfg.py from tools/hal_nodes.csv, do not edit */",
+        "",
+        "#ifndef HAL_CFG_H",
+        "#define HAL_CFG_H",
+        "",
+        "/*---------------------------------------------------------",
+        " * Shared Driver Configuration : %s" % node["node"],
+        " *---------------------------------------------------------*/",
+        define("HAL_NODE_ID", node["node_id"], "NM / XCP / boot / profile IDs"),
+        define("HAL_TSYNC_MASTER", node["tsync"],
+               "Time master, Timer1" if node["tsync"] else "Time slave, Timer3"),
+        define("HAL_CAN_RX_IRQ", node["can_rx"],
+               "RX ISR + ring" if node["can_rx"] else "Polled can_receive()"),
+        define("HAL_CAN_FILTER_NODE", node["can_filter"],
+               "Node acceptance filters" if node["can_filter"] else "Accept every frame"),
+        define("HAL_CAN_TX_WAIT_LOOPS", node["can_tx_wait"],
+               "Wait for a busy TXB0" if node["can_tx_wait"] else "Callers check ECAN_TX0_BUSY"),
+        define("HAL_ADC", node["adc"], "adc.c"),
+        define("HAL_CLCD", node["clcd"], "clcd.c"),
+        define("HAL_DIGITAL_KEYPAD", node["digital_keypad"], "digital_keypad.c"),
+        define("HAL_CALIB", node["calib"], "calib.c"),
+        define("HAL_TTSCHED", node["ttsched"], "ttsched.c"),
+        "",
+        "#endif /* HAL_CFG_H */",
+        "",
+    ]
+    return "\n".join(line.rstrip() for line in lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate <node>/hal_cfg.h for the shared tree")
+    parser.add_argument("--table", default=TABLE)
+    parser.add_argument("--check", action="store_true", help="only verify the headers are current")
+    parser.add_argument("--sources", metavar="NODE", help="list the HAL sources a node compiles")
+    args = parser.parse_args()
+
+    nodes = read_table(args.table)
+
+    if args.sources:
+        node = next((n for n in nodes if n["node"] == args.sources), None)
+        if node is None:
+            raise SystemExit("unknown node %s" % args.sources)
+        for name, flag in SOURCES:
+            if flag is None or node[flag]:
+                print(os.path.join("HAL", name))
+        return 0
+
+    stale = 0
+    for node in nodes:
+        path = os.path.join(ROOT, node["dir"], "hal_cfg.h")
+        text = render(node)
+        try:
+            with open(path) as f:
+                current = f.read()
+        except FileNotFoundError:
+            current = None
+        if current == text:
+            continue
+        if args.check:
+            print("%s is out of date" % os.path.relpath(path, ROOT))
+            stale += 1
+        else:
+            with open(path, "w") as f:
+                f.write(text)
+            print("wrote %s" % os.path.relpath(path, ROOT))
+    return 1 if stale else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""
+Code size of the shared drivers and modules per node.
+
+Compiles every HAL/*.c once with each node's hal_cfg.h and once with a
+configuration that switches every feature on (what a single image for
+all nodes, selecting features at run time, would have to carry), and
+prints the .text size of each object (the "all" column takes the
+larger of that build and the nodes' own, e.g. node-specific probes).
+
+    hal_size.py                     # host gcc -Os, relative sizes
+    hal_size.py --cc xc8-cc --cflags "-mcpu=18F4580 -Os"
+
+Without XC8 the numbers come from the host compiler against the
+register model in test/stub/; they compare configurations, they are
+not PIC18 program memory bytes. Sources a node leaves out compile to
+empty objects (size 0).
+"""
+
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.dirname(TOOLS)
+sys.path.insert(0, TOOLS)
+
+import gen_hal_cfg  # noqa: E402
+
+# Every switch on; the node_cfg.h with a calibration set (ECU1) and the
+# interrupt map of the node with the RX ISR (ECU3) complete the build.
+# The LCD and the keypad share RC0..RC2, so clcd.c is sized with the
+# keypad off and everything else with the LCD off.
+ALL = {
+    "node": "all", "dir": "", "node_id": 1, "tsync": 0, "can_rx": 1, "can_filter": 1,
+    "can_tx_wait": 2000, "adc": 1, "clcd": 0, "digital_keypad": 1, "calib": 1, "ttsched": 1,
+}
+ALL_CLCD = dict(ALL, clcd=1, digital_keypad=0)
+ALL_DIRS = ("ECU1", "ECU3")
+
+
+def text_size(cc, cflags, includes, source, obj):
+    cmd = [cc] + cflags + ["-c", source, "-o", obj] + ["-I" + i for i in includes]
+    subprocess.run(cmd, check=True)
+    out = subprocess.run(["size", obj], check=True, capture_output=True, text=True).stdout
+    return int(out.splitlines()[1].split()[0])
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-node code size of the shared tree")
+    parser.add_argument("--cc", default="gcc")
+    parser.add_argument("--cflags", default="-std=gnu99 -Os -w",
+                        help="compiler flags (default: host build)")
+    args = parser.parse_args()
+
+    cflags = shlex.split(args.cflags)
+    stub = [] if "xc8" in os.path.basename(args.cc) else [os.path.join(ROOT, "test", "stub")]
+    nodes = gen_hal_cfg.read_table(gen_hal_cfg.TABLE)
+    hal = os.path.join(ROOT, "HAL")
+    sizes = {}
+
+    with tempfile.TemporaryDirectory() as tmp:
+        all_dirs = {}
+        for name, cfg in (("all", ALL), ("all_clcd", ALL_CLCD)):
+            all_dirs[name] = os.path.join(tmp, name)
+            os.mkdir(all_dirs[name])
+            with open(os.path.join(all_dirs[name], "hal_cfg.h"), "w") as f:
+                f.write(gen_hal_cfg.render(cfg))
+
+        for source, _ in gen_hal_cfg.SOURCES:
+            configs = [(n["node"], [os.path.join(ROOT, n["dir"])]) for n in nodes]
+            configs.append(("all", [all_dirs["all_clcd" if source == "clcd.c" else "all"]] +
+                            [os.path.join(ROOT, d) for d in ALL_DIRS]))
+            for name, dirs in configs:
+                obj = os.path.join(tmp, "%s_%s.o" % (name, source))
+                sizes[name, source] = text_size(args.cc, cflags, stub + dirs + [hal],
+                                                os.path.join(hal, source), obj)
+
+    # One image carries the largest variant of every source
+    for source, _ in gen_hal_cfg.SOURCES:
+        sizes["all", source] = max(sizes[n, source] for n in [n["node"] for n in nodes] + ["all"])
+
+    names = [n["node"] for n in nodes] + ["all"]
+    print("%-18s" % "HAL source" + "".join("%8s" % n for n in names))
+    for source, _ in gen_hal_cfg.SOURCES:
+        print("%-18s" % source + "".join("%8d" % sizes[n, source] for n in names))
+    totals = {n: sum(sizes[n, s] for s, _ in gen_hal_cfg.SOURCES) for n in names}
+    print("%-18s" % "total" + "".join("%8d" % totals[n] for n in names))
+    print("%-18s" % "vs all" + "".join("%7d%%" % (100 * totals[n] // totals["all"]) for n in names))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
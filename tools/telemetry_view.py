@@ -0,0 +1,342 @@
+#!/usr/bin/env python3
+"""
+Host side of the ECU3 serial telemetry bridge (ECU3/telemetry.c).
+
+Reads COBS framed records from a serial device or pseudo-terminal,
+checks their CRC-8 and sequence numbers, and shows a live text
+dashboard of the decoded signals and the raw CAN traffic.
+
+    telemetry_view.py /dev/ttyUSB0            # live dashboard
+    telemetry_view.py /dev/ttyUSB0 --raw      # one line per record
+    telemetry_view.py --simulate              # built-in ECU3 stand-in on a pty
+
+--simulate opens a pseudo-terminal pair, writes records exactly as the
+firmware frames them to one end and decodes the other end, so the
+whole path can be exercised on Linux without hardware. The host tests
+(test/test_telemetry.c) feed the bytes of the built ECU3 firmware to
+--raw over a pty instead.
+
+Input ends when the device goes away (pty closed, adapter unplugged);
+--raw then prints the decoder totals.
+"""
+
+import argparse
+import errno
+import os
+import random
+import select
+import sys
+import termios
+import threading
+import time
+import tty
+
+# Record types / signal IDs (ECU3/telemetry.h)
+REC_CAN_FRAME = 0x01
+REC_SIGNAL = 0x02
+
+SIG_SPEED = 0x00
+SIG_GEAR = 0x01
+SIG_RPM = 0x02
+SIG_INDICATOR = 0x03
+SIG_COLLISION = 0x04
+
+SIGNAL_NAMES = {
+    SIG_SPEED: "speed",
+    SIG_GEAR: "gear",
+    SIG_RPM: "rpm",
+    SIG_INDICATOR: "indicator",
+    SIG_COLLISION: "collision",
+}
+
+GEAR_LABELS = ["ON", "GN", "G1", "G2", "G3", "G4", "G5", "Gr", "C_"]
+INDICATOR_LABELS = ["off", "<- left", "right ->", "<- hazard ->"]
+
+BAUD_RATES = {
+    9600: termios.B9600,
+    19200: termios.B19200,
+    38400: termios.B38400,
+    57600: termios.B57600,
+    115200: termios.B115200,
+    230400: termios.B230400,
+}
+
+
+# ---------------------------------------------------------------------
+# CRC-8 SAE J1850 (poly 0x1D, init 0xFF, xor-out 0xFF), as HAL/crc8.c
+# ---------------------------------------------------------------------
+def _make_crc8_table():
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1D) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+        table.append(crc)
+    return table
+
+
+CRC8_TABLE = _make_crc8_table()
+
+
+def crc8(data):
+    crc = 0xFF
+    for byte in data:
+        crc = CRC8_TABLE[crc ^ byte]
+    return crc ^ 0xFF
+
+
+# ---------------------------------------------------------------------
+# COBS
+# ---------------------------------------------------------------------
+def cobs_encode(data):
+    out = bytearray([0])
+    code_pos = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_pos] = code
+            code_pos = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_pos] = code
+                code_pos = len(out)
+                out.append(0)
+                code = 1
+    out[code_pos] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS code")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_record(rec_type, seq, payload):
+    body = bytes([rec_type, seq & 0xFF]) + bytes(payload)
+    return cobs_encode(body + bytes([crc8(body)])) + b"\x00"
+
+
+# ---------------------------------------------------------------------
+# Stream decoder
+# ---------------------------------------------------------------------
+class Decoder:
+    """Splits the byte stream on 0x00 and validates each record."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.next_seq = None
+        self.records = 0
+        self.crc_errors = 0
+        self.framing_errors = 0
+        self.lost = 0
+
+    def feed(self, chunk):
+        self.buf += chunk
+        while True:
+            end = self.buf.find(b"\x00")
+            if end < 0:
+                return
+            frame = bytes(self.buf[:end])
+            del self.buf[:end + 1]
+            if not frame:
+                continue
+            record = self._parse(frame)
+            if record is not None:
+                yield record
+
+    def _parse(self, frame):
+        try:
+            body = cobs_decode(frame)
+        except ValueError:
+            self.framing_errors += 1
+            return None
+        if len(body) < 3:
+            self.framing_errors += 1
+            return None
+        if crc8(body[:-1]) != body[-1]:
+            self.crc_errors += 1
+            return None
+
+        rec_type, seq, payload = body[0], body[1], body[2:-1]
+        if self.next_seq is not None:
+            self.lost += (seq - self.next_seq) & 0xFF
+        self.next_seq = (seq + 1) & 0xFF
+        self.records += 1
+
+        if rec_type == REC_CAN_FRAME and len(payload) >= 3:
+            msg_id = payload[0] | (payload[1] << 8)
+            dlc = payload[2]
+            return ("can", msg_id, bytes(payload[3:3 + dlc]))
+        if rec_type == REC_SIGNAL and len(payload) == 3:
+            return ("signal", payload[0], payload[1] | (payload[2] << 8))
+        self.framing_errors += 1
+        return None
+
+
+# ---------------------------------------------------------------------
+# Live dashboard
+# ---------------------------------------------------------------------
+class Dashboard:
+    def __init__(self):
+        self.signals = {}
+        self.frame_counts = {}
+        self.frames = 0
+        self.rate = 0.0
+        self._rate_start = time.monotonic()
+        self._rate_frames = 0
+
+    def update(self, record):
+        if record[0] == "signal":
+            self.signals[record[1]] = record[2]
+        else:
+            self.frames += 1
+            self.frame_counts[record[1]] = self.frame_counts.get(record[1], 0) + 1
+
+    def render(self, decoder):
+        now = time.monotonic()
+        if now - self._rate_start >= 1.0:
+            self.rate = (self.frames - self._rate_frames) / (now - self._rate_start)
+            self._rate_start = now
+            self._rate_frames = self.frames
+
+        gear = self.signals.get(SIG_GEAR)
+        indicator = self.signals.get(SIG_INDICATOR)
+        lines = [
+            "ECU3 telemetry",
+            "",
+            "  speed      : %s km/h" % self.signals.get(SIG_SPEED, "--"),
+            "  gear       : %s" % (GEAR_LABELS[gear] if gear is not None and gear < 9 else "--"),
+            "  rpm        : %s" % self.signals.get(SIG_RPM, "--"),
+            "  indicator  : %s" % (INDICATOR_LABELS[indicator] if indicator is not None and indicator < 4 else "--"),
+            "  collision  : %s" % ("YES" if self.signals.get(SIG_COLLISION) else "no"),
+            "",
+            "  CAN frames : %d (%.0f/s)" % (self.frames, self.rate),
+        ]
+        for msg_id in sorted(self.frame_counts):
+            lines.append("    0x%03X    : %d" % (msg_id, self.frame_counts[msg_id]))
+        lines += ["", "  " + format_totals(decoder)]
+        sys.stdout.write("\x1b[H\x1b[2J" + "\n".join(lines) + "\n")
+        sys.stdout.flush()
+
+
+def format_totals(decoder):
+    return "records %d  lost %d  crc errors %d  framing errors %d" % (
+        decoder.records, decoder.lost, decoder.crc_errors, decoder.framing_errors)
+
+
+def format_record(record):
+    if record[0] == "signal":
+        return "SIG %-9s %u" % (SIGNAL_NAMES.get(record[1], "#%d" % record[1]), record[2])
+    return "CAN 0x%03X [%d] %s" % (record[1], len(record[2]), record[2].hex(" "))
+
+
+# ---------------------------------------------------------------------
+# Input
+# ---------------------------------------------------------------------
+def open_port(path, baud):
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    if os.isatty(fd):
+        # Keep bytes already received: COBS resynchronises anyway
+        tty.setraw(fd, termios.TCSANOW)
+        if baud not in BAUD_RATES:
+            raise SystemExit("unsupported baud rate %d" % baud)
+        attrs = termios.tcgetattr(fd)
+        attrs[4] = attrs[5] = BAUD_RATES[baud]
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def simulate(fd, stop):
+    """Stand-in for ECU3: frames records like the firmware does."""
+    seq = 0
+    speed, rpm, gear, indicator = 0, 800, 1, 0
+    while not stop.is_set():
+        speed = max(0, min(180, speed + random.randint(-2, 3)))
+        rpm = max(800, min(7000, rpm + random.randint(-150, 200)))
+        if random.random() < 0.02:
+            gear = random.randint(1, 6)
+        if random.random() < 0.01:
+            indicator = random.randint(0, 3)
+
+        speed_txt = str(speed).zfill(2)[:3].encode()
+        records = [
+            (REC_CAN_FRAME, [0x10, 0x00, len(speed_txt)] + list(speed_txt)),
+            (REC_SIGNAL, [SIG_SPEED, speed & 0xFF, speed >> 8]),
+            (REC_CAN_FRAME, [0x20, 0x00, 1, gear]),
+            (REC_SIGNAL, [SIG_GEAR, gear, 0]),
+            (REC_SIGNAL, [SIG_RPM, rpm & 0xFF, rpm >> 8]),
+            (REC_SIGNAL, [SIG_INDICATOR, indicator, 0]),
+        ]
+        out = b"".join(encode_record(t, seq + i, p) for i, (t, p) in enumerate(records))
+        seq = (seq + len(records)) & 0xFF
+        os.write(fd, out)
+        time.sleep(0.02)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="ECU3 serial telemetry viewer")
+    parser.add_argument("device", nargs="?", help="serial device or pty")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--raw", action="store_true", help="print records instead of the dashboard")
+    parser.add_argument("--simulate", action="store_true", help="feed a built-in ECU3 stand-in through a pty")
+    args = parser.parse_args()
+
+    stop = threading.Event()
+    if args.simulate:
+        master, slave = os.openpty()
+        tty.setraw(slave)
+        threading.Thread(target=simulate, args=(master, stop), daemon=True).start()
+        fd = slave
+    elif args.device:
+        fd = open_port(args.device, args.baud)
+    else:
+        parser.error("a device is required unless --simulate is given")
+
+    decoder = Decoder()
+    dashboard = Dashboard()
+    last_render = 0.0
+
+    try:
+        while True:
+            ready, _, _ = select.select([fd], [], [], 0.2)
+            if ready:
+                try:
+                    chunk = os.read(fd, 4096)
+                except OSError as exc:
+                    # Other end of a pty closed
+                    if exc.errno != errno.EIO:
+                        raise
+                    chunk = b""
+                if not chunk:
+                    break
+                for record in decoder.feed(chunk):
+                    if args.raw:
+                        print(format_record(record))
+                    else:
+                        dashboard.update(record)
+            if not args.raw and time.monotonic() - last_render >= 0.1:
+                dashboard.render(decoder)
+                last_render = time.monotonic()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stop.set()
+        if args.raw:
+            print(format_totals(decoder))
+
+
+if __name__ == "__main__":
+    main()
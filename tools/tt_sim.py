@@ -0,0 +1,330 @@
+#!/usr/bin/env python3
+"""
+Virtual-bus comparison of free-running and time-triggered transmission.
+
+Models the three ECUs on one 500 kbit/s bus and measures, at ECU3,
+how regularly the slotted frames of ECU1 and ECU2 (GEAR, SPEED, RPM,
+INDICATOR) arrive:
+
+  free  ECU1/ECU2 loops paced by profile_delay_ms(10) (ends on the
+        first 1 ms wake-up after 10 ms) plus varying execution time,
+        each node on its own crystal.
+  tt    loops paced by ttsched_wait() on the matrix of
+        HAL/tt_matrix.h, on the global time of the SYNC/FUP exchange
+        (residual clock error after each 1 s SYNC, raw-timer spin
+        resolution, occasional interrupt in the final spin).
+
+ECU3 traffic (TIME_SYNC, NM, XCP DTO, profile reports) is free-running
+in both modes. Arbitration is bitwise (lowest ID), frames are
+non-preemptive, frame lengths use exact bit stuffing (can_rta.py) and
+each node sends through one buffer in order, as can_transmit() does.
+
+For every slotted frame the tool reports the inter-arrival jitter
+(deviation of the arrival interval from its mean), the arbitration
+wait (queued to start of frame) and how often another slotted frame
+was in the way, with a histogram of the jitter for both modes.
+
+    tt_sim.py                       # 60 s per mode
+    tt_sim.py --duration 600 --seed 7
+
+Exits non-zero if, in tt mode, a slotted frame ever waits behind
+another slotted frame or its jitter is not below the free-running one.
+"""
+
+import argparse
+import os
+import random
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from can_rta import exact_bits  # noqa: E402
+
+BITRATE = 500000
+TAU = 1.0 / BITRATE
+
+MATRIX_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "HAL", "tt_matrix.h")
+
+# Message IDs and payload lengths on the wire (msg_id.h, E2E header included)
+TIME_SYNC, SPEED, GEAR, RPM, INDICATOR = 0x008, 0x010, 0x020, 0x030, 0x050
+NM = {1: 0x501, 2: 0x502, 3: 0x503}
+XCP_DTO = {1: 0x651, 2: 0x652, 3: 0x653}
+PROFILE = {1: 0x7F6, 2: 0x7F7, 3: 0x7F8}
+DLC = {TIME_SYNC: 6, SPEED: 5, GEAR: 3, RPM: 7, INDICATOR: 3}
+NAMES = {GEAR: "GEAR", SPEED: "SPEED", RPM: "RPM", INDICATOR: "INDICATOR"}
+SLOTTED = (GEAR, SPEED, RPM, INDICATOR)
+
+# Firmware timing assumptions
+CRYSTAL_PPM = 50            # per-node oscillator tolerance
+SYNC_PERIOD = 1.0           # TSYNC_PERIOD_MS
+SYNC_NOISE = 3e-6           # RX stamp error per SYNC (ISR entry)
+DRIFT_RESIDUAL_PPM = 1.0    # after drift compensation
+SPIN_STEP = 1.6e-6          # Timer3 count (Fosc/4, 1:8)
+ISR_PROB, ISR_MAX = 0.05, 15e-6
+TX_SETUP = 60e-6            # e2e_protect() + can_transmit() (constant)
+
+
+def read_matrix(path):
+    """Slot start granules and cycle from tt_matrix.h."""
+    text = open(path).read()
+
+    def value(name):
+        match = re.search(r"#define\s+%s\s+(\d+)" % name, text)
+        if not match:
+            raise SystemExit("%s: %s not found" % (path, name))
+        return int(match.group(1))
+
+    granule = value("TT_GRANULE_US") * 1e-6
+    cycle = granule * value("TT_CYCLE_GRANULES")
+    starts = {mid: value("TT_%s_START" % NAMES[mid]) * granule for mid in SLOTTED}
+    return cycle, starts
+
+
+# ---------------------------------------------------------------------
+# Traffic generation (queue time, node, id, dlc) per node, in order
+# ---------------------------------------------------------------------
+class Clock:
+    """Local oscillator: local seconds -> true seconds."""
+
+    def __init__(self, rng):
+        self.rate = 1 + rng.uniform(-CRYSTAL_PPM, CRYSTAL_PPM) * 1e-6
+
+    def true(self, local):
+        return local * self.rate
+
+
+class GlobalTime:
+    """Error of a slave's synchronized global time, as a function of true time."""
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.drift = rng.uniform(-DRIFT_RESIDUAL_PPM, DRIFT_RESIDUAL_PPM) * 1e-6
+        self.noise = {}
+
+    def error(self, t):
+        k = int(t / SYNC_PERIOD)
+        if k not in self.noise:
+            self.noise[k] = self.rng.gauss(0, SYNC_NOISE)
+        return self.noise[k] + self.drift * (t - k * SYNC_PERIOD)
+
+
+def exec_time(rng, low=0.2e-3, high=0.8e-3):
+    return rng.uniform(low, high)
+
+
+def free_delay(t, clock, rng):
+    """profile_delay_ms(10): ends on the first 1 ms wake-up after 10 ms."""
+    phase = rng.uniform(0, 1e-3)
+    return t + clock.true(10e-3 + phase)
+
+
+def node_frames(node, mode, duration, rng, cycle, starts):
+    """Main loop of ECU1 / ECU2 (main.c) as a list of queued frames."""
+    clock = Clock(rng)
+    gtime = GlobalTime(rng)
+    frames = []
+    t = rng.uniform(0, 20e-3)
+    due = {"nm": t + rng.uniform(0, 0.2), "profile": t + rng.uniform(0, 0.1)}
+
+    def wait(t, mid):
+        if mode != "tt":
+            return free_delay(t, clock, rng)
+        # ttsched_wait(): next slot start on the node's global time
+        g = t + gtime.error(t)
+        target = g - (g % cycle) + starts[mid]
+        if g - target >= 200e-6:
+            target += cycle
+        t = max(t, target - gtime.error(target)) + rng.uniform(0, SPIN_STEP)
+        if rng.random() < ISR_PROB:
+            t += rng.uniform(0, ISR_MAX)
+        return t
+
+    def send(t, mid, dlc, setup=TX_SETUP):
+        frames.append((t + setup, node, mid, dlc))
+        return t + setup
+
+    def housekeeping(t):
+        t = send(t + exec_time(rng), XCP_DTO[node], 8, 0)
+        if t >= due["profile"]:
+            t = send(t, PROFILE[node], 7, 0)
+            due["profile"] += clock.true(0.1)
+        if t >= due["nm"]:
+            t = send(t, NM[node], 5, 0)
+            due["nm"] += clock.true(0.2)
+        return t
+
+    while t < duration:
+        sample = exec_time(rng, 0.1e-3, 0.4e-3)
+        if node == 1:
+            if mode != "tt":
+                t = housekeeping(wait(t, None))
+            t = send(wait(t + sample, GEAR) if mode == "tt" else t + sample, GEAR, DLC[GEAR])
+            if mode == "tt":
+                t = housekeeping(t)
+            t = send(wait(t + exec_time(rng, 0.1e-3, 0.4e-3), SPEED), SPEED, DLC[SPEED])
+        else:
+            if mode == "tt":
+                t = send(wait(t + sample, RPM), RPM, DLC[RPM])
+                t = send(wait(t, INDICATOR), INDICATOR, DLC[INDICATOR])
+            else:
+                t = send(t + sample, INDICATOR, DLC[INDICATOR])
+                t = send(wait(t, None), RPM, DLC[RPM])
+                t = wait(t, None)
+            t = housekeeping(t)
+    return frames
+
+
+def ecu3_frames(duration, rng):
+    clock = Clock(rng)
+    frames = []
+    for period, mid, dlc in ((0.01, XCP_DTO[3], 8), (0.1, PROFILE[3], 7), (0.2, NM[3], 5)):
+        t = rng.uniform(0, period)
+        while t < duration:
+            frames.append((t + exec_time(rng, 0, 0.5e-3), 3, mid, dlc))
+            t += clock.true(period)
+    t = rng.uniform(0, SYNC_PERIOD)
+    while t < duration:
+        frames.append((t, 3, TIME_SYNC, DLC[TIME_SYNC]))           # SYNC
+        frames.append((t + 30e-3, 3, TIME_SYNC, DLC[TIME_SYNC]))   # FUP
+        t += clock.true(SYNC_PERIOD)
+    frames.sort()
+    return frames
+
+
+# ---------------------------------------------------------------------
+# Bus
+# ---------------------------------------------------------------------
+def run_bus(queues, rng):
+    """queues: {node: [(t, node, id, dlc)...]} -> list of transmitted frames."""
+    heads = {node: 0 for node in queues}
+    log = []
+    now = 0.0
+    while True:
+        ready = []
+        for node, frames in queues.items():
+            i = heads[node]
+            if i < len(frames):
+                ready.append((frames[i], node))
+        if not ready:
+            break
+        queued = [r for r in ready if r[0][0] <= now]
+        if not queued:
+            now = min(r[0][0] for r in ready)
+            continue
+        (t_q, _, mid, dlc), node = min(queued, key=lambda r: r[0][2])
+        heads[node] += 1
+        data = bytes(rng.getrandbits(8) for _ in range(dlc))
+        start = now
+        now += exact_bits(mid, data) * TAU
+        log.append((mid, node, t_q, start, now))
+        # Next frame of this node cannot be queued before this one has left
+        frames = queues[node]
+        if heads[node] < len(frames) and frames[heads[node]][0] < now:
+            f = frames[heads[node]]
+            frames[heads[node]] = (now,) + f[1:]
+    return log
+
+
+def simulate(mode, duration, seed, cycle, starts):
+    rng = random.Random(seed)
+    queues = {
+        1: node_frames(1, mode, duration, rng, cycle, starts),
+        2: node_frames(2, mode, duration, rng, cycle, starts),
+        3: ecu3_frames(duration, rng),
+    }
+    log = run_bus(queues, rng)
+
+    stats = {}
+    for mid in SLOTTED:
+        rows = [i for i, r in enumerate(log) if r[0] == mid]
+        arrivals = [log[i][4] for i in rows]
+        deltas = [b - a for a, b in zip(arrivals, arrivals[1:])]
+        mean = sum(deltas) / len(deltas)
+        jitter = sorted(abs(d - mean) for d in deltas)
+        waits = sorted(log[i][3] - log[i][2] for i in rows)
+        stats[mid] = {"period": mean, "jitter": jitter, "waits": waits,
+                      "slot_blocked": sum(1 for i in rows if blocked_by_slot(log, i)),
+                      "count": len(rows)}
+    busy = sum(r[4] - r[3] for r in log) / log[-1][4]
+    return stats, busy
+
+
+def blocked_by_slot(log, i):
+    """True if another node's slotted frame was on the bus while frame i waited."""
+    mid, node, queued = log[i][0], log[i][1], log[i][2]
+    j = i - 1
+    while j >= 0 and log[j][4] > queued:
+        if log[j][0] in SLOTTED and log[j][1] != node:
+            return True
+        j -= 1
+    return False
+
+
+# ---------------------------------------------------------------------
+# Report
+# ---------------------------------------------------------------------
+BINS = [(0, 10e-6), (10e-6, 50e-6), (50e-6, 100e-6), (100e-6, 250e-6), (250e-6, 500e-6),
+        (500e-6, 1e-3), (1e-3, float("inf"))]
+
+
+def pct(values, p):
+    return values[min(len(values) - 1, int(p * len(values)))]
+
+
+def histogram(label, values):
+    print("  %s" % label)
+    for low, high in BINS:
+        n = sum(1 for v in values if low <= v < high)
+        share = n / len(values)
+        name = ">= %4.0f us" % (low * 1e6) if high == float("inf") else \
+               "%4.0f..%4.0f us" % (low * 1e6, high * 1e6)
+        print("    %-14s %6.2f%% %s" % (name, 100 * share, "#" * int(round(50 * share))))
+
+
+def report(mode, stats, busy):
+    print("%s mode (bus load %.1f %%)" % (mode, 100 * busy))
+    print("  %-10s %6s %9s %9s %9s %9s %9s %7s"
+          % ("message", "frames", "period ms", "jit p50", "jit p99", "jit max", "wait max", "vs slot"))
+    for mid in SLOTTED:
+        s = stats[mid]
+        print("  %-10s %6d %9.3f %7.1fus %7.1fus %7.1fus %7.1fus %7d"
+              % (NAMES[mid], s["count"], s["period"] * 1e3, pct(s["jitter"], 0.5) * 1e6,
+                 pct(s["jitter"], 0.99) * 1e6, s["jitter"][-1] * 1e6, s["waits"][-1] * 1e6,
+                 s["slot_blocked"]))
+    all_jitter = sorted(v for s in stats.values() for v in s["jitter"])
+    histogram("inter-arrival jitter at ECU3, all slotted frames:", all_jitter)
+    print()
+    return all_jitter
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Free-running vs time-triggered CAN jitter")
+    parser.add_argument("--duration", type=float, default=60.0, help="simulated seconds per mode")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--matrix", default=MATRIX_H, help="tt_matrix.h to read the slots from")
+    args = parser.parse_args()
+
+    cycle, starts = read_matrix(args.matrix)
+    print("Matrix cycle %.3f ms, slots: %s\n" % (cycle * 1e3, ", ".join(
+        "%s @ %.3f ms" % (NAMES[m], starts[m] * 1e3) for m in SLOTTED)))
+
+    free_stats, free_busy = simulate("free", args.duration, args.seed, cycle, starts)
+    free_jitter = report("free", free_stats, free_busy)
+    tt_stats, tt_busy = simulate("tt", args.duration, args.seed, cycle, starts)
+    tt_jitter = report("tt", tt_stats, tt_busy)
+
+    failed = []
+    if any(s["slot_blocked"] for s in tt_stats.values()):
+        failed.append("a slotted frame waited behind another slotted frame")
+    if tt_jitter[-1] >= free_jitter[-1]:
+        failed.append("tt jitter not below free-running")
+    print("tt vs free: worst jitter %.1f us vs %.1f us, p99 %.1f us vs %.1f us"
+          % (tt_jitter[-1] * 1e6, free_jitter[-1] * 1e6,
+             pct(tt_jitter, 0.99) * 1e6, pct(free_jitter, 0.99) * 1e6))
+    if failed:
+        print("FAIL: " + "; ".join(failed))
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()